@@ -191,6 +191,13 @@ namespace bgfx
 
 	static const uint16_t invalidHandle = UINT16_MAX;
 
+	/// Memory release callback.
+	///
+	/// @param _ptr Pointer to the data passed to `bgfx::makeRef`.
+	/// @param _userData User data passed to `bgfx::makeRef`.
+	///
+	typedef void (*ReleaseFn)(void* _ptr, void* _userData);
+
 	BGFX_HANDLE(DynamicIndexBufferHandle);
 	BGFX_HANDLE(DynamicVertexBufferHandle);
 	BGFX_HANDLE(FrameBufferHandle);
@@ -583,8 +590,16 @@ namespace bgfx
 
 	/// Make reference to data to pass to bgfx. Unlike `bgfx::alloc` this call
 	/// doesn't allocate memory for data. It just copies pointer to data. You
-	/// must make sure data is available for at least 2 `bgfx::frame` calls.
-	const Memory* makeRef(const void* _data, uint32_t _size);
+	/// must make sure data is available for at least 2 `bgfx::frame` calls,
+	/// or until `_releaseFn` is called.
+	///
+	/// @param _data Pointer to data.
+	/// @param _size Size of data.
+	/// @param _releaseFn Callback function called once bgfx is done with the
+	///   data. It may be called from the render thread.
+	/// @param _userData User data passed to `_releaseFn`.
+	///
+	const Memory* makeRef(const void* _data, uint32_t _size, ReleaseFn _releaseFn = NULL, void* _userData = NULL);
 
 	/// Set debug flags.
 	///
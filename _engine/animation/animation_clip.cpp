@@ -0,0 +1,328 @@
+#include "animation/animation_clip.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace monster
+{
+	static const float k_sqrt2 = 1.41421356f;
+	static const float k_quat_max = 32767.0f;
+
+	void packQuaternion(const float quat[4], uint16_t packed[3])
+	{
+		uint32_t largest = 0;
+		for (uint32_t ii = 1; ii < 4; ++ii)
+		{
+			if (fabsf(quat[ii]) > fabsf(quat[largest]))
+			{
+				largest = ii;
+			}
+		}
+
+		// q and -q are the same rotation, so the dropped component is always positive
+		float sign = quat[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint16_t values[3];
+		for (uint32_t ii = 0, jj = 0; ii < 4; ++ii)
+		{
+			if (ii == largest)
+			{
+				continue;
+			}
+
+			// the three smaller components lie within +-1/sqrt(2)
+			float value = quat[ii] * sign * k_sqrt2 * 0.5f + 0.5f;
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			values[jj++] = (uint16_t)(value * k_quat_max + 0.5f);
+		}
+
+		packed[0] = (uint16_t)(((largest >> 1) << 15) | values[0]);
+		packed[1] = (uint16_t)(((largest & 1) << 15) | values[1]);
+		packed[2] = values[2];
+	}
+
+	void unpackQuaternion(const uint16_t packed[3], float quat[4])
+	{
+		uint32_t largest = ((packed[0] >> 15) << 1) | (packed[1] >> 15);
+
+		float values[3];
+		float sum = 0.0f;
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			values[ii] = ((packed[ii] & 0x7fff) / k_quat_max - 0.5f) * k_sqrt2;
+			sum += values[ii] * values[ii];
+		}
+
+		for (uint32_t ii = 0, jj = 0; ii < 4; ++ii)
+		{
+			quat[ii] = ii == largest ? sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f) : values[jj++];
+		}
+	}
+
+	static const BlobArray<AnimationKey>& getStream(const AnimationClip& clip, uint32_t stream)
+	{
+		return k_stream_translation == stream ? clip._translations : (k_stream_rotation == stream ? clip._rotations : clip._scales);
+	}
+
+	bool isValidClip(const AnimationClip& clip)
+	{
+		const uint32_t track_count = clip._track_count;
+		if (0 == clip._frame_count
+			|| !(0.0f < clip._frame_rate)
+			|| clip._translation_ranges.size() < track_count
+			|| clip._scale_ranges.size() < track_count)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> seen(track_count);
+		for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+		{
+			const BlobArray<AnimationKey>& keys = getStream(clip, stream);
+			if (keys.size() < 2 * (uint64_t)track_count)
+			{
+				return false;
+			}
+
+			for (uint32_t ii = 0; ii < keys.size(); ++ii)
+			{
+				if (keys[ii]._track >= track_count)
+				{
+					return false;
+				}
+			}
+
+			// the leading keys are keys 0 and 1 of every track, once each
+			std::fill(seen.begin(), seen.end(), 0);
+			for (uint32_t ii = 0; ii < 2 * track_count; ++ii)
+			{
+				const AnimationKey& key = keys[ii];
+				if (2 == seen[key._track]
+					|| (0 == seen[key._track] && 0 != key._frame))
+				{
+					return false;
+				}
+				++seen[key._track];
+			}
+
+			for (uint8_t count : seen)
+			{
+				if (2 != count)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool loadClip(BlobFile& file, FileSystem* fs, const char* path)
+	{
+		if (!file.load<AnimationClip>(fs, path)
+			|| !isValidClip(*file.get<AnimationClip>()))
+		{
+			file.unload();
+			return false;
+		}
+		return true;
+	}
+
+	// shifts key1 into key0 and decodes key into key1 for the key's track;
+	// without decode only the key times move, which is all the stream walk needs
+	static void pushKey(const AnimationClip& clip, uint32_t stream, const AnimationKey& key, bool decode, SoaTransform& key0, SoaTransform& key1, bx::float4_t* time0, bx::float4_t* time1)
+	{
+		uint32_t lane = key._track & 3;
+
+		setLane(time0[stream], lane, getLane(time1[stream], lane));
+		setLane(time1[stream], lane, (float)key._frame);
+
+		if (!decode)
+		{
+			return;
+		}
+
+		bx::float4_t* src = k_stream_translation == stream ? &key1._tx : (k_stream_rotation == stream ? &key1._qx : &key1._sx);
+		bx::float4_t* dst = k_stream_translation == stream ? &key0._tx : (k_stream_rotation == stream ? &key0._qx : &key0._sx);
+
+		if (k_stream_rotation == stream)
+		{
+			float quat[4];
+			unpackQuaternion(key._value, quat);
+			for (uint32_t ii = 0; ii < 4; ++ii)
+			{
+				setLane(dst[ii], lane, getLane(src[ii], lane));
+				setLane(src[ii], lane, quat[ii]);
+			}
+		}
+		else
+		{
+			const TrackRange& range = k_stream_translation == stream ? clip._translation_ranges[key._track] : clip._scale_ranges[key._track];
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				setLane(dst[ii], lane, getLane(src[ii], lane));
+				setLane(src[ii], lane, range._min[ii] + key._value[ii] * range._step[ii]);
+			}
+		}
+	}
+
+	void ClipSampler::bind(const AnimationClip* clip)
+	{
+		_clip = clip;
+		if (nullptr != clip)
+		{
+			assert(isValidClip(*clip));
+			_groups.resize((clip->_track_count + 3) / 4);
+			_track_limit = clip->_track_count;
+			reset();
+		}
+	}
+
+	void ClipSampler::reset()
+	{
+		const bx::float4_t zero = bx::float4_zero();
+		const bx::float4_t one = bx::float4_splat(1.0f);
+
+		// padding lanes interpolate identity transforms
+		for (Group& group : _groups)
+		{
+			SoaTransform identity = { zero, zero, zero, zero, zero, zero, one, one, one, one };
+			group._key0 = identity;
+			group._key1 = identity;
+			for (uint32_t ii = 0; ii < k_stream_count; ++ii)
+			{
+				group._time0[ii] = zero;
+				group._time1[ii] = zero;
+			}
+		}
+
+		uint32_t track_count = _clip->_track_count;
+		for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+		{
+			const BlobArray<AnimationKey>& keys = getStream(*_clip, stream);
+			for (uint32_t ii = 0; ii < 2 * track_count; ++ii)
+			{
+				const AnimationKey& key = keys[ii];
+				Group& group = _groups[key._track >> 2];
+				pushKey(*_clip, stream, key, key._track < _track_limit, group._key0, group._key1, group._time0, group._time1);
+			}
+			_cursor[stream] = 2 * track_count;
+		}
+
+		_frame = 0.0f;
+	}
+
+	void ClipSampler::advance(uint32_t stream, float frame)
+	{
+		const BlobArray<AnimationKey>& keys = getStream(*_clip, stream);
+		uint32_t cursor = _cursor[stream];
+		uint32_t count = keys.size();
+
+		// keys are ordered by the frame of their predecessor, so the first
+		// key whose predecessor is still ahead ends the walk
+		while (cursor < count)
+		{
+			const AnimationKey& key = keys[cursor];
+			Group& group = _groups[key._track >> 2];
+			if (getLane(group._time1[stream], key._track & 3) > frame)
+			{
+				break;
+			}
+
+			if (key._track < _track_limit)
+			{
+				pushKey(*_clip, stream, key, true, group._key0, group._key1, group._time0, group._time1);
+			}
+			else
+			{
+				// skipped tracks are reset before they're decoded again, so
+				// only the frame the walk stops on has to be kept
+				setLane(group._time1[stream], key._track & 3, (float)key._frame);
+			}
+			++cursor;
+		}
+
+		_cursor[stream] = cursor;
+	}
+
+	void ClipSampler::sample(float time, SoaTransform* output, uint32_t soa_count)
+	{
+		float last_frame = (float)(_clip->_frame_count - 1);
+		float frame = time * _clip->_frame_rate;
+		frame = frame < 0.0f ? 0.0f : (frame > last_frame ? last_frame : frame);
+
+		// tracks that were skipped hold stale keys, so more tracks means starting over
+		uint32_t track_limit = 0 == soa_count || soa_count * 4 > _clip->_track_count ? _clip->_track_count : soa_count * 4;
+		bool is_wider = track_limit > _track_limit;
+		_track_limit = track_limit;
+
+		if (frame < _frame || is_wider)
+		{
+			reset();
+		}
+		_frame = frame;
+
+		for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+		{
+			advance(stream, frame);
+		}
+
+		const bx::float4_t zero = bx::float4_zero();
+		const bx::float4_t one = bx::float4_splat(1.0f);
+		const bx::float4_t epsilon = bx::float4_splat(1e-6f);
+		const bx::float4_t sign_bit = bx::float4_splat(-0.0f);
+		const bx::float4_t current = bx::float4_splat(frame);
+
+		uint32_t group_count = 0 == soa_count || soa_count > _groups.size() ? (uint32_t)_groups.size() : soa_count;
+		for (uint32_t ii = 0; ii < group_count; ++ii)
+		{
+			const Group& group = _groups[ii];
+			const SoaTransform& key0 = group._key0;
+			const SoaTransform& key1 = group._key1;
+			SoaTransform& out = output[ii];
+
+			bx::float4_t alpha[k_stream_count];
+			for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+			{
+				bx::float4_t span = bx::float4_max(bx::float4_sub(group._time1[stream], group._time0[stream]), epsilon);
+				bx::float4_t value = bx::float4_div(bx::float4_sub(current, group._time0[stream]), span);
+				alpha[stream] = bx::float4_min(bx::float4_max(value, zero), one);
+			}
+
+			const bx::float4_t at = alpha[k_stream_translation];
+			out._tx = bx::float4_add(key0._tx, bx::float4_mul(bx::float4_sub(key1._tx, key0._tx), at));
+			out._ty = bx::float4_add(key0._ty, bx::float4_mul(bx::float4_sub(key1._ty, key0._ty), at));
+			out._tz = bx::float4_add(key0._tz, bx::float4_mul(bx::float4_sub(key1._tz, key0._tz), at));
+
+			const bx::float4_t as = alpha[k_stream_scale];
+			out._sx = bx::float4_add(key0._sx, bx::float4_mul(bx::float4_sub(key1._sx, key0._sx), as));
+			out._sy = bx::float4_add(key0._sy, bx::float4_mul(bx::float4_sub(key1._sy, key0._sy), as));
+			out._sz = bx::float4_add(key0._sz, bx::float4_mul(bx::float4_sub(key1._sz, key0._sz), as));
+
+			// nlerp along the shorter arc; packing may have flipped either key's sign
+			bx::float4_t dot = bx::float4_mul(key0._qx, key1._qx);
+			dot = bx::float4_add(dot, bx::float4_mul(key0._qy, key1._qy));
+			dot = bx::float4_add(dot, bx::float4_mul(key0._qz, key1._qz));
+			dot = bx::float4_add(dot, bx::float4_mul(key0._qw, key1._qw));
+			const bx::float4_t flip = bx::float4_and(bx::float4_cmplt(dot, zero), sign_bit);
+
+			const bx::float4_t ar = alpha[k_stream_rotation];
+			bx::float4_t qx = bx::float4_add(key0._qx, bx::float4_mul(bx::float4_sub(bx::float4_xor(key1._qx, flip), key0._qx), ar));
+			bx::float4_t qy = bx::float4_add(key0._qy, bx::float4_mul(bx::float4_sub(bx::float4_xor(key1._qy, flip), key0._qy), ar));
+			bx::float4_t qz = bx::float4_add(key0._qz, bx::float4_mul(bx::float4_sub(bx::float4_xor(key1._qz, flip), key0._qz), ar));
+			bx::float4_t qw = bx::float4_add(key0._qw, bx::float4_mul(bx::float4_sub(bx::float4_xor(key1._qw, flip), key0._qw), ar));
+
+			bx::float4_t length = bx::float4_mul(qx, qx);
+			length = bx::float4_add(length, bx::float4_mul(qy, qy));
+			length = bx::float4_add(length, bx::float4_mul(qz, qz));
+			length = bx::float4_add(length, bx::float4_mul(qw, qw));
+			const bx::float4_t inv_length = bx::float4_div(one, bx::float4_sqrt(length));
+
+			out._qx = bx::float4_mul(qx, inv_length);
+			out._qy = bx::float4_mul(qy, inv_length);
+			out._qz = bx::float4_mul(qz, inv_length);
+			out._qw = bx::float4_mul(qw, inv_length);
+		}
+	}
+}
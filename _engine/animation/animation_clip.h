@@ -0,0 +1,136 @@
+#ifndef __MONSTER_ANIMATION_CLIP_H__
+#define __MONSTER_ANIMATION_CLIP_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "animation/skeleton.h"
+#include "core/serialization/blob_serializer.h"
+
+namespace monster
+{
+	// key streams of a clip, also the order of ClipCompressionStats::_kept_keys
+	enum ClipStream
+	{
+		k_stream_translation,
+		k_stream_rotation,
+		k_stream_scale,
+		k_stream_count
+	};
+
+	// One keyframe of one track. Translations and scales are 16 bit fixed
+	// point within the track's range; rotations are smallest-three
+	// quaternions in 48 bits.
+	struct AnimationKey
+	{
+		uint16_t _frame;
+		uint16_t _track;
+		uint16_t _value[3];
+	};
+
+	struct TrackRange
+	{
+		float _min[3];
+		float _step[3];        // extent / 65535
+	};
+
+	// Compressed clip, one track per skeleton joint, stored as a blob (see
+	// BlobFile) and built offline by compressClip(). Each key stream holds
+	// key 0 of every track, then key 1 of every track, then the remaining
+	// keys ordered by the frame of the key before them in the same track.
+	// That is exactly the order in which a sampler playing forward needs
+	// them, so sampling only ever reads the stream front to back.
+	struct AnimationClip
+	{
+		float _duration;
+		float _frame_rate;
+		uint32_t _frame_count;
+		uint32_t _track_count;
+		BlobArray<TrackRange> _translation_ranges;
+		BlobArray<TrackRange> _scale_ranges;
+		BlobArray<AnimationKey> _translations;
+		BlobArray<AnimationKey> _rotations;
+		BlobArray<AnimationKey> _scales;
+	};
+
+	void packQuaternion(const float quat[4], uint16_t packed[3]);
+	void unpackQuaternion(const uint16_t packed[3], float quat[4]);
+
+	// Checks what ClipSampler trusts: every stream starts with two keys of
+	// every track, the first of them at frame 0, every key names a track of
+	// the clip and the ranges cover all tracks. The order of the remaining
+	// keys isn't checked; a wrong one plays wrong but reads nothing out of
+	// bounds. Clips from disk must pass before they are bound.
+	bool isValidClip(const AnimationClip& clip);
+
+	// Loads a clip blob and checks it; file is left empty on failure.
+	bool loadClip(BlobFile& file, FileSystem* fs, const char* path);
+
+	// Per-instance playback state: the two keys around the current time of
+	// every track, already decoded, plus a cursor into each key stream.
+	// Playing forward decodes each key once; seeking backwards restarts the
+	// streams. Memory is only allocated when a clip with more tracks is bound.
+	class ClipSampler
+	{
+	private:
+		// four tracks; lane ii of every member belongs to the same track
+		struct Group
+		{
+			SoaTransform _key0;
+			SoaTransform _key1;
+			bx::float4_t _time0[3];   // frame of key0, per stream
+			bx::float4_t _time1[3];
+		};
+
+		const AnimationClip* _clip;
+		AlignedVector<Group> _groups;
+		uint32_t _cursor[3];
+		uint32_t _track_limit;     // tracks whose keys are decoded
+		float _frame;
+
+	private:
+		void reset();
+		void advance(uint32_t stream, float frame);
+
+	public:
+		ClipSampler() : _clip(nullptr), _track_limit(0), _frame(0.0f) {}
+
+		ClipSampler(const ClipSampler&) = delete;
+		ClipSampler& operator = (const ClipSampler&) = delete;
+
+		// The clip must pass isValidClip().
+		void bind(const AnimationClip* clip);
+		const AnimationClip* getClip() const { return _clip; }
+
+		// Writes the pose at time (seconds, clamped to the clip) as local
+		// SoA transforms, ready for localToModel(). soa_count limits the
+		// groups written and decoded, e.g. to an animation LOD; 0 writes all
+		// of them. Raising it again restarts the streams once.
+		void sample(float time, SoaTransform* output, uint32_t soa_count = 0);
+	};
+}
+
+MONSTER_REFLECT_BEGIN(monster::AnimationKey)
+	MONSTER_REFLECT_FIELD(_frame)
+	MONSTER_REFLECT_FIELD(_track)
+	MONSTER_REFLECT_FIELD(_value)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::TrackRange)
+	MONSTER_REFLECT_FIELD(_min)
+	MONSTER_REFLECT_FIELD(_step)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::AnimationClip)
+	MONSTER_REFLECT_FIELD(_duration)
+	MONSTER_REFLECT_FIELD(_frame_rate)
+	MONSTER_REFLECT_FIELD(_frame_count)
+	MONSTER_REFLECT_FIELD(_track_count)
+	MONSTER_REFLECT_FIELD(_translation_ranges)
+	MONSTER_REFLECT_FIELD(_scale_ranges)
+	MONSTER_REFLECT_FIELD(_translations)
+	MONSTER_REFLECT_FIELD(_rotations)
+	MONSTER_REFLECT_FIELD(_scales)
+MONSTER_REFLECT_END()
+
+#endif
@@ -0,0 +1,88 @@
+#include "animation/animation_lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <bx/fpumath.h>
+
+namespace monster
+{
+	float getScreenSize(const Sphere& bounds, const float* world, const float* view, const float* proj)
+	{
+		float center[3];
+		float view_center[3];
+		bx::vec3MulMtx(center, bounds.m_center, world);
+		bx::vec3MulMtx(view_center, center, view);
+
+		// largest axis scale of world
+		float scale_sq = 0.0f;
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			const float* row = &world[ii * 4];
+			scale_sq = std::max(scale_sq, row[0] * row[0] + row[1] * row[1] + row[2] * row[2]);
+		}
+		const float radius = bounds.m_radius * sqrtf(scale_sq);
+
+		// orthographic projections have no perspective divide
+		if (0.0f == proj[11])
+		{
+			return radius * proj[5];
+		}
+
+		const float depth = view_center[2];
+		if (depth <= radius)
+		{
+			return 1.0f;
+		}
+
+		return radius * proj[5] / depth;
+	}
+
+	void AnimationLod::addLevel(const AnimationLodLevel& level)
+	{
+		_levels.push_back(level);
+		std::stable_sort(_levels.begin(), _levels.end(), [](const AnimationLodLevel& a, const AnimationLodLevel& b)
+		{
+			return a._min_screen_size > b._min_screen_size;
+		});
+	}
+
+	uint32_t AnimationLod::selectLevel(float screen_size, uint32_t current) const
+	{
+		if (_levels.empty())
+		{
+			return 0;
+		}
+
+		uint32_t last = (uint32_t)_levels.size() - 1;
+		uint32_t level = 0;
+		while (level < last && screen_size < _levels[level]._min_screen_size)
+		{
+			++level;
+		}
+
+		// coarser levels apply at once, finer ones only past the hysteresis band
+		current = current > last ? last : current;
+		for (uint32_t ii = level; ii < current; ++ii)
+		{
+			if (screen_size >= _levels[ii]._min_screen_size * (1.0f + _hysteresis))
+			{
+				return ii;
+			}
+		}
+
+		return std::max(level, current);
+	}
+
+	void AnimationLod::apply(BlendTreeInstance& instance, float screen_size) const
+	{
+		if (_levels.empty())
+		{
+			return;
+		}
+
+		uint32_t level = selectLevel(screen_size, instance.getLodLevel());
+		const AnimationLodLevel& lod = _levels[level];
+		instance.setLod((uint8_t)level, lod._joint_count, lod._update_interval, lod._interpolate, lod._dominant_only);
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef __MONSTER_ANIMATION_LOD_H__
+#define __MONSTER_ANIMATION_LOD_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+
+#include "animation/blend_tree.h"
+
+namespace monster
+{
+	struct AnimationLodLevel
+	{
+		float _min_screen_size;     // used while the bounds cover at least this fraction of the viewport height
+		uint32_t _joint_count;      // animated joints, see BlendTreeInstance::setLod(); 0 means all
+		uint8_t _update_interval;   // evaluate every n-th update
+		bool _interpolate;          // blend skipped updates instead of holding the last pose
+		bool _dominant_only;        // one clip per character, see BlendTreeInstance::setLod()
+	};
+
+	// Fraction of the viewport height covered by bounds (e.g. from
+	// calcMaxBoundingSphere() over the bind pose mesh) placed by world and
+	// seen through view and proj, all bx row-vector matrices. Bounds around
+	// the camera count as covering the whole view.
+	float getScreenSize(const Sphere& bounds, const float* world, const float* view, const float* proj);
+
+	// Picks an animation LOD per character from its screen size. Joint counts
+	// are prefixes of the skeleton, so skeletons should order the joints a
+	// coarse level drops (fingers, face) after the ones it keeps.
+	class AnimationLod
+	{
+	private:
+		std::vector<AnimationLodLevel> _levels;    // finest first
+		float _hysteresis;
+
+	public:
+		AnimationLod() : _hysteresis(0.1f) {}
+
+		void addLevel(const AnimationLodLevel& level);
+		uint32_t getLevelCount() const { return (uint32_t)_levels.size(); }
+		const AnimationLodLevel& getLevel(uint32_t level) const { return _levels[level]; }
+
+		// Moving to a finer level needs the screen size to pass its threshold
+		// by this fraction, so characters near a threshold don't flip every frame.
+		void setHysteresis(float hysteresis) { _hysteresis = hysteresis; }
+
+		uint32_t selectLevel(float screen_size, uint32_t current) const;
+
+		// Selects the level for screen_size and applies it to instance.
+		void apply(BlendTreeInstance& instance, float screen_size) const;
+	};
+}
+
+#endif
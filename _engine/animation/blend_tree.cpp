@@ -0,0 +1,494 @@
+#include "animation/blend_tree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#include "core/job/job_system.h"
+
+namespace monster
+{
+	static float saturate(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	}
+
+	uint16_t BlendTree::addNode(const Node& node)
+	{
+		assert(_nodes.size() < 0xffff);
+		_nodes.push_back(node);
+		_root = (uint16_t)(_nodes.size() - 1);
+		return _root;
+	}
+
+	uint16_t BlendTree::addParameter(float default_value)
+	{
+		_defaults.push_back(default_value);
+		return (uint16_t)(_defaults.size() - 1);
+	}
+
+	uint16_t BlendTree::addClip(const AnimationClip* clip, float speed, bool loop)
+	{
+		Clip entry;
+		entry._clip = clip;
+		entry._speed = speed;
+		entry._loop = loop;
+		_clips.push_back(entry);
+
+		Node node = {};
+		node._type = BlendNodeType::Clip;
+		node._clip = (uint16_t)(_clips.size() - 1);
+		return addNode(node);
+	}
+
+	uint16_t BlendTree::addLerp(uint16_t a, uint16_t b, uint16_t weight_param, const LayerMask* mask)
+	{
+		assert(a < _nodes.size() && b < _nodes.size() && weight_param < _defaults.size());
+
+		// a is evaluated straight into the output, b needs a scratch pose
+		Node node = {};
+		node._type = BlendNodeType::Lerp;
+		node._input[0] = a;
+		node._input[1] = b;
+		node._param[0] = weight_param;
+		node._mask = mask;
+		node._depth = (uint16_t)std::max<uint32_t>(_nodes[a]._depth, _nodes[b]._depth + 1u);
+		return addNode(node);
+	}
+
+	uint16_t BlendTree::addAdditive(uint16_t base, uint16_t additive, uint16_t weight_param, const LayerMask* mask)
+	{
+		uint16_t index = addLerp(base, additive, weight_param, mask);
+		_nodes[index]._type = BlendNodeType::Additive;
+		return index;
+	}
+
+	uint16_t BlendTree::addBlendSpace1D(const uint16_t* inputs, const float* positions, uint32_t count, uint16_t param)
+	{
+		assert(0 < count && count <= k_max_blend_samples && param < _defaults.size());
+
+		Node node = {};
+		node._type = BlendNodeType::BlendSpace1D;
+		node._param[0] = param;
+		node._first_sample = (uint16_t)_samples.size();
+		node._sample_count = (uint16_t)count;
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			assert(inputs[ii] < _nodes.size());
+			Sample sample;
+			sample._node = inputs[ii];
+			sample._position[0] = positions[ii];
+			sample._position[1] = 0.0f;
+			_samples.push_back(sample);
+			node._depth = (uint16_t)std::max<uint32_t>(node._depth, _nodes[inputs[ii]]._depth + 1u);
+		}
+
+		std::sort(_samples.begin() + node._first_sample, _samples.end(), [](const Sample& a, const Sample& b)
+		{
+			return a._position[0] < b._position[0];
+		});
+
+		return addNode(node);
+	}
+
+	uint16_t BlendTree::addBlendSpace2D(const uint16_t* inputs, const float* positions, uint32_t count, uint16_t param_x, uint16_t param_y)
+	{
+		assert(0 < count && count <= k_max_blend_samples && param_x < _defaults.size() && param_y < _defaults.size());
+
+		// every input is evaluated into scratch and summed into the output
+		Node node = {};
+		node._type = BlendNodeType::BlendSpace2D;
+		node._param[0] = param_x;
+		node._param[1] = param_y;
+		node._first_sample = (uint16_t)_samples.size();
+		node._sample_count = (uint16_t)count;
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			assert(inputs[ii] < _nodes.size());
+			Sample sample;
+			sample._node = inputs[ii];
+			sample._position[0] = positions[ii * 2];
+			sample._position[1] = positions[ii * 2 + 1];
+			_samples.push_back(sample);
+			node._depth = (uint16_t)std::max<uint32_t>(node._depth, _nodes[inputs[ii]]._depth + 1u);
+		}
+
+		return addNode(node);
+	}
+
+	void BlendTreeInstance::create(const BlendTree* tree, const Skeleton* skeleton)
+	{
+		destroy();
+
+		_tree = tree;
+		_skeleton = skeleton;
+
+		uint32_t clip_count = tree->getClipCount();
+		_samplers = new ClipSampler[clip_count];
+		for (uint32_t ii = 0; ii < clip_count; ++ii)
+		{
+			_samplers[ii].bind(tree->getClip(ii)._clip);
+		}
+		_times.assign(clip_count, 0.0f);
+
+		_params.resize(tree->getParameterCount());
+		for (uint32_t ii = 0; ii < tree->getParameterCount(); ++ii)
+		{
+			_params[ii] = tree->getDefault(ii);
+		}
+
+		_previous.assign(skeleton->getBindPose(), skeleton->getBindPose() + skeleton->getSoaCount());
+		_current = _previous;
+		_local = _previous;
+		_model.resize(skeleton->getJointCount());
+
+		// spreads the sparse updates of characters created together over frames
+		static std::atomic<uint32_t> s_next_phase(0);
+		_phase = s_next_phase++;
+
+		_pending_dt = 0.0f;
+		_joint_count = skeleton->getJointCount();
+		_soa_count = skeleton->getSoaCount();
+		_lod_level = 0;
+		_update_interval = 1;
+		_countdown = 0;
+		_interpolate = false;
+		_dominant_only = false;
+		_has_previous = false;
+	}
+
+	void BlendTreeInstance::destroy()
+	{
+		delete [] _samplers;
+		_samplers = nullptr;
+		_tree = nullptr;
+		_skeleton = nullptr;
+		_times.clear();
+		_params.clear();
+		_previous.clear();
+		_current.clear();
+		_local.clear();
+		_model.clear();
+	}
+
+	void BlendTreeInstance::setLod(uint8_t level, uint32_t joint_count, uint8_t update_interval, bool interpolate, bool dominant_only)
+	{
+		joint_count = 0 == joint_count || joint_count > _skeleton->getJointCount() ? _skeleton->getJointCount() : joint_count;
+		update_interval = 0 == update_interval ? 1 : update_interval;
+
+		if (joint_count != _joint_count)
+		{
+			_joint_count = joint_count;
+			_soa_count = (joint_count + 3) / 4;
+			_countdown = 0;
+			_has_previous = false;
+		}
+
+		if (update_interval != _update_interval)
+		{
+			_update_interval = update_interval;
+			_countdown = (uint8_t)(_countdown < update_interval ? _countdown : _phase % update_interval);
+		}
+
+		_lod_level = level;
+		_interpolate = interpolate;
+		_dominant_only = dominant_only;
+	}
+
+	uint32_t BlendTreeInstance::getScratchSize() const
+	{
+		return _tree->getScratchCount() * _skeleton->getSoaCount();
+	}
+
+	void BlendTreeInstance::evaluate(uint16_t index, SoaTransform* output, SoaTransform* scratch)
+	{
+		const BlendTree::Node& node = _tree->getNode(index);
+		const uint32_t soa_count = _soa_count;
+		SoaTransform* next_scratch = scratch + soa_count;
+
+		switch (node._type)
+		{
+		case BlendNodeType::Clip:
+			_samplers[node._clip].sample(_times[node._clip], output, soa_count);
+			break;
+
+		case BlendNodeType::Lerp:
+		case BlendNodeType::Additive:
+		{
+			float weight = saturate(_params[node._param[0]]);
+			const bool is_additive = BlendNodeType::Additive == node._type;
+			if (_dominant_only)
+			{
+				weight = is_additive || nullptr != node._mask || 0.5f > weight ? 0.0f : 1.0f;
+			}
+
+			if (!is_additive && 1.0f <= weight && nullptr == node._mask)
+			{
+				evaluate(node._input[1], output, scratch);
+				break;
+			}
+
+			evaluate(node._input[0], output, scratch);
+			if (0.0f >= weight)
+			{
+				break;
+			}
+
+			const float* mask = nullptr != node._mask ? node._mask->getWeights() : nullptr;
+			evaluate(node._input[1], scratch, next_scratch);
+			if (is_additive)
+			{
+				addPose(output, scratch, weight, mask, soa_count, output);
+			}
+			else
+			{
+				blendPoses(output, scratch, weight, mask, soa_count, output);
+			}
+			break;
+		}
+
+		case BlendNodeType::BlendSpace1D:
+		{
+			const BlendTree::Sample* samples = &_tree->getSample(node._first_sample);
+			const float value = _params[node._param[0]];
+
+			uint32_t last = node._sample_count - 1;
+			uint32_t lower = 0;
+			while (lower < last && samples[lower + 1]._position[0] <= value)
+			{
+				++lower;
+			}
+
+			float alpha = 0.0f;
+			if (lower < last)
+			{
+				const float extent = samples[lower + 1]._position[0] - samples[lower]._position[0];
+				alpha = 0.0f < extent ? saturate((value - samples[lower]._position[0]) / extent) : 0.0f;
+			}
+
+			if (_dominant_only)
+			{
+				lower = 0.5f > alpha ? lower : lower + 1;
+				alpha = 0.0f;
+			}
+
+			evaluate(samples[lower]._node, output, scratch);
+			if (0.0f < alpha)
+			{
+				evaluate(samples[lower + 1]._node, scratch, next_scratch);
+				blendPoses(output, scratch, alpha, nullptr, soa_count, output);
+			}
+			break;
+		}
+
+		case BlendNodeType::BlendSpace2D:
+		{
+			const BlendTree::Sample* samples = &_tree->getSample(node._first_sample);
+			const float px = _params[node._param[0]];
+			const float py = _params[node._param[1]];
+
+			// gradient bands: each sample's weight falls off linearly towards
+			// every other sample, the smallest falloff wins
+			float weights[BlendTree::k_max_blend_samples];
+			float total = 0.0f;
+			for (uint32_t ii = 0; ii < node._sample_count; ++ii)
+			{
+				const float ox = px - samples[ii]._position[0];
+				const float oy = py - samples[ii]._position[1];
+
+				float weight = 1.0f;
+				for (uint32_t jj = 0; jj < node._sample_count && 0.0f < weight; ++jj)
+				{
+					const float dx = samples[jj]._position[0] - samples[ii]._position[0];
+					const float dy = samples[jj]._position[1] - samples[ii]._position[1];
+					const float length_sq = dx * dx + dy * dy;
+					if (ii != jj && 0.0f < length_sq)
+					{
+						weight = std::min(weight, saturate(1.0f - (ox * dx + oy * dy) / length_sq));
+					}
+				}
+
+				weights[ii] = weight;
+				total += weight;
+			}
+
+			if (0.0f >= total)
+			{
+				weights[0] = 1.0f;
+				total = 1.0f;
+			}
+
+			if (_dominant_only)
+			{
+				uint32_t dominant = 0;
+				for (uint32_t ii = 1; ii < node._sample_count; ++ii)
+				{
+					dominant = weights[ii] > weights[dominant] ? ii : dominant;
+				}
+
+				evaluate(samples[dominant]._node, output, scratch);
+				break;
+			}
+
+			bool is_first = true;
+			for (uint32_t ii = 0; ii < node._sample_count; ++ii)
+			{
+				if (0.0f < weights[ii])
+				{
+					evaluate(samples[ii]._node, scratch, next_scratch);
+					accumulatePose(scratch, weights[ii] / total, soa_count, is_first, output);
+					is_first = false;
+				}
+			}
+			normalizePose(soa_count, output);
+			break;
+		}
+		}
+	}
+
+	void BlendTreeInstance::advanceClips(float dt)
+	{
+		for (uint32_t ii = 0; ii < _tree->getClipCount(); ++ii)
+		{
+			const BlendTree::Clip& clip = _tree->getClip(ii);
+			const float duration = clip._clip->_duration;
+			float time = _times[ii] + dt * clip._speed;
+
+			if (clip._loop && 0.0f < duration)
+			{
+				time = fmodf(time, duration);
+				time = 0.0f > time ? time + duration : time;
+			}
+			else
+			{
+				time = time < 0.0f ? 0.0f : (time > duration ? duration : time);
+			}
+			_times[ii] = time;
+		}
+	}
+
+	void BlendTreeInstance::update(float dt, SoaTransform* scratch)
+	{
+		_pending_dt += dt;
+
+		if (0 == _countdown)
+		{
+			advanceClips(_pending_dt);
+			_pending_dt = 0.0f;
+			_countdown = _update_interval - 1;
+
+			_current.swap(_previous);
+			evaluate(_tree->getRoot(), &_current[0], scratch);
+			if (!_has_previous)
+			{
+				std::copy(_current.begin(), _current.begin() + _soa_count, _previous.begin());
+				_has_previous = true;
+			}
+		}
+		else
+		{
+			--_countdown;
+			if (!_interpolate)
+			{
+				return;
+			}
+		}
+
+		const SoaTransform* pose = &_current[0];
+		if (_interpolate && 1 < _update_interval)
+		{
+			// reaches the evaluated pose on the update before the next evaluation
+			const float alpha = (float)(_update_interval - _countdown) / (float)_update_interval;
+			blendPoses(&_previous[0], &_current[0], alpha, nullptr, _soa_count, &_local[0]);
+			pose = &_local[0];
+		}
+
+		localToModel(*_skeleton, pose, &_model[0], _joint_count);
+		if (_joint_count < _skeleton->getJointCount())
+		{
+			bindPoseToModel(*_skeleton, &_model[0], _joint_count);
+		}
+	}
+
+	void BlendTreeEvaluator::initialize(JobSystem* job_system)
+	{
+		_job_system = job_system;
+
+		// a few jobs per thread so uneven characters still balance
+		uint32_t thread_count = nullptr != job_system ? job_system->getWorkerCount() + 1 : 1;
+		_slot_count = thread_count * 4;
+		_slot_size = 0;
+		_pool.clear();
+	}
+
+	void BlendTreeEvaluator::shutdown()
+	{
+		_job_system = nullptr;
+		_pool.clear();
+		_slot_size = 0;
+		_slot_count = 0;
+	}
+
+	void BlendTreeEvaluator::reserve(const BlendTreeInstance& instance)
+	{
+		uint32_t size = instance.getScratchSize();
+		if (size > _slot_size)
+		{
+			_slot_size = size;
+			_pool.resize((size_t)_slot_size * _slot_count);
+		}
+	}
+
+	struct BlendTreeJob
+	{
+		BlendTreeInstance* const* _instances;
+		SoaTransform* _pool;
+		uint32_t _slot_size;
+		uint32_t _grain;
+		float _dt;
+	};
+
+	static void updateInstances(void* data, uint32_t begin, uint32_t end)
+	{
+		const BlendTreeJob& job = *(const BlendTreeJob*)data;
+		SoaTransform* scratch = job._pool + (size_t)(begin / job._grain) * job._slot_size;
+
+		for (uint32_t ii = begin; ii < end; ++ii)
+		{
+			job._instances[ii]->update(job._dt, scratch);
+		}
+	}
+
+	void BlendTreeEvaluator::update(BlendTreeInstance* const* instances, uint32_t count, float dt)
+	{
+		if (0 == count)
+		{
+			return;
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			reserve(*instances[ii]);
+		}
+
+		BlendTreeJob job;
+		job._instances = instances;
+		job._pool = _pool.empty() ? nullptr : &_pool[0];
+		job._slot_size = _slot_size;
+		job._grain = (count + _slot_count - 1) / _slot_count;
+		job._dt = dt;
+
+		if (nullptr == _job_system)
+		{
+			updateInstances(&job, 0, count);
+			return;
+		}
+
+		JobCounter counter;
+		_job_system->parallelFor(count, job._grain, updateInstances, &job, counter);
+		_job_system->wait(counter);
+	}
+}
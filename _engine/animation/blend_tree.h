@@ -0,0 +1,223 @@
+#ifndef __MONSTER_BLEND_TREE_H__
+#define __MONSTER_BLEND_TREE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "animation/animation_clip.h"
+#include "animation/blending.h"
+#include "core/memory/aligned_allocator.h"
+
+namespace monster
+{
+	class JobSystem;
+
+	enum class BlendNodeType : uint8_t
+	{
+		Clip,
+		Lerp,
+		Additive,
+		BlendSpace1D,
+		BlendSpace2D
+	};
+
+	// Shared, immutable once built, graph definition. Nodes may only take
+	// earlier nodes as inputs, so the graph is acyclic by construction. Any
+	// number of BlendTreeInstances can play the same tree.
+	class BlendTree
+	{
+	public:
+		static const uint32_t k_max_blend_samples = 16;
+
+		struct Node
+		{
+			BlendNodeType _type;
+			uint16_t _input[2];          // Lerp a/b, Additive base/additive
+			uint16_t _param[2];
+			uint16_t _clip;              // Clip: index into the clip list
+			uint16_t _first_sample;      // blend spaces
+			uint16_t _sample_count;
+			uint16_t _depth;             // scratch poses needed to evaluate the subtree
+			const LayerMask* _mask;
+		};
+
+		struct Sample
+		{
+			uint16_t _node;
+			float _position[2];
+		};
+
+		struct Clip
+		{
+			const AnimationClip* _clip;
+			float _speed;
+			bool _loop;
+		};
+
+	private:
+		std::vector<Node> _nodes;
+		std::vector<Sample> _samples;
+		std::vector<Clip> _clips;
+		std::vector<float> _defaults;
+		uint16_t _root;
+
+	private:
+		uint16_t addNode(const Node& node);
+
+	public:
+		BlendTree() : _root(0) {}
+
+		BlendTree(const BlendTree&) = delete;
+		BlendTree& operator = (const BlendTree&) = delete;
+
+		uint16_t addParameter(float default_value);
+
+		uint16_t addClip(const AnimationClip* clip, float speed = 1.0f, bool loop = true);
+
+		// Blends from a to b by the weight parameter, per joint scaled by mask
+		// when one is given (a layer: mask 1 joints follow b, mask 0 stay a).
+		uint16_t addLerp(uint16_t a, uint16_t b, uint16_t weight_param, const LayerMask* mask = nullptr);
+
+		// additive must produce deltas from makeAdditivePose().
+		uint16_t addAdditive(uint16_t base, uint16_t additive, uint16_t weight_param, const LayerMask* mask = nullptr);
+
+		// Blends the two inputs around the parameter value, clamped to the ends.
+		uint16_t addBlendSpace1D(const uint16_t* inputs, const float* positions, uint32_t count, uint16_t param);
+
+		// positions holds x, y pairs; weights come from gradient band
+		// interpolation, so each input gets full weight at its position.
+		uint16_t addBlendSpace2D(const uint16_t* inputs, const float* positions, uint32_t count, uint16_t param_x, uint16_t param_y);
+
+		void setRoot(uint16_t node) { _root = node; }
+		uint16_t getRoot() const { return _root; }
+
+		const Node& getNode(uint16_t node) const { return _nodes[node]; }
+		const Sample& getSample(uint32_t sample) const { return _samples[sample]; }
+		const Clip& getClip(uint32_t clip) const { return _clips[clip]; }
+		uint32_t getClipCount() const { return (uint32_t)_clips.size(); }
+		uint32_t getParameterCount() const { return (uint32_t)_defaults.size(); }
+		float getDefault(uint32_t param) const { return _defaults[param]; }
+
+		// Scratch poses an evaluation of the root needs, besides the output.
+		uint32_t getScratchCount() const { return _nodes.empty() ? 0 : _nodes[_root]._depth; }
+	};
+
+	// Per-character playback state: parameters, clip times and samplers,
+	// and the resulting local pose and model matrices. All storage is
+	// allocated by create().
+	//
+	// An animation LOD (see AnimationLod) can limit evaluation to the first
+	// joints of the skeleton and to every n-th update. Skipped updates
+	// either keep the last model matrices or interpolate between the last
+	// two evaluated poses, which shows the animation up to n - 1 updates late.
+	class BlendTreeInstance
+	{
+	private:
+		const BlendTree* _tree;
+		const Skeleton* _skeleton;
+		ClipSampler* _samplers;
+		std::vector<float> _times;
+		std::vector<float> _params;
+		AlignedVector<SoaTransform> _previous;
+		AlignedVector<SoaTransform> _current;
+		AlignedVector<SoaTransform> _local;
+		AlignedVector<bx::float4x4_t> _model;
+		float _pending_dt;
+		uint32_t _joint_count;
+		uint32_t _soa_count;
+		uint32_t _phase;
+		uint8_t _lod_level;
+		uint8_t _update_interval;
+		uint8_t _countdown;
+		bool _interpolate;
+		bool _dominant_only;
+		bool _has_previous;
+
+	private:
+		void evaluate(uint16_t node, SoaTransform* output, SoaTransform* scratch);
+		void advanceClips(float dt);
+
+	public:
+		BlendTreeInstance()
+			: _tree(nullptr)
+			, _skeleton(nullptr)
+			, _samplers(nullptr)
+			, _pending_dt(0.0f)
+			, _joint_count(0)
+			, _soa_count(0)
+			, _phase(0)
+			, _lod_level(0)
+			, _update_interval(1)
+			, _countdown(0)
+			, _interpolate(false)
+			, _dominant_only(false)
+			, _has_previous(false)
+		{
+		}
+		~BlendTreeInstance() { destroy(); }
+
+		BlendTreeInstance(const BlendTreeInstance&) = delete;
+		BlendTreeInstance& operator = (const BlendTreeInstance&) = delete;
+
+		void create(const BlendTree* tree, const Skeleton* skeleton);
+		void destroy();
+
+		const BlendTree* getTree() const { return _tree; }
+		const Skeleton* getSkeleton() const { return _skeleton; }
+
+		void setParameter(uint16_t param, float value) { _params[param] = value; }
+		float getParameter(uint16_t param) const { return _params[param]; }
+
+		void setTime(uint32_t clip, float time) { _times[clip] = time; }
+		float getTime(uint32_t clip) const { return _times[clip]; }
+
+		// joint_count 0 animates every joint, the rest follow their parent in
+		// bind pose. update_interval is in calls to update(). Changing the
+		// joint count forces an evaluation on the next update. dominant_only
+		// evaluates just the most weighted input of every blend and drops
+		// masked and additive layers, so only one clip is sampled.
+		void setLod(uint8_t level, uint32_t joint_count, uint8_t update_interval, bool interpolate, bool dominant_only = false);
+		uint8_t getLodLevel() const { return _lod_level; }
+
+		// Scratch SoaTransforms update() needs.
+		uint32_t getScratchSize() const;
+
+		// Advances the clips by dt and, unless the LOD skips this update,
+		// evaluates the tree into the local pose and model matrices. Doesn't
+		// allocate.
+		void update(float dt, SoaTransform* scratch);
+
+		// Last evaluated local pose; joints past the LOD's count are stale.
+		const SoaTransform* getLocalPose() const { return &_current[0]; }
+		const bx::float4x4_t* getModelMatrices() const { return &_model[0]; }
+	};
+
+	// Updates many instances as jobs. Scratch poses come from a pool with one
+	// slot per job, so evaluation allocates nothing once the pool has grown
+	// to fit the largest tree and skeleton it has seen.
+	class BlendTreeEvaluator
+	{
+	private:
+		JobSystem* _job_system;
+		AlignedVector<SoaTransform> _pool;
+		uint32_t _slot_size;
+		uint32_t _slot_count;
+
+	public:
+		BlendTreeEvaluator() : _job_system(nullptr), _slot_size(0), _slot_count(0) {}
+
+		BlendTreeEvaluator(const BlendTreeEvaluator&) = delete;
+		BlendTreeEvaluator& operator = (const BlendTreeEvaluator&) = delete;
+
+		// job_system nullptr evaluates on the calling thread.
+		void initialize(JobSystem* job_system);
+		void shutdown();
+
+		// Grows the pool ahead of time, e.g. when loading a character.
+		void reserve(const BlendTreeInstance& instance);
+
+		void update(BlendTreeInstance* const* instances, uint32_t count, float dt);
+	};
+}
+
+#endif
@@ -0,0 +1,215 @@
+#include "animation/blending.h"
+
+namespace monster
+{
+	void LayerMask::create(const Skeleton& skeleton, float weight)
+	{
+		_weights.assign(skeleton.getSoaCount() * 4, weight);
+	}
+
+	void LayerMask::setJointWeight(uint32_t joint, float weight)
+	{
+		_weights[joint] = weight;
+	}
+
+	void LayerMask::setSubtreeWeight(const Skeleton& skeleton, uint32_t joint, float weight)
+	{
+		// parents come first, so one pass from joint onwards finds the whole subtree
+		std::vector<uint8_t> is_inside(skeleton.getJointCount(), 0);
+		const int16_t* parents = skeleton.getParents();
+
+		is_inside[joint] = 1;
+		setJointWeight(joint, weight);
+		for (uint32_t ii = joint + 1; ii < skeleton.getJointCount(); ++ii)
+		{
+			if (Skeleton::k_no_parent != parents[ii] && is_inside[parents[ii]])
+			{
+				is_inside[ii] = 1;
+				setJointWeight(ii, weight);
+			}
+		}
+	}
+
+	static bx::float4_t lerp(bx::float4_t a, bx::float4_t b, bx::float4_t alpha)
+	{
+		return bx::float4_add(a, bx::float4_mul(bx::float4_sub(b, a), alpha));
+	}
+
+	static bx::float4_t dot4(bx::float4_t ax, bx::float4_t ay, bx::float4_t az, bx::float4_t aw, bx::float4_t bx_, bx::float4_t by, bx::float4_t bz, bx::float4_t bw)
+	{
+		bx::float4_t dot = bx::float4_mul(ax, bx_);
+		dot = bx::float4_add(dot, bx::float4_mul(ay, by));
+		dot = bx::float4_add(dot, bx::float4_mul(az, bz));
+		return bx::float4_add(dot, bx::float4_mul(aw, bw));
+	}
+
+	static void normalizeQuat(bx::float4_t& qx, bx::float4_t& qy, bx::float4_t& qz, bx::float4_t& qw)
+	{
+		const bx::float4_t length = bx::float4_sqrt(dot4(qx, qy, qz, qw, qx, qy, qz, qw));
+		const bx::float4_t inv_length = bx::float4_div(bx::float4_splat(1.0f), length);
+		qx = bx::float4_mul(qx, inv_length);
+		qy = bx::float4_mul(qy, inv_length);
+		qz = bx::float4_mul(qz, inv_length);
+		qw = bx::float4_mul(qw, inv_length);
+	}
+
+	// sign bits of the lanes where a and b lie in opposite hemispheres
+	static bx::float4_t getFlip(const SoaTransform& a, const SoaTransform& b)
+	{
+		const bx::float4_t dot = dot4(a._qx, a._qy, a._qz, a._qw, b._qx, b._qy, b._qz, b._qw);
+		return bx::float4_and(bx::float4_cmplt(dot, bx::float4_zero()), bx::float4_splat(-0.0f));
+	}
+
+	static bx::float4_t getAlpha(float weight, const float* mask, uint32_t index)
+	{
+		const bx::float4_t alpha = bx::float4_splat(weight);
+		if (nullptr == mask)
+		{
+			return alpha;
+		}
+
+		const float* lanes = mask + index * 4;
+		return bx::float4_mul(alpha, bx::float4_ld(lanes[0], lanes[1], lanes[2], lanes[3]));
+	}
+
+	void blendPoses(const SoaTransform* a, const SoaTransform* b, float weight, const float* mask, uint32_t soa_count, SoaTransform* out)
+	{
+		for (uint32_t ii = 0; ii < soa_count; ++ii)
+		{
+			const SoaTransform& pa = a[ii];
+			const SoaTransform& pb = b[ii];
+			const bx::float4_t alpha = getAlpha(weight, mask, ii);
+			const bx::float4_t flip = getFlip(pa, pb);
+
+			SoaTransform result;
+			result._tx = lerp(pa._tx, pb._tx, alpha);
+			result._ty = lerp(pa._ty, pb._ty, alpha);
+			result._tz = lerp(pa._tz, pb._tz, alpha);
+			result._qx = lerp(pa._qx, bx::float4_xor(pb._qx, flip), alpha);
+			result._qy = lerp(pa._qy, bx::float4_xor(pb._qy, flip), alpha);
+			result._qz = lerp(pa._qz, bx::float4_xor(pb._qz, flip), alpha);
+			result._qw = lerp(pa._qw, bx::float4_xor(pb._qw, flip), alpha);
+			result._sx = lerp(pa._sx, pb._sx, alpha);
+			result._sy = lerp(pa._sy, pb._sy, alpha);
+			result._sz = lerp(pa._sz, pb._sz, alpha);
+			normalizeQuat(result._qx, result._qy, result._qz, result._qw);
+
+			out[ii] = result;
+		}
+	}
+
+	// a * b, four quaternions at once
+	static void mulQuat(bx::float4_t ax, bx::float4_t ay, bx::float4_t az, bx::float4_t aw,
+		bx::float4_t bx_, bx::float4_t by, bx::float4_t bz, bx::float4_t bw,
+		bx::float4_t& rx, bx::float4_t& ry, bx::float4_t& rz, bx::float4_t& rw)
+	{
+		rx = bx::float4_add(bx::float4_add(bx::float4_mul(aw, bx_), bx::float4_mul(ax, bw)), bx::float4_sub(bx::float4_mul(ay, bz), bx::float4_mul(az, by)));
+		ry = bx::float4_add(bx::float4_sub(bx::float4_mul(aw, by), bx::float4_mul(ax, bz)), bx::float4_add(bx::float4_mul(ay, bw), bx::float4_mul(az, bx_)));
+		rz = bx::float4_add(bx::float4_add(bx::float4_mul(aw, bz), bx::float4_mul(ax, by)), bx::float4_sub(bx::float4_mul(az, bw), bx::float4_mul(ay, bx_)));
+		rw = bx::float4_sub(bx::float4_sub(bx::float4_mul(aw, bw), bx::float4_mul(ax, bx_)), bx::float4_add(bx::float4_mul(ay, by), bx::float4_mul(az, bz)));
+	}
+
+	void addPose(const SoaTransform* base, const SoaTransform* additive, float weight, const float* mask, uint32_t soa_count, SoaTransform* out)
+	{
+		const bx::float4_t zero = bx::float4_zero();
+		const bx::float4_t one = bx::float4_splat(1.0f);
+
+		for (uint32_t ii = 0; ii < soa_count; ++ii)
+		{
+			const SoaTransform& pb = base[ii];
+			const SoaTransform& pa = additive[ii];
+			const bx::float4_t alpha = getAlpha(weight, mask, ii);
+
+			// scale the delta rotation by nlerp from identity, on the identity's side
+			const bx::float4_t flip = bx::float4_and(bx::float4_cmplt(pa._qw, zero), bx::float4_splat(-0.0f));
+			bx::float4_t dx = bx::float4_mul(bx::float4_xor(pa._qx, flip), alpha);
+			bx::float4_t dy = bx::float4_mul(bx::float4_xor(pa._qy, flip), alpha);
+			bx::float4_t dz = bx::float4_mul(bx::float4_xor(pa._qz, flip), alpha);
+			bx::float4_t dw = lerp(one, bx::float4_xor(pa._qw, flip), alpha);
+			normalizeQuat(dx, dy, dz, dw);
+
+			SoaTransform result;
+			mulQuat(pb._qx, pb._qy, pb._qz, pb._qw, dx, dy, dz, dw, result._qx, result._qy, result._qz, result._qw);
+			result._tx = bx::float4_add(pb._tx, bx::float4_mul(pa._tx, alpha));
+			result._ty = bx::float4_add(pb._ty, bx::float4_mul(pa._ty, alpha));
+			result._tz = bx::float4_add(pb._tz, bx::float4_mul(pa._tz, alpha));
+			result._sx = bx::float4_mul(pb._sx, lerp(one, pa._sx, alpha));
+			result._sy = bx::float4_mul(pb._sy, lerp(one, pa._sy, alpha));
+			result._sz = bx::float4_mul(pb._sz, lerp(one, pa._sz, alpha));
+
+			out[ii] = result;
+		}
+	}
+
+	void makeAdditivePose(const SoaTransform* reference, const SoaTransform* pose, uint32_t soa_count, SoaTransform* out)
+	{
+		const bx::float4_t sign_bit = bx::float4_splat(-0.0f);
+
+		for (uint32_t ii = 0; ii < soa_count; ++ii)
+		{
+			const SoaTransform& pr = reference[ii];
+			const SoaTransform& pp = pose[ii];
+
+			// conjugate(reference) * pose, so that reference * delta == pose
+			SoaTransform result;
+			mulQuat(bx::float4_xor(pr._qx, sign_bit), bx::float4_xor(pr._qy, sign_bit), bx::float4_xor(pr._qz, sign_bit), pr._qw,
+				pp._qx, pp._qy, pp._qz, pp._qw,
+				result._qx, result._qy, result._qz, result._qw);
+			result._tx = bx::float4_sub(pp._tx, pr._tx);
+			result._ty = bx::float4_sub(pp._ty, pr._ty);
+			result._tz = bx::float4_sub(pp._tz, pr._tz);
+			result._sx = bx::float4_div(pp._sx, pr._sx);
+			result._sy = bx::float4_div(pp._sy, pr._sy);
+			result._sz = bx::float4_div(pp._sz, pr._sz);
+
+			out[ii] = result;
+		}
+	}
+
+	void accumulatePose(const SoaTransform* pose, float weight, uint32_t soa_count, bool is_first, SoaTransform* accum)
+	{
+		const bx::float4_t alpha = bx::float4_splat(weight);
+
+		for (uint32_t ii = 0; ii < soa_count; ++ii)
+		{
+			const SoaTransform& pp = pose[ii];
+			SoaTransform& pa = accum[ii];
+
+			if (is_first)
+			{
+				pa._tx = bx::float4_mul(pp._tx, alpha);
+				pa._ty = bx::float4_mul(pp._ty, alpha);
+				pa._tz = bx::float4_mul(pp._tz, alpha);
+				pa._qx = bx::float4_mul(pp._qx, alpha);
+				pa._qy = bx::float4_mul(pp._qy, alpha);
+				pa._qz = bx::float4_mul(pp._qz, alpha);
+				pa._qw = bx::float4_mul(pp._qw, alpha);
+				pa._sx = bx::float4_mul(pp._sx, alpha);
+				pa._sy = bx::float4_mul(pp._sy, alpha);
+				pa._sz = bx::float4_mul(pp._sz, alpha);
+				continue;
+			}
+
+			// keep every rotation in the hemisphere of what is accumulated so far
+			const bx::float4_t flip = getFlip(pa, pp);
+			pa._tx = bx::float4_add(pa._tx, bx::float4_mul(pp._tx, alpha));
+			pa._ty = bx::float4_add(pa._ty, bx::float4_mul(pp._ty, alpha));
+			pa._tz = bx::float4_add(pa._tz, bx::float4_mul(pp._tz, alpha));
+			pa._qx = bx::float4_add(pa._qx, bx::float4_mul(bx::float4_xor(pp._qx, flip), alpha));
+			pa._qy = bx::float4_add(pa._qy, bx::float4_mul(bx::float4_xor(pp._qy, flip), alpha));
+			pa._qz = bx::float4_add(pa._qz, bx::float4_mul(bx::float4_xor(pp._qz, flip), alpha));
+			pa._qw = bx::float4_add(pa._qw, bx::float4_mul(bx::float4_xor(pp._qw, flip), alpha));
+			pa._sx = bx::float4_add(pa._sx, bx::float4_mul(pp._sx, alpha));
+			pa._sy = bx::float4_add(pa._sy, bx::float4_mul(pp._sy, alpha));
+			pa._sz = bx::float4_add(pa._sz, bx::float4_mul(pp._sz, alpha));
+		}
+	}
+
+	void normalizePose(uint32_t soa_count, SoaTransform* pose)
+	{
+		for (uint32_t ii = 0; ii < soa_count; ++ii)
+		{
+			normalizeQuat(pose[ii]._qx, pose[ii]._qy, pose[ii]._qz, pose[ii]._qw);
+		}
+	}
+}
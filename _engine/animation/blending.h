@@ -0,0 +1,47 @@
+#ifndef __MONSTER_BLENDING_H__
+#define __MONSTER_BLENDING_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "animation/skeleton.h"
+
+namespace monster
+{
+	// Per-joint blend weights, padded to whole SoaTransform groups.
+	class LayerMask
+	{
+	private:
+		std::vector<float> _weights;
+
+	public:
+		void create(const Skeleton& skeleton, float weight);
+
+		void setJointWeight(uint32_t joint, float weight);
+
+		// Sets joint and every joint below it.
+		void setSubtreeWeight(const Skeleton& skeleton, uint32_t joint, float weight);
+
+		const float* getWeights() const { return _weights.empty() ? nullptr : &_weights[0]; }
+	};
+
+	// All functions work on soa_count groups of four joints and allow out to
+	// alias any input. mask may be nullptr, meaning weight applies to every
+	// joint; otherwise each joint uses weight * mask.
+
+	// a towards b; rotations take the shorter arc and are renormalized.
+	void blendPoses(const SoaTransform* a, const SoaTransform* b, float weight, const float* mask, uint32_t soa_count, SoaTransform* out);
+
+	// Applies a delta made by makeAdditivePose() on top of base.
+	void addPose(const SoaTransform* base, const SoaTransform* additive, float weight, const float* mask, uint32_t soa_count, SoaTransform* out);
+
+	// Delta that turns reference into pose, for additive layers.
+	void makeAdditivePose(const SoaTransform* reference, const SoaTransform* pose, uint32_t soa_count, SoaTransform* out);
+
+	// Weighted sum for blending many poses; the first call must pass is_first
+	// and the sum must be finished with normalizePose(). Weights should add up to 1.
+	void accumulatePose(const SoaTransform* pose, float weight, uint32_t soa_count, bool is_first, SoaTransform* accum);
+	void normalizePose(uint32_t soa_count, SoaTransform* pose);
+}
+
+#endif
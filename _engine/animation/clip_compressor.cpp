@@ -0,0 +1,284 @@
+#include "animation/clip_compressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/serialization/blob_serializer.h"
+
+namespace monster
+{
+	struct SortedKey
+	{
+		int32_t _order;        // frame of the previous key in the track, -2 and -1 for the first two
+		AnimationKey _key;
+
+		bool operator < (const SortedKey& other) const
+		{
+			return _order != other._order ? _order < other._order : _key._track < other._key._track;
+		}
+	};
+
+	struct TrackValue
+	{
+		float _v[4];
+	};
+
+	static void normalize(float quat[4])
+	{
+		float length = sqrtf(quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+		float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+		for (uint32_t ii = 0; ii < 4; ++ii)
+		{
+			quat[ii] *= inv_length;
+		}
+	}
+
+	// encodes a track of one stream and decides which of its frames to keep
+	class TrackEncoder
+	{
+	private:
+		uint32_t _stream;
+		TrackRange _range;
+
+	public:
+		std::vector<TrackValue> _values;
+		std::vector<AnimationKey> _quantized;
+		std::vector<TrackValue> _decoded;
+		std::vector<uint32_t> _kept;
+
+	private:
+		void encode(const TrackValue& value, uint16_t packed[3]) const
+		{
+			if (k_stream_rotation == _stream)
+			{
+				packQuaternion(value._v, packed);
+				return;
+			}
+
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				float scaled = 0.0f < _range._step[ii] ? (value._v[ii] - _range._min[ii]) / _range._step[ii] : 0.0f;
+				scaled = scaled < 0.0f ? 0.0f : (scaled > 65535.0f ? 65535.0f : scaled);
+				packed[ii] = (uint16_t)(scaled + 0.5f);
+			}
+		}
+
+		void decode(const uint16_t packed[3], TrackValue& value) const
+		{
+			if (k_stream_rotation == _stream)
+			{
+				unpackQuaternion(packed, value._v);
+				return;
+			}
+
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				value._v[ii] = _range._min[ii] + packed[ii] * _range._step[ii];
+			}
+			value._v[3] = 0.0f;
+		}
+
+		// same interpolation as ClipSampler::sample()
+		void interpolate(const TrackValue& a, const TrackValue& b, float alpha, TrackValue& result) const
+		{
+			float sign = 1.0f;
+			if (k_stream_rotation == _stream
+				&& a._v[0] * b._v[0] + a._v[1] * b._v[1] + a._v[2] * b._v[2] + a._v[3] * b._v[3] < 0.0f)
+			{
+				sign = -1.0f;
+			}
+
+			for (uint32_t ii = 0; ii < 4; ++ii)
+			{
+				result._v[ii] = a._v[ii] + (b._v[ii] * sign - a._v[ii]) * alpha;
+			}
+
+			if (k_stream_rotation == _stream)
+			{
+				normalize(result._v);
+			}
+		}
+
+		float getError(const TrackValue& a, const TrackValue& b) const
+		{
+			if (k_stream_rotation == _stream)
+			{
+				// angle of conj(a) * b; acos of the dot would drown small errors in
+				// the rounding of a dot product close to 1
+				const float* qa = a._v;
+				const float* qb = b._v;
+				float x = qa[3] * qb[0] - qa[0] * qb[3] - qa[1] * qb[2] + qa[2] * qb[1];
+				float y = qa[3] * qb[1] - qa[1] * qb[3] - qa[2] * qb[0] + qa[0] * qb[2];
+				float z = qa[3] * qb[2] - qa[2] * qb[3] - qa[0] * qb[1] + qa[1] * qb[0];
+				float w = qa[3] * qb[3] + qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2];
+				return 2.0f * atan2f(sqrtf(x * x + y * y + z * z), fabsf(w));
+			}
+
+			if (k_stream_translation == _stream)
+			{
+				float dx = a._v[0] - b._v[0];
+				float dy = a._v[1] - b._v[1];
+				float dz = a._v[2] - b._v[2];
+				return sqrtf(dx * dx + dy * dy + dz * dz);
+			}
+
+			return std::max(fabsf(a._v[0] - b._v[0]), std::max(fabsf(a._v[1] - b._v[1]), fabsf(a._v[2] - b._v[2])));
+		}
+
+		bool isReproduced(uint32_t start, uint32_t end, float tolerance) const
+		{
+			for (uint32_t frame = start + 1; frame < end; ++frame)
+			{
+				TrackValue value;
+				interpolate(_decoded[start], _decoded[end], (float)(frame - start) / (float)(end - start), value);
+				if (getError(value, _values[frame]) > tolerance)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	public:
+		explicit TrackEncoder(uint32_t stream) : _stream(stream) {}
+
+		const TrackRange& getRange() const { return _range; }
+
+		void encode(const RawAnimation& raw, uint32_t track, float tolerance)
+		{
+			uint32_t frame_count = raw._frame_count;
+			_values.resize(frame_count);
+
+			for (uint32_t frame = 0; frame < frame_count; ++frame)
+			{
+				const JointTransform& transform = raw._frames[frame * raw._track_count + track];
+				TrackValue& value = _values[frame];
+				const float* src = k_stream_translation == _stream ? transform._translation : (k_stream_rotation == _stream ? transform._rotation : transform._scale);
+				value._v[0] = src[0];
+				value._v[1] = src[1];
+				value._v[2] = src[2];
+				value._v[3] = k_stream_rotation == _stream ? src[3] : 0.0f;
+
+				if (k_stream_rotation == _stream)
+				{
+					normalize(value._v);
+				}
+			}
+
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				float min = _values[0]._v[ii];
+				float max = min;
+				for (const TrackValue& value : _values)
+				{
+					min = std::min(min, value._v[ii]);
+					max = std::max(max, value._v[ii]);
+				}
+				_range._min[ii] = min;
+				_range._step[ii] = (max - min) / 65535.0f;
+			}
+
+			_quantized.resize(frame_count);
+			_decoded.resize(frame_count);
+			for (uint32_t frame = 0; frame < frame_count; ++frame)
+			{
+				_quantized[frame]._frame = (uint16_t)frame;
+				_quantized[frame]._track = (uint16_t)track;
+				encode(_values[frame], _quantized[frame]._value);
+				decode(_quantized[frame]._value, _decoded[frame]);
+			}
+
+			// greedy: extend each segment until some frame inside it drifts past tolerance
+			_kept.clear();
+			_kept.push_back(0);
+			uint32_t start = 0;
+			for (uint32_t end = 2; end < frame_count; ++end)
+			{
+				if (!isReproduced(start, end, tolerance))
+				{
+					start = end - 1;
+					_kept.push_back(start);
+				}
+			}
+
+			// the sampler always needs two keys per track
+			_kept.push_back(1 < frame_count ? frame_count - 1 : 0);
+		}
+	};
+
+	bool compressClip(const RawAnimation& raw, const ClipCompressionSettings& settings, std::vector<uint8_t>& blob, ClipCompressionStats* stats)
+	{
+		if (0 == raw._frame_count
+			|| 0xffff < raw._frame_count
+			|| 0 == raw._track_count
+			|| 0xffff < raw._track_count
+			|| 0.0f >= raw._frame_rate
+			|| raw._frames.size() != (size_t)raw._frame_count * raw._track_count)
+		{
+			return false;
+		}
+
+		const float tolerances[k_stream_count] = { settings._translation_tolerance, settings._rotation_tolerance, settings._scale_tolerance };
+
+		std::vector<TrackRange> ranges[k_stream_count];
+		std::vector<SortedKey> sorted[k_stream_count];
+
+		for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+		{
+			TrackEncoder encoder(stream);
+			for (uint32_t track = 0; track < raw._track_count; ++track)
+			{
+				encoder.encode(raw, track, tolerances[stream]);
+				ranges[stream].push_back(encoder.getRange());
+
+				for (uint32_t ii = 0; ii < encoder._kept.size(); ++ii)
+				{
+					SortedKey key;
+					key._order = ii < 2 ? (int32_t)ii - 2 : (int32_t)encoder._kept[ii - 1];
+					key._key = encoder._quantized[encoder._kept[ii]];
+					sorted[stream].push_back(key);
+				}
+			}
+
+			std::stable_sort(sorted[stream].begin(), sorted[stream].end());
+		}
+
+		std::vector<AnimationKey> keys[k_stream_count];
+		for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+		{
+			for (const SortedKey& key : sorted[stream])
+			{
+				keys[stream].push_back(key._key);
+			}
+		}
+
+		AnimationClip clip;
+		clip._frame_rate = raw._frame_rate;
+		clip._frame_count = raw._frame_count;
+		clip._duration = (raw._frame_count - 1) / raw._frame_rate;
+		clip._track_count = raw._track_count;
+		clip._translation_ranges.set(&ranges[k_stream_translation][0], raw._track_count);
+		clip._scale_ranges.set(&ranges[k_stream_scale][0], raw._track_count);
+		clip._translations.set(&keys[k_stream_translation][0], (uint32_t)keys[k_stream_translation].size());
+		clip._rotations.set(&keys[k_stream_rotation][0], (uint32_t)keys[k_stream_rotation].size());
+		clip._scales.set(&keys[k_stream_scale][0], (uint32_t)keys[k_stream_scale].size());
+
+		if (!writeBlob(clip, blob))
+		{
+			return false;
+		}
+
+		if (nullptr != stats)
+		{
+			stats->_raw_size = (uint32_t)(raw._frames.size() * sizeof(JointTransform));
+			stats->_compressed_size = (uint32_t)blob.size();
+			stats->_raw_keys = raw._frame_count * raw._track_count;
+			for (uint32_t stream = 0; stream < k_stream_count; ++stream)
+			{
+				stats->_kept_keys[stream] = (uint32_t)keys[stream].size();
+			}
+		}
+
+		return true;
+	}
+}
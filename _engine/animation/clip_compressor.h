@@ -0,0 +1,48 @@
+#ifndef __MONSTER_CLIP_COMPRESSOR_H__
+#define __MONSTER_CLIP_COMPRESSOR_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "animation/animation_clip.h"
+
+namespace monster
+{
+	// Uncompressed input: every track sampled at every frame.
+	struct RawAnimation
+	{
+		float _frame_rate;
+		uint32_t _frame_count;
+		uint32_t _track_count;
+		std::vector<JointTransform> _frames;   // [frame * _track_count + track]
+	};
+
+	struct ClipCompressionSettings
+	{
+		float _translation_tolerance;   // distance
+		float _rotation_tolerance;      // radians
+		float _scale_tolerance;
+
+		ClipCompressionSettings()
+			: _translation_tolerance(0.0005f)
+			, _rotation_tolerance(0.0005f)
+			, _scale_tolerance(0.0005f)
+		{
+		}
+	};
+
+	struct ClipCompressionStats
+	{
+		uint32_t _raw_size;
+		uint32_t _compressed_size;
+		uint32_t _raw_keys;         // per stream, all frames of all tracks
+		uint32_t _kept_keys[k_stream_count];
+	};
+
+	// Offline step: quantizes every key, drops keys that linear interpolation
+	// of their neighbours reproduces within tolerance (measured after
+	// quantization), and writes the result as an AnimationClip blob.
+	bool compressClip(const RawAnimation& raw, const ClipCompressionSettings& settings, std::vector<uint8_t>& blob, ClipCompressionStats* stats = nullptr);
+}
+
+#endif
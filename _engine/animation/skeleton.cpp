@@ -1,6 +1,231 @@
 #include "animation/skeleton.h"
 
+#include <cstring>
+
 namespace monster
 {
+	const int16_t Skeleton::k_no_parent;
+
+	void setJointTransform(SoaTransform* pose, uint32_t joint, const JointTransform& transform)
+	{
+		SoaTransform& soa = pose[joint >> 2];
+		uint32_t lane = joint & 3;
+
+		setLane(soa._tx, lane, transform._translation[0]);
+		setLane(soa._ty, lane, transform._translation[1]);
+		setLane(soa._tz, lane, transform._translation[2]);
+		setLane(soa._qx, lane, transform._rotation[0]);
+		setLane(soa._qy, lane, transform._rotation[1]);
+		setLane(soa._qz, lane, transform._rotation[2]);
+		setLane(soa._qw, lane, transform._rotation[3]);
+		setLane(soa._sx, lane, transform._scale[0]);
+		setLane(soa._sy, lane, transform._scale[1]);
+		setLane(soa._sz, lane, transform._scale[2]);
+	}
+
+	void getJointTransform(const SoaTransform* pose, uint32_t joint, JointTransform& transform)
+	{
+		const SoaTransform& soa = pose[joint >> 2];
+		uint32_t lane = joint & 3;
+
+		transform._translation[0] = getLane(soa._tx, lane);
+		transform._translation[1] = getLane(soa._ty, lane);
+		transform._translation[2] = getLane(soa._tz, lane);
+		transform._rotation[0] = getLane(soa._qx, lane);
+		transform._rotation[1] = getLane(soa._qy, lane);
+		transform._rotation[2] = getLane(soa._qz, lane);
+		transform._rotation[3] = getLane(soa._qw, lane);
+		transform._scale[0] = getLane(soa._sx, lane);
+		transform._scale[1] = getLane(soa._sy, lane);
+		transform._scale[2] = getLane(soa._sz, lane);
+	}
+
+	bool Skeleton::create(const SkeletonData& data)
+	{
+		destroy();
+
+		uint32_t count = data._joints.size();
+		if (0 == count
+			|| 0x7fff < count)
+		{
+			return false;
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			int32_t parent = data._joints[ii]._parent;
+			if (parent >= (int32_t)ii
+				|| parent < k_no_parent)
+			{
+				return false;
+			}
+		}
+
+		_names.resize(count);
+		_parents.resize(count);
+		_inverse_bind.resize(count);
+		_bind_local.resize(count);
+
+		// padding lanes hold identity transforms so they stay finite through the math
+		JointTransform identity = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+		_bind_pose.resize((count + 3) / 4);
+		for (uint32_t ii = 0; ii < _bind_pose.size() * 4; ++ii)
+		{
+			setJointTransform(&_bind_pose[0], ii, ii < count ? data._joints[ii]._bind : identity);
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			_names[ii] = getString(data._joints[ii]._name);
+			_parents[ii] = (int16_t)data._joints[ii]._parent;
+		}
+
+		AlignedVector<bx::float4x4_t> model(count);
+		localToModel(*this, &_bind_pose[0], &model[0]);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			bx::float4x4_inverse(&_inverse_bind[ii], &model[ii]);
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			if (k_no_parent == _parents[ii])
+			{
+				_bind_local[ii] = model[ii];
+			}
+			else
+			{
+				bx::float4x4_mul(&_bind_local[ii], &model[ii], &_inverse_bind[_parents[ii]]);
+			}
+		}
+
+		return true;
+	}
+
+	void Skeleton::destroy()
+	{
+		_names.clear();
+		_parents.clear();
+		_bind_pose.clear();
+		_inverse_bind.clear();
+		_bind_local.clear();
+	}
+
+	int32_t Skeleton::findJoint(const char* name) const
+	{
+		for (uint32_t ii = 0; ii < _names.size(); ++ii)
+		{
+			if (_names[ii] == name)
+			{
+				return (int32_t)ii;
+			}
+		}
+		return -1;
+	}
+
+	void localToModel(const Skeleton& skeleton, const SoaTransform* local, bx::float4x4_t* model, uint32_t joint_count)
+	{
+		uint32_t count = 0 == joint_count || joint_count > skeleton.getJointCount() ? skeleton.getJointCount() : joint_count;
+		const int16_t* parents = skeleton.getParents();
+
+		const bx::float4_t one = bx::float4_splat(1.0f);
+		const bx::float4_t zero = bx::float4_zero();
+
+		for (uint32_t base = 0; base < count; base += 4)
+		{
+			const SoaTransform& soa = local[base >> 2];
+
+			// rotation and scale of four joints at once; rows are the rotated basis
+			// vectors, i.e. the transpose of what bx::mtxQuat produces
+			const bx::float4_t x2 = bx::float4_add(soa._qx, soa._qx);
+			const bx::float4_t y2 = bx::float4_add(soa._qy, soa._qy);
+			const bx::float4_t z2 = bx::float4_add(soa._qz, soa._qz);
+			const bx::float4_t xx = bx::float4_mul(soa._qx, x2);
+			const bx::float4_t xy = bx::float4_mul(soa._qx, y2);
+			const bx::float4_t xz = bx::float4_mul(soa._qx, z2);
+			const bx::float4_t yy = bx::float4_mul(soa._qy, y2);
+			const bx::float4_t yz = bx::float4_mul(soa._qy, z2);
+			const bx::float4_t zz = bx::float4_mul(soa._qz, z2);
+			const bx::float4_t wx = bx::float4_mul(soa._qw, x2);
+			const bx::float4_t wy = bx::float4_mul(soa._qw, y2);
+			const bx::float4_t wz = bx::float4_mul(soa._qw, z2);
+
+			// row r of all four matrices; transposing turns it into one row per joint
+			bx::float4x4_t soa_rows[4];
+			soa_rows[0].col[0] = bx::float4_mul(bx::float4_sub(one, bx::float4_add(yy, zz)), soa._sx);
+			soa_rows[0].col[1] = bx::float4_mul(bx::float4_add(xy, wz), soa._sx);
+			soa_rows[0].col[2] = bx::float4_mul(bx::float4_sub(xz, wy), soa._sx);
+			soa_rows[0].col[3] = zero;
+			soa_rows[1].col[0] = bx::float4_mul(bx::float4_sub(xy, wz), soa._sy);
+			soa_rows[1].col[1] = bx::float4_mul(bx::float4_sub(one, bx::float4_add(xx, zz)), soa._sy);
+			soa_rows[1].col[2] = bx::float4_mul(bx::float4_add(yz, wx), soa._sy);
+			soa_rows[1].col[3] = zero;
+			soa_rows[2].col[0] = bx::float4_mul(bx::float4_add(xz, wy), soa._sz);
+			soa_rows[2].col[1] = bx::float4_mul(bx::float4_sub(yz, wx), soa._sz);
+			soa_rows[2].col[2] = bx::float4_mul(bx::float4_sub(one, bx::float4_add(xx, yy)), soa._sz);
+			soa_rows[2].col[3] = zero;
+			soa_rows[3].col[0] = soa._tx;
+			soa_rows[3].col[1] = soa._ty;
+			soa_rows[3].col[2] = soa._tz;
+			soa_rows[3].col[3] = one;
+
+			bx::float4x4_t rows[4];
+			bx::float4x4_transpose(&rows[0], &soa_rows[0]);
+			bx::float4x4_transpose(&rows[1], &soa_rows[1]);
+			bx::float4x4_transpose(&rows[2], &soa_rows[2]);
+			bx::float4x4_transpose(&rows[3], &soa_rows[3]);
+
+			uint32_t lanes = count - base < 4 ? count - base : 4;
+			for (uint32_t lane = 0; lane < lanes; ++lane)
+			{
+				uint32_t joint = base + lane;
+
+				bx::float4x4_t joint_local;
+				joint_local.col[0] = rows[0].col[lane];
+				joint_local.col[1] = rows[1].col[lane];
+				joint_local.col[2] = rows[2].col[lane];
+				joint_local.col[3] = rows[3].col[lane];
+
+				// parents come first, so their model matrix is already final
+				int16_t parent = parents[joint];
+				if (Skeleton::k_no_parent == parent)
+				{
+					model[joint] = joint_local;
+				}
+				else
+				{
+					bx::float4x4_mul(&model[joint], &joint_local, &model[parent]);
+				}
+			}
+		}
+	}
+
+	void bindPoseToModel(const Skeleton& skeleton, bx::float4x4_t* model, uint32_t first_joint)
+	{
+		const int16_t* parents = skeleton.getParents();
+		const bx::float4x4_t* bind_local = skeleton.getBindLocalMatrices();
+
+		for (uint32_t ii = first_joint; ii < skeleton.getJointCount(); ++ii)
+		{
+			if (Skeleton::k_no_parent == parents[ii])
+			{
+				model[ii] = bind_local[ii];
+			}
+			else
+			{
+				bx::float4x4_mul(&model[ii], &bind_local[ii], &model[parents[ii]]);
+			}
+		}
+	}
+
+	void computeSkinningMatrices(const Skeleton& skeleton, const bx::float4x4_t* model, bx::float4x4_t* skinning, uint32_t joint_count)
+	{
+		uint32_t count = 0 == joint_count || joint_count > skeleton.getJointCount() ? skeleton.getJointCount() : joint_count;
+		const bx::float4x4_t* inverse_bind = skeleton.getInverseBindMatrices();
 
-}
\ No newline at end of file
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			bx::float4x4_mul(&skinning[ii], &inverse_bind[ii], &model[ii]);
+		}
+	}
+}
@@ -1,12 +1,121 @@
 #ifndef __MONSTER_SKELETON_H__
 #define __MONSTER_SKELETON_H__
 
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bx/float4x4_t.h>
+
+#include "core/memory/aligned_allocator.h"
+#include "core/serialization/blob.h"
+
 namespace monster
 {
+	// Four joint transforms in SIMD lanes: one float4_t per component, so a
+	// pose is processed four joints at a time with no shuffling.
+	struct SoaTransform
+	{
+		bx::float4_t _tx, _ty, _tz;
+		bx::float4_t _qx, _qy, _qz, _qw;
+		bx::float4_t _sx, _sy, _sz;
+	};
+
+	inline float getLane(const bx::float4_t& value, uint32_t lane)
+	{
+		return ((const float*)&value)[lane];
+	}
+
+	inline void setLane(bx::float4_t& value, uint32_t lane, float scalar)
+	{
+		((float*)&value)[lane] = scalar;
+	}
+
+	struct JointTransform
+	{
+		float _translation[3];
+		float _rotation[4];    // quaternion xyzw
+		float _scale[3];
+	};
+
+	void setJointTransform(SoaTransform* pose, uint32_t joint, const JointTransform& transform);
+	void getJointTransform(const SoaTransform* pose, uint32_t joint, JointTransform& transform);
+
+	// Skeleton asset as stored on disk, see BlobFile.
+	struct SkeletonJoint
+	{
+		BlobString _name;
+		int32_t _parent;           // index of an earlier joint, -1 for roots
+		JointTransform _bind;
+	};
+
+	struct SkeletonData
+	{
+		BlobArray<SkeletonJoint> _joints;
+	};
+
 	class Skeleton
 	{
+	public:
+		static const int16_t k_no_parent = -1;
+
+	private:
+		std::vector<std::string> _names;
+		std::vector<int16_t> _parents;
+		AlignedVector<SoaTransform> _bind_pose;
+		AlignedVector<bx::float4x4_t> _inverse_bind;
+		AlignedVector<bx::float4x4_t> _bind_local;
+
+	public:
+		Skeleton() {}
+
+		Skeleton(const Skeleton&) = delete;
+		Skeleton& operator = (const Skeleton&) = delete;
+
+		// Joints must be ordered parent before child.
+		bool create(const SkeletonData& data);
+		void destroy();
+
+		uint32_t getJointCount() const { return (uint32_t)_parents.size(); }
+		uint32_t getSoaCount() const { return (uint32_t)_bind_pose.size(); }
 
+		const int16_t* getParents() const { return _parents.empty() ? nullptr : &_parents[0]; }
+		const char* getName(uint32_t joint) const { return _names[joint].c_str(); }
+		int32_t findJoint(const char* name) const;
+
+		const SoaTransform* getBindPose() const { return _bind_pose.empty() ? nullptr : &_bind_pose[0]; }
+		const bx::float4x4_t* getInverseBindMatrices() const { return _inverse_bind.empty() ? nullptr : &_inverse_bind[0]; }
+		const bx::float4x4_t* getBindLocalMatrices() const { return _bind_local.empty() ? nullptr : &_bind_local[0]; }
 	};
+
+	// Converts the first joint_count joints of a local SoA pose to model
+	// space matrices, four joints at a time. joint_count 0 means all; a
+	// smaller count must still cover every parent of the joints it includes,
+	// which parent-before-child order guarantees for any prefix.
+	void localToModel(const Skeleton& skeleton, const SoaTransform* local, bx::float4x4_t* model, uint32_t joint_count = 0);
+
+	// Model matrices for joints first_joint and up, in their bind pose
+	// relative to their parent; for joints an animation LOD leaves out.
+	void bindPoseToModel(const Skeleton& skeleton, bx::float4x4_t* model, uint32_t first_joint);
+
+	// model * inverse bind, ready for bgfx::setTransform(skinning, count)
+	// or a mat4 uniform array.
+	void computeSkinningMatrices(const Skeleton& skeleton, const bx::float4x4_t* model, bx::float4x4_t* skinning, uint32_t joint_count = 0);
 }
 
-#endif
\ No newline at end of file
+MONSTER_REFLECT_BEGIN(monster::JointTransform)
+	MONSTER_REFLECT_FIELD(_translation)
+	MONSTER_REFLECT_FIELD(_rotation)
+	MONSTER_REFLECT_FIELD(_scale)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::SkeletonJoint)
+	MONSTER_REFLECT_FIELD(_name)
+	MONSTER_REFLECT_FIELD(_parent)
+	MONSTER_REFLECT_FIELD(_bind)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::SkeletonData)
+	MONSTER_REFLECT_FIELD(_joints)
+MONSTER_REFLECT_END()
+
+#endif
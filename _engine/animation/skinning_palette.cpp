@@ -0,0 +1,287 @@
+#include "animation/skinning_palette.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace monster
+{
+	void toDualQuaternion(const float* mtx, float* dq)
+	{
+		// rotation rows without scale; rows are the rotated basis vectors, so
+		// the column-vector rotation matrix is their transpose
+		float m[3][3];
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			const float* src = &mtx[row * 4];
+			float length = sqrtf(src[0] * src[0] + src[1] * src[1] + src[2] * src[2]);
+			float inv_length = 0.0f < length ? 1.0f / length : 0.0f;
+			m[row][0] = src[0] * inv_length;
+			m[row][1] = src[1] * inv_length;
+			m[row][2] = src[2] * inv_length;
+		}
+
+		float* r = dq;
+		float trace = m[0][0] + m[1][1] + m[2][2];
+		if (0.0f < trace)
+		{
+			float s = 0.5f / sqrtf(trace + 1.0f);
+			r[0] = (m[1][2] - m[2][1]) * s;
+			r[1] = (m[2][0] - m[0][2]) * s;
+			r[2] = (m[0][1] - m[1][0]) * s;
+			r[3] = 0.25f / s;
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			float s = 2.0f * sqrtf(1.0f + m[0][0] - m[1][1] - m[2][2]);
+			r[0] = 0.25f * s;
+			r[1] = (m[1][0] + m[0][1]) / s;
+			r[2] = (m[2][0] + m[0][2]) / s;
+			r[3] = (m[1][2] - m[2][1]) / s;
+		}
+		else if (m[1][1] > m[2][2])
+		{
+			float s = 2.0f * sqrtf(1.0f + m[1][1] - m[0][0] - m[2][2]);
+			r[0] = (m[1][0] + m[0][1]) / s;
+			r[1] = 0.25f * s;
+			r[2] = (m[2][1] + m[1][2]) / s;
+			r[3] = (m[2][0] - m[0][2]) / s;
+		}
+		else
+		{
+			float s = 2.0f * sqrtf(1.0f + m[2][2] - m[0][0] - m[1][1]);
+			r[0] = (m[2][0] + m[0][2]) / s;
+			r[1] = (m[2][1] + m[1][2]) / s;
+			r[2] = 0.25f * s;
+			r[3] = (m[0][1] - m[1][0]) / s;
+		}
+
+		// dual = 0.5 * translation * real
+		const float tx = mtx[12];
+		const float ty = mtx[13];
+		const float tz = mtx[14];
+		dq[4] = 0.5f * ( tx * r[3] + ty * r[2] - tz * r[1]);
+		dq[5] = 0.5f * (-tx * r[2] + ty * r[3] + tz * r[0]);
+		dq[6] = 0.5f * ( tx * r[1] - ty * r[0] + tz * r[3]);
+		dq[7] = -0.5f * (tx * r[0] + ty * r[1] + tz * r[2]);
+	}
+
+	static void packJoint(SkinningMode mode, const bx::float4x4_t& skinning, float* texels)
+	{
+		if (SkinningMode::DualQuaternion == mode)
+		{
+			toDualQuaternion((const float*)&skinning, texels);
+			return;
+		}
+
+		// the first three columns; the shader dots them with vec4(position, 1.0)
+		bx::float4x4_t columns;
+		bx::float4x4_transpose(&columns, &skinning);
+		bx::float4_st(texels, columns.col[0]);
+		bx::float4_st(texels + 4, columns.col[1]);
+		bx::float4_st(texels + 8, columns.col[2]);
+	}
+
+	SkinningPalette::SkinningPalette()
+		: _mode(SkinningMode::Matrix)
+		, _texels_per_joint(3)
+		, _max_joints(0)
+		, _used(0)
+		, _height(0)
+	{
+		_texture.idx = bgfx::invalidHandle;
+		_sampler.idx = bgfx::invalidHandle;
+		_params.idx = bgfx::invalidHandle;
+	}
+
+	bool SkinningPalette::initialize(uint32_t max_joints, SkinningMode mode)
+	{
+		shutdown();
+
+		_mode = mode;
+		_texels_per_joint = SkinningMode::DualQuaternion == mode ? 2 : 3;
+
+		uint32_t height = (max_joints * _texels_per_joint + k_width - 1) / k_width;
+		if (0 == height || 0xffff < height)
+		{
+			return false;
+		}
+
+		_texture = bgfx::createTexture2D(k_width, (uint16_t)height, 1, bgfx::TextureFormat::RGBA32F,
+			BGFX_TEXTURE_MIN_POINT | BGFX_TEXTURE_MAG_POINT | BGFX_TEXTURE_MIP_POINT | BGFX_TEXTURE_U_CLAMP | BGFX_TEXTURE_V_CLAMP);
+		if (!bgfx::isValid(_texture))
+		{
+			return false;
+		}
+
+		_sampler = bgfx::createUniform("s_skinning", bgfx::UniformType::Uniform1i);
+		_params = bgfx::createUniform("u_skinning", bgfx::UniformType::Uniform4fv);
+
+		_max_joints = max_joints;
+		_height = (uint16_t)height;
+		_used = 0;
+		_staging.resize((size_t)height * k_width * 4);
+		return true;
+	}
+
+	void SkinningPalette::shutdown()
+	{
+		if (bgfx::isValid(_texture))
+		{
+			bgfx::destroyTexture(_texture);
+			bgfx::destroyUniform(_sampler);
+			bgfx::destroyUniform(_params);
+			_texture.idx = bgfx::invalidHandle;
+			_sampler.idx = bgfx::invalidHandle;
+			_params.idx = bgfx::invalidHandle;
+		}
+
+		_staging.clear();
+		_max_joints = 0;
+		_used = 0;
+		_height = 0;
+	}
+
+	uint32_t SkinningPalette::reserve(uint32_t joint_count)
+	{
+		if (_used + joint_count > _max_joints)
+		{
+			return k_invalid_offset;
+		}
+
+		uint32_t offset = _used;
+		_used += joint_count;
+		return offset;
+	}
+
+	uint32_t SkinningPalette::add(const Skeleton& skeleton, const bx::float4x4_t* model, uint32_t joint_count)
+	{
+		uint32_t count = 0 == joint_count || joint_count > skeleton.getJointCount() ? skeleton.getJointCount() : joint_count;
+		uint32_t offset = reserve(count);
+		if (k_invalid_offset == offset)
+		{
+			return k_invalid_offset;
+		}
+
+		const bx::float4x4_t* inverse_bind = skeleton.getInverseBindMatrices();
+		float* texels = &_staging[(size_t)offset * _texels_per_joint * 4];
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			bx::float4x4_t skinning;
+			bx::float4x4_mul(&skinning, &inverse_bind[ii], &model[ii]);
+			packJoint(_mode, skinning, texels);
+			texels += _texels_per_joint * 4;
+		}
+
+		return offset;
+	}
+
+	uint32_t SkinningPalette::add(const bx::float4x4_t* skinning, uint32_t joint_count)
+	{
+		uint32_t offset = reserve(joint_count);
+		if (k_invalid_offset == offset)
+		{
+			return k_invalid_offset;
+		}
+
+		float* texels = &_staging[(size_t)offset * _texels_per_joint * 4];
+		for (uint32_t ii = 0; ii < joint_count; ++ii)
+		{
+			packJoint(_mode, skinning[ii], texels);
+			texels += _texels_per_joint * 4;
+		}
+
+		return offset;
+	}
+
+	void SkinningPalette::upload()
+	{
+		if (0 == _used)
+		{
+			return;
+		}
+
+		// whole rows only; the tail of the last row is whatever was there before
+		uint16_t rows = (uint16_t)((_used * _texels_per_joint + k_width - 1) / k_width);
+		uint32_t size = (uint32_t)rows * k_width * 4 * sizeof(float);
+		bgfx::updateTexture2D(_texture, 0, 0, 0, k_width, rows, bgfx::copy(&_staging[0], size));
+	}
+
+	void SkinningPalette::bind(uint8_t stage) const
+	{
+		const float params[4] = { 1.0f / k_width, 1.0f / _height, (float)k_width, (float)_texels_per_joint };
+		bgfx::setUniform(_params, params);
+		bgfx::setTexture(stage, _sampler, _texture);
+	}
+
+	SkinnedInstanceBuffer::SkinnedInstanceBuffer()
+		: _used(0)
+	{
+		_buffer.idx = bgfx::invalidHandle;
+
+		_decl.begin()
+			.add(bgfx::Attrib::TexCoord3, 4, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::TexCoord4, 4, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::TexCoord5, 4, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+			.end();
+	}
+
+	bool SkinnedInstanceBuffer::initialize(uint32_t max_instances)
+	{
+		shutdown();
+
+		_buffer = bgfx::createDynamicVertexBuffer(max_instances, _decl);
+		if (!bgfx::isValid(_buffer))
+		{
+			return false;
+		}
+
+		_instances.resize(max_instances);
+		_used = 0;
+		return true;
+	}
+
+	void SkinnedInstanceBuffer::shutdown()
+	{
+		if (bgfx::isValid(_buffer))
+		{
+			bgfx::destroyDynamicVertexBuffer(_buffer);
+			_buffer.idx = bgfx::invalidHandle;
+		}
+
+		_instances.clear();
+		_used = 0;
+	}
+
+	uint32_t SkinnedInstanceBuffer::add(const float* world, uint32_t palette_offset)
+	{
+		if (_used == _instances.size())
+		{
+			return SkinningPalette::k_invalid_offset;
+		}
+
+		SkinnedInstance& instance = _instances[_used];
+		memcpy(instance._world, world, sizeof(instance._world));
+		instance._palette[0] = (float)palette_offset;
+		instance._palette[1] = 0.0f;
+		instance._palette[2] = 0.0f;
+		instance._palette[3] = 0.0f;
+		return _used++;
+	}
+
+	void SkinnedInstanceBuffer::upload()
+	{
+		if (0 == _used)
+		{
+			return;
+		}
+
+		bgfx::updateDynamicVertexBuffer(_buffer, bgfx::copy(&_instances[0], _used * (uint32_t)sizeof(SkinnedInstance)));
+	}
+
+	void SkinnedInstanceBuffer::bind(uint32_t first, uint32_t count) const
+	{
+		bgfx::setInstanceDataBuffer(_buffer, first, count);
+	}
+}
@@ -0,0 +1,120 @@
+#ifndef __MONSTER_SKINNING_PALETTE_H__
+#define __MONSTER_SKINNING_PALETTE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "bgfx.h"
+
+#include "animation/skeleton.h"
+
+namespace monster
+{
+	enum class SkinningMode : uint8_t
+	{
+		Matrix,            // 4x3 affine, three texels per joint
+		DualQuaternion     // rigid joints only (scale is dropped), two texels per joint
+	};
+
+	// Rotation and translation of a row-vector affine matrix as a unit dual
+	// quaternion: real part in dq[0..3], dual part in dq[4..7]. Scale is
+	// removed before the rotation is extracted.
+	void toDualQuaternion(const float* mtx, float* dq);
+
+	// Skinning transforms of every character drawn this frame, packed into
+	// one RGBA32F texture that the skinned vertex shaders read with
+	// texture2DLod. Characters are added with add() once per frame, which
+	// returns the palette offset a draw passes to the shader, then the used
+	// rows go to the GPU with a single updateTexture2D in upload().
+	class SkinningPalette
+	{
+	public:
+		static const uint16_t k_width = 1024;             // texels per row, a power of two
+		static const uint32_t k_invalid_offset = UINT32_MAX;
+
+	private:
+		SkinningMode _mode;
+		uint32_t _texels_per_joint;
+		uint32_t _max_joints;
+		uint32_t _used;
+		uint16_t _height;
+		std::vector<float> _staging;
+		bgfx::TextureHandle _texture;
+		bgfx::UniformHandle _sampler;
+		bgfx::UniformHandle _params;
+
+	private:
+		uint32_t reserve(uint32_t joint_count);
+
+	public:
+		SkinningPalette();
+		~SkinningPalette() { shutdown(); }
+
+		SkinningPalette(const SkinningPalette&) = delete;
+		SkinningPalette& operator = (const SkinningPalette&) = delete;
+
+		// max_joints is the total over all characters in one frame.
+		bool initialize(uint32_t max_joints, SkinningMode mode);
+		void shutdown();
+
+		SkinningMode getMode() const { return _mode; }
+		uint32_t getTexelsPerJoint() const { return _texels_per_joint; }
+		uint32_t getUsedJoints() const { return _used; }
+
+		// Starts a new frame; offsets from the previous frame become invalid.
+		void reset() { _used = 0; }
+
+		// Multiplies model space matrices by the inverse bind pose while
+		// packing. Returns the palette offset or k_invalid_offset when full.
+		uint32_t add(const Skeleton& skeleton, const bx::float4x4_t* model, uint32_t joint_count = 0);
+
+		// Packs ready-made skinning matrices, e.g. from computeSkinningMatrices().
+		uint32_t add(const bx::float4x4_t* skinning, uint32_t joint_count);
+
+		void upload();
+
+		// Binds the palette texture and its u_skinning parameters for the next submit.
+		void bind(uint8_t stage) const;
+	};
+
+	// Per-instance vertex data for skinned draws, i_data0 to i_data4 in the
+	// shaders: the world matrix rows followed by the palette offset in x.
+	struct SkinnedInstance
+	{
+		float _world[16];
+		float _palette[4];
+	};
+
+	// Instance data of all skinned draws in a frame, in one dynamic vertex
+	// buffer. Draws of the same mesh added one after another can be
+	// submitted as one instanced draw with bind(first, count).
+	class SkinnedInstanceBuffer
+	{
+	private:
+		std::vector<SkinnedInstance> _instances;
+		uint32_t _used;
+		bgfx::VertexDecl _decl;
+		bgfx::DynamicVertexBufferHandle _buffer;
+
+	public:
+		SkinnedInstanceBuffer();
+		~SkinnedInstanceBuffer() { shutdown(); }
+
+		SkinnedInstanceBuffer(const SkinnedInstanceBuffer&) = delete;
+		SkinnedInstanceBuffer& operator = (const SkinnedInstanceBuffer&) = delete;
+
+		bool initialize(uint32_t max_instances);
+		void shutdown();
+
+		void reset() { _used = 0; }
+
+		// Returns the instance index, or SkinningPalette::k_invalid_offset when full.
+		uint32_t add(const float* world, uint32_t palette_offset);
+
+		void upload();
+
+		void bind(uint32_t first, uint32_t count) const;
+	};
+}
+
+#endif
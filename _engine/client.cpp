@@ -1,8 +1,12 @@
 
 #include "bgfx.h"
 #include "core/platform.h"
+#include "core/job/job_system.h"
+#include "entity/entity_manager.h"
+#include "entity/system_scheduler.h"
 #include "framework.h"
 #include <stdint.h>
+#include <bx/timer.h>
 
 int _main_(int /*_argc*/, char** /*_argv*/)
 {
@@ -25,8 +29,23 @@ int _main_(int /*_argc*/, char** /*_argv*/)
 		, 0
 		);
 
+	monster::JobSystem jobs;
+	jobs.initialize();
+
+	monster::EntityManager entities;
+	monster::SystemScheduler systems(&jobs);
+
+	int64_t last = bx::getHPCounter();
+
 	while (!monster::FrameWork::processEvents(width, height, debug, reset))
 	{
+		int64_t now = bx::getHPCounter();
+		float dt = float(now - last) / float(bx::getHPFrequency());
+		last = now;
+
+		// Systems are ordered by their declared component access, not by hand.
+		systems.update(entities, dt);
+
 		// Set view 0 default viewport.
 		bgfx::setViewRect(0, 0, 0, width, height);
 
@@ -0,0 +1,234 @@
+#include "core/filesystem/access_trace.h"
+#include "core/filesystem/disk_filesystem.h"
+
+#if MONSTER_PLATFORM_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace monster
+{
+	void AccessTraceRecorder::begin()
+	{
+		MutexScope lock(_mutex);
+		_paths.clear();
+		_path_ids.clear();
+		_records.clear();
+		_is_recording = true;
+	}
+
+	void AccessTraceRecorder::end()
+	{
+		_is_recording = false;
+	}
+
+	uint32_t AccessTraceRecorder::internPath(const char* path)
+	{
+		MutexScope lock(_mutex);
+		auto it = _path_ids.find(path);
+		if (it != _path_ids.end())
+		{
+			return it->second;
+		}
+
+		uint32_t id = (uint32_t)_paths.size();
+		_paths.push_back(path);
+		_path_ids[path] = id;
+		return id;
+	}
+
+	void AccessTraceRecorder::record(uint32_t path, size_t offset, size_t size)
+	{
+		if (!_is_recording
+			|| 0 == size)
+		{
+			return;
+		}
+
+		uint32_t first = (uint32_t)(offset >> k_page_shift);
+		uint32_t last = (uint32_t)((offset + size - 1) >> k_page_shift);
+
+		MutexScope lock(_mutex);
+
+		// sequential reads through a file collapse into one record
+		if (!_records.empty())
+		{
+			Record& prev = _records.back();
+			uint32_t prev_end = prev._page + prev._num_pages;
+			if (prev._path == path
+				&& first >= prev._page
+				&& first <= prev_end)
+			{
+				if (last + 1 > prev_end)
+				{
+					prev._num_pages = last + 1 - prev._page;
+				}
+				return;
+			}
+		}
+
+		Record record = { path, first, last - first + 1 };
+		_records.push_back(record);
+	}
+
+	bool AccessTraceRecorder::save(const char* trace_path)
+	{
+		DiskFile file(trace_path, FileOpenMode::write);
+		if (!file.isOpen())
+		{
+			return false;
+		}
+
+		MutexScope lock(_mutex);
+
+		uint32_t header[4] = { k_magic, k_version, (uint32_t)_paths.size(), (uint32_t)_records.size() };
+		file.write(header, sizeof(header));
+
+		for (const std::string& path : _paths)
+		{
+			uint16_t len = (uint16_t)path.size();
+			file.write(&len, sizeof(len));
+			file.write(path.c_str(), len);
+		}
+
+		if (!_records.empty())
+		{
+			file.write(&_records[0], _records.size() * sizeof(Record));
+		}
+
+		return true;
+	}
+
+	bool AccessTracePrefetcher::load(const char* trace_path, const char* root)
+	{
+		DiskFile file(trace_path, FileOpenMode::read);
+		if (!file.isOpen())
+		{
+			return false;
+		}
+
+		uint32_t header[4];
+		if (sizeof(header) != file.read(header, sizeof(header))
+			|| AccessTraceRecorder::k_magic != header[0]
+			|| AccessTraceRecorder::k_version != header[1])
+		{
+			return false;
+		}
+
+		std::string prefix = root;
+		if (!prefix.empty()
+			&& '/' != prefix.back())
+		{
+			prefix += '/';
+		}
+
+		_paths.resize(header[2]);
+		for (std::string& path : _paths)
+		{
+			uint16_t len = 0;
+			file.read(&len, sizeof(len));
+
+			std::string name(len, '\0');
+			if (len != file.read(&name[0], len))
+			{
+				_paths.clear();
+				return false;
+			}
+			path = prefix + name;
+		}
+
+		_records.resize(header[3]);
+		size_t size = _records.size() * sizeof(AccessTraceRecorder::Record);
+		if (0 != size
+			&& size != file.read(&_records[0], size))
+		{
+			_paths.clear();
+			_records.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	void AccessTracePrefetcher::start()
+	{
+		if (_records.empty()
+			|| _thread.isRunning())
+		{
+			return;
+		}
+
+		_quit = false;
+		_thread.init(threadFunc, this);
+	}
+
+	void AccessTracePrefetcher::stop()
+	{
+		if (_thread.isRunning())
+		{
+			_quit = true;
+			_thread.shutdown();
+		}
+	}
+
+	int32_t AccessTracePrefetcher::threadFunc(void* user_data)
+	{
+		AccessTracePrefetcher* prefetcher = (AccessTracePrefetcher*)user_data;
+		prefetcher->replay();
+		return 0;
+	}
+
+	void AccessTracePrefetcher::replay()
+	{
+		// a file is opened per record and closed right after, so a trace
+		// over more files than the descriptor limit still plays out
+		std::vector<uint8_t> missing(_paths.size(), 0);
+
+#if !MONSTER_PLATFORM_POSIX
+		std::vector<uint8_t> scratch(64 << 10);
+#endif
+
+		for (const AccessTraceRecorder::Record& record : _records)
+		{
+			if (_quit)
+			{
+				break;
+			}
+
+			if (record._path >= missing.size()
+				|| 0 != missing[record._path])
+			{
+				continue;
+			}
+
+			DiskFile file(_paths[record._path].c_str(), FileOpenMode::read);
+			if (!file.isOpen())
+			{
+				missing[record._path] = 1;
+				continue;
+			}
+
+			size_t offset = (size_t)record._page << AccessTraceRecorder::k_page_shift;
+			size_t size = (size_t)record._num_pages << AccessTraceRecorder::k_page_shift;
+
+#if MONSTER_PLATFORM_LINUX || MONSTER_PLATFORM_ANDROID
+			posix_fadvise(file.getFd(), (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED);
+#elif MONSTER_PLATFORM_POSIX
+			radvisory advisory = { (off_t)offset, (int)size };
+			fcntl(file.getFd(), F_RDADVISE, &advisory);
+#else
+			file.seek(offset);
+			for (size_t read = 0; read < size && !_quit; )
+			{
+				size_t chunk = size - read < scratch.size() ? size - read : scratch.size();
+				size_t result = file.read(&scratch[0], chunk);
+				if (0 == result)
+				{
+					break;
+				}
+				read += result;
+			}
+#endif
+		}
+	}
+}
@@ -0,0 +1,173 @@
+#ifndef __MONSTER_ACCESS_TRACE_H__
+#define __MONSTER_ACCESS_TRACE_H__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "core/mutex.h"
+#include "core/thread.h"
+#include "core/filesystem/filesystem.h"
+
+namespace monster
+{
+	// Records which files are read, in which order and at which offsets, so
+	// the next run can replay the same reads as read-ahead hints.
+	//
+	// Trace file layout (little endian):
+	//   u32 magic, u32 version, u32 path count, u32 record count
+	//   path count x { u16 length, char[length] }
+	//   record count x { u32 path, u32 first page, u32 page count }
+	class AccessTraceRecorder
+	{
+	public:
+		static const uint32_t k_magic = 0x4352544d; // 'MTRC'
+		static const uint32_t k_version = 1;
+		static const uint32_t k_page_shift = 12;
+
+		struct Record
+		{
+			uint32_t _path;
+			uint32_t _page;
+			uint32_t _num_pages;
+		};
+
+	private:
+		Mutex _mutex;
+		std::vector<std::string> _paths;
+		std::unordered_map<std::string, uint32_t> _path_ids;
+		std::vector<Record> _records;
+		volatile bool _is_recording;
+
+	public:
+		AccessTraceRecorder() : _is_recording(false) {}
+
+		void begin();
+		void end();
+		bool isRecording() const { return _is_recording; }
+
+		uint32_t internPath(const char* path);
+		void record(uint32_t path, size_t offset, size_t size);
+		void record(const char* path, size_t offset, size_t size) { record(internPath(path), offset, size); }
+
+		bool save(const char* trace_path);
+	};
+
+	// Replays a recorded trace on a background thread as posix_fadvise(WILLNEED)
+	// hints. Platforms without fadvise fall back to reading the pages into a
+	// scratch buffer, which warms the OS cache the same way.
+	class AccessTracePrefetcher
+	{
+	private:
+		std::vector<std::string> _paths;
+		std::vector<AccessTraceRecorder::Record> _records;
+		Thread _thread;
+		volatile bool _quit;
+
+		static int32_t threadFunc(void* user_data);
+		void replay();
+
+	public:
+		AccessTracePrefetcher() : _quit(false) {}
+		~AccessTracePrefetcher() { stop(); }
+
+		// Paths in the trace are resolved against root, which must match the one used when recording.
+		bool load(const char* trace_path, const char* root = "");
+
+		void start();
+		void stop();
+	};
+
+	// FileSystem decorator that reports every read through the wrapped file
+	// system to a recorder.
+	class TracingFileSystem : public FileSystem
+	{
+	private:
+		class TracingFile : public File
+		{
+		private:
+			File* _file;
+			AccessTraceRecorder* _recorder;
+			uint32_t _path;
+
+		public:
+			TracingFile(File* file, FileOpenMode mode, AccessTraceRecorder* recorder, uint32_t path)
+				: File(mode), _file(file), _recorder(recorder), _path(path) {}
+
+			File* getFile() const { return _file; }
+
+			virtual size_t read(void* buffer, size_t length) override
+			{
+				size_t offset = _file->tell();
+				size_t result = _file->read(buffer, length);
+				if (0 != result
+					&& _recorder->isRecording())
+				{
+					_recorder->record(_path, offset, result);
+				}
+				return result;
+			}
+
+			virtual size_t write(const void* buffer, size_t length) override { return _file->write(buffer, length); }
+			virtual void seek(size_t position) override { _file->seek(position); }
+			virtual void seekEnd() override { _file->seekEnd(); }
+			virtual void skip(size_t bytes) override { _file->skip(bytes); }
+			virtual size_t tell() const override { return _file->tell(); }
+			virtual bool sync(bool data_only) override { return _file->sync(data_only); }
+		};
+
+		FileSystem* _fs;
+		AccessTraceRecorder* _recorder;
+
+	public:
+		TracingFileSystem(FileSystem* fs, AccessTraceRecorder* recorder) : _fs(fs), _recorder(recorder) {}
+		virtual ~TracingFileSystem() {}
+
+		virtual File* open(const char* path, FileOpenMode mode) override
+		{
+			File* file = _fs->open(path, mode);
+			if (nullptr == file)
+			{
+				return nullptr;
+			}
+			return new TracingFile(file, mode, _recorder, _recorder->internPath(path));
+		}
+
+		virtual void close(File* file) override
+		{
+			TracingFile* tracing = static_cast<TracingFile*>(file);
+			_fs->close(tracing->getFile());
+			delete tracing;
+		}
+
+		virtual bool isExist(const char* path) override { return _fs->isExist(path); }
+
+		virtual bool createFile(const char* path) override { return _fs->createFile(path); }
+		virtual bool deleteFile(const char* path) override { return _fs->deleteFile(path); }
+
+		virtual bool createDirectory(const char* path) override { return _fs->createDirectory(path); }
+		virtual bool delteDirectory(const char* path) override { return _fs->delteDirectory(path); }
+
+		virtual bool enumerate(const char* path, uint32_t flags, DirectoryListing& listing) override { return _fs->enumerate(path, flags, listing); }
+		virtual void stat(const char* const* paths, uint32_t count, FileStat* stats) override { _fs->stat(paths, count, stats); }
+
+		virtual bool map(const char* path, size_t offset, size_t size, MappedRegion& region) override
+		{
+			if (!_fs->map(path, offset, size, region))
+			{
+				return false;
+			}
+
+			// mapped pages are faulted in by whoever touches them, so record the whole region up front
+			if (_recorder->isRecording())
+			{
+				_recorder->record(path, offset, region._size);
+			}
+			return true;
+		}
+
+		virtual void unmap(MappedRegion& region) override { _fs->unmap(region); }
+	};
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "core/filesystem/buffered_writer.h"
+
+#include <cstring>
+
+namespace monster
+{
+	BufferedFileWriter::BufferedFileWriter(File* file, uint32_t block_size, uint32_t max_blocks, BackpressurePolicy backpressure, SyncPolicy sync)
+		: _file(file)
+		, _block_size(block_size)
+		, _backpressure(backpressure)
+		, _sync(sync)
+		, _current(nullptr)
+		, _reserved(0)
+		, _quit(false)
+		, _dropped_bytes(0)
+		, _written_bytes(0)
+	{
+		for (uint32_t ii = 0; ii < (max_blocks < 2 ? 2 : max_blocks); ++ii)
+		{
+			_free.push_back(createBlock());
+			_free_sem.post();
+		}
+
+		_thread.init(threadFunc, this);
+	}
+
+	BufferedFileWriter::~BufferedFileWriter()
+	{
+		close();
+
+		for (Block* block : _blocks)
+		{
+			delete[] block->_data;
+			delete block;
+		}
+	}
+
+	BufferedFileWriter::Block* BufferedFileWriter::createBlock()
+	{
+		Block* block = new Block;
+		block->_data = new uint8_t[_block_size];
+		block->_size = 0;
+		_blocks.push_back(block);
+		return block;
+	}
+
+	BufferedFileWriter::Block* BufferedFileWriter::acquireBlock()
+	{
+		if (0 != _reserved)
+		{
+			--_reserved;
+		}
+		else switch (_backpressure)
+		{
+			case BackpressurePolicy::Block:
+				_free_sem.wait();
+				break;
+
+			case BackpressurePolicy::Drop:
+				if (!_free_sem.wait(0))
+				{
+					return nullptr;
+				}
+				break;
+
+			case BackpressurePolicy::Grow:
+				if (!_free_sem.wait(0))
+				{
+					MutexScope lock(_mutex);
+					return createBlock();
+				}
+				break;
+		}
+
+		MutexScope lock(_mutex);
+		Block* block = _free.back();
+		_free.pop_back();
+		return block;
+	}
+
+	void BufferedFileWriter::submit(Block* block)
+	{
+		{
+			MutexScope lock(_mutex);
+			_pending.push_back(block);
+		}
+		_pending_sem.post();
+	}
+
+	// Takes the free blocks the part of length past the current block
+	// needs, or none of them.
+	bool BufferedFileWriter::reserve(size_t length)
+	{
+		const size_t room = nullptr != _current ? _block_size - _current->_size : 0;
+		if (length <= room)
+		{
+			return true;
+		}
+
+		const size_t needed = (length - room + _block_size - 1) / _block_size;
+		while (_reserved < needed)
+		{
+			if (!_free_sem.wait(0))
+			{
+				_free_sem.post(_reserved);
+				_reserved = 0;
+				return false;
+			}
+			++_reserved;
+		}
+		return true;
+	}
+
+	size_t BufferedFileWriter::write(const void* buffer, size_t length)
+	{
+		// nothing would ever write it, or free a block to wait for
+		if (_quit)
+		{
+			return 0;
+		}
+
+		if (BackpressurePolicy::Drop == _backpressure
+			&& !reserve(length))
+		{
+			_dropped_bytes += length;
+			return 0;
+		}
+
+		const uint8_t* data = (const uint8_t*)buffer;
+		size_t accepted = 0;
+
+		while (accepted < length)
+		{
+			if (nullptr == _current)
+			{
+				_current = acquireBlock();
+				_current->_size = 0;
+			}
+
+			size_t room = _block_size - _current->_size;
+			size_t size = length - accepted < room ? length - accepted : room;
+			memcpy(&_current->_data[_current->_size], &data[accepted], size);
+			_current->_size += (uint32_t)size;
+			accepted += size;
+
+			if (_current->_size == _block_size)
+			{
+				submit(_current);
+				_current = nullptr;
+			}
+		}
+
+		return accepted;
+	}
+
+	void BufferedFileWriter::flush()
+	{
+		if (nullptr != _current
+			&& 0 != _current->_size)
+		{
+			submit(_current);
+			_current = nullptr;
+		}
+	}
+
+	void BufferedFileWriter::close()
+	{
+		if (!_thread.isRunning())
+		{
+			return;
+		}
+
+		flush();
+
+		_quit = true;
+		_pending_sem.post();
+		_thread.shutdown();
+
+		if (SyncPolicy::OnClose == _sync)
+		{
+			_file->sync(true);
+		}
+	}
+
+	int32_t BufferedFileWriter::threadFunc(void* user_data)
+	{
+		BufferedFileWriter* writer = (BufferedFileWriter*)user_data;
+		writer->process();
+		return 0;
+	}
+
+	void BufferedFileWriter::process()
+	{
+		for (;;)
+		{
+			_pending_sem.wait();
+
+			Block* block = nullptr;
+			{
+				MutexScope lock(_mutex);
+				if (!_pending.empty())
+				{
+					block = _pending.front();
+					_pending.erase(_pending.begin());
+				}
+			}
+
+			// the quit post is the last one, so everything submitted before it is drained first
+			if (nullptr == block)
+			{
+				if (_quit)
+				{
+					break;
+				}
+				continue;
+			}
+
+			_written_bytes += _file->write(block->_data, block->_size);
+			if (SyncPolicy::EveryBlock == _sync)
+			{
+				_file->sync(true);
+			}
+
+			block->_size = 0;
+			{
+				MutexScope lock(_mutex);
+				_free.push_back(block);
+			}
+			_free_sem.post();
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef __MONSTER_BUFFERED_WRITER_H__
+#define __MONSTER_BUFFERED_WRITER_H__
+
+#include <atomic>
+#include <vector>
+
+#include "core/mutex.h"
+#include "core/thread.h"
+#include "core/filesystem/file.h"
+
+namespace monster
+{
+	// What write() does when every block is waiting on the disk.
+	enum class BackpressurePolicy : uint8_t
+	{
+		Block,  // wait for the writer thread to hand a block back
+		Drop,   // discard the data and count it in getDroppedBytes()
+		Grow    // allocate another block; memory is no longer bounded
+	};
+
+	enum class SyncPolicy : uint8_t
+	{
+		None,       // leave it to the OS
+		EveryBlock, // fdatasync after each block is written
+		OnClose     // fdatasync once, when the writer is closed
+	};
+
+	// Write-behind wrapper around a File. The caller fills fixed-size blocks
+	// and a background thread writes full blocks to the file, so write() only
+	// ever copies memory unless the Block policy has to wait.
+	class BufferedFileWriter
+	{
+	private:
+		struct Block
+		{
+			uint8_t* _data;
+			uint32_t _size;
+		};
+
+		File* _file;
+		uint32_t _block_size;
+		BackpressurePolicy _backpressure;
+		SyncPolicy _sync;
+
+		Block* _current;
+		uint32_t _reserved;             // taken from _free_sem for the record being written
+		std::vector<Block*> _blocks;    // every block owned by the writer
+		std::vector<Block*> _free;
+		std::vector<Block*> _pending;   // full blocks in submit order
+
+		Mutex _mutex;
+		Semaphore _pending_sem;
+		Semaphore _free_sem;
+		Thread _thread;
+		volatile bool _quit;
+
+		uint64_t _dropped_bytes;
+		std::atomic<uint64_t> _written_bytes;   // added to by the writer thread
+
+	private:
+		Block* createBlock();
+		Block* acquireBlock();
+		bool reserve(size_t length);
+		void submit(Block* block);
+
+		static int32_t threadFunc(void* user_data);
+		void process();
+
+	public:
+		// max_blocks of 2 double-buffers: one block being filled while the other is written.
+		BufferedFileWriter(File* file,
+			uint32_t block_size = 64 << 10,
+			uint32_t max_blocks = 2,
+			BackpressurePolicy backpressure = BackpressurePolicy::Block,
+			SyncPolicy sync = SyncPolicy::None);
+		~BufferedFileWriter();
+
+		BufferedFileWriter(const BufferedFileWriter&) = delete;
+		BufferedFileWriter& operator = (const BufferedFileWriter&) = delete;
+
+		// Returns the number of bytes accepted. Under the Drop policy a write
+		// is taken whole or not at all, so records are never torn; one
+		// larger than every block together is always dropped. Nothing is
+		// accepted after close().
+		size_t write(const void* buffer, size_t length);
+
+		// Hands the partially filled block to the writer thread without waiting for it.
+		void flush();
+
+		// Writes out everything, applies the sync policy and stops the thread. The file stays open.
+		void close();
+
+		uint64_t getDroppedBytes() const { return _dropped_bytes; }
+		uint64_t getWrittenBytes() const { return _written_bytes; }
+	};
+}
+
+#endif
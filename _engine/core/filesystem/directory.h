@@ -0,0 +1,87 @@
+#ifndef __MONSTER_DIRECTORY_H__
+#define __MONSTER_DIRECTORY_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace monster
+{
+	struct FileStat
+	{
+		uint64_t _size;
+		uint64_t _mtime;        // seconds since epoch
+		bool _is_exist;
+		bool _is_directory;
+	};
+
+	enum EnumerateFlags : uint32_t
+	{
+		k_enumerate_none      = 0,
+		k_enumerate_recursive = 0x1,
+		k_enumerate_stat      = 0x2,   // fill size and mtime; costs one fstatat per entry on posix
+	};
+
+	// Flat result of a directory walk. Names live back to back in one char
+	// arena and each entry points at its parent entry, so a walk over 100k
+	// files costs two growing allocations instead of one string per file.
+	class DirectoryListing
+	{
+	public:
+		static const uint32_t k_root = UINT32_MAX;
+
+		struct Entry
+		{
+			uint32_t _name;         // offset into the name arena, null terminated
+			uint32_t _parent;       // entry index of the parent directory, or k_root
+			uint64_t _size;
+			uint64_t _mtime;
+			bool _is_directory;
+		};
+
+	private:
+		std::vector<Entry> _entries;
+		std::vector<char> _names;
+
+	public:
+		void clear()
+		{
+			_entries.clear();
+			_names.clear();
+		}
+
+		uint32_t add(const char* name, uint32_t length, uint32_t parent, bool is_directory)
+		{
+			Entry entry;
+			entry._name = (uint32_t)_names.size();
+			entry._parent = parent;
+			entry._size = 0;
+			entry._mtime = 0;
+			entry._is_directory = is_directory;
+
+			_names.insert(_names.end(), name, name + length);
+			_names.push_back('\0');
+
+			_entries.push_back(entry);
+			return (uint32_t)_entries.size() - 1;
+		}
+
+		uint32_t getCount() const { return (uint32_t)_entries.size(); }
+		const Entry& getEntry(uint32_t index) const { return _entries[index]; }
+		Entry& getEntry(uint32_t index) { return _entries[index]; }
+		const char* getName(uint32_t index) const { return &_names[_entries[index]._name]; }
+
+		// Path of the entry relative to the enumerated directory.
+		void getPath(uint32_t index, std::string& path) const
+		{
+			path = getName(index);
+			for (uint32_t parent = _entries[index]._parent; k_root != parent; parent = _entries[parent]._parent)
+			{
+				path.insert(0, 1, '/');
+				path.insert(0, getName(parent));
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,509 @@
+#include "core/filesystem/disk_filesystem.h"
+#include "core/platform.h"
+
+#include <fcntl.h>
+#include <cstring>
+#include <sys/stat.h>
+
+#if MONSTER_PLATFORM_WINDOWS
+#include <io.h>
+#include <direct.h>
+#define MONSTER_O_BINARY _O_BINARY
+#define monster_open     _open
+#define monster_close    _close
+#define monster_read     _read
+#define monster_write    _write
+#define monster_lseek    _lseeki64
+#define monster_unlink   _unlink
+#define monster_mkdir(_path) _mkdir(_path)
+#define monster_rmdir    _rmdir
+#define monster_access   _access
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#if MONSTER_PLATFORM_LINUX
+#include <sys/syscall.h>
+#endif
+#define MONSTER_O_BINARY 0
+#define monster_open     ::open
+#define monster_close    ::close
+#define monster_read     ::read
+#define monster_write    ::write
+#define monster_lseek    ::lseek
+#define monster_unlink   ::unlink
+#define monster_mkdir(_path) ::mkdir(_path, 0755)
+#define monster_rmdir    ::rmdir
+#define monster_access   ::access
+#endif
+
+namespace monster
+{
+#if MONSTER_PLATFORM_WINDOWS
+	static uint64_t toUnixTime(const FILETIME& time)
+	{
+		uint64_t ticks = ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+		return ticks / 10000000 - UINT64_C(11644473600);
+	}
+
+	static void enumerateDirectory(const std::string& dir, uint32_t parent, uint32_t flags, DirectoryListing& listing)
+	{
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileExA((dir + "\\*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+		if (INVALID_HANDLE_VALUE == find)
+		{
+			return;
+		}
+
+		uint32_t first = listing.getCount();
+		do
+		{
+			const char* name = data.cFileName;
+			if ('.' == name[0]
+				&& ('\0' == name[1] || ('.' == name[1] && '\0' == name[2])))
+			{
+				continue;
+			}
+
+			bool is_directory = 0 != (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+			uint32_t index = listing.add(name, (uint32_t)strlen(name), parent, is_directory);
+
+			// the find data already carries size and time, so k_enumerate_stat is free here
+			DirectoryListing::Entry& entry = listing.getEntry(index);
+			entry._size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			entry._mtime = toUnixTime(data.ftLastWriteTime);
+		}
+		while (FindNextFileA(find, &data));
+
+		FindClose(find);
+
+		if (0 != (flags & k_enumerate_recursive))
+		{
+			for (uint32_t ii = first, last = listing.getCount(); ii < last; ++ii)
+			{
+				if (listing.getEntry(ii)._is_directory)
+				{
+					enumerateDirectory(dir + "\\" + listing.getName(ii), ii, flags, listing);
+				}
+			}
+		}
+	}
+#else
+	static void statEntry(int32_t dir_fd, const char* name, DirectoryListing::Entry& entry)
+	{
+		struct stat st;
+		if (0 == fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW))
+		{
+			entry._size = (uint64_t)st.st_size;
+			entry._mtime = (uint64_t)st.st_mtime;
+			entry._is_directory = S_ISDIR(st.st_mode);
+		}
+	}
+
+#if MONSTER_PLATFORM_LINUX
+	struct LinuxDirent64
+	{
+		uint64_t _ino;
+		int64_t _off;
+		uint16_t _reclen;
+		uint8_t _type;
+		char _name[1];
+	};
+#endif
+
+	// Children of a directory are listed completely before descending, so a
+	// single getdents buffer serves the whole walk and at most one descriptor
+	// per level is open.
+	static void enumerateDirectory(int32_t dir_fd, uint32_t parent, uint32_t flags, DirectoryListing& listing, std::vector<char>& buffer)
+	{
+		uint32_t first = listing.getCount();
+
+#if MONSTER_PLATFORM_LINUX
+		for (;;)
+		{
+			long size = syscall(SYS_getdents64, dir_fd, &buffer[0], buffer.size());
+			if (0 >= size)
+			{
+				break;
+			}
+
+			for (long offset = 0; offset < size; )
+			{
+				const LinuxDirent64* dirent = (const LinuxDirent64*)&buffer[offset];
+				offset += dirent->_reclen;
+
+				const char* name = dirent->_name;
+				uint8_t type = dirent->_type;
+#else
+		int32_t dup_fd = dup(dir_fd);
+		DIR* dir = fdopendir(dup_fd);
+		if (nullptr == dir)
+		{
+			::close(dup_fd);
+			return;
+		}
+
+		{
+			for (const dirent* ent = readdir(dir); nullptr != ent; ent = readdir(dir))
+			{
+				const char* name = ent->d_name;
+				uint8_t type = ent->d_type;
+#endif
+				if ('.' == name[0]
+					&& ('\0' == name[1] || ('.' == name[1] && '\0' == name[2])))
+				{
+					continue;
+				}
+
+				uint32_t index = listing.add(name, (uint32_t)strlen(name), parent, DT_DIR == type);
+				if (DT_UNKNOWN == type
+					|| 0 != (flags & k_enumerate_stat))
+				{
+					statEntry(dir_fd, name, listing.getEntry(index));
+				}
+			}
+		}
+
+#if !MONSTER_PLATFORM_LINUX
+		closedir(dir);
+#endif
+
+		if (0 != (flags & k_enumerate_recursive))
+		{
+			for (uint32_t ii = first, last = listing.getCount(); ii < last; ++ii)
+			{
+				if (!listing.getEntry(ii)._is_directory)
+				{
+					continue;
+				}
+
+				int32_t child_fd = openat(dir_fd, listing.getName(ii), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+				if (0 <= child_fd)
+				{
+					enumerateDirectory(child_fd, ii, flags, listing, buffer);
+					::close(child_fd);
+				}
+			}
+		}
+	}
+#endif
+	DiskFile::DiskFile(const char* path, FileOpenMode mode)
+		: File(mode)
+		, _mode(mode)
+	{
+		int flags = FileOpenMode::read == mode
+			? O_RDONLY
+			: O_WRONLY | O_CREAT | O_TRUNC
+			;
+
+		_fd = monster_open(path, flags | MONSTER_O_BINARY, 0644);
+	}
+
+	DiskFile::~DiskFile()
+	{
+		if (isOpen())
+		{
+			monster_close(_fd);
+		}
+	}
+
+	size_t DiskFile::read(void* buffer, size_t length)
+	{
+		size_t total = 0;
+		while (total < length)
+		{
+			auto result = monster_read(_fd, (char*)buffer + total, (unsigned)(length - total));
+			if (0 >= result)
+			{
+				break;
+			}
+			total += result;
+		}
+		return total;
+	}
+
+	size_t DiskFile::write(const void* buffer, size_t length)
+	{
+		size_t total = 0;
+		while (total < length)
+		{
+			auto result = monster_write(_fd, (const char*)buffer + total, (unsigned)(length - total));
+			if (0 >= result)
+			{
+				break;
+			}
+			total += result;
+		}
+		return total;
+	}
+
+	void DiskFile::seek(size_t position)
+	{
+		monster_lseek(_fd, position, SEEK_SET);
+	}
+
+	void DiskFile::seekEnd()
+	{
+		monster_lseek(_fd, 0, SEEK_END);
+	}
+
+	void DiskFile::skip(size_t bytes)
+	{
+		monster_lseek(_fd, bytes, SEEK_CUR);
+	}
+
+	size_t DiskFile::tell() const
+	{
+		return (size_t)monster_lseek(_fd, 0, SEEK_CUR);
+	}
+
+	bool DiskFile::sync(bool data_only)
+	{
+#if MONSTER_PLATFORM_WINDOWS
+		(void)data_only;
+		return 0 == _commit(_fd);
+#elif MONSTER_PLATFORM_LINUX || MONSTER_PLATFORM_ANDROID
+		return 0 == (data_only ? fdatasync(_fd) : fsync(_fd));
+#else
+		(void)data_only;
+		return 0 == fsync(_fd);
+#endif
+	}
+
+	DiskFileSystem::DiskFileSystem(const char* root)
+		: _root(root)
+	{
+		if (!_root.empty()
+			&& '/' != _root.back())
+		{
+			_root += '/';
+		}
+	}
+
+	std::string DiskFileSystem::getFullPath(const char* path) const
+	{
+		return _root + path;
+	}
+
+	File* DiskFileSystem::open(const char* path, FileOpenMode mode)
+	{
+		DiskFile* file = new DiskFile(getFullPath(path).c_str(), mode);
+		if (!file->isOpen())
+		{
+			delete file;
+			return nullptr;
+		}
+		return file;
+	}
+
+	void DiskFileSystem::close(File* file)
+	{
+		delete file;
+	}
+
+	bool DiskFileSystem::isExist(const char* path)
+	{
+		return 0 == monster_access(getFullPath(path).c_str(), 0);
+	}
+
+	bool DiskFileSystem::createFile(const char* path)
+	{
+		int32_t fd = monster_open(getFullPath(path).c_str(), O_WRONLY | O_CREAT | MONSTER_O_BINARY, 0644);
+		if (0 > fd)
+		{
+			return false;
+		}
+		monster_close(fd);
+		return true;
+	}
+
+	bool DiskFileSystem::deleteFile(const char* path)
+	{
+		return 0 == monster_unlink(getFullPath(path).c_str());
+	}
+
+	bool DiskFileSystem::createDirectory(const char* path)
+	{
+		return 0 == monster_mkdir(getFullPath(path).c_str());
+	}
+
+	bool DiskFileSystem::delteDirectory(const char* path)
+	{
+		return 0 == monster_rmdir(getFullPath(path).c_str());
+	}
+
+	bool DiskFileSystem::enumerate(const char* path, uint32_t flags, DirectoryListing& listing)
+	{
+		std::string full = getFullPath(path);
+		if (full.empty())
+		{
+			full = ".";
+		}
+
+#if MONSTER_PLATFORM_WINDOWS
+		DWORD attributes = GetFileAttributesA(full.c_str());
+		if (INVALID_FILE_ATTRIBUTES == attributes
+			|| 0 == (attributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return false;
+		}
+
+		enumerateDirectory(full, DirectoryListing::k_root, flags, listing);
+#else
+		int32_t dir_fd = ::open(full.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (0 > dir_fd)
+		{
+			return false;
+		}
+
+		std::vector<char> buffer(64 << 10);
+		enumerateDirectory(dir_fd, DirectoryListing::k_root, flags, listing, buffer);
+		::close(dir_fd);
+#endif
+		return true;
+	}
+
+	void DiskFileSystem::stat(const char* const* paths, uint32_t count, FileStat* stats)
+	{
+#if MONSTER_PLATFORM_WINDOWS
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			FileStat& result = stats[ii];
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			result._is_exist = 0 != GetFileAttributesExA(getFullPath(paths[ii]).c_str(), GetFileExInfoStandard, &data);
+			result._is_directory = result._is_exist && 0 != (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+			result._size = result._is_exist ? ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow : 0;
+			result._mtime = result._is_exist ? toUnixTime(data.ftLastWriteTime) : 0;
+		}
+#else
+		// consecutive paths in one directory share a descriptor, so the kernel
+		// walks the directory part once per run instead of once per file
+		std::string dir;
+		int32_t dir_fd = -1;
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			std::string full = getFullPath(paths[ii]);
+			size_t slash = full.rfind('/');
+			std::string parent = std::string::npos == slash ? std::string(".") : full.substr(0, slash + 1);
+			const char* name = std::string::npos == slash ? full.c_str() : full.c_str() + slash + 1;
+
+			if (parent != dir
+				|| 0 > dir_fd)
+			{
+				if (0 <= dir_fd)
+				{
+					::close(dir_fd);
+				}
+				dir = parent;
+				dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			}
+
+			FileStat& result = stats[ii];
+			struct stat st;
+			result._is_exist = 0 <= dir_fd && 0 == fstatat(dir_fd, name, &st, 0);
+			result._is_directory = result._is_exist && S_ISDIR(st.st_mode);
+			result._size = result._is_exist ? (uint64_t)st.st_size : 0;
+			result._mtime = result._is_exist ? (uint64_t)st.st_mtime : 0;
+		}
+
+		if (0 <= dir_fd)
+		{
+			::close(dir_fd);
+		}
+#endif
+	}
+
+	bool DiskFileSystem::map(const char* path, size_t offset, size_t size, MappedRegion& region)
+	{
+		std::string full = getFullPath(path);
+
+#if MONSTER_PLATFORM_WINDOWS
+		HANDLE file = CreateFileA(full.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (INVALID_HANDLE_VALUE == file)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+		GetFileSizeEx(file, &file_size);
+		size_t length = (size_t)file_size.QuadPart;
+
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		size_t granularity = info.dwAllocationGranularity;
+#else
+		int32_t fd = ::open(full.c_str(), O_RDONLY | O_CLOEXEC);
+		if (0 > fd)
+		{
+			return false;
+		}
+
+		struct stat st;
+		fstat(fd, &st);
+		size_t length = (size_t)st.st_size;
+		size_t granularity = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+
+		bool result = false;
+		if (offset < length)
+		{
+			size = 0 == size || size > length - offset ? length - offset : size;
+
+			size_t base_offset = offset & ~(granularity - 1);
+			size_t base_size = size + (offset - base_offset);
+			void* base = nullptr;
+
+#if MONSTER_PLATFORM_WINDOWS
+			HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (NULL != mapping)
+			{
+				base = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)((uint64_t)base_offset >> 32), (DWORD)base_offset, base_size);
+				// the view keeps the mapping object alive
+				CloseHandle(mapping);
+			}
+#else
+			base = mmap(nullptr, base_size, PROT_READ, MAP_PRIVATE, fd, (off_t)base_offset);
+			if (MAP_FAILED == base)
+			{
+				base = nullptr;
+			}
+#endif
+
+			if (nullptr != base)
+			{
+				region._base = base;
+				region._base_size = base_size;
+				region._data = (const uint8_t*)base + (offset - base_offset);
+				region._size = size;
+				result = true;
+			}
+		}
+
+#if MONSTER_PLATFORM_WINDOWS
+		CloseHandle(file);
+#else
+		::close(fd);
+#endif
+		return result;
+	}
+
+	void DiskFileSystem::unmap(MappedRegion& region)
+	{
+		if (nullptr == region._base)
+		{
+			return;
+		}
+
+#if MONSTER_PLATFORM_WINDOWS
+		UnmapViewOfFile(region._base);
+#else
+		munmap(region._base, region._base_size);
+#endif
+		region._base = nullptr;
+		region._base_size = 0;
+		region._data = nullptr;
+		region._size = 0;
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef __MONSTER_DISK_FILESYSTEM_H__
+#define __MONSTER_DISK_FILESYSTEM_H__
+
+#include <string>
+#include "core/filesystem/filesystem.h"
+
+namespace monster
+{
+	class DiskFile : public File
+	{
+	private:
+		int32_t _fd;
+		FileOpenMode _mode;
+
+	public:
+		DiskFile(const char* path, FileOpenMode mode);
+		virtual ~DiskFile();
+
+		bool isOpen() const { return 0 <= _fd; }
+		int32_t getFd() const { return _fd; }
+
+		virtual size_t read(void* buffer, size_t length) override;
+		virtual size_t write(const void* buffer, size_t length) override;
+		virtual void seek(size_t position) override;
+		virtual void seekEnd() override;
+		virtual void skip(size_t bytes) override;
+		virtual size_t tell() const override;
+		virtual bool sync(bool data_only) override;
+	};
+
+	// Loose files on the local disk, with every path resolved against a root directory.
+	class DiskFileSystem : public FileSystem
+	{
+	private:
+		std::string _root;
+
+	public:
+		explicit DiskFileSystem(const char* root = "");
+		virtual ~DiskFileSystem() {}
+
+		const char* getRoot() const { return _root.c_str(); }
+		std::string getFullPath(const char* path) const;
+
+		virtual File* open(const char* path, FileOpenMode mode) override;
+		virtual void close(File* file) override;
+
+		virtual bool isExist(const char* path) override;
+
+		virtual bool createFile(const char* path) override;
+		virtual bool deleteFile(const char* path) override;
+
+		virtual bool createDirectory(const char* path) override;
+		virtual bool delteDirectory(const char* path) override;
+
+		virtual bool enumerate(const char* path, uint32_t flags, DirectoryListing& listing) override;
+		virtual void stat(const char* const* paths, uint32_t count, FileStat* stats) override;
+
+		virtual bool map(const char* path, size_t offset, size_t size, MappedRegion& region) override;
+		virtual void unmap(MappedRegion& region) override;
+	};
+}
+
+#endif
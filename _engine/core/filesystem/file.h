@@ -2,6 +2,7 @@
 #define __MONSTER_FILE_H__
 
 #include <cstdint>
+#include <cstddef>
 
 namespace monster
 {
@@ -23,6 +24,9 @@ namespace monster
 		virtual void seekEnd() = 0;
 		virtual void skip(size_t bytes) = 0;
 		virtual size_t tell() const = 0;
+
+		// Blocks until written data reaches storage. data_only skips metadata such as mtime.
+		virtual bool sync(bool data_only) = 0;
 	};
 }
 
@@ -2,9 +2,18 @@
 #define __MONSTER_FILESYSTEM_H__
 
 #include "core/filesystem/file.h"
+#include "core/filesystem/directory.h"
 
 namespace monster
 {
+	struct MappedRegion
+	{
+		const void* _data;      // first requested byte
+		size_t _size;
+		void* _base;            // start of the mapping, aligned down to the OS granularity
+		size_t _base_size;
+	};
+
 	class FileSystem
 	{
 	private:
@@ -26,6 +35,18 @@ namespace monster
 		virtual bool createDirectory(const char* path) = 0;
 		virtual bool delteDirectory(const char* path) = 0;
 
+		// Appends the entries below path to listing; see EnumerateFlags.
+		virtual bool enumerate(const char* path, uint32_t flags, DirectoryListing& listing) = 0;
+
+		// Fills stats[ii] for paths[ii]; missing files come back with _is_exist false.
+		virtual void stat(const char* const* paths, uint32_t count, FileStat* stats) = 0;
+
+		// Maps [offset, offset + size) of a file read-only; size 0 maps to the end of the file.
+		virtual bool map(const char* path, size_t offset, size_t size, MappedRegion& region) = 0;
+
+		// Must be callable from any thread, bgfx releases mapped memory on the render thread.
+		virtual void unmap(MappedRegion& region) = 0;
+
 	};
 }
 
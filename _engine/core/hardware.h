@@ -2,8 +2,7 @@
 #define __MONSTER_HARDWARE_H__
 
 #include <cstdint>
-
-#define MONSTER_COMPILER_MSVC 1
+#include "core/platform.h"
 
 #if MONSTER_COMPILER_MSVC
 #include <intrin.h>
@@ -14,6 +13,7 @@
 #pragma intrinsic(_ReadWriteBarrier)
 #pragma intrinsic(_InterlockedIncrement)
 #pragma intrinsic(_InterlockedDecrement)
+#pragma intrinsic(_InterlockedExchangeAdd)
 #pragma intrinsic(_InterlockedCompareExchange)
 #endif
 
@@ -73,6 +73,15 @@ namespace monster
 #endif
 	}
 
+	inline int32_t atomicAdd(volatile void* ptr, int32_t value)
+	{
+#if MONSTER_COMPILER_MSVC
+		return _InterlockedExchangeAdd((volatile LONG*)ptr, value) + value;
+#else
+		return __sync_add_and_fetch((volatile int32_t*)ptr, value);
+#endif
+	}
+
 	inline int32_t atomicCompareAndSwap(volatile void* ptr, int32_t old_value, int32_t new_value)
 	{
 #if MONSTER_COMPILER_MSVC
@@ -0,0 +1,178 @@
+#include "core/job/job_system.h"
+
+#include <algorithm>
+
+namespace monster
+{
+	void JobSystem::initialize(uint32_t worker_count)
+	{
+		if (0 == worker_count)
+		{
+			uint32_t cpu_count = getCpuCount();
+			worker_count = 1 < cpu_count ? cpu_count - 1 : 1;
+		}
+
+		_quit = false;
+		for (uint32_t ii = 0; ii < worker_count; ++ii)
+		{
+			Thread* thread = new Thread;
+			thread->init(workerFunc, this);
+			_workers.push_back(thread);
+		}
+	}
+
+	void JobSystem::shutdown()
+	{
+		if (_workers.empty())
+		{
+			return;
+		}
+
+		_quit = true;
+		_work_sem.post((uint32_t)_workers.size());
+
+		for (Thread* thread : _workers)
+		{
+			thread->shutdown();
+			delete thread;
+		}
+		_workers.clear();
+	}
+
+	bool JobSystem::pop(Job& job)
+	{
+		MutexScope lock(_mutex);
+		if (0 == _count)
+		{
+			return false;
+		}
+
+		job = _queue[_head];
+		_head = _head + 1 == _queue.size() ? 0 : _head + 1;
+		--_count;
+		return true;
+	}
+
+	void JobSystem::run(const Job& job)
+	{
+		job._fn(job._data, job._begin, job._end);
+		if (nullptr != job._counter)
+		{
+			job._counter->decrement();
+		}
+	}
+
+	void JobSystem::push(const Job& job)
+	{
+		push(&job, 1);
+	}
+
+	void JobSystem::push(const Job* jobs, uint32_t count)
+	{
+		if (0 == count)
+		{
+			return;
+		}
+
+		{
+			MutexScope lock(_mutex);
+			uint32_t capacity = (uint32_t)_queue.size();
+			if (_count + count > capacity)
+			{
+				// unwrap into a larger buffer
+				std::vector<Job> queue(std::max(capacity * 2, _count + count));
+				for (uint32_t ii = 0; ii < _count; ++ii)
+				{
+					queue[ii] = _queue[(_head + ii) % capacity];
+				}
+				_queue.swap(queue);
+				_head = 0;
+				capacity = (uint32_t)_queue.size();
+			}
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				_queue[(_head + _count) % capacity] = jobs[ii];
+				++_count;
+			}
+		}
+
+		// without workers everything runs inside wait()
+		if (!_workers.empty())
+		{
+			_work_sem.post(count);
+		}
+	}
+
+	void JobSystem::wait(JobCounter& counter)
+	{
+		Job job;
+		while (!counter.isDone())
+		{
+			if (pop(job))
+			{
+				run(job);
+			}
+			else
+			{
+				yieldThread();
+			}
+		}
+
+		readWriteBarrier();
+	}
+
+	void JobSystem::parallelFor(uint32_t count, uint32_t grain, JobFunc fn, void* data, JobCounter& counter)
+	{
+		if (0 == count)
+		{
+			return;
+		}
+
+		grain = 0 == grain ? 1 : grain;
+		uint32_t num_jobs = (count + grain - 1) / grain;
+		counter.add((int32_t)num_jobs);
+
+		// queued in batches from the stack so a per-frame loop doesn't allocate
+		const uint32_t k_batch_size = 64;
+		Job jobs[k_batch_size];
+		for (uint32_t first = 0; first < num_jobs; first += k_batch_size)
+		{
+			uint32_t batch = num_jobs - first < k_batch_size ? num_jobs - first : k_batch_size;
+			for (uint32_t ii = 0; ii < batch; ++ii)
+			{
+				Job& job = jobs[ii];
+				job._fn = fn;
+				job._data = data;
+				job._begin = (first + ii) * grain;
+				job._end = count < job._begin + grain ? count : job._begin + grain;
+				job._counter = &counter;
+			}
+
+			push(jobs, batch);
+		}
+	}
+
+	int32_t JobSystem::workerFunc(void* user_data)
+	{
+		JobSystem* system = (JobSystem*)user_data;
+
+		Job job;
+		for (;;)
+		{
+			system->_work_sem.wait();
+			if (system->_quit)
+			{
+				break;
+			}
+
+			// the job this post was meant for may already have been taken by a waiting thread
+			if (system->pop(job))
+			{
+				run(job);
+			}
+		}
+
+		return 0;
+	}
+}
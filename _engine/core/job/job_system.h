@@ -0,0 +1,99 @@
+#ifndef __MONSTER_JOB_SYSTEM_H__
+#define __MONSTER_JOB_SYSTEM_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "core/hardware.h"
+#include "core/mutex.h"
+#include "core/thread.h"
+
+namespace monster
+{
+	// Number of jobs still outstanding. Jobs decrement it when they finish.
+	class JobCounter
+	{
+	private:
+		volatile int32_t _value;
+
+	public:
+		explicit JobCounter(int32_t value = 0) : _value(value) {}
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator = (const JobCounter&) = delete;
+
+		void add(int32_t value) { atomicAdd(&_value, value); }
+		int32_t decrement() { return atomicDec(&_value); }
+		bool isDone() const { return 0 >= _value; }
+	};
+
+	typedef void (*JobFunc)(void* data, uint32_t begin, uint32_t end);
+
+	struct Job
+	{
+		JobFunc _fn;
+		void* _data;
+		uint32_t _begin;
+		uint32_t _end;
+		JobCounter* _counter;
+	};
+
+	// Fixed pool of worker threads pulling from one shared queue. Any thread,
+	// workers included, may push jobs; wait() runs queued jobs on the calling
+	// thread instead of blocking, so waiting from inside a job can't deadlock.
+	class JobSystem
+	{
+	private:
+		std::vector<Thread*> _workers;
+		std::vector<Job> _queue;     // ring buffer, grows when full and never shrinks
+		uint32_t _head;
+		uint32_t _count;
+		Mutex _mutex;
+		Semaphore _work_sem;
+		volatile bool _quit;
+
+	private:
+		bool pop(Job& job);
+		static void run(const Job& job);
+		static int32_t workerFunc(void* user_data);
+
+		template <class F>
+		static void rangeTrampoline(void* data, uint32_t begin, uint32_t end)
+		{
+			(*(F*)data)(begin, end);
+		}
+
+	public:
+		JobSystem() : _head(0), _count(0), _quit(false) {}
+		~JobSystem() { shutdown(); }
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator = (const JobSystem&) = delete;
+
+		// worker_count 0 uses one worker per core, minus the calling thread.
+		void initialize(uint32_t worker_count = 0);
+		void shutdown();
+
+		uint32_t getWorkerCount() const { return (uint32_t)_workers.size(); }
+
+		void push(const Job& job);
+		void push(const Job* jobs, uint32_t count);
+
+		// Helps with queued work until counter reaches zero.
+		void wait(JobCounter& counter);
+
+		// Splits [0, count) into ranges of at most grain and queues one job per range.
+		void parallelFor(uint32_t count, uint32_t grain, JobFunc fn, void* data, JobCounter& counter);
+
+		// Blocking variant for a callable taking (begin, end).
+		template <class F>
+		void parallelFor(uint32_t count, uint32_t grain, F& fn)
+		{
+			JobCounter counter;
+			parallelFor(count, grain, rangeTrampoline<F>, &fn, counter);
+			wait(counter);
+		}
+	};
+}
+
+#endif
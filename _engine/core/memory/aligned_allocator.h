@@ -0,0 +1,54 @@
+#ifndef __MONSTER_ALIGNED_ALLOCATOR_H__
+#define __MONSTER_ALIGNED_ALLOCATOR_H__
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace monster
+{
+	// std allocator for SIMD data. operator new only promises 8 bytes on
+	// 32-bit targets, too little for aligned float4 loads. The offset back
+	// to the malloc block sits in the byte before the data.
+	template <class T, size_t AlignT = 16>
+	class AlignedAllocator
+	{
+		static_assert(0 == (AlignT & (AlignT - 1)) && AlignT <= 128, "alignment must be a power of two up to 128");
+
+	public:
+		typedef T value_type;
+
+		template <class U>
+		struct rebind { typedef AlignedAllocator<U, AlignT> other; };
+
+		AlignedAllocator() {}
+
+		template <class U>
+		AlignedAllocator(const AlignedAllocator<U, AlignT>&) {}
+
+		T* allocate(size_t count)
+		{
+			uint8_t* raw = (uint8_t*)malloc(count * sizeof(T) + AlignT);
+			uint8_t* data = (uint8_t*)(((uintptr_t)raw + AlignT) & ~(uintptr_t)(AlignT - 1));
+			data[-1] = (uint8_t)(data - raw);
+			return (T*)data;
+		}
+
+		void deallocate(T* p, size_t)
+		{
+			uint8_t* data = (uint8_t*)p;
+			free(data - data[-1]);
+		}
+
+		template <class U>
+		bool operator == (const AlignedAllocator<U, AlignT>&) const { return true; }
+
+		template <class U>
+		bool operator != (const AlignedAllocator<U, AlignT>&) const { return false; }
+	};
+
+	template <class T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T> >;
+}
+
+#endif
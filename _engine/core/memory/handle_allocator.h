@@ -166,7 +166,7 @@ namespace monster
 		}
 	};
 
-	HandleAlloc* createHandleAlloc(AllocatorI* allocator, uint16_t max_handles_count)
+	inline HandleAlloc* createHandleAlloc(AllocatorI* allocator, uint16_t max_handles_count)
 	{
 		uint8_t* ptr = (uint8_t*)monster::alloc(allocator, sizeof(HandleAlloc) + 2 * max_handles_count*sizeof(uint16_t));
 		return ::new (ptr) HandleAlloc(max_handles_count, &ptr[sizeof(HandleAlloc)]);
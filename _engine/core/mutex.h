@@ -6,9 +6,11 @@
 #ifndef BX_MUTEX_H_HEADER_GUARD
 #define BX_MUTEX_H_HEADER_GUARD
 
-#include "hardware.h"
+#include "core/hardware.h"
 
-#define MONSTER_PLATFORM_WINDOWS 1
+#if MONSTER_PLATFORM_POSIX
+#include <pthread.h>
+#endif
 
 namespace monster
 {
@@ -69,7 +71,7 @@ namespace monster
 
 	inline int thread_mutex_init(thread_mutex_t* mutex, thread_mutexattr_t* /*attr*/)
 	{
-		return pthread_mutex_init(mutex);
+		return pthread_mutex_init(mutex, NULL);
 	}
 
 	inline int thread_mutex_destroy(thread_mutex_t* mutex)
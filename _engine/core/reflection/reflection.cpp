@@ -0,0 +1,49 @@
+#include "core/reflection/reflection.h"
+
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+#include "core/mutex.h"
+
+namespace monster
+{
+	static Mutex& getRegistryMutex()
+	{
+		static Mutex s_mutex;
+		return s_mutex;
+	}
+
+	static std::unordered_map<TypeId, const TypeInfo*>& getRegistry()
+	{
+		static std::unordered_map<TypeId, const TypeInfo*> s_types;
+		return s_types;
+	}
+
+	const FieldInfo* TypeInfo::findField(const char* name) const
+	{
+		for (uint32_t ii = 0; ii < _field_count; ++ii)
+		{
+			if (0 == strcmp(_fields[ii]._name, name))
+			{
+				return &_fields[ii];
+			}
+		}
+		return nullptr;
+	}
+
+	void TypeRegistry::registerType(const TypeInfo* info)
+	{
+		MutexScope lock(getRegistryMutex());
+		const TypeInfo*& slot = getRegistry()[info->_id];
+		assert((nullptr == slot || slot == info) && "type id collision, rename one of the types");
+		slot = info;
+	}
+
+	const TypeInfo* TypeRegistry::find(TypeId id)
+	{
+		MutexScope lock(getRegistryMutex());
+		std::unordered_map<TypeId, const TypeInfo*>::const_iterator it = getRegistry().find(id);
+		return getRegistry().end() == it ? nullptr : it->second;
+	}
+}
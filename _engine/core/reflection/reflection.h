@@ -0,0 +1,295 @@
+#ifndef __MONSTER_REFLECTION_H__
+#define __MONSTER_REFLECTION_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace monster
+{
+	typedef uint32_t TypeId;
+
+	// FNV-1a of the type name. constexpr so ids can be used as case labels and
+	// template arguments, and stable across builds and platforms.
+	constexpr uint32_t hashTypeName(const char* str, uint32_t hash = 2166136261u)
+	{
+		return 0 == *str ? hash : hashTypeName(str + 1, (hash ^ (uint32_t)(uint8_t)*str) * 16777619u);
+	}
+
+	enum class FieldType : uint8_t
+	{
+		Bool,
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Int64,
+		UInt64,
+		Float,
+		Double,
+		Struct,  // another reflected type, see FieldInfo::getStruct()
+		Array,   // variable length, stored as a relative offset and count (BlobArray)
+		Opaque   // copied as raw bytes
+	};
+
+	struct TypeInfo;
+
+	struct FieldInfo
+	{
+		const char* _name;
+		uint32_t _offset;
+		uint32_t _size;            // of one element
+		uint32_t _count;           // number of elements, 1 unless the field is an array
+		FieldType _type;
+		FieldType _element_type;   // same as _type except for FieldType::Array
+		const TypeInfo* (*_get_struct)();   // element type when _element_type is FieldType::Struct
+
+		// resolved lazily so a type can hold a BlobArray of itself
+		const TypeInfo* getStruct() const { return nullptr != _get_struct ? _get_struct() : nullptr; }
+	};
+
+	struct TypeInfo
+	{
+		const char* _name;
+		TypeId _id;
+		uint32_t _size;
+		uint32_t _align;
+		const void* _default;      // value-initialized instance, for fields missing from old data
+		const FieldInfo* _fields;
+		uint32_t _field_count;
+
+		const FieldInfo* findField(const char* name) const;
+	};
+
+	// Runtime lookup by id, for data that names its type (serialized blobs,
+	// editor selections). A type is registered the first time getTypeInfo<T>()
+	// runs for it.
+	class TypeRegistry
+	{
+	public:
+		static void registerType(const TypeInfo* info);
+		static const TypeInfo* find(TypeId id);
+	};
+
+	// Specialised by MONSTER_REFLECT_BEGIN; the primary template marks a type as not reflected.
+	template <class T>
+	struct Reflect
+	{
+	};
+
+	template <class T, class Enable = void>
+	struct IsReflected : std::false_type
+	{
+	};
+
+	template <class T>
+	struct IsReflected<T, typename std::enable_if<0 != sizeof(&Reflect<T>::getId)>::type> : std::true_type
+	{
+	};
+
+	// How a member type is described in a FieldInfo. Specialise it to give a
+	// custom type its own FieldType or element layout.
+	template <class M, class Enable = void>
+	struct FieldTraits
+	{
+		typedef M Element;
+		static constexpr uint32_t k_count = 1;
+		static constexpr FieldType k_type = IsReflected<M>::value ? FieldType::Struct : FieldType::Opaque;
+	};
+
+#define MONSTER_REFLECT_PRIMITIVE(_type, _field_type) \
+	template <> \
+	struct FieldTraits<_type> \
+	{ \
+		typedef _type Element; \
+		static constexpr uint32_t k_count = 1; \
+		static constexpr FieldType k_type = FieldType::_field_type; \
+	}
+
+	MONSTER_REFLECT_PRIMITIVE(bool, Bool);
+	MONSTER_REFLECT_PRIMITIVE(int8_t, Int8);
+	MONSTER_REFLECT_PRIMITIVE(uint8_t, UInt8);
+	MONSTER_REFLECT_PRIMITIVE(int16_t, Int16);
+	MONSTER_REFLECT_PRIMITIVE(uint16_t, UInt16);
+	MONSTER_REFLECT_PRIMITIVE(int32_t, Int32);
+	MONSTER_REFLECT_PRIMITIVE(uint32_t, UInt32);
+	MONSTER_REFLECT_PRIMITIVE(int64_t, Int64);
+	MONSTER_REFLECT_PRIMITIVE(uint64_t, UInt64);
+	MONSTER_REFLECT_PRIMITIVE(float, Float);
+	MONSTER_REFLECT_PRIMITIVE(double, Double);
+
+#undef MONSTER_REFLECT_PRIMITIVE
+
+	// enums are stored as their underlying integer
+	template <class M>
+	struct FieldTraits<M, typename std::enable_if<std::is_enum<M>::value>::type>
+		: FieldTraits<typename std::underlying_type<M>::type>
+	{
+	};
+
+	// fixed arrays, including nested ones, flatten to count elements
+	template <class M, size_t N>
+	struct FieldTraits<M[N], void>
+	{
+		typedef typename FieldTraits<M>::Element Element;
+		static constexpr uint32_t k_count = (uint32_t)N * FieldTraits<M>::k_count;
+		static constexpr FieldType k_type = FieldTraits<M>::k_type;
+		static_assert(FieldType::Array != FieldTraits<M>::k_type, "fixed arrays of variable length arrays are not supported");
+	};
+
+	// Compile-time field descriptor handed to forEachField visitors. The
+	// member pointer is a template argument, so get() inlines to a plain
+	// member access and a visitor loop costs the same as hand-written code.
+	template <class T, class M, M T::* Member>
+	struct Field
+	{
+		typedef T Owner;
+		typedef M Type;
+		typedef FieldTraits<M> Traits;
+
+		const char* _name;
+		uint32_t _offset;
+
+		static M& get(T& object) { return object.*Member; }
+		static const M& get(const T& object) { return object.*Member; }
+	};
+
+	// Calls visitor(field) for every reflected field of T, in declaration order.
+	template <class T, class V>
+	inline void forEachField(V&& visitor)
+	{
+		static_assert(IsReflected<T>::value, "type is not reflected, see MONSTER_REFLECT_BEGIN");
+		Reflect<T>::forEachField(visitor);
+	}
+
+	template <class T, class F>
+	struct FieldValueVisitor
+	{
+		T& _object;
+		F& _fn;
+
+		template <class Fd>
+		void operator()(const Fd& field) { _fn(field, Fd::get(_object)); }
+	};
+
+	// Calls fn(field, value) for every reflected field of object; fn must be
+	// callable with every member type, e.g. a generic lambda.
+	template <class T, class F>
+	inline void forEachField(T& object, F&& fn)
+	{
+		typedef typename std::remove_const<T>::type Type;
+		FieldValueVisitor<T, F> visitor = { object, fn };
+		forEachField<Type>(visitor);
+	}
+
+	template <class T>
+	constexpr TypeId getTypeId()
+	{
+		return Reflect<T>::getId();
+	}
+
+	template <class T>
+	const TypeInfo* getTypeInfo();
+
+	template <class T>
+	inline const TypeInfo* findTypeInfo(std::true_type) { return getTypeInfo<T>(); }
+
+	template <class T>
+	inline const TypeInfo* findTypeInfo(std::false_type) { return nullptr; }
+
+	// nullptr for types without reflection
+	template <class T>
+	inline const TypeInfo* findTypeInfo() { return findTypeInfo<T>(IsReflected<T>()); }
+
+	template <class T>
+	inline const TypeInfo* (*getTypeInfoFn(std::true_type))() { return &getTypeInfo<T>; }
+
+	template <class T>
+	inline const TypeInfo* (*getTypeInfoFn(std::false_type))() { return nullptr; }
+
+	template <class T>
+	struct TypeInfoBuilder
+	{
+		std::vector<FieldInfo> _fields;
+		TypeInfo _info;
+		T _default;
+
+		template <class Fd>
+		void operator()(const Fd& field)
+		{
+			typedef typename Fd::Traits Traits;
+
+			FieldInfo info;
+			info._name = field._name;
+			info._offset = field._offset;
+			info._size = (uint32_t)sizeof(typename Traits::Element);
+			info._count = Traits::k_count;
+			info._type = Traits::k_type;
+			info._element_type = FieldTraits<typename Traits::Element>::k_type;
+			info._get_struct = getTypeInfoFn<typename Traits::Element>(IsReflected<typename Traits::Element>());
+			_fields.push_back(info);
+		}
+
+		TypeInfoBuilder()
+			: _default()
+		{
+			Reflect<T>::forEachField(*this);
+
+			_info._name = Reflect<T>::getName();
+			_info._id = Reflect<T>::getId();
+			_info._size = (uint32_t)sizeof(T);
+			_info._align = (uint32_t)alignof(T);
+			_info._default = &_default;
+			_info._fields = _fields.empty() ? nullptr : &_fields[0];
+			_info._field_count = (uint32_t)_fields.size();
+
+			TypeRegistry::registerType(&_info);
+		}
+	};
+
+	// Runtime field table, built once on first use. Prefer forEachField on hot paths.
+	template <class T>
+	inline const TypeInfo* getTypeInfo()
+	{
+		static_assert(IsReflected<T>::value, "type is not reflected, see MONSTER_REFLECT_BEGIN");
+		static const TypeInfoBuilder<T> s_builder;
+		return &s_builder._info;
+	}
+}
+
+// Reflection is declared next to the type, at global scope, with the type
+// spelled fully qualified; the spelling is hashed into the type id, so it
+// must not change once data has been saved. Fields can be added, removed
+// or reordered later: blobs match fields by name and give missing ones
+// the value-initialized default.
+//
+//	MONSTER_REFLECT_BEGIN(monster::Light)
+//		MONSTER_REFLECT_FIELD(_color)
+//		MONSTER_REFLECT_FIELD(_range)
+//		MONSTER_REFLECT_FIELD(_falloff)
+//	MONSTER_REFLECT_END()
+#define MONSTER_REFLECT_BEGIN(_type) \
+	namespace monster \
+	{ \
+		template <> \
+		struct Reflect<_type> \
+		{ \
+			typedef _type Type; \
+			static const char* getName() { return #_type; } \
+			static constexpr TypeId getId() { return hashTypeName(#_type); } \
+			template <class V> \
+			static void forEachField(V& visitor) \
+			{
+
+#define MONSTER_REFLECT_FIELD(_field) \
+				visitor(::monster::Field<Type, decltype(Type::_field), &Type::_field>{ #_field, (uint32_t)offsetof(Type, _field) });
+
+#define MONSTER_REFLECT_END() \
+			} \
+		}; \
+	}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __MONSTER_BLOB_H__
+#define __MONSTER_BLOB_H__
+
+#include <cstdint>
+#include <cstring>
+
+#include "core/reflection/reflection.h"
+
+namespace monster
+{
+	// Variable length array that stores the distance from itself to its
+	// elements instead of a pointer. A blob built from these is valid at any
+	// address, so it can be used straight out of a memory mapped file.
+	// Copying the field would break the offset, so it is not copyable; build
+	// data in place and serialize it with writeBlob().
+	template <class T>
+	class BlobArray
+	{
+	private:
+		int64_t _offset;   // from this to the first element, 0 when empty
+		uint32_t _count;
+		uint32_t _reserved;
+
+	public:
+		BlobArray() : _offset(0), _count(0), _reserved(0) {}
+
+		BlobArray(const BlobArray&) = delete;
+		BlobArray& operator = (const BlobArray&) = delete;
+
+		// Points at data owned elsewhere; data must stay alive until serialized.
+		// The offset goes through integers both ways: as a pointer difference
+		// the optimizer may take data as unreachable and drop stores to it.
+		void set(const T* data, uint32_t count)
+		{
+			_offset = 0 == count ? 0 : (intptr_t)data - (intptr_t)this;
+			_count = count;
+		}
+
+		uint32_t size() const { return _count; }
+		bool empty() const { return 0 == _count; }
+
+		const T* data() const { return 0 == _count ? nullptr : (const T*)((intptr_t)this + _offset); }
+		T* data() { return 0 == _count ? nullptr : (T*)((intptr_t)this + _offset); }
+
+		const T& operator [] (uint32_t index) const { return data()[index]; }
+		T& operator [] (uint32_t index) { return data()[index]; }
+
+		const T* begin() const { return data(); }
+		const T* end() const { return data() + _count; }
+	};
+
+	// Strings are char arrays that include their terminator.
+	typedef BlobArray<char> BlobString;
+
+	inline void setString(BlobString& string, const char* str)
+	{
+		string.set(str, (uint32_t)strlen(str) + 1);
+	}
+
+	inline const char* getString(const BlobString& string)
+	{
+		return string.empty() ? "" : string.data();
+	}
+
+	template <class T>
+	struct FieldTraits<BlobArray<T>, void>
+	{
+		typedef T Element;
+		static constexpr uint32_t k_count = 1;
+		static constexpr FieldType k_type = FieldType::Array;
+		static_assert(FieldType::Array != FieldTraits<T>::k_type, "arrays of arrays need a reflected struct in between");
+	};
+}
+
+#endif
@@ -0,0 +1,763 @@
+#include "core/serialization/blob_serializer.h"
+
+#include <cstring>
+#include <iterator>
+#include <map>
+
+namespace monster
+{
+	static const uint32_t k_blob_magic = 0x424c424d; // 'MBLB'
+	static const uint32_t k_blob_version = 1;
+	static const uint32_t k_blob_align = 16;
+	static const uint32_t k_no_type = UINT32_MAX;
+
+	// header | schema types | schema fields | root | array data
+	struct BlobHeader
+	{
+		uint32_t _magic;
+		uint32_t _version;
+		uint32_t _size;
+		uint32_t _root_offset;
+		uint32_t _type_count;      // schema type 0 is the root type
+		uint32_t _field_count;
+	};
+
+	struct SchemaType
+	{
+		TypeId _id;
+		uint32_t _size;
+		uint32_t _align;
+		uint32_t _first_field;
+		uint32_t _field_count;
+	};
+
+	struct SchemaField
+	{
+		uint32_t _name;            // hashTypeName of the field name
+		uint32_t _offset;
+		uint32_t _size;
+		uint32_t _count;
+		uint32_t _struct;          // schema type index, k_no_type unless the element is a struct
+		uint8_t _type;
+		uint8_t _element_type;
+		uint16_t _reserved;
+	};
+
+	// same layout as the BlobArray fields
+	struct ArrayHeader
+	{
+		int64_t _offset;
+		uint32_t _count;
+		uint32_t _reserved;
+	};
+
+	struct Schema
+	{
+		const SchemaType* _types;
+		uint32_t _type_count;
+		const SchemaField* _fields;
+		uint32_t _field_count;
+	};
+
+	// Flattens a TypeInfo graph into schema form. Types are numbered in
+	// discovery order, so the same graph always produces the same bytes.
+	class SchemaBuilder
+	{
+	private:
+		std::vector<const TypeInfo*> _infos;
+
+	public:
+		std::vector<SchemaType> _types;
+		std::vector<SchemaField> _fields;
+
+		uint32_t add(const TypeInfo* info)
+		{
+			for (uint32_t ii = 0; ii < _infos.size(); ++ii)
+			{
+				if (_infos[ii] == info)
+				{
+					return ii;
+				}
+			}
+
+			uint32_t index = (uint32_t)_types.size();
+			_infos.push_back(info);
+			_types.push_back(SchemaType());
+
+			std::vector<uint32_t> nested(info->_field_count, k_no_type);
+			for (uint32_t ii = 0; ii < info->_field_count; ++ii)
+			{
+				const TypeInfo* nested_info = info->_fields[ii].getStruct();
+				if (nullptr != nested_info)
+				{
+					nested[ii] = add(nested_info);
+				}
+			}
+
+			SchemaType& type = _types[index];
+			type._id = info->_id;
+			type._size = info->_size;
+			type._align = info->_align;
+			type._first_field = (uint32_t)_fields.size();
+			type._field_count = info->_field_count;
+
+			for (uint32_t ii = 0; ii < info->_field_count; ++ii)
+			{
+				const FieldInfo& field = info->_fields[ii];
+
+				SchemaField schema_field;
+				schema_field._name = hashTypeName(field._name);
+				schema_field._offset = field._offset;
+				schema_field._size = field._size;
+				schema_field._count = field._count;
+				schema_field._struct = nested[ii];
+				schema_field._type = (uint8_t)field._type;
+				schema_field._element_type = (uint8_t)field._element_type;
+				schema_field._reserved = 0;
+				_fields.push_back(schema_field);
+			}
+
+			return index;
+		}
+
+		Schema getSchema() const
+		{
+			Schema schema = { &_types[0], (uint32_t)_types.size(), _fields.empty() ? nullptr : &_fields[0], (uint32_t)_fields.size() };
+			return schema;
+		}
+
+		const TypeInfo* getInfo(uint32_t index) const { return _infos[index]; }
+	};
+
+	static bool isNumeric(uint8_t type)
+	{
+		return type <= (uint8_t)FieldType::Double;
+	}
+
+	// bytes convertScalar() reads or writes for a numeric type
+	static uint32_t getScalarSize(uint8_t type)
+	{
+		static const uint8_t k_sizes[] = { 1, 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+		return k_sizes[type];
+	}
+
+	static void convertScalar(uint8_t src_type, const uint8_t* src, uint8_t dst_type, uint8_t* dst)
+	{
+		int64_t integer = 0;
+		double real = 0.0;
+		bool is_real = false;
+
+		switch ((FieldType)src_type)
+		{
+		case FieldType::Bool:   { uint8_t v; memcpy(&v, src, 1); integer = 0 != v; } break;
+		case FieldType::Int8:   { int8_t v; memcpy(&v, src, 1); integer = v; } break;
+		case FieldType::UInt8:  { uint8_t v; memcpy(&v, src, 1); integer = v; } break;
+		case FieldType::Int16:  { int16_t v; memcpy(&v, src, 2); integer = v; } break;
+		case FieldType::UInt16: { uint16_t v; memcpy(&v, src, 2); integer = v; } break;
+		case FieldType::Int32:  { int32_t v; memcpy(&v, src, 4); integer = v; } break;
+		case FieldType::UInt32: { uint32_t v; memcpy(&v, src, 4); integer = v; } break;
+		case FieldType::Int64:  { int64_t v; memcpy(&v, src, 8); integer = v; } break;
+		case FieldType::UInt64: { uint64_t v; memcpy(&v, src, 8); integer = (int64_t)v; } break;
+		case FieldType::Float:  { float v; memcpy(&v, src, 4); real = v; is_real = true; } break;
+		case FieldType::Double: { double v; memcpy(&v, src, 8); real = v; is_real = true; } break;
+		default: return;
+		}
+
+		if (!is_real)
+		{
+			real = (double)integer;
+		}
+		else
+		{
+			integer = (int64_t)real;
+		}
+
+		switch ((FieldType)dst_type)
+		{
+		case FieldType::Bool:   { uint8_t v = 0 != integer; memcpy(dst, &v, 1); } break;
+		case FieldType::Int8:   { int8_t v = (int8_t)integer; memcpy(dst, &v, 1); } break;
+		case FieldType::UInt8:  { uint8_t v = (uint8_t)integer; memcpy(dst, &v, 1); } break;
+		case FieldType::Int16:  { int16_t v = (int16_t)integer; memcpy(dst, &v, 2); } break;
+		case FieldType::UInt16: { uint16_t v = (uint16_t)integer; memcpy(dst, &v, 2); } break;
+		case FieldType::Int32:  { int32_t v = (int32_t)integer; memcpy(dst, &v, 4); } break;
+		case FieldType::UInt32: { uint32_t v = (uint32_t)integer; memcpy(dst, &v, 4); } break;
+		case FieldType::Int64:  { int64_t v = integer; memcpy(dst, &v, 8); } break;
+		case FieldType::UInt64: { uint64_t v = (uint64_t)integer; memcpy(dst, &v, 8); } break;
+		case FieldType::Float:  { float v = (float)real; memcpy(dst, &v, 4); } break;
+		case FieldType::Double: { double v = real; memcpy(dst, &v, 8); } break;
+		default: break;
+		}
+	}
+
+	static uint32_t getElementAlign(uint32_t size)
+	{
+		uint32_t align = 1;
+		while (align < k_blob_align && 0 == (size & align))
+		{
+			align <<= 1;
+		}
+		return align;
+	}
+
+	// Copies data described by one schema into a blob laid out by another.
+	// When both are the same (writing from memory) structs are copied whole
+	// and only their BlobArrays are visited; otherwise every field is matched
+	// by name over a value-initialized default. Arrays are queued and appended
+	// breadth first, and their offsets written once their data has a place.
+	class BlobBuilder
+	{
+	private:
+		struct Pending
+		{
+			uint32_t _field_pos;
+			const uint8_t* _src;
+			uint32_t _count;
+			const SchemaField* _src_field;
+			const SchemaField* _dst_field;
+		};
+
+		const Schema& _src;
+		const Schema& _dst;
+		const SchemaBuilder& _dst_builder;
+		bool _is_identical;
+		const uint8_t* _src_begin;   // bounds of untrusted source data, nullptr when writing from memory
+		const uint8_t* _src_end;
+
+		std::vector<uint8_t>& _out;
+		std::vector<Pending> _pending;
+		std::map<const uint8_t*, const uint8_t*> _queued;  // source ranges of the pending arrays, begin -> end
+		std::vector<uint8_t> _has_arrays;
+		bool _is_valid;
+
+	private:
+		bool isInSource(const uint8_t* src, uint64_t size) const
+		{
+			return nullptr == _src_begin
+				|| (src >= _src_begin && src <= _src_end && size <= (uint64_t)(_src_end - src));
+		}
+
+		// An array sharing source bytes with another one, or pointing back
+		// at itself, would be expanded once per reference; a few hundred
+		// bytes could nest into gigabytes before the size limit trips.
+		// With every array its own range the output stays within the
+		// source size times the widest element.
+		bool isDisjoint(const uint8_t* begin, const uint8_t* end)
+		{
+			if (nullptr == _src_begin)
+			{
+				return true;
+			}
+
+			std::map<const uint8_t*, const uint8_t*>::iterator next = _queued.lower_bound(begin);
+			if ((next != _queued.end() && next->first < end)
+				|| (next != _queued.begin() && std::prev(next)->second > begin))
+			{
+				return false;
+			}
+
+			_queued.insert(next, std::make_pair(begin, end));
+			return true;
+		}
+
+		const SchemaField* findSourceField(uint32_t src_type, uint32_t name) const
+		{
+			const SchemaType& type = _src._types[src_type];
+			for (uint32_t ii = 0; ii < type._field_count; ++ii)
+			{
+				const SchemaField& field = _src._fields[type._first_field + ii];
+				if (field._name == name)
+				{
+					return &field;
+				}
+			}
+			return nullptr;
+		}
+
+		void computeHasArrays()
+		{
+			_has_arrays.assign(_dst._type_count, 0);
+
+			// BlobArray<Self> makes the type graph cyclic, so iterate to a fixed point
+			bool is_changed = true;
+			while (is_changed)
+			{
+				is_changed = false;
+				for (uint32_t ii = 0; ii < _dst._type_count; ++ii)
+				{
+					const SchemaType& type = _dst._types[ii];
+					for (uint32_t jj = 0; jj < type._field_count && !_has_arrays[ii]; ++jj)
+					{
+						const SchemaField& field = _dst._fields[type._first_field + jj];
+						if ((uint8_t)FieldType::Array == field._type
+							|| ((uint8_t)FieldType::Struct == field._type && _has_arrays[field._struct]))
+						{
+							_has_arrays[ii] = 1;
+							is_changed = true;
+						}
+					}
+				}
+			}
+		}
+
+		void queueArray(uint32_t field_pos, const uint8_t* src_field, const SchemaField& src, const SchemaField& dst)
+		{
+			ArrayHeader header;
+			memcpy(&header, src_field, sizeof(header));
+
+			ArrayHeader empty = { 0, 0, 0 };
+			memcpy(&_out[field_pos], &empty, sizeof(empty));
+
+			bool is_struct = (uint8_t)FieldType::Struct == src._element_type;
+			if (0 == header._count
+				|| is_struct != ((uint8_t)FieldType::Struct == dst._element_type))
+			{
+				return;
+			}
+
+			uint32_t src_stride = is_struct ? _src._types[src._struct]._size : src._size;
+			const uint8_t* data = src_field + header._offset;
+			if (0 == src_stride
+				|| !isInSource(data, (uint64_t)header._count * src_stride)
+				|| !isDisjoint(data, data + (size_t)header._count * src_stride))
+			{
+				_is_valid = false;
+				return;
+			}
+
+			Pending pending = { field_pos, data, header._count, &src, &dst };
+			_pending.push_back(pending);
+		}
+
+		void queueArrays(uint32_t type_index, const uint8_t* src, uint32_t dst_pos)
+		{
+			const SchemaType& type = _dst._types[type_index];
+			for (uint32_t ii = 0; ii < type._field_count; ++ii)
+			{
+				const SchemaField& field = _dst._fields[type._first_field + ii];
+				if ((uint8_t)FieldType::Array == field._type)
+				{
+					queueArray(dst_pos + field._offset, src + field._offset, field, field);
+				}
+				else if ((uint8_t)FieldType::Struct == field._type && _has_arrays[field._struct])
+				{
+					uint32_t stride = _dst._types[field._struct]._size;
+					for (uint32_t jj = 0; jj < field._count; ++jj)
+					{
+						queueArrays(field._struct, src + field._offset + jj * stride, dst_pos + field._offset + jj * stride);
+					}
+				}
+			}
+		}
+
+		void copyScalars(const SchemaField& src, const uint8_t* src_data, const SchemaField& dst, uint32_t dst_pos, uint32_t count)
+		{
+			if (src._element_type == dst._element_type && src._size == dst._size)
+			{
+				memcpy(&_out[dst_pos], src_data, (size_t)count * dst._size);
+			}
+			else if (isNumeric(src._element_type) && isNumeric(dst._element_type))
+			{
+				for (uint32_t ii = 0; ii < count; ++ii)
+				{
+					convertScalar(src._element_type, src_data + ii * src._size, dst._element_type, &_out[dst_pos + ii * dst._size]);
+				}
+			}
+		}
+
+		void copyField(const SchemaField& src, const uint8_t* src_data, const SchemaField& dst, uint32_t dst_pos)
+		{
+			if ((uint8_t)FieldType::Array == dst._type)
+			{
+				if ((uint8_t)FieldType::Array == src._type)
+				{
+					queueArray(dst_pos, src_data, src, dst);
+				}
+				return;
+			}
+
+			if ((uint8_t)FieldType::Array == src._type)
+			{
+				return;
+			}
+
+			uint32_t count = src._count < dst._count ? src._count : dst._count;
+			if ((uint8_t)FieldType::Struct == dst._type)
+			{
+				if ((uint8_t)FieldType::Struct == src._type)
+				{
+					copyStructs(src._struct, src_data, dst._struct, dst_pos, count);
+				}
+				return;
+			}
+
+			copyScalars(src, src_data, dst, dst_pos, count);
+		}
+
+		void copyStructs(uint32_t src_type, const uint8_t* src, uint32_t dst_type, uint32_t dst_pos, uint32_t count)
+		{
+			const SchemaType& dst_info = _dst._types[dst_type];
+
+			if (_is_identical)
+			{
+				memcpy(&_out[dst_pos], src, (size_t)count * dst_info._size);
+				if (_has_arrays[dst_type])
+				{
+					for (uint32_t ii = 0; ii < count; ++ii)
+					{
+						queueArrays(dst_type, src + ii * dst_info._size, dst_pos + ii * dst_info._size);
+					}
+				}
+				return;
+			}
+
+			const SchemaType& src_info = _src._types[src_type];
+			const void* defaults = _dst_builder.getInfo(dst_type)->_default;
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const uint8_t* src_element = src + ii * src_info._size;
+				uint32_t dst_element = dst_pos + ii * dst_info._size;
+
+				memcpy(&_out[dst_element], defaults, dst_info._size);
+
+				for (uint32_t jj = 0; jj < dst_info._field_count; ++jj)
+				{
+					const SchemaField& dst_field = _dst._fields[dst_info._first_field + jj];
+					const SchemaField* src_field = findSourceField(src_type, dst_field._name);
+					if (nullptr != src_field)
+					{
+						copyField(*src_field, src_element + src_field->_offset, dst_field, dst_element + dst_field._offset);
+					}
+				}
+			}
+		}
+
+	public:
+		BlobBuilder(const Schema& src, const Schema& dst, const SchemaBuilder& dst_builder, bool is_identical, const uint8_t* src_begin, const uint8_t* src_end, std::vector<uint8_t>& out)
+			: _src(src)
+			, _dst(dst)
+			, _dst_builder(dst_builder)
+			, _is_identical(is_identical)
+			, _src_begin(src_begin)
+			, _src_end(src_end)
+			, _out(out)
+			, _is_valid(true)
+		{
+			computeHasArrays();
+		}
+
+		uint32_t allocate(uint64_t size, uint32_t align)
+		{
+			uint64_t pos = ((uint64_t)_out.size() + align - 1) & ~(uint64_t)(align - 1);
+			if (pos + size > UINT32_MAX)
+			{
+				// also stops cyclic source data from growing the blob forever
+				_is_valid = false;
+				return 0;
+			}
+
+			_out.resize((size_t)(pos + size), 0);
+			return (uint32_t)pos;
+		}
+
+		bool build(const uint8_t* root, uint32_t src_root_type)
+		{
+			const SchemaType& root_type = _dst._types[0];
+			uint32_t root_pos = allocate(root_type._size, k_blob_align);
+			if (!_is_valid)
+			{
+				return false;
+			}
+			((BlobHeader*)&_out[0])->_root_offset = root_pos;
+
+			copyStructs(src_root_type, root, 0, root_pos, 1);
+
+			for (uint32_t ii = 0; ii < _pending.size() && _is_valid; ++ii)
+			{
+				Pending pending = _pending[ii];
+				const SchemaField& dst = *pending._dst_field;
+
+				bool is_struct = (uint8_t)FieldType::Struct == dst._element_type;
+				uint32_t stride = is_struct ? _dst._types[dst._struct]._size : dst._size;
+				uint32_t align = is_struct ? _dst._types[dst._struct]._align : getElementAlign(dst._size);
+
+				uint32_t pos = allocate((uint64_t)pending._count * stride, align);
+				if (!_is_valid)
+				{
+					break;
+				}
+
+				ArrayHeader header = { (int64_t)pos - (int64_t)pending._field_pos, pending._count, 0 };
+				memcpy(&_out[pending._field_pos], &header, sizeof(header));
+
+				if (is_struct)
+				{
+					if ((uint8_t)FieldType::Struct == pending._src_field->_element_type)
+					{
+						copyStructs(pending._src_field->_struct, pending._src, dst._struct, pos, pending._count);
+					}
+				}
+				else
+				{
+					copyScalars(*pending._src_field, pending._src, dst, pos, pending._count);
+				}
+			}
+
+			return _is_valid;
+		}
+	};
+
+	static void writeHeader(const SchemaBuilder& schema, std::vector<uint8_t>& blob)
+	{
+		size_t types_size = schema._types.size() * sizeof(SchemaType);
+		size_t fields_size = schema._fields.size() * sizeof(SchemaField);
+
+		blob.clear();
+		blob.resize(sizeof(BlobHeader) + types_size + fields_size, 0);
+
+		BlobHeader* header = (BlobHeader*)&blob[0];
+		header->_magic = k_blob_magic;
+		header->_version = k_blob_version;
+		header->_type_count = (uint32_t)schema._types.size();
+		header->_field_count = (uint32_t)schema._fields.size();
+
+		memcpy(&blob[sizeof(BlobHeader)], &schema._types[0], types_size);
+		if (0 != fields_size)
+		{
+			memcpy(&blob[sizeof(BlobHeader) + types_size], &schema._fields[0], fields_size);
+		}
+	}
+
+	// Checks everything the builder relies on, so a damaged or hostile blob
+	// fails to load instead of reading out of bounds.
+	static bool readSchema(const void* data, size_t size, Schema& schema)
+	{
+		if (size < sizeof(BlobHeader))
+		{
+			return false;
+		}
+
+		const BlobHeader* header = (const BlobHeader*)data;
+		if (k_blob_magic != header->_magic
+			|| k_blob_version != header->_version
+			|| header->_size > size
+			|| 0 == header->_type_count)
+		{
+			return false;
+		}
+
+		uint64_t schema_size = (uint64_t)header->_type_count * sizeof(SchemaType) + (uint64_t)header->_field_count * sizeof(SchemaField);
+		if (sizeof(BlobHeader) + schema_size > header->_size)
+		{
+			return false;
+		}
+
+		schema._types = (const SchemaType*)(header + 1);
+		schema._type_count = header->_type_count;
+		schema._fields = (const SchemaField*)(schema._types + schema._type_count);
+		schema._field_count = header->_field_count;
+
+		for (uint32_t ii = 0; ii < schema._type_count; ++ii)
+		{
+			const SchemaType& type = schema._types[ii];
+			if ((uint64_t)type._first_field + type._field_count > schema._field_count)
+			{
+				return false;
+			}
+
+			for (uint32_t jj = 0; jj < type._field_count; ++jj)
+			{
+				const SchemaField& field = schema._fields[type._first_field + jj];
+				if (field._type > (uint8_t)FieldType::Opaque
+					|| field._element_type > (uint8_t)FieldType::Opaque
+					|| (field._type != field._element_type && (uint8_t)FieldType::Array != field._type))
+				{
+					return false;
+				}
+
+				// scalars are converted at their own width, whatever size the field claims
+				if (isNumeric(field._element_type)
+					&& field._size != getScalarSize(field._element_type))
+				{
+					return false;
+				}
+
+				bool is_struct = (uint8_t)FieldType::Struct == field._element_type;
+				if (is_struct
+					&& (field._struct >= schema._type_count || field._size != schema._types[field._struct]._size))
+				{
+					return false;
+				}
+
+				uint64_t field_size = (uint8_t)FieldType::Array == field._type ? sizeof(ArrayHeader) : (uint64_t)field._size * field._count;
+				if ((uint64_t)field._offset + field_size > type._size)
+				{
+					return false;
+				}
+			}
+		}
+
+		return (uint64_t)header->_root_offset + schema._types[0]._size <= header->_size;
+	}
+
+	bool writeBlob(const TypeInfo* type, const void* root, std::vector<uint8_t>& blob)
+	{
+		SchemaBuilder builder;
+		builder.add(type);
+		Schema schema = builder.getSchema();
+
+		writeHeader(builder, blob);
+
+		BlobBuilder blob_builder(schema, schema, builder, true, nullptr, nullptr, blob);
+		if (!blob_builder.build((const uint8_t*)root, 0))
+		{
+			blob.clear();
+			return false;
+		}
+
+		((BlobHeader*)&blob[0])->_size = (uint32_t)blob.size();
+		return true;
+	}
+
+	bool saveBlob(FileSystem* fs, const char* path, const TypeInfo* type, const void* root)
+	{
+		std::vector<uint8_t> blob;
+		if (!writeBlob(type, root, blob))
+		{
+			return false;
+		}
+
+		File* file = fs->open(path, FileOpenMode::write);
+		if (nullptr == file)
+		{
+			return false;
+		}
+
+		bool result = blob.size() == file->write(&blob[0], blob.size());
+		fs->close(file);
+		return result;
+	}
+
+	const void* getBlobRoot(const void* data, size_t size, const TypeInfo* type)
+	{
+		Schema schema;
+		if (!readSchema(data, size, schema))
+		{
+			return nullptr;
+		}
+
+		SchemaBuilder builder;
+		builder.add(type);
+
+		// identical schema bytes mean identical layout of every type in the blob
+		if (schema._type_count != builder._types.size()
+			|| schema._field_count != builder._fields.size()
+			|| 0 != memcmp(schema._types, &builder._types[0], schema._type_count * sizeof(SchemaType))
+			|| (0 != schema._field_count && 0 != memcmp(schema._fields, &builder._fields[0], schema._field_count * sizeof(SchemaField))))
+		{
+			return nullptr;
+		}
+
+		return (const uint8_t*)data + ((const BlobHeader*)data)->_root_offset;
+	}
+
+	bool convertBlob(const void* data, size_t size, const TypeInfo* type, std::vector<uint8_t>& blob)
+	{
+		Schema src;
+		if (!readSchema(data, size, src)
+			|| type->_id != src._types[0]._id)
+		{
+			return false;
+		}
+
+		SchemaBuilder builder;
+		builder.add(type);
+		Schema dst = builder.getSchema();
+
+		writeHeader(builder, blob);
+
+		const uint8_t* begin = (const uint8_t*)data;
+		const uint8_t* end = begin + ((const BlobHeader*)data)->_size;
+		BlobBuilder blob_builder(src, dst, builder, false, begin, end, blob);
+		if (!blob_builder.build(begin + ((const BlobHeader*)data)->_root_offset, 0))
+		{
+			blob.clear();
+			return false;
+		}
+
+		((BlobHeader*)&blob[0])->_size = (uint32_t)blob.size();
+		return true;
+	}
+
+	bool BlobFile::load(FileSystem* fs, const char* path, const TypeInfo* type)
+	{
+		unload();
+
+		if (fs->map(path, 0, 0, _region))
+		{
+			_root = getBlobRoot(_region._data, _region._size, type);
+			if (nullptr != _root)
+			{
+				_fs = fs;
+				return true;
+			}
+
+			std::vector<uint8_t> blob;
+			bool result = convertBlob(_region._data, _region._size, type, blob);
+			fs->unmap(_region);
+			if (!result)
+			{
+				return false;
+			}
+			_converted.assign(blob.begin(), blob.end());
+		}
+		else
+		{
+			// no mapping support, read the whole file instead
+			File* file = fs->open(path, FileOpenMode::read);
+			if (nullptr == file)
+			{
+				return false;
+			}
+
+			file->seekEnd();
+			size_t size = file->tell();
+			file->seek(0);
+
+			_converted.resize(size);
+			bool result = 0 != size && size == file->read(&_converted[0], size);
+			fs->close(file);
+			if (!result)
+			{
+				_converted.clear();
+				return false;
+			}
+
+			if (nullptr == getBlobRoot(&_converted[0], size, type))
+			{
+				std::vector<uint8_t> blob;
+				if (!convertBlob(&_converted[0], size, type, blob))
+				{
+					_converted.clear();
+					return false;
+				}
+				_converted.assign(blob.begin(), blob.end());
+			}
+		}
+
+		_root = getBlobRoot(&_converted[0], _converted.size(), type);
+		return nullptr != _root;
+	}
+
+	void BlobFile::unload()
+	{
+		if (nullptr != _fs)
+		{
+			_fs->unmap(_region);
+			_fs = nullptr;
+		}
+
+		_converted.clear();
+		_root = nullptr;
+	}
+}
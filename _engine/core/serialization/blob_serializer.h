@@ -0,0 +1,68 @@
+#ifndef __MONSTER_BLOB_SERIALIZER_H__
+#define __MONSTER_BLOB_SERIALIZER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "core/filesystem/filesystem.h"
+#include "core/memory/aligned_allocator.h"
+#include "core/serialization/blob.h"
+
+namespace monster
+{
+	// Serializes root and everything its BlobArrays reach into one
+	// relocatable blob. The blob carries the schema of every type it holds,
+	// so data written by an older or newer build can still be converted.
+	bool writeBlob(const TypeInfo* type, const void* root, std::vector<uint8_t>& blob);
+
+	template <class T>
+	inline bool writeBlob(const T& root, std::vector<uint8_t>& blob)
+	{
+		return writeBlob(getTypeInfo<T>(), &root, blob);
+	}
+
+	bool saveBlob(FileSystem* fs, const char* path, const TypeInfo* type, const void* root);
+
+	// Root of a blob whose layout matches type exactly, ready to use in place;
+	// nullptr if the blob is invalid or has to go through convertBlob() first.
+	// data must be aligned to 16 bytes.
+	const void* getBlobRoot(const void* data, size_t size, const TypeInfo* type);
+
+	// Rebuilds a blob in the current layout of type, matching fields by name.
+	// Fields the blob lacks keep the defaults of a value-initialized T, fields
+	// the type no longer has are dropped, and numeric fields whose type
+	// changed are converted.
+	bool convertBlob(const void* data, size_t size, const TypeInfo* type, std::vector<uint8_t>& blob);
+
+	// A blob loaded from disk. Blobs in the current layout stay memory mapped
+	// and are used with no parsing or fix-ups; anything else is converted once
+	// into a heap copy at load time.
+	class BlobFile
+	{
+	private:
+		FileSystem* _fs;
+		MappedRegion _region;
+		AlignedVector<uint8_t> _converted;  // aligned like a mapped blob, for the root's SIMD members
+		const void* _root;
+
+	public:
+		BlobFile() : _fs(nullptr), _root(nullptr) {}
+		~BlobFile() { unload(); }
+
+		BlobFile(const BlobFile&) = delete;
+		BlobFile& operator = (const BlobFile&) = delete;
+
+		bool load(FileSystem* fs, const char* path, const TypeInfo* type);
+		void unload();
+
+		bool isMapped() const { return nullptr != _fs; }
+
+		template <class T>
+		bool load(FileSystem* fs, const char* path) { return load(fs, path, getTypeInfo<T>()); }
+
+		template <class T>
+		const T* get() const { return (const T*)_root; }
+	};
+}
+
+#endif
@@ -2,10 +2,42 @@
 #define __MONSTER_THREAD_H__
 
 #include <cstdint>
+#include "core/platform.h"
+
+#if MONSTER_PLATFORM_WINDOWS
 #include <Windows.h>
+#elif MONSTER_PLATFORM_POSIX
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 namespace monster
 {
+	inline void yieldThread()
+	{
+#if MONSTER_PLATFORM_WINDOWS
+		SwitchToThread();
+#else
+		sched_yield();
+#endif
+	}
+
+	inline uint32_t getCpuCount()
+	{
+#if MONSTER_PLATFORM_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors;
+#else
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		return 0 < count ? (uint32_t)count : 1;
+#endif
+	}
+
+#if MONSTER_PLATFORM_WINDOWS
 	class Semaphore
 	{
 	private:
@@ -38,8 +70,88 @@ namespace monster
 	};
 
 
+#else
+	class Semaphore
+	{
+	private:
+		pthread_mutex_t _mutex;
+		pthread_cond_t _cond;
+		int32_t _count;
+
+	public:
+		Semaphore() : _count(0)
+		{
+			pthread_mutex_init(&_mutex, NULL);
+			pthread_cond_init(&_cond, NULL);
+		}
+
+		~Semaphore()
+		{
+			pthread_cond_destroy(&_cond);
+			pthread_mutex_destroy(&_mutex);
+		}
+
+		Semaphore(const Semaphore&) = delete;
+		Semaphore& operator=(const Semaphore&) = delete;
+
+		void post(uint32_t _count = 1)
+		{
+			pthread_mutex_lock(&_mutex);
+			for (uint32_t ii = 0; ii < _count; ++ii)
+			{
+				++this->_count;
+				pthread_cond_signal(&_cond);
+			}
+			pthread_mutex_unlock(&_mutex);
+		}
+
+		bool wait(int32_t _msecs = -1)
+		{
+			pthread_mutex_lock(&_mutex);
+
+			int result = 0;
+			if (0 > _msecs)
+			{
+				while (0 == result
+					&& 0 >= _count)
+				{
+					result = pthread_cond_wait(&_cond, &_mutex);
+				}
+			}
+			else
+			{
+				timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				ts.tv_sec += _msecs / 1000;
+				ts.tv_nsec += (_msecs % 1000) * 1000000;
+				if (ts.tv_nsec >= 1000000000)
+				{
+					ts.tv_sec += 1;
+					ts.tv_nsec -= 1000000000;
+				}
+
+				while (0 == result
+					&& 0 >= _count)
+				{
+					result = pthread_cond_timedwait(&_cond, &_mutex, &ts);
+				}
+			}
+
+			bool ok = 0 == result;
+			if (ok)
+			{
+				--_count;
+			}
+
+			pthread_mutex_unlock(&_mutex);
+			return ok;
+		}
+	};
+#endif
+
 	typedef int32_t(*ThreadFunc) (void* user_data);
-	
+
+#if MONSTER_PLATFORM_WINDOWS
 	class Thread
 	{
 	private:
@@ -110,6 +222,86 @@ namespace monster
 
 		int32_t getExitCode() const { return _exit_code; }
 	};
+#else
+	class Thread
+	{
+	private:
+		pthread_t _handle;
+		ThreadFunc _thread_fn;
+		void* _user_data;
+		Semaphore _sem;
+		uint32_t _stack_size;
+		int32_t _exit_code;
+		bool _is_running;
+
+	private:
+		int32_t entry()
+		{
+			_sem.post();
+			return _thread_fn(_user_data);
+		}
+
+		static void* threadFunc(void* _arg)
+		{
+			Thread* thread = (Thread*)_arg;
+			int32_t result = thread->entry();
+			return (void*)(intptr_t)result;
+		}
+
+	public:
+		Thread() :
+			_handle(0),
+			_thread_fn(nullptr),
+			_user_data(nullptr),
+			_stack_size(0),
+			_exit_code(0),
+			_is_running(false) {}
+
+		~Thread()
+		{
+			if (_is_running)
+			{
+				shutdown();
+			}
+		}
+
+		Thread(const Thread&) = delete;
+		Thread& operator = (const Thread&) = delete;
+
+		void init(ThreadFunc fn, void* user_data = nullptr, uint32_t stack_size = 0)
+		{
+			_thread_fn = fn;
+			_user_data = user_data;
+			_stack_size = stack_size;
+			_is_running = true;
+
+			pthread_attr_t attr;
+			pthread_attr_init(&attr);
+			if (0 != _stack_size)
+			{
+				pthread_attr_setstacksize(&attr, _stack_size);
+			}
+
+			pthread_create(&_handle, &attr, threadFunc, this);
+			pthread_attr_destroy(&attr);
+
+			_sem.wait();
+		}
+
+		void shutdown()
+		{
+			void* result = nullptr;
+			pthread_join(_handle, &result);
+			_exit_code = (int32_t)(intptr_t)result;
+			_handle = 0;
+			_is_running = false;
+		}
+
+		bool isRunning() const { return _is_running; }
+
+		int32_t getExitCode() const { return _exit_code; }
+	};
+#endif
 }
 
 #endif
\ No newline at end of file
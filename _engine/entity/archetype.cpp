@@ -0,0 +1,168 @@
+#include "entity/archetype.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include "core/hardware.h"
+
+namespace monster
+{
+	static const uint32_t k_max_registered_types = k_max_component_types;
+	static ComponentInfo s_component_infos[k_max_registered_types];
+	static volatile int32_t s_component_count = 0;
+
+	// types register lazily from whichever thread touches them first
+	ComponentTypeId ComponentRegistry::registerType(uint32_t size, uint32_t align, const TypeInfo* type)
+	{
+		uint32_t id = (uint32_t)atomicInc(&s_component_count) - 1;
+		assert(id < k_max_registered_types);
+		assert(0 != align && 0 == (align & (align - 1)) && align <= k_max_component_align);
+
+		ComponentInfo& info = s_component_infos[id];
+		info._size = size;
+		info._align = align;
+		info._name = nullptr != type ? type->_name : nullptr;
+		info._type = type;
+		return (ComponentTypeId)id;
+	}
+
+	const ComponentInfo& ComponentRegistry::getInfo(ComponentTypeId id)
+	{
+		return s_component_infos[id];
+	}
+
+	uint32_t ComponentRegistry::getCount()
+	{
+		return (uint32_t)s_component_count;
+	}
+
+	static uint32_t alignUp(uint32_t value, uint32_t align)
+	{
+		return (value + align - 1) & ~(align - 1);
+	}
+
+	static uint8_t* allocateChunk()
+	{
+		uint8_t* raw = (uint8_t*)malloc(Archetype::k_chunk_size + Archetype::k_chunk_align);
+		uint8_t* data = (uint8_t*)(((uintptr_t)raw + Archetype::k_chunk_align) & ~(uintptr_t)(Archetype::k_chunk_align - 1));
+		data[-1] = (uint8_t)(data - raw);
+		return data;
+	}
+
+	static void freeChunk(uint8_t* data)
+	{
+		free(data - data[-1]);
+	}
+
+	Archetype::Archetype(const ComponentMask& mask)
+		: _mask(mask)
+		, _entity_count(0)
+	{
+		for (uint32_t ii = 0; ii < k_max_component_types; ++ii)
+		{
+			_columns[ii] = -1;
+			_add_edges[ii] = nullptr;
+			_remove_edges[ii] = nullptr;
+		}
+
+		uint32_t row_size = sizeof(Entity);
+		for (uint32_t ii = 0, num = ComponentRegistry::getCount(); ii < num; ++ii)
+		{
+			if (mask.test((ComponentTypeId)ii))
+			{
+				_columns[ii] = (int16_t)_types.size();
+				_types.push_back((ComponentTypeId)ii);
+				row_size += ComponentRegistry::getInfo((ComponentTypeId)ii)._size;
+			}
+		}
+
+		// start from the unpadded estimate and shrink until the aligned arrays fit
+		_offsets.resize(_types.size());
+		for (_capacity = k_chunk_size / row_size; 0 < _capacity; --_capacity)
+		{
+			uint32_t offset = sizeof(Entity) * _capacity;
+			for (uint32_t ii = 0; ii < _types.size(); ++ii)
+			{
+				const ComponentInfo& info = ComponentRegistry::getInfo(_types[ii]);
+				offset = alignUp(offset, info._align);
+				_offsets[ii] = offset;
+				offset += info._size * _capacity;
+			}
+
+			if (offset <= k_chunk_size)
+			{
+				break;
+			}
+		}
+
+		// rows would run off the end of every chunk, release builds included
+		assert(0 < _capacity && "a row of this signature doesn't fit in a chunk");
+		if (0 == _capacity)
+		{
+			abort();
+		}
+	}
+
+	Archetype::~Archetype()
+	{
+		for (Chunk& chunk : _chunks)
+		{
+			freeChunk(chunk._data);
+		}
+	}
+
+	void Archetype::allocateRow(Entity entity, uint32_t& chunk, uint32_t& row)
+	{
+		if (_chunks.empty()
+			|| _chunks.back()._count == _capacity)
+		{
+			Chunk new_chunk = { allocateChunk(), 0 };
+			_chunks.push_back(new_chunk);
+		}
+
+		chunk = (uint32_t)_chunks.size() - 1;
+		Chunk& last = _chunks.back();
+		row = last._count++;
+		++_entity_count;
+
+		getEntities(chunk)[row] = entity;
+		for (uint32_t ii = 0; ii < _types.size(); ++ii)
+		{
+			uint32_t size = ComponentRegistry::getInfo(_types[ii])._size;
+			memset(last._data + _offsets[ii] + size * row, 0, size);
+		}
+	}
+
+	Entity Archetype::removeRow(uint32_t chunk, uint32_t row)
+	{
+		uint32_t last_chunk = (uint32_t)_chunks.size() - 1;
+		uint32_t last_row = _chunks[last_chunk]._count - 1;
+
+		Entity moved = k_invalid_entity;
+		if (chunk != last_chunk
+			|| row != last_row)
+		{
+			moved = getEntities(last_chunk)[last_row];
+			getEntities(chunk)[row] = moved;
+
+			for (uint32_t ii = 0; ii < _types.size(); ++ii)
+			{
+				uint32_t size = ComponentRegistry::getInfo(_types[ii])._size;
+				memcpy(_chunks[chunk]._data + _offsets[ii] + size * row
+					, _chunks[last_chunk]._data + _offsets[ii] + size * last_row
+					, size
+					);
+			}
+		}
+
+		--_entity_count;
+		if (0 == --_chunks[last_chunk]._count)
+		{
+			freeChunk(_chunks[last_chunk]._data);
+			_chunks.pop_back();
+		}
+
+		return moved;
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef __MONSTER_ARCHETYPE_H__
+#define __MONSTER_ARCHETYPE_H__
+
+#include <vector>
+#include "entity/entity.h"
+
+namespace monster
+{
+	// All entities with exactly one component signature. Their data lives in
+	// 16 KB chunks laid out as structure-of-arrays: the entity handles, then
+	// one tightly packed array per component. Rows are kept dense by moving
+	// the last row into any hole, so only the last chunk is ever partly full.
+	// A signature whose row doesn't fit in one chunk can't be created.
+	class Archetype
+	{
+	public:
+		static const uint32_t k_chunk_size = 16 << 10;
+		static const uint32_t k_chunk_align = k_max_component_align;
+
+		struct Chunk
+		{
+			uint8_t* _data;
+			uint32_t _count;
+		};
+
+	private:
+		ComponentMask _mask;
+		std::vector<ComponentTypeId> _types;
+		std::vector<uint32_t> _offsets;                     // per column, from the chunk start
+		int16_t _columns[k_max_component_types];            // component type -> column, -1 if absent
+		Archetype* _add_edges[k_max_component_types];
+		Archetype* _remove_edges[k_max_component_types];
+
+		uint32_t _capacity;
+		uint32_t _entity_count;
+		std::vector<Chunk> _chunks;
+
+	public:
+		Archetype(const ComponentMask& mask);
+		~Archetype();
+
+		Archetype(const Archetype&) = delete;
+		Archetype& operator = (const Archetype&) = delete;
+
+		const ComponentMask& getMask() const { return _mask; }
+		const std::vector<ComponentTypeId>& getTypes() const { return _types; }
+		uint32_t getCapacity() const { return _capacity; }
+		uint32_t getEntityCount() const { return _entity_count; }
+
+		uint32_t getChunkCount() const { return (uint32_t)_chunks.size(); }
+		const Chunk& getChunk(uint32_t chunk) const { return _chunks[chunk]; }
+
+		int32_t getColumn(ComponentTypeId id) const { return _columns[id]; }
+
+		Entity* getEntities(uint32_t chunk) const { return (Entity*)_chunks[chunk]._data; }
+
+		void* getColumnData(uint32_t chunk, int32_t column) const
+		{
+			return _chunks[chunk]._data + _offsets[column];
+		}
+
+		template <class T>
+		T* getArray(uint32_t chunk) const
+		{
+			int32_t column = _columns[getComponentTypeId<T>()];
+			return 0 > column ? nullptr : (T*)getColumnData(chunk, column);
+		}
+
+		Archetype* getAddEdge(ComponentTypeId id) const { return _add_edges[id]; }
+		Archetype* getRemoveEdge(ComponentTypeId id) const { return _remove_edges[id]; }
+		void setAddEdge(ComponentTypeId id, Archetype* archetype) { _add_edges[id] = archetype; }
+		void setRemoveEdge(ComponentTypeId id, Archetype* archetype) { _remove_edges[id] = archetype; }
+
+		// Appends a zero-initialized row for entity.
+		void allocateRow(Entity entity, uint32_t& chunk, uint32_t& row);
+
+		// Fills the hole with the last row and returns the entity that moved
+		// into it, or k_invalid_entity if the removed row was the last one.
+		Entity removeRow(uint32_t chunk, uint32_t row);
+	};
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef __MONSTER_ENTITY_H__
+#define __MONSTER_ENTITY_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "core/reflection/reflection.h"
+
+namespace monster
+{
+	// Generational handle. The index is reused after destroy(), the generation
+	// is not, so stale handles fail isAlive() instead of aliasing a new entity.
+	struct Entity
+	{
+		uint32_t _index;
+		uint32_t _generation;
+
+		bool operator == (const Entity& other) const { return _index == other._index && _generation == other._generation; }
+		bool operator != (const Entity& other) const { return !(*this == other); }
+	};
+
+	static const Entity k_invalid_entity = { UINT32_MAX, 0 };
+	inline bool isValid(Entity entity) { return UINT32_MAX != entity._index; }
+
+	typedef uint16_t ComponentTypeId;
+	static const uint32_t k_max_component_types = 128;
+	static const uint32_t k_max_component_align = 64;     // chunks are aligned to this
+
+	struct ComponentInfo
+	{
+		uint32_t _size;
+		uint32_t _align;
+		const char* _name;
+		const TypeInfo* _type;  // nullptr unless the component is reflected
+	};
+
+	class ComponentRegistry
+	{
+	public:
+		static ComponentTypeId registerType(uint32_t size, uint32_t align, const TypeInfo* type);
+		static const ComponentInfo& getInfo(ComponentTypeId id);
+		static uint32_t getCount();
+	};
+
+	// Components are plain data: archetype moves relocate them with memcpy and
+	// never run constructors or destructors.
+	template <class T>
+	inline ComponentTypeId getComponentTypeId()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "components must be trivially copyable");
+		static_assert(alignof(T) <= k_max_component_align, "components can't be aligned past a chunk");
+		static const ComponentTypeId id = ComponentRegistry::registerType(
+			std::is_empty<T>::value ? 0 : (uint32_t)sizeof(T), (uint32_t)alignof(T), findTypeInfo<T>());
+		return id;
+	}
+
+	class ComponentMask
+	{
+	private:
+		static const uint32_t k_word_count = k_max_component_types / 64;
+		uint64_t _bits[k_word_count];
+
+	public:
+		ComponentMask()
+		{
+			for (uint32_t ii = 0; ii < k_word_count; ++ii)
+			{
+				_bits[ii] = 0;
+			}
+		}
+
+		void set(ComponentTypeId id) { _bits[id >> 6] |= UINT64_C(1) << (id & 63); }
+		void reset(ComponentTypeId id) { _bits[id >> 6] &= ~(UINT64_C(1) << (id & 63)); }
+		bool test(ComponentTypeId id) const { return 0 != (_bits[id >> 6] & (UINT64_C(1) << (id & 63))); }
+
+		// true if every bit of other is also set here
+		bool contains(const ComponentMask& other) const
+		{
+			for (uint32_t ii = 0; ii < k_word_count; ++ii)
+			{
+				if (other._bits[ii] != (_bits[ii] & other._bits[ii]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool intersects(const ComponentMask& other) const
+		{
+			for (uint32_t ii = 0; ii < k_word_count; ++ii)
+			{
+				if (0 != (_bits[ii] & other._bits[ii]))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool operator == (const ComponentMask& other) const
+		{
+			for (uint32_t ii = 0; ii < k_word_count; ++ii)
+			{
+				if (_bits[ii] != other._bits[ii])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		size_t hash() const
+		{
+			uint64_t result = 0;
+			for (uint32_t ii = 0; ii < k_word_count; ++ii)
+			{
+				result = result * UINT64_C(0x9e3779b97f4a7c15) + _bits[ii];
+			}
+			return (size_t)(result ^ (result >> 32));
+		}
+
+		struct Hasher
+		{
+			size_t operator()(const ComponentMask& mask) const { return mask.hash(); }
+		};
+	};
+
+	template <class... Ts>
+	inline ComponentMask makeComponentMask()
+	{
+		ComponentMask mask;
+		ComponentTypeId ids[] = { 0, getComponentTypeId<Ts>()... };
+		for (uint32_t ii = 1; ii < sizeof(ids) / sizeof(ids[0]); ++ii)
+		{
+			mask.set(ids[ii]);
+		}
+		return mask;
+	}
+}
+
+#endif
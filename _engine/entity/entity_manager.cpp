@@ -0,0 +1,224 @@
+#include "entity/entity_manager.h"
+
+#include <cstring>
+#include <cassert>
+
+namespace monster
+{
+	const std::vector<Archetype*>& EntityQuery::refresh(const EntityManager& manager)
+	{
+		for (uint32_t num = manager.getArchetypeCount(); _archetypes_seen < num; ++_archetypes_seen)
+		{
+			Archetype* archetype = manager.getArchetype(_archetypes_seen);
+			if (archetype->getMask().contains(_all)
+				&& !archetype->getMask().intersects(_none))
+			{
+				_matches.push_back(archetype);
+			}
+		}
+
+		return _matches;
+	}
+
+	EntityManager::EntityManager()
+	{
+		_empty = getOrCreateArchetype(ComponentMask());
+	}
+
+	EntityManager::~EntityManager()
+	{
+		for (Archetype* archetype : _archetypes)
+		{
+			delete archetype;
+		}
+	}
+
+	Archetype* EntityManager::getOrCreateArchetype(const ComponentMask& mask)
+	{
+		auto it = _archetype_lookup.find(mask);
+		if (it != _archetype_lookup.end())
+		{
+			return it->second;
+		}
+
+		Archetype* archetype = new Archetype(mask);
+		_archetypes.push_back(archetype);
+		_archetype_lookup[mask] = archetype;
+		return archetype;
+	}
+
+	Archetype* EntityManager::getAddTarget(Archetype* archetype, ComponentTypeId id)
+	{
+		Archetype* target = archetype->getAddEdge(id);
+		if (nullptr == target)
+		{
+			ComponentMask mask = archetype->getMask();
+			mask.set(id);
+			target = getOrCreateArchetype(mask);
+			archetype->setAddEdge(id, target);
+			target->setRemoveEdge(id, archetype);
+		}
+		return target;
+	}
+
+	Archetype* EntityManager::getRemoveTarget(Archetype* archetype, ComponentTypeId id)
+	{
+		Archetype* target = archetype->getRemoveEdge(id);
+		if (nullptr == target)
+		{
+			ComponentMask mask = archetype->getMask();
+			mask.reset(id);
+			target = getOrCreateArchetype(mask);
+			archetype->setRemoveEdge(id, target);
+			target->setAddEdge(id, archetype);
+		}
+		return target;
+	}
+
+	Entity EntityManager::create()
+	{
+		uint32_t index;
+		if (!_free_indices.empty())
+		{
+			index = _free_indices.back();
+			_free_indices.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)_records.size();
+			Record record = { nullptr, 0, 0, 0 };
+			_records.push_back(record);
+		}
+
+		Record& record = _records[index];
+		Entity entity = { index, record._generation };
+
+		record._archetype = _empty;
+		_empty->allocateRow(entity, record._chunk, record._row);
+
+		return entity;
+	}
+
+	void EntityManager::destroy(Entity entity)
+	{
+		if (!isAlive(entity))
+		{
+			return;
+		}
+
+		Record& record = _records[entity._index];
+		Entity moved = record._archetype->removeRow(record._chunk, record._row);
+		if (isValid(moved))
+		{
+			_records[moved._index]._chunk = record._chunk;
+			_records[moved._index]._row = record._row;
+		}
+
+		record._archetype = nullptr;
+		++record._generation;
+		_free_indices.push_back(entity._index);
+	}
+
+	bool EntityManager::isAlive(Entity entity) const
+	{
+		return entity._index < _records.size()
+			&& nullptr != _records[entity._index]._archetype
+			&& _records[entity._index]._generation == entity._generation;
+	}
+
+	void EntityManager::moveEntity(Entity entity, Archetype* target)
+	{
+		Record& record = _records[entity._index];
+		Archetype* source = record._archetype;
+
+		uint32_t chunk, row;
+		target->allocateRow(entity, chunk, row);
+
+		for (ComponentTypeId id : source->getTypes())
+		{
+			int32_t to = target->getColumn(id);
+			if (0 > to)
+			{
+				continue;
+			}
+
+			uint32_t size = ComponentRegistry::getInfo(id)._size;
+			memcpy((uint8_t*)target->getColumnData(chunk, to) + size * row
+				, (const uint8_t*)source->getColumnData(record._chunk, source->getColumn(id)) + size * record._row
+				, size
+				);
+		}
+
+		Entity moved = source->removeRow(record._chunk, record._row);
+		if (isValid(moved))
+		{
+			_records[moved._index]._chunk = record._chunk;
+			_records[moved._index]._row = record._row;
+		}
+
+		record._archetype = target;
+		record._chunk = chunk;
+		record._row = row;
+	}
+
+	void EntityManager::addComponent(Entity entity, ComponentTypeId id, const void* data)
+	{
+		assert(isAlive(entity));
+
+		Record& record = _records[entity._index];
+		if (0 > record._archetype->getColumn(id))
+		{
+			moveEntity(entity, getAddTarget(record._archetype, id));
+		}
+
+		uint32_t size = ComponentRegistry::getInfo(id)._size;
+		if (0 != size
+			&& nullptr != data)
+		{
+			memcpy(getComponent(entity, id), data, size);
+		}
+	}
+
+	void EntityManager::removeComponent(Entity entity, ComponentTypeId id)
+	{
+		assert(isAlive(entity));
+
+		Record& record = _records[entity._index];
+		if (0 <= record._archetype->getColumn(id))
+		{
+			moveEntity(entity, getRemoveTarget(record._archetype, id));
+		}
+	}
+
+	bool EntityManager::hasComponent(Entity entity, ComponentTypeId id) const
+	{
+		return isAlive(entity)
+			&& 0 <= _records[entity._index]._archetype->getColumn(id);
+	}
+
+	void* EntityManager::getComponent(Entity entity, ComponentTypeId id) const
+	{
+		if (!isAlive(entity))
+		{
+			return nullptr;
+		}
+
+		const Record& record = _records[entity._index];
+		int32_t column = record._archetype->getColumn(id);
+		if (0 > column)
+		{
+			return nullptr;
+		}
+
+		uint32_t size = ComponentRegistry::getInfo(id)._size;
+		return (uint8_t*)record._archetype->getColumnData(record._chunk, column) + size * record._row;
+	}
+
+	void EntityManager::collectChunks(EntityQuery& query, std::vector<ChunkView>& chunks) const
+	{
+		forEachChunk(query, [&chunks](const ChunkView& view)
+		{
+			chunks.push_back(view);
+		});
+	}
+}
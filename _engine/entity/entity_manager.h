@@ -0,0 +1,156 @@
+#ifndef __MONSTER_ENTITY_MANAGER_H__
+#define __MONSTER_ENTITY_MANAGER_H__
+
+#include <vector>
+#include <unordered_map>
+
+#include "entity/entity.h"
+#include "entity/archetype.h"
+
+namespace monster
+{
+	class EntityManager;
+
+	// One chunk of one matching archetype, handed to chunk-level callbacks.
+	struct ChunkView
+	{
+		Archetype* _archetype;
+		uint32_t _chunk;
+		uint32_t _count;
+
+		Entity* getEntities() const { return _archetype->getEntities(_chunk); }
+
+		template <class T>
+		T* get() const { return _archetype->getArray<T>(_chunk); }
+	};
+
+	// Archetypes that have every component of _all and none of _none. The
+	// match list is cached and only extended with archetypes created since
+	// the last refresh; archetypes are never destroyed.
+	class EntityQuery
+	{
+	private:
+		ComponentMask _all;
+		ComponentMask _none;
+		std::vector<Archetype*> _matches;
+		uint32_t _archetypes_seen;
+
+	public:
+		EntityQuery() : _archetypes_seen(0) {}
+		EntityQuery(const ComponentMask& all, const ComponentMask& none = ComponentMask())
+			: _all(all), _none(none), _archetypes_seen(0) {}
+
+		const ComponentMask& getAll() const { return _all; }
+		const ComponentMask& getNone() const { return _none; }
+
+		const std::vector<Archetype*>& refresh(const EntityManager& manager);
+	};
+
+	class EntityManager
+	{
+	private:
+		struct Record
+		{
+			Archetype* _archetype;
+			uint32_t _chunk;
+			uint32_t _row;
+			uint32_t _generation;
+		};
+
+		std::vector<Record> _records;
+		std::vector<uint32_t> _free_indices;
+
+		std::vector<Archetype*> _archetypes;
+		std::unordered_map<ComponentMask, Archetype*, ComponentMask::Hasher> _archetype_lookup;
+		Archetype* _empty;
+
+	private:
+		Archetype* getOrCreateArchetype(const ComponentMask& mask);
+		Archetype* getAddTarget(Archetype* archetype, ComponentTypeId id);
+		Archetype* getRemoveTarget(Archetype* archetype, ComponentTypeId id);
+		void moveEntity(Entity entity, Archetype* target);
+
+		template <class F, class... Ptrs>
+		static void forEachRow(uint32_t count, const Entity* entities, F& fn, Ptrs... arrays)
+		{
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				fn(entities[ii], arrays[ii]...);
+			}
+		}
+
+	public:
+		EntityManager();
+		~EntityManager();
+
+		EntityManager(const EntityManager&) = delete;
+		EntityManager& operator = (const EntityManager&) = delete;
+
+		Entity create();
+		void destroy(Entity entity);
+		bool isAlive(Entity entity) const;
+		uint32_t getEntityCount() const { return (uint32_t)(_records.size() - _free_indices.size()); }
+
+		// Moves the entity to the archetype with (or without) the component,
+		// copying each shared column once: O(component count).
+		void addComponent(Entity entity, ComponentTypeId id, const void* data);
+		void removeComponent(Entity entity, ComponentTypeId id);
+		bool hasComponent(Entity entity, ComponentTypeId id) const;
+		void* getComponent(Entity entity, ComponentTypeId id) const;
+
+		template <class T>
+		T& addComponent(Entity entity, const T& value = T())
+		{
+			ComponentTypeId id = getComponentTypeId<T>();
+			addComponent(entity, id, &value);
+			return *(T*)getComponent(entity, id);
+		}
+
+		template <class T>
+		void removeComponent(Entity entity) { removeComponent(entity, getComponentTypeId<T>()); }
+
+		template <class T>
+		bool hasComponent(Entity entity) const { return hasComponent(entity, getComponentTypeId<T>()); }
+
+		template <class T>
+		T* getComponent(Entity entity) const { return (T*)getComponent(entity, getComponentTypeId<T>()); }
+
+		uint32_t getArchetypeCount() const { return (uint32_t)_archetypes.size(); }
+		Archetype* getArchetype(uint32_t index) const { return _archetypes[index]; }
+
+		// Appends every non-empty chunk matching the query, in archetype then chunk order.
+		void collectChunks(EntityQuery& query, std::vector<ChunkView>& chunks) const;
+
+		template <class F>
+		void forEachChunk(EntityQuery& query, F fn) const
+		{
+			for (Archetype* archetype : query.refresh(*this))
+			{
+				for (uint32_t chunk = 0, num = archetype->getChunkCount(); chunk < num; ++chunk)
+				{
+					ChunkView view = { archetype, chunk, archetype->getChunk(chunk)._count };
+					fn(view);
+				}
+			}
+		}
+
+		// Calls fn(Entity, Ts&...) for every entity that has all of Ts, walking each chunk's arrays linearly.
+		template <class... Ts, class F>
+		void forEach(F fn) const
+		{
+			EntityQuery query(makeComponentMask<Ts...>());
+			forEach<Ts...>(query, fn);
+		}
+
+		template <class... Ts, class F>
+		void forEach(EntityQuery& query, F fn) const
+		{
+			forEachChunk(query, [&fn](const ChunkView& view)
+			{
+				forEachRow(view._count, view.getEntities(), fn, view.get<Ts>()...);
+			});
+		}
+	};
+}
+
+#endif
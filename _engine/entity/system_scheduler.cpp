@@ -0,0 +1,166 @@
+#include "entity/system_scheduler.h"
+
+#include <algorithm>
+
+namespace monster
+{
+	static bool isConflicting(const System* a, const System* b)
+	{
+		return a->getWrites().intersects(b->getReads())
+			|| a->getWrites().intersects(b->getWrites())
+			|| b->getWrites().intersects(a->getReads());
+	}
+
+	void SystemScheduler::addSystem(System* system)
+	{
+		Node node;
+		node._system = system;
+		node._dependency_count = 0;
+		node._pending_dependencies = 0;
+		node._pending_chunks = 0;
+		_nodes.push_back(node);
+		_is_dirty = true;
+	}
+
+	void SystemScheduler::removeSystem(System* system)
+	{
+		_nodes.erase(std::remove_if(_nodes.begin(), _nodes.end(), [system](const Node& node)
+		{
+			return node._system == system;
+		}), _nodes.end());
+		_is_dirty = true;
+	}
+
+	void SystemScheduler::buildGraph()
+	{
+		for (Node& node : _nodes)
+		{
+			node._dependents.clear();
+			node._dependency_count = 0;
+		}
+
+		for (uint32_t ii = 0; ii < _nodes.size(); ++ii)
+		{
+			for (uint32_t jj = ii + 1; jj < _nodes.size(); ++jj)
+			{
+				if (isConflicting(_nodes[ii]._system, _nodes[jj]._system))
+				{
+					_nodes[ii]._dependents.push_back(jj);
+					++_nodes[jj]._dependency_count;
+				}
+			}
+		}
+
+		_chunk_jobs.resize(_nodes.size());
+		for (uint32_t ii = 0; ii < _nodes.size(); ++ii)
+		{
+			_chunk_jobs[ii]._scheduler = this;
+			_chunk_jobs[ii]._node = ii;
+		}
+
+		_is_dirty = false;
+	}
+
+	void SystemScheduler::update(EntityManager& manager, float dt)
+	{
+		if (_nodes.empty())
+		{
+			return;
+		}
+
+		if (_is_dirty)
+		{
+			buildGraph();
+		}
+
+		_manager = &manager;
+		_dt = dt;
+
+		for (Node& node : _nodes)
+		{
+			node._system->prepare(manager, dt);
+			node._chunks.clear();
+			manager.collectChunks(node._system->getQuery(), node._chunks);
+			node._pending_dependencies = (int32_t)node._dependency_count;
+		}
+
+		_frame_counter.add((int32_t)_nodes.size());
+
+		for (uint32_t ii = 0; ii < _nodes.size(); ++ii)
+		{
+			if (0 == _nodes[ii]._dependency_count)
+			{
+				dispatch(ii);
+			}
+		}
+
+		_jobs->wait(_frame_counter);
+	}
+
+	void SystemScheduler::dispatch(uint32_t index)
+	{
+		Node& node = _nodes[index];
+		uint32_t num_chunks = (uint32_t)node._chunks.size();
+		if (0 == num_chunks)
+		{
+			finish(index);
+			return;
+		}
+
+		// a few jobs per worker keeps the cores busy without paying queue overhead per chunk
+		uint32_t target_jobs = (_jobs->getWorkerCount() + 1) * 4;
+		uint32_t grain = std::max<uint32_t>(1, (num_chunks + target_jobs - 1) / target_jobs);
+		uint32_t num_jobs = (num_chunks + grain - 1) / grain;
+
+		node._pending_chunks = (int32_t)num_jobs;
+
+		Job jobs[64];
+		uint32_t count = 0;
+		for (uint32_t begin = 0; begin < num_chunks; begin += grain)
+		{
+			Job& job = jobs[count++];
+			job._fn = chunkJobFunc;
+			job._data = &_chunk_jobs[index];
+			job._begin = begin;
+			job._end = std::min(begin + grain, num_chunks);
+			job._counter = nullptr;
+
+			if (count == sizeof(jobs) / sizeof(jobs[0]))
+			{
+				_jobs->push(jobs, count);
+				count = 0;
+			}
+		}
+		_jobs->push(jobs, count);
+	}
+
+	void SystemScheduler::finish(uint32_t index)
+	{
+		for (uint32_t dependent : _nodes[index]._dependents)
+		{
+			if (0 == atomicDec(&_nodes[dependent]._pending_dependencies))
+			{
+				dispatch(dependent);
+			}
+		}
+
+		_frame_counter.decrement();
+	}
+
+	void SystemScheduler::chunkJobFunc(void* data, uint32_t begin, uint32_t end)
+	{
+		const ChunkJob* chunk_job = (const ChunkJob*)data;
+		SystemScheduler* scheduler = chunk_job->_scheduler;
+		Node& node = scheduler->_nodes[chunk_job->_node];
+
+		for (uint32_t ii = begin; ii < end; ++ii)
+		{
+			node._system->updateChunk(node._chunks[ii], scheduler->_dt);
+		}
+
+		if (0 == atomicDec(&node._pending_chunks))
+		{
+			scheduler->finish(chunk_job->_node);
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#ifndef __MONSTER_SYSTEM_SCHEDULER_H__
+#define __MONSTER_SYSTEM_SCHEDULER_H__
+
+#include <vector>
+
+#include "entity/entity_manager.h"
+#include "core/job/job_system.h"
+
+namespace monster
+{
+	// A system declares the components it reads and writes and then updates
+	// one chunk at a time. updateChunk() may run on several workers at once
+	// for different chunks, so it must only touch the chunk it was given.
+	class System
+	{
+	private:
+		ComponentMask _reads;
+		ComponentMask _writes;
+		EntityQuery _query;
+
+	protected:
+		template <class T>
+		void reads() { _reads.set(getComponentTypeId<T>()); }
+
+		template <class T>
+		void writes() { _writes.set(getComponentTypeId<T>()); }
+
+		// Call once the access is declared; entities must have every read and written component.
+		void buildQuery(const ComponentMask& none = ComponentMask())
+		{
+			ComponentMask all = _reads;
+			for (uint32_t ii = 0; ii < k_max_component_types; ++ii)
+			{
+				if (_writes.test((ComponentTypeId)ii))
+				{
+					all.set((ComponentTypeId)ii);
+				}
+			}
+			_query = EntityQuery(all, none);
+		}
+
+	public:
+		virtual ~System() {}
+
+		const ComponentMask& getReads() const { return _reads; }
+		const ComponentMask& getWrites() const { return _writes; }
+		EntityQuery& getQuery() { return _query; }
+
+		// Runs on the scheduling thread before any chunk of this system is dispatched.
+		virtual void prepare(EntityManager& /*manager*/, float /*dt*/) {}
+		virtual void updateChunk(const ChunkView& chunk, float dt) = 0;
+	};
+
+	// Orders systems by their declared access instead of by hand. A system
+	// depends on every earlier-added system it conflicts with (one writes
+	// what the other reads or writes); everything else runs concurrently,
+	// and each system's chunks are spread over the job system's workers.
+	// The entity manager must not change structurally during update().
+	class SystemScheduler
+	{
+	private:
+		struct Node
+		{
+			System* _system;
+			std::vector<uint32_t> _dependents;
+			uint32_t _dependency_count;
+			volatile int32_t _pending_dependencies;
+			volatile int32_t _pending_chunks;
+			std::vector<ChunkView> _chunks;
+		};
+
+		struct ChunkJob
+		{
+			SystemScheduler* _scheduler;
+			uint32_t _node;
+		};
+
+		JobSystem* _jobs;
+		std::vector<Node> _nodes;
+		std::vector<ChunkJob> _chunk_jobs;
+		bool _is_dirty;
+
+		EntityManager* _manager;
+		float _dt;
+		JobCounter _frame_counter;
+
+	private:
+		void buildGraph();
+		void dispatch(uint32_t node);
+		void finish(uint32_t node);
+
+		static void chunkJobFunc(void* data, uint32_t begin, uint32_t end);
+
+	public:
+		explicit SystemScheduler(JobSystem* jobs) : _jobs(jobs), _is_dirty(false), _manager(nullptr), _dt(0.0f) {}
+
+		// Registration order breaks ties: of two conflicting systems the earlier one runs first.
+		void addSystem(System* system);
+		void removeSystem(System* system);
+
+		void update(EntityManager& manager, float dt);
+	};
+}
+
+#endif
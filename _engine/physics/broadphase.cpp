@@ -0,0 +1,1378 @@
+#include "physics/broadphase.h"
+
+#include "physics/state_stream.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <bx/uint32_t.h>
+
+namespace monster
+{
+	static const float k_aabb_margin = 0.1f;
+	static const float k_displacement_multiplier = 2.0f;
+	static const uint32_t k_bin_count = 16;
+
+	// more new proxies than this at once rebuild instead of going in one by one
+	static const uint32_t k_tree_rebuild_threshold = 256;
+
+	// deeper than this, rebuild() splits halve the count to bound the height
+	static const uint32_t k_tree_median_depth = 32;
+
+	// lane masks to bits, or-ed together across the lanes
+	static uint32_t laneMask(bx::float4_t mask)
+	{
+		using namespace bx;
+
+		const float4_t bits = float4_and(mask, float4_ild(1, 2, 4, 8));
+		const float4_t pairs = float4_or(bits, float4_swiz_zwxy(bits));
+		const float4_t result = float4_or(pairs, float4_swiz_yxwz(pairs));
+
+		uint32_t lanes;
+		float4_stx(&lanes, result);
+		return lanes;
+	}
+
+	void loadAabb4(Aabb4& boxes, const Aabb* aabb, uint32_t count)
+	{
+		float bounds[6][4];
+		for (uint32_t ii = 0; ii < 4; ++ii)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				bounds[axis][ii] = ii < count ? aabb[ii].m_min[axis] : FLT_MAX;
+				bounds[axis + 3][ii] = ii < count ? aabb[ii].m_max[axis] : -FLT_MAX;
+			}
+		}
+
+		boxes._min_x = bx::float4_ld(bounds[0][0], bounds[0][1], bounds[0][2], bounds[0][3]);
+		boxes._min_y = bx::float4_ld(bounds[1][0], bounds[1][1], bounds[1][2], bounds[1][3]);
+		boxes._min_z = bx::float4_ld(bounds[2][0], bounds[2][1], bounds[2][2], bounds[2][3]);
+		boxes._max_x = bx::float4_ld(bounds[3][0], bounds[3][1], bounds[3][2], bounds[3][3]);
+		boxes._max_y = bx::float4_ld(bounds[4][0], bounds[4][1], bounds[4][2], bounds[4][3]);
+		boxes._max_z = bx::float4_ld(bounds[5][0], bounds[5][1], bounds[5][2], bounds[5][3]);
+	}
+
+	uint32_t aabbOverlapTest4(const Aabb& aabb, const Aabb4& boxes)
+	{
+		using namespace bx;
+
+		const float4_t min_x = float4_splat(aabb.m_min[0]);
+		const float4_t min_y = float4_splat(aabb.m_min[1]);
+		const float4_t min_z = float4_splat(aabb.m_min[2]);
+		const float4_t max_x = float4_splat(aabb.m_max[0]);
+		const float4_t max_y = float4_splat(aabb.m_max[1]);
+		const float4_t max_z = float4_splat(aabb.m_max[2]);
+
+		const float4_t x = float4_and(float4_cmple(boxes._min_x, max_x), float4_cmpge(boxes._max_x, min_x));
+		const float4_t y = float4_and(float4_cmple(boxes._min_y, max_y), float4_cmpge(boxes._max_y, min_y));
+		const float4_t z = float4_and(float4_cmple(boxes._min_z, max_z), float4_cmpge(boxes._max_z, min_z));
+		return laneMask(float4_and(x, float4_and(y, z)));
+	}
+
+	RayPacket::RayPacket()
+	{
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				_origin[axis][lane] = 0.0f;
+				_inv_direction[axis][lane] = 0.0f;
+			}
+			_max_t[lane] = -1.0f;
+		}
+	}
+
+	void RayPacket::setRay(uint32_t lane, const float origin[3], const float direction[3], float max_t)
+	{
+		assert(4 > lane);
+
+		// huge rather than infinite, so a ray in a slab's plane gives 0 and not NaN
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			_origin[axis][lane] = origin[axis];
+			_inv_direction[axis][lane] = 0.0f != direction[axis] ? 1.0f / direction[axis] : FLT_MAX;
+		}
+		_max_t[lane] = max_t;
+	}
+
+	struct RayPacket4
+	{
+		bx::float4_t _origin[3];
+		bx::float4_t _inv_direction[3];
+	};
+
+	static void loadRayPacket(RayPacket4& rays, const RayPacket& packet)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float* origin = packet._origin[axis];
+			const float* inv_direction = packet._inv_direction[axis];
+			rays._origin[axis] = bx::float4_ld(origin[0], origin[1], origin[2], origin[3]);
+			rays._inv_direction[axis] = bx::float4_ld(inv_direction[0], inv_direction[1], inv_direction[2], inv_direction[3]);
+		}
+	}
+
+	static bx::float4_t loadMaxT(const RayPacket& packet)
+	{
+		return bx::float4_ld(packet._max_t[0], packet._max_t[1], packet._max_t[2], packet._max_t[3]);
+	}
+
+	static float getFurthest(const RayPacket& packet)
+	{
+		float furthest = packet._max_t[0];
+		for (uint32_t lane = 1; lane < 4; ++lane)
+		{
+			furthest = packet._max_t[lane] > furthest ? packet._max_t[lane] : furthest;
+		}
+		return furthest;
+	}
+
+	// slab test of all four rays against one box, entry is where the
+	// first of the lanes that hit gets in
+	static uint32_t rayTest4(const RayPacket4& rays, bx::float4_t max_t, const Aabb& aabb, float& entry)
+	{
+		using namespace bx;
+
+		float4_t t_near = float4_zero();
+		float4_t t_far = max_t;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float4_t t0 = float4_mul(float4_sub(float4_splat(aabb.m_min[axis]), rays._origin[axis]), rays._inv_direction[axis]);
+			const float4_t t1 = float4_mul(float4_sub(float4_splat(aabb.m_max[axis]), rays._origin[axis]), rays._inv_direction[axis]);
+			t_near = float4_max(t_near, float4_min(t0, t1));
+			t_far = float4_min(t_far, float4_max(t0, t1));
+		}
+
+		const float4_t hit = float4_cmple(t_near, t_far);
+		const float4_t near = float4_or(float4_and(hit, t_near), float4_andc(float4_splat(FLT_MAX), hit));
+		const float4_t pairs = float4_min(near, float4_swiz_zwxy(near));
+		float4_stx(&entry, float4_min(pairs, float4_swiz_yxwz(pairs)));
+		return laneMask(hit);
+	}
+
+	static bool containsAabb(const Aabb& outer, const Aabb& inner)
+	{
+		return outer.m_min[0] <= inner.m_min[0] && outer.m_min[1] <= inner.m_min[1] && outer.m_min[2] <= inner.m_min[2]
+			&& outer.m_max[0] >= inner.m_max[0] && outer.m_max[1] >= inner.m_max[1] && outer.m_max[2] >= inner.m_max[2];
+	}
+
+	static void combineAabb(Aabb& result, const Aabb& a, const Aabb& b)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			result.m_min[axis] = a.m_min[axis] < b.m_min[axis] ? a.m_min[axis] : b.m_min[axis];
+			result.m_max[axis] = a.m_max[axis] > b.m_max[axis] ? a.m_max[axis] : b.m_max[axis];
+		}
+	}
+
+	// half the surface area, all the SAH cost needs
+	static float getArea(const Aabb& aabb)
+	{
+		float dx = aabb.m_max[0] - aabb.m_min[0];
+		float dy = aabb.m_max[1] - aabb.m_min[1];
+		float dz = aabb.m_max[2] - aabb.m_min[2];
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	static void computeFatAabb(Aabb& fat, const Aabb& aabb, const float displacement[3])
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			float d = k_displacement_multiplier * displacement[axis];
+			fat.m_min[axis] = aabb.m_min[axis] - k_aabb_margin + (d < 0.0f ? d : 0.0f);
+			fat.m_max[axis] = aabb.m_max[axis] + k_aabb_margin + (d > 0.0f ? d : 0.0f);
+		}
+	}
+
+	// still inside the fat box, and the fat box isn't left oversized by a fast move that stopped
+	static bool isFatAabbValid(const Aabb& fat, const Aabb& aabb)
+	{
+		if (!containsAabb(fat, aabb))
+		{
+			return false;
+		}
+
+		Aabb huge;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			huge.m_min[axis] = aabb.m_min[axis] - 4.0f * k_aabb_margin;
+			huge.m_max[axis] = aabb.m_max[axis] + 4.0f * k_aabb_margin;
+		}
+		return containsAabb(huge, fat);
+	}
+
+	DynamicTree::DynamicTree()
+		: _root(k_null)
+		, _free(k_null)
+		, _proxy_count(0)
+		, _created(0)
+	{
+	}
+
+	uint32_t DynamicTree::allocateNode()
+	{
+		uint32_t node = _free;
+		if (k_null == node)
+		{
+			node = (uint32_t)_nodes.size();
+			_nodes.push_back(Node());
+		}
+		else
+		{
+			_free = _nodes[node]._parent;
+		}
+
+		Node& result = _nodes[node];
+		result._parent = k_null;
+		result._child[0] = k_null;
+		result._child[1] = k_null;
+		result._user_data = 0;
+		result._height = 0;
+		result._is_static = false;
+		result._moved = false;
+		return node;
+	}
+
+	void DynamicTree::freeNode(uint32_t node)
+	{
+		_nodes[node]._parent = _free;
+		_nodes[node]._height = -1;
+		_nodes[node]._moved = false;
+		_free = node;
+	}
+
+	void DynamicTree::insertLeaf(uint32_t leaf)
+	{
+		if (k_null == _root)
+		{
+			_root = leaf;
+			_nodes[leaf]._parent = k_null;
+			return;
+		}
+
+		// walk down to the sibling that grows the total area the least
+		const Aabb box = _nodes[leaf]._aabb;
+		uint32_t index = _root;
+		while (k_null != _nodes[index]._child[0])
+		{
+			const Node& node = _nodes[index];
+
+			Aabb combined;
+			combineAabb(combined, node._aabb, box);
+			float combined_area = getArea(combined);
+
+			// a new parent here, or push the leaf further down and grow this node
+			float cost = 2.0f * combined_area;
+			float inheritance_cost = 2.0f * (combined_area - getArea(node._aabb));
+
+			float child_cost[2];
+			for (uint32_t ii = 0; ii < 2; ++ii)
+			{
+				const Node& child = _nodes[node._child[ii]];
+				combineAabb(combined, child._aabb, box);
+				child_cost[ii] = getArea(combined) + inheritance_cost;
+				if (k_null != child._child[0])
+				{
+					child_cost[ii] -= getArea(child._aabb);
+				}
+			}
+
+			if (cost < child_cost[0] && cost < child_cost[1])
+			{
+				break;
+			}
+
+			index = child_cost[0] < child_cost[1] ? node._child[0] : node._child[1];
+		}
+
+		const uint32_t sibling = index;
+		const uint32_t old_parent = _nodes[sibling]._parent;
+		const uint32_t new_parent = allocateNode();
+
+		Node& parent = _nodes[new_parent];
+		parent._parent = old_parent;
+		combineAabb(parent._aabb, box, _nodes[sibling]._aabb);
+		parent._height = _nodes[sibling]._height + 1;
+		parent._child[0] = sibling;
+		parent._child[1] = leaf;
+		_nodes[sibling]._parent = new_parent;
+		_nodes[leaf]._parent = new_parent;
+
+		if (k_null == old_parent)
+		{
+			_root = new_parent;
+		}
+		else
+		{
+			Node& node = _nodes[old_parent];
+			node._child[node._child[0] == sibling ? 0 : 1] = new_parent;
+		}
+
+		// refit and rebalance on the way back up
+		for (index = _nodes[leaf]._parent; k_null != index; index = _nodes[index]._parent)
+		{
+			index = balance(index);
+
+			Node& node = _nodes[index];
+			const Node& child0 = _nodes[node._child[0]];
+			const Node& child1 = _nodes[node._child[1]];
+			node._height = 1 + (child0._height > child1._height ? child0._height : child1._height);
+			combineAabb(node._aabb, child0._aabb, child1._aabb);
+		}
+	}
+
+	void DynamicTree::removeLeaf(uint32_t leaf)
+	{
+		if (leaf == _root)
+		{
+			_root = k_null;
+			return;
+		}
+
+		const uint32_t parent = _nodes[leaf]._parent;
+		const uint32_t grand_parent = _nodes[parent]._parent;
+		const uint32_t sibling = _nodes[parent]._child[_nodes[parent]._child[0] == leaf ? 1 : 0];
+
+		// the sibling takes the parent's place
+		freeNode(parent);
+		_nodes[sibling]._parent = grand_parent;
+		if (k_null == grand_parent)
+		{
+			_root = sibling;
+			return;
+		}
+
+		Node& node = _nodes[grand_parent];
+		node._child[node._child[0] == parent ? 0 : 1] = sibling;
+
+		for (uint32_t index = grand_parent; k_null != index; index = _nodes[index]._parent)
+		{
+			index = balance(index);
+
+			Node& current = _nodes[index];
+			const Node& child0 = _nodes[current._child[0]];
+			const Node& child1 = _nodes[current._child[1]];
+			current._height = 1 + (child0._height > child1._height ? child0._height : child1._height);
+			combineAabb(current._aabb, child0._aabb, child1._aabb);
+		}
+	}
+
+	// Rotates the taller child of node up when the heights differ by more
+	// than one, and returns the subtree's new root.
+	uint32_t DynamicTree::balance(uint32_t node)
+	{
+		Node* nodes = &_nodes[0];
+		Node& a = nodes[node];
+		if (k_null == a._child[0] || a._height < 2)
+		{
+			return node;
+		}
+
+		const int32_t difference = nodes[a._child[1]]._height - nodes[a._child[0]]._height;
+		if (-1 <= difference && difference <= 1)
+		{
+			return node;
+		}
+
+		const uint32_t tall = 0 < difference ? 1 : 0;
+		const uint32_t up = a._child[tall];
+		Node& x = nodes[up];
+
+		// x keeps its taller child, the shorter one moves down to a
+		uint32_t keep = x._child[1];
+		uint32_t give = x._child[0];
+		if (nodes[give]._height > nodes[keep]._height)
+		{
+			std::swap(keep, give);
+		}
+
+		x._child[0] = node;
+		x._child[1] = keep;
+		x._parent = a._parent;
+		a._parent = up;
+
+		if (k_null == x._parent)
+		{
+			_root = up;
+		}
+		else
+		{
+			Node& parent = nodes[x._parent];
+			parent._child[parent._child[0] == node ? 0 : 1] = up;
+		}
+
+		a._child[tall] = give;
+		nodes[give]._parent = node;
+
+		const Node& child0 = nodes[a._child[0]];
+		const Node& child1 = nodes[a._child[1]];
+		combineAabb(a._aabb, child0._aabb, child1._aabb);
+		a._height = 1 + (child0._height > child1._height ? child0._height : child1._height);
+
+		combineAabb(x._aabb, a._aabb, nodes[keep]._aabb);
+		x._height = 1 + (a._height > nodes[keep]._height ? a._height : nodes[keep]._height);
+		return up;
+	}
+
+	uint32_t DynamicTree::createProxy(const Aabb& aabb, uint32_t user_data, bool is_static)
+	{
+		const float no_displacement[3] = { 0.0f, 0.0f, 0.0f };
+
+		uint32_t proxy = allocateNode();
+		Node& node = _nodes[proxy];
+		computeFatAabb(node._aabb, aabb, no_displacement);
+		node._user_data = user_data;
+		node._is_static = is_static;
+		node._moved = true;
+
+		insertLeaf(proxy);
+		_moved.push_back(proxy);
+		++_proxy_count;
+		++_created;
+		return proxy;
+	}
+
+	void DynamicTree::destroyProxy(uint32_t proxy)
+	{
+		assert(k_null == _nodes[proxy]._child[0]);
+
+		// a stale entry left in _moved is skipped by its cleared flag
+		removeLeaf(proxy);
+		freeNode(proxy);
+		--_proxy_count;
+	}
+
+	bool DynamicTree::moveProxy(uint32_t proxy, const Aabb& aabb, const float displacement[3])
+	{
+		Node& node = _nodes[proxy];
+		if (isFatAabbValid(node._aabb, aabb))
+		{
+			return false;
+		}
+
+		removeLeaf(proxy);
+		computeFatAabb(_nodes[proxy]._aabb, aabb, displacement);
+		insertLeaf(proxy);
+
+		if (!_nodes[proxy]._moved)
+		{
+			_nodes[proxy]._moved = true;
+			_moved.push_back(proxy);
+		}
+		return true;
+	}
+
+	void DynamicTree::updatePairs(std::vector<ProxyPair>& pairs)
+	{
+		// one insert at a time builds a worse tree than binning them all
+		if (k_tree_rebuild_threshold < _created && _proxy_count < 2 * _created)
+		{
+			rebuild();
+		}
+		_created = 0;
+
+		for (uint32_t ii = 0; ii < _moved.size(); ++ii)
+		{
+			const uint32_t proxy = _moved[ii];
+			if (!_nodes[proxy]._moved)
+			{
+				continue;
+			}
+
+			const Node& node = _nodes[proxy];
+			auto fn = [&](uint32_t other) -> bool
+			{
+				const Node& candidate = _nodes[other];
+				if (other == proxy || (node._is_static && candidate._is_static))
+				{
+					return true;
+				}
+
+				// two moved proxies find each other, keep one of them
+				if (candidate._moved && other < proxy)
+				{
+					return true;
+				}
+
+				ProxyPair pair = { node._user_data, candidate._user_data };
+				pairs.push_back(pair);
+				return true;
+			};
+			query(node._aabb, fn);
+		}
+
+		for (uint32_t proxy : _moved)
+		{
+			_nodes[proxy]._moved = false;
+		}
+		_moved.clear();
+	}
+
+	void DynamicTree::clear()
+	{
+		_nodes.clear();
+		_moved.clear();
+		_root = k_null;
+		_free = k_null;
+		_proxy_count = 0;
+		_created = 0;
+	}
+
+	void DynamicTree::rayCast(RayPacket& packet, RayCastFunc fn, void* data) const
+	{
+		struct Entry
+		{
+			uint32_t _node;
+			uint32_t _lanes;
+			float _t;
+		};
+
+		if (k_null == _root)
+		{
+			return;
+		}
+
+		RayPacket4 rays;
+		loadRayPacket(rays, packet);
+		bx::float4_t max_t = loadMaxT(packet);
+		float furthest = getFurthest(packet);
+
+		Entry stack[k_stack_size];
+		stack[0]._node = _root;
+		stack[0]._lanes = rayTest4(rays, max_t, _nodes[_root]._aabb, stack[0]._t);
+		uint32_t count = 0 != stack[0]._lanes ? 1 : 0;
+		while (0 < count)
+		{
+			// hits since the push may have brought every lane closer
+			const Entry entry = stack[--count];
+			if (entry._t > furthest)
+			{
+				continue;
+			}
+
+			const Node& node = _nodes[entry._node];
+			if (k_null == node._child[0])
+			{
+				const uint32_t lanes = entry._lanes & laneMask(bx::float4_cmpge(max_t, bx::float4_zero()));
+				if (0 != lanes)
+				{
+					fn(data, entry._node, lanes, packet);
+					max_t = loadMaxT(packet);
+					furthest = getFurthest(packet);
+				}
+				continue;
+			}
+
+			// the child the rays enter first is popped first
+			Entry child[2];
+			for (uint32_t ii = 0; ii < 2; ++ii)
+			{
+				child[ii]._node = node._child[ii];
+				child[ii]._lanes = rayTest4(rays, max_t, _nodes[node._child[ii]]._aabb, child[ii]._t);
+			}
+			const uint32_t first = child[0]._t <= child[1]._t ? 0 : 1;
+
+			assert(count + 2 <= k_stack_size);
+			if (0 != child[1 - first]._lanes)
+			{
+				stack[count++] = child[1 - first];
+			}
+			if (0 != child[first]._lanes)
+			{
+				stack[count++] = child[first];
+			}
+		}
+	}
+
+	void DynamicTree::queryAabb(const Aabb& aabb, std::vector<uint32_t>& proxies) const
+	{
+		auto fn = [&](uint32_t proxy) -> bool
+		{
+			proxies.push_back(proxy);
+			return true;
+		};
+		query(aabb, fn);
+	}
+
+	void DynamicTree::saveState(StateWriter& writer) const
+	{
+		writer.write(_nodes);
+		writer.write(_root);
+		writer.write(_free);
+		writer.write(_proxy_count);
+		writer.write(_created);
+		writer.write(_moved);
+	}
+
+	void DynamicTree::loadState(StateReader& reader)
+	{
+		reader.read(_nodes);
+		reader.read(_root);
+		reader.read(_free);
+		reader.read(_proxy_count);
+		reader.read(_created);
+		reader.read(_moved);
+	}
+
+	bool DynamicTree::isValidState() const
+	{
+		const uint32_t size = (uint32_t)_nodes.size();
+		if (k_null != _root && (_root >= size || 0 > _nodes[_root]._height || k_null != _nodes[_root]._parent))
+		{
+			return false;
+		}
+
+		// heights strictly falling towards the leaves rule out cycles, and
+		// every node but the root being its parent's child makes it one tree
+		uint32_t leaf_count = 0;
+		uint32_t used_count = 0;
+		for (uint32_t ii = 0; ii < size; ++ii)
+		{
+			const Node& node = _nodes[ii];
+			if (0 > node._height)
+			{
+				continue;
+			}
+
+			++used_count;
+			if (ii != _root)
+			{
+				if (node._parent >= size
+					|| 0 > _nodes[node._parent]._height
+					|| (ii != _nodes[node._parent]._child[0] && ii != _nodes[node._parent]._child[1]))
+				{
+					return false;
+				}
+			}
+
+			if (k_null == node._child[0])
+			{
+				if (k_null != node._child[1] || 0 != node._height)
+				{
+					return false;
+				}
+				++leaf_count;
+				continue;
+			}
+
+			if (node._child[0] >= size
+				|| node._child[1] >= size
+				|| node._child[0] == node._child[1]
+				|| (uint32_t)node._height >= k_stack_size)
+			{
+				return false;
+			}
+
+			const int32_t height0 = _nodes[node._child[0]]._height;
+			const int32_t height1 = _nodes[node._child[1]]._height;
+			if (0 > height0 || 0 > height1 || node._height != 1 + (height0 > height1 ? height0 : height1))
+			{
+				return false;
+			}
+		}
+
+		if (leaf_count != _proxy_count || (0 < used_count) != (k_null != _root))
+		{
+			return false;
+		}
+
+		uint32_t free_count = 0;
+		for (uint32_t node = _free; k_null != node; node = _nodes[node]._parent)
+		{
+			if (node >= size || 0 <= _nodes[node]._height || ++free_count > size - used_count)
+			{
+				return false;
+			}
+		}
+
+		for (uint32_t proxy : _moved)
+		{
+			if (proxy >= size)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t DynamicTree::buildRange(uint32_t* leaves, uint32_t count, uint32_t parent, uint32_t depth)
+	{
+		if (1 == count)
+		{
+			_nodes[leaves[0]]._parent = parent;
+			return leaves[0];
+		}
+
+		Aabb bounds;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			bounds.m_min[axis] = FLT_MAX;
+			bounds.m_max[axis] = -FLT_MAX;
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const Aabb& aabb = _nodes[leaves[ii]]._aabb;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				float center = aabb.m_min[axis] + aabb.m_max[axis];
+				bounds.m_min[axis] = center < bounds.m_min[axis] ? center : bounds.m_min[axis];
+				bounds.m_max[axis] = center > bounds.m_max[axis] ? center : bounds.m_max[axis];
+			}
+		}
+
+		// bin the centers along their widest axis and split where the SAH cost is lowest
+		uint32_t axis = 0;
+		for (uint32_t ii = 1; ii < 3; ++ii)
+		{
+			if (bounds.m_max[ii] - bounds.m_min[ii] > bounds.m_max[axis] - bounds.m_min[axis])
+			{
+				axis = ii;
+			}
+		}
+
+		const float extent = bounds.m_max[axis] - bounds.m_min[axis];
+		const float origin = bounds.m_min[axis];
+		const float scale = 0.0f < extent ? (float)k_bin_count * 0.999f / extent : 0.0f;
+		auto getBin = [&](uint32_t leaf) -> uint32_t
+		{
+			const Aabb& aabb = _nodes[leaf]._aabb;
+			return (uint32_t)((aabb.m_min[axis] + aabb.m_max[axis] - origin) * scale);
+		};
+
+		uint32_t mid = 0;
+		if (k_tree_median_depth <= depth)
+		{
+			// lopsided SAH splits can go as deep as there are leaves
+			mid = count / 2;
+			std::nth_element(leaves, leaves + mid, leaves + count, [&](uint32_t a, uint32_t b)
+			{
+				const Aabb& aabb_a = _nodes[a]._aabb;
+				const Aabb& aabb_b = _nodes[b]._aabb;
+				return aabb_a.m_min[axis] + aabb_a.m_max[axis] < aabb_b.m_min[axis] + aabb_b.m_max[axis];
+			});
+		}
+		else if (0.0f < extent)
+		{
+			Aabb bin_aabb[k_bin_count];
+			uint32_t bin_count[k_bin_count] = {};
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				uint32_t bin = getBin(leaves[ii]);
+				const Aabb& aabb = _nodes[leaves[ii]]._aabb;
+				if (0 == bin_count[bin]++)
+				{
+					bin_aabb[bin] = aabb;
+				}
+				else
+				{
+					combineAabb(bin_aabb[bin], bin_aabb[bin], aabb);
+				}
+			}
+
+			// area times count of everything right of each split, then sweep from the left
+			float right_cost[k_bin_count];
+			Aabb accumulated;
+			uint32_t accumulated_count = 0;
+			for (uint32_t ii = k_bin_count - 1; 0 < ii; --ii)
+			{
+				if (0 < bin_count[ii])
+				{
+					if (0 == accumulated_count)
+					{
+						accumulated = bin_aabb[ii];
+					}
+					else
+					{
+						combineAabb(accumulated, accumulated, bin_aabb[ii]);
+					}
+					accumulated_count += bin_count[ii];
+				}
+				right_cost[ii] = 0 < accumulated_count ? getArea(accumulated) * (float)accumulated_count : 0.0f;
+			}
+
+			float best_cost = FLT_MAX;
+			uint32_t best_split = 0;
+			accumulated_count = 0;
+			for (uint32_t ii = 0; ii < k_bin_count - 1; ++ii)
+			{
+				if (0 < bin_count[ii])
+				{
+					if (0 == accumulated_count)
+					{
+						accumulated = bin_aabb[ii];
+					}
+					else
+					{
+						combineAabb(accumulated, accumulated, bin_aabb[ii]);
+					}
+					accumulated_count += bin_count[ii];
+				}
+
+				if (0 == accumulated_count || count == accumulated_count)
+				{
+					continue;
+				}
+
+				float cost = getArea(accumulated) * (float)accumulated_count + right_cost[ii + 1];
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_split = ii;
+				}
+			}
+
+			mid = (uint32_t)(std::partition(leaves, leaves + count, [&](uint32_t leaf) { return getBin(leaf) <= best_split; }) - leaves);
+		}
+
+		// every center in one spot, split by count
+		if (0 == mid || count == mid)
+		{
+			mid = count / 2;
+		}
+
+		const uint32_t node = allocateNode();
+		_nodes[node]._parent = parent;
+		const uint32_t child0 = buildRange(leaves, mid, node, depth + 1);
+		const uint32_t child1 = buildRange(leaves + mid, count - mid, node, depth + 1);
+
+		Node& result = _nodes[node];
+		result._child[0] = child0;
+		result._child[1] = child1;
+		combineAabb(result._aabb, _nodes[child0]._aabb, _nodes[child1]._aabb);
+		result._height = 1 + (_nodes[child0]._height > _nodes[child1]._height ? _nodes[child0]._height : _nodes[child1]._height);
+		return node;
+	}
+
+	void DynamicTree::rebuild()
+	{
+		_build.clear();
+		for (uint32_t ii = 0; ii < _nodes.size(); ++ii)
+		{
+			if (0 > _nodes[ii]._height)
+			{
+				continue;
+			}
+
+			if (k_null == _nodes[ii]._child[0])
+			{
+				_build.push_back(ii);
+			}
+			else
+			{
+				freeNode(ii);
+			}
+		}
+
+		_root = _build.empty() ? k_null : buildRange(&_build[0], (uint32_t)_build.size(), k_null, 0);
+	}
+
+	SweepAndPrune::SweepAndPrune()
+		: _free(k_null)
+		, _proxy_count(0)
+	{
+	}
+
+	uint32_t SweepAndPrune::createProxy(const Aabb& aabb, uint32_t user_data, bool is_static)
+	{
+		const float no_displacement[3] = { 0.0f, 0.0f, 0.0f };
+
+		uint32_t proxy = _free;
+		if (k_null == proxy)
+		{
+			proxy = (uint32_t)_proxies.size();
+			_proxies.push_back(Proxy());
+		}
+		else
+		{
+			_free = _proxies[proxy]._user_data;
+		}
+
+		Proxy& data = _proxies[proxy];
+		computeFatAabb(data._aabb, aabb, no_displacement);
+		data._user_data = user_data;
+		data._is_static = is_static;
+		data._in_use = true;
+		data._is_new = false;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			data._endpoint[axis][0] = k_null;
+			data._endpoint[axis][1] = k_null;
+		}
+
+		// endpoints go in with the next updatePairs()
+		_added.push_back(proxy);
+		++_proxy_count;
+		return proxy;
+	}
+
+	void SweepAndPrune::destroyProxy(uint32_t proxy)
+	{
+		Proxy& data = _proxies[proxy];
+		assert(data._in_use);
+
+		data._in_use = false;
+		--_proxy_count;
+
+		if (k_null == data._endpoint[0][0])
+		{
+			_added.erase(std::find(_added.begin(), _added.end(), proxy));
+			data._user_data = _free;
+			_free = proxy;
+		}
+		else
+		{
+			// the slot is reused once the endpoints are gone
+			_removed.push_back(proxy);
+		}
+	}
+
+	bool SweepAndPrune::moveProxy(uint32_t proxy, const Aabb& aabb, const float displacement[3])
+	{
+		Proxy& data = _proxies[proxy];
+		if (isFatAabbValid(data._aabb, aabb))
+		{
+			return false;
+		}
+
+		computeFatAabb(data._aabb, aabb, displacement);
+		_moved.push_back(proxy);
+		return true;
+	}
+
+	void SweepAndPrune::reportIfOverlapping(uint32_t a, uint32_t b, std::vector<ProxyPair>& pairs) const
+	{
+		const Proxy& first = _proxies[a];
+		const Proxy& second = _proxies[b];
+		if ((first._is_static && second._is_static) || !aabbOverlap(first._aabb, second._aabb))
+		{
+			return;
+		}
+
+		ProxyPair pair = { first._user_data, second._user_data };
+		pairs.push_back(pair);
+	}
+
+	// Moves one endpoint to its sorted place. Ties keep a min before a max,
+	// so touching boxes count as overlapping like aabbOverlap has them.
+	void SweepAndPrune::bubble(uint32_t axis, uint32_t index, std::vector<ProxyPair>& pairs)
+	{
+		std::vector<Endpoint>& endpoints = _endpoints[axis];
+		const Endpoint moving = endpoints[index];
+		const uint32_t proxy = moving._data >> 1;
+		const uint32_t is_max = moving._data & 1;
+
+		while (0 < index)
+		{
+			const Endpoint& prev = endpoints[index - 1];
+			if (!(moving._value < prev._value || (moving._value == prev._value && !is_max && (prev._data & 1))))
+			{
+				break;
+			}
+
+			// a min passing a max to the left may start an overlap
+			if (!is_max && (prev._data & 1))
+			{
+				reportIfOverlapping(proxy, prev._data >> 1, pairs);
+			}
+
+			endpoints[index] = prev;
+			_proxies[prev._data >> 1]._endpoint[axis][prev._data & 1] = index;
+			--index;
+		}
+
+		const uint32_t count = (uint32_t)endpoints.size();
+		while (index + 1 < count)
+		{
+			const Endpoint& next = endpoints[index + 1];
+			if (!(moving._value > next._value || (moving._value == next._value && is_max && !(next._data & 1))))
+			{
+				break;
+			}
+
+			// and so may a max passing a min to the right
+			if (is_max && !(next._data & 1))
+			{
+				reportIfOverlapping(proxy, next._data >> 1, pairs);
+			}
+
+			endpoints[index] = next;
+			_proxies[next._data >> 1]._endpoint[axis][next._data & 1] = index;
+			++index;
+		}
+
+		endpoints[index] = moving;
+		_proxies[proxy]._endpoint[axis][is_max] = index;
+	}
+
+	void SweepAndPrune::freeRemoved()
+	{
+		for (uint32_t proxy : _removed)
+		{
+			_proxies[proxy]._user_data = _free;
+			_free = proxy;
+		}
+		_removed.clear();
+	}
+
+	void SweepAndPrune::merge(std::vector<ProxyPair>& pairs)
+	{
+		for (uint32_t proxy : _added)
+		{
+			_proxies[proxy]._is_new = true;
+		}
+
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			std::vector<Endpoint>& endpoints = _endpoints[axis];
+
+			_merge.clear();
+			for (uint32_t proxy : _added)
+			{
+				Endpoint min = { _proxies[proxy]._aabb.m_min[axis], proxy << 1 };
+				Endpoint max = { _proxies[proxy]._aabb.m_max[axis], proxy << 1 | 1 };
+				_merge.push_back(min);
+				_merge.push_back(max);
+			}
+			std::sort(_merge.begin(), _merge.end(), isLess);
+
+			// one pass drops the removed ends and merges the sorted new ones in
+			_scratch.clear();
+			uint32_t added = 0;
+			for (uint32_t ii = 0; ii < endpoints.size(); ++ii)
+			{
+				const Endpoint& endpoint = endpoints[ii];
+				if (!_proxies[endpoint._data >> 1]._in_use)
+				{
+					continue;
+				}
+
+				for (; added < _merge.size() && isLess(_merge[added], endpoint); ++added)
+				{
+					_scratch.push_back(_merge[added]);
+				}
+				_scratch.push_back(endpoint);
+			}
+			_scratch.insert(_scratch.end(), _merge.begin() + added, _merge.end());
+			endpoints.swap(_scratch);
+
+			for (uint32_t ii = 0; ii < endpoints.size(); ++ii)
+			{
+				_proxies[endpoints[ii]._data >> 1]._endpoint[axis][endpoints[ii]._data & 1] = ii;
+			}
+		}
+
+		// sweep x once with the proxies whose range is open: a new proxy is
+		// tested against all of them, any other against the open new ones
+		_open.clear();
+		_open_new.clear();
+		for (const Endpoint& endpoint : _endpoints[0])
+		{
+			const uint32_t proxy = endpoint._data >> 1;
+			Proxy& data = _proxies[proxy];
+			if (0 == (endpoint._data & 1))
+			{
+				const std::vector<uint32_t>& others = data._is_new ? _open : _open_new;
+				for (uint32_t other : others)
+				{
+					reportIfOverlapping(proxy, other, pairs);
+				}
+
+				data._open = (uint32_t)_open.size();
+				_open.push_back(proxy);
+				if (data._is_new)
+				{
+					_open_new.push_back(proxy);
+				}
+			}
+			else
+			{
+				_proxies[_open.back()]._open = data._open;
+				_open[data._open] = _open.back();
+				_open.pop_back();
+				if (data._is_new)
+				{
+					_open_new.erase(std::find(_open_new.begin(), _open_new.end(), proxy));
+				}
+			}
+		}
+
+		for (uint32_t proxy : _added)
+		{
+			_proxies[proxy]._is_new = false;
+		}
+		_added.clear();
+		freeRemoved();
+	}
+
+	void SweepAndPrune::rebuild(std::vector<ProxyPair>& pairs)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			std::vector<Endpoint>& endpoints = _endpoints[axis];
+			endpoints.clear();
+			for (uint32_t ii = 0; ii < _proxies.size(); ++ii)
+			{
+				if (_proxies[ii]._in_use)
+				{
+					Endpoint min = { _proxies[ii]._aabb.m_min[axis], ii << 1 };
+					Endpoint max = { _proxies[ii]._aabb.m_max[axis], ii << 1 | 1 };
+					endpoints.push_back(min);
+					endpoints.push_back(max);
+				}
+			}
+
+			std::sort(endpoints.begin(), endpoints.end(), isLess);
+
+			for (uint32_t ii = 0; ii < endpoints.size(); ++ii)
+			{
+				_proxies[endpoints[ii]._data >> 1]._endpoint[axis][endpoints[ii]._data & 1] = ii;
+			}
+		}
+
+		// box pruning: the mins on x are the proxies in sweep order, and
+		// each box only needs testing against the ones that start before it ends
+		_order.clear();
+		for (const Endpoint& endpoint : _endpoints[0])
+		{
+			if (0 == (endpoint._data & 1))
+			{
+				_order.push_back(endpoint._data >> 1);
+			}
+		}
+
+		const uint32_t count = (uint32_t)_order.size();
+		_sorted.resize((count + 3) / 4);
+		for (uint32_t ii = 0; ii < count; ii += 4)
+		{
+			Aabb boxes[4];
+			uint32_t group_count = count - ii < 4 ? count - ii : 4;
+			for (uint32_t jj = 0; jj < group_count; ++jj)
+			{
+				boxes[jj] = _proxies[_order[ii + jj]]._aabb;
+			}
+			loadAabb4(_sorted[ii / 4], boxes, group_count);
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const Proxy& proxy = _proxies[_order[ii]];
+			const float max_x = proxy._aabb.m_max[0];
+			for (uint32_t group = (ii + 1) / 4; group * 4 < count; ++group)
+			{
+				if (_proxies[_order[group * 4]]._aabb.m_min[0] > max_x)
+				{
+					break;
+				}
+
+				// lanes up to ii are pairs already seen from the other side
+				uint32_t mask = aabbOverlapTest4(proxy._aabb, _sorted[group]);
+				if (group * 4 <= ii)
+				{
+					mask &= ~((2u << (ii - group * 4)) - 1);
+				}
+
+				for (; 0 != mask; mask &= mask - 1)
+				{
+					const Proxy& other = _proxies[_order[group * 4 + bx::uint32_cnttz(mask)]];
+					if (proxy._is_static && other._is_static)
+					{
+						continue;
+					}
+
+					ProxyPair pair = { proxy._user_data, other._user_data };
+					pairs.push_back(pair);
+				}
+			}
+		}
+
+		freeRemoved();
+		_added.clear();
+		_moved.clear();
+	}
+
+	void SweepAndPrune::updatePairs(std::vector<ProxyPair>& pairs)
+	{
+		if (_proxy_count < 2 * _added.size())
+		{
+			rebuild(pairs);
+			return;
+		}
+
+		if (!_added.empty() || !_removed.empty())
+		{
+			merge(pairs);
+		}
+
+		for (uint32_t proxy : _moved)
+		{
+			Proxy& data = _proxies[proxy];
+			if (!data._in_use || k_null == data._endpoint[0][0])
+			{
+				continue;
+			}
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				std::vector<Endpoint>& endpoints = _endpoints[axis];
+				const float min = data._aabb.m_min[axis];
+				const float max = data._aabb.m_max[axis];
+
+				// both values are set first, so neither end can bubble past the other
+				endpoints[data._endpoint[axis][0]]._value = min;
+				endpoints[data._endpoint[axis][1]]._value = max;
+				bubble(axis, data._endpoint[axis][0], pairs);
+				bubble(axis, data._endpoint[axis][1], pairs);
+			}
+		}
+		_moved.clear();
+	}
+
+	void SweepAndPrune::clear()
+	{
+		_proxies.clear();
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			_endpoints[axis].clear();
+		}
+		_moved.clear();
+		_added.clear();
+		_removed.clear();
+		_free = k_null;
+		_proxy_count = 0;
+	}
+
+	void SweepAndPrune::rayCast(RayPacket& packet, RayCastFunc fn, void* data) const
+	{
+		RayPacket4 rays;
+		loadRayPacket(rays, packet);
+		bx::float4_t max_t = loadMaxT(packet);
+
+		for (uint32_t proxy = 0; proxy < _proxies.size(); ++proxy)
+		{
+			if (!_proxies[proxy]._in_use)
+			{
+				continue;
+			}
+
+			float entry;
+			const uint32_t lanes = rayTest4(rays, max_t, _proxies[proxy]._aabb, entry);
+			if (0 != lanes)
+			{
+				fn(data, proxy, lanes, packet);
+				max_t = loadMaxT(packet);
+			}
+		}
+	}
+
+	void SweepAndPrune::queryAabb(const Aabb& aabb, std::vector<uint32_t>& proxies) const
+	{
+		for (uint32_t proxy = 0; proxy < _proxies.size(); ++proxy)
+		{
+			if (_proxies[proxy]._in_use && aabbOverlap(_proxies[proxy]._aabb, aabb))
+			{
+				proxies.push_back(proxy);
+			}
+		}
+	}
+
+	void SweepAndPrune::saveState(StateWriter& writer) const
+	{
+		writer.write(_proxies);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			writer.write(_endpoints[axis]);
+		}
+		writer.write(_moved);
+		writer.write(_added);
+		writer.write(_removed);
+		writer.write(_free);
+		writer.write(_proxy_count);
+	}
+
+	void SweepAndPrune::loadState(StateReader& reader)
+	{
+		reader.read(_proxies);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			reader.read(_endpoints[axis]);
+		}
+		reader.read(_moved);
+		reader.read(_added);
+		reader.read(_removed);
+		reader.read(_free);
+		reader.read(_proxy_count);
+	}
+
+	bool SweepAndPrune::isValidState() const
+	{
+		const uint32_t size = (uint32_t)_proxies.size();
+
+		// every endpoint and the proxy it belongs to point at each other
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const std::vector<Endpoint>& endpoints = _endpoints[axis];
+			for (uint32_t ii = 0; ii < endpoints.size(); ++ii)
+			{
+				const uint32_t proxy = endpoints[ii]._data >> 1;
+				if (proxy >= size || ii != _proxies[proxy]._endpoint[axis][endpoints[ii]._data & 1])
+				{
+					return false;
+				}
+			}
+		}
+
+		// freed slots keep stale endpoints until they are reused
+		uint32_t used_count = 0;
+		for (uint32_t ii = 0; ii < size; ++ii)
+		{
+			const Proxy& proxy = _proxies[ii];
+			if (!proxy._in_use)
+			{
+				continue;
+			}
+
+			++used_count;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				for (uint32_t end = 0; end < 2; ++end)
+				{
+					const uint32_t endpoint = proxy._endpoint[axis][end];
+					if ((k_null == endpoint) != (k_null == proxy._endpoint[0][0])
+						|| (k_null != endpoint
+							&& (endpoint >= _endpoints[axis].size() || (ii << 1 | end) != _endpoints[axis][endpoint]._data)))
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		if (used_count != _proxy_count)
+		{
+			return false;
+		}
+
+		uint32_t free_count = 0;
+		for (uint32_t proxy = _free; k_null != proxy; proxy = _proxies[proxy]._user_data)
+		{
+			if (proxy >= size || _proxies[proxy]._in_use || ++free_count > size - used_count)
+			{
+				return false;
+			}
+		}
+
+		const std::vector<uint32_t>* lists[] = { &_moved, &_added, &_removed };
+		for (const std::vector<uint32_t>* list : lists)
+		{
+			for (uint32_t proxy : *list)
+			{
+				if (proxy >= size)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,309 @@
+#ifndef __MONSTER_BROADPHASE_H__
+#define __MONSTER_BROADPHASE_H__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <bx/float4_t.h>
+
+#include "bounds.h"
+
+namespace monster
+{
+	class StateReader;
+	class StateWriter;
+
+	// Four boxes in SIMD lanes, one float4_t per bound.
+	struct Aabb4
+	{
+		bx::float4_t _min_x, _min_y, _min_z;
+		bx::float4_t _max_x, _max_y, _max_z;
+	};
+
+	// Loads up to four boxes; missing lanes never overlap anything.
+	void loadAabb4(Aabb4& boxes, const Aabb* aabb, uint32_t count);
+
+	// aabbOverlapTest against four boxes at once. Unlike it, returns the
+	// lanes that do overlap, bit ii for box ii; touching boxes overlap.
+	uint32_t aabbOverlapTest4(const Aabb& aabb, const Aabb4& boxes);
+
+	inline bool aabbOverlap(const Aabb& a, const Aabb& b)
+	{
+		return a.m_max[0] >= b.m_min[0] && a.m_min[0] <= b.m_max[0]
+			&& a.m_max[1] >= b.m_min[1] && a.m_min[1] <= b.m_max[1]
+			&& a.m_max[2] >= b.m_min[2] && a.m_min[2] <= b.m_max[2];
+	}
+
+	// Up to four rays in SIMD lanes, ray ii is origin + t * direction for
+	// t in [0, _max_t[ii]]. Traversal skips lanes with a negative _max_t,
+	// so unused lanes and rays that need no more hits are negative.
+	struct RayPacket
+	{
+		float _origin[3][4];            // by axis, then lane
+		float _inv_direction[3][4];
+		float _max_t[4];
+
+		RayPacket();
+
+		void setRay(uint32_t lane, const float origin[3], const float direction[3], float max_t);
+	};
+
+	// Called with a proxy and the lanes whose ray enters its fat box. It
+	// may shorten _max_t of those lanes, e.g. to the closest hit so far,
+	// and traversal only goes on with what is left.
+	typedef void (*RayCastFunc)(void* data, uint32_t proxy, uint32_t lanes, RayPacket& packet);
+
+	struct ProxyPair
+	{
+		uint32_t _a;    // user data of the two proxies
+		uint32_t _b;
+	};
+
+	enum class BroadphaseType : uint8_t
+	{
+		DynamicTree,      // anything that moves
+		SweepAndPrune     // mostly static scenes, nearly free while nothing moves
+	};
+
+	// Proxies carry a fattened copy of their box, so small motion doesn't
+	// touch the structure. Pairs between two static proxies are never
+	// reported. The broadphase only finds pairs that start overlapping;
+	// the caller keeps them, e.g. in a PairSet, and drops a pair once
+	// testOverlap() fails.
+	class Broadphase
+	{
+	public:
+		static const uint32_t k_null = UINT32_MAX;
+
+	public:
+		virtual ~Broadphase() {}
+
+		virtual uint32_t createProxy(const Aabb& aabb, uint32_t user_data, bool is_static) = 0;
+		virtual void destroyProxy(uint32_t proxy) = 0;
+
+		// displacement is the expected motion until the next move, the fat
+		// box is stretched along it. Returns true when aabb left the fat box.
+		virtual bool moveProxy(uint32_t proxy, const Aabb& aabb, const float displacement[3]) = 0;
+
+		// Appends pairs whose fat boxes started to overlap since the last
+		// call. A pair may be reported twice, or again while it still overlaps.
+		virtual void updatePairs(std::vector<ProxyPair>& pairs) = 0;
+
+		virtual const Aabb& getFatAabb(uint32_t proxy) const = 0;
+		virtual uint32_t getUserData(uint32_t proxy) const = 0;
+		virtual uint32_t getProxyCount() const = 0;
+
+		// True for an id createProxy() returned and destroyProxy() hasn't freed.
+		virtual bool isProxy(uint32_t proxy) const = 0;
+
+		virtual void clear() = 0;
+
+		// Scene queries against the fat boxes. Both only read, so any
+		// number may run at once between updates.
+		virtual void rayCast(RayPacket& packet, RayCastFunc fn, void* data) const = 0;
+		virtual void queryAabb(const Aabb& aabb, std::vector<uint32_t>& proxies) const = 0;
+
+		// Everything that decides future pairs and proxy ids, scratch left out.
+		// loadState() copies what it reads; isValidState() then checks that
+		// every index in it points where it should.
+		virtual void saveState(StateWriter& writer) const = 0;
+		virtual void loadState(StateReader& reader) = 0;
+		virtual bool isValidState() const = 0;
+
+		bool testOverlap(uint32_t a, uint32_t b) const { return aabbOverlap(getFatAabb(a), getFatAabb(b)); }
+	};
+
+	// Bounding volume hierarchy over the fat boxes. Inserting descends to
+	// the sibling with the lowest surface area cost and AVL rotations keep
+	// the tree balanced on the way back up; a proxy that leaves its fat box
+	// is reinserted. rebuild() builds the whole tree top down with binned
+	// SAH, halving by count past a fixed depth, and runs by itself when
+	// most proxies are new since the last updatePairs(), e.g. after loading
+	// a level. Ray packets walk the tree together, nearer child first, and
+	// a node is skipped once no lane reaches it.
+	class DynamicTree : public Broadphase
+	{
+	public:
+		// traversals keep their stack on the call stack; the AVL inserts and
+		// the depth capped rebuild() keep the height well below this
+		static const uint32_t k_stack_size = 256;
+
+		struct Node
+		{
+			Aabb _aabb;
+			uint32_t _parent;       // next free node while on the free list
+			uint32_t _child[2];     // k_null for leaves
+			uint32_t _user_data;
+			int32_t _height;        // leaves are 0, -1 while free
+			bool _is_static;
+			bool _moved;
+		};
+
+	private:
+		std::vector<Node> _nodes;
+		uint32_t _root;
+		uint32_t _free;
+		uint32_t _proxy_count;
+		uint32_t _created;          // since the last updatePairs()
+		std::vector<uint32_t> _moved;
+		std::vector<uint32_t> _build;
+
+	private:
+		uint32_t allocateNode();
+		void freeNode(uint32_t node);
+		void insertLeaf(uint32_t leaf);
+		void removeLeaf(uint32_t leaf);
+		uint32_t balance(uint32_t node);
+		uint32_t buildRange(uint32_t* leaves, uint32_t count, uint32_t parent, uint32_t depth);
+
+	public:
+		DynamicTree();
+
+		virtual uint32_t createProxy(const Aabb& aabb, uint32_t user_data, bool is_static) override;
+		virtual void destroyProxy(uint32_t proxy) override;
+		virtual bool moveProxy(uint32_t proxy, const Aabb& aabb, const float displacement[3]) override;
+		virtual void updatePairs(std::vector<ProxyPair>& pairs) override;
+
+		virtual const Aabb& getFatAabb(uint32_t proxy) const override { return _nodes[proxy]._aabb; }
+		virtual uint32_t getUserData(uint32_t proxy) const override { return _nodes[proxy]._user_data; }
+		virtual uint32_t getProxyCount() const override { return _proxy_count; }
+		virtual bool isProxy(uint32_t proxy) const override { return proxy < _nodes.size() && 0 == _nodes[proxy]._height; }
+
+		virtual void clear() override;
+
+		virtual void rayCast(RayPacket& packet, RayCastFunc fn, void* data) const override;
+		virtual void queryAabb(const Aabb& aabb, std::vector<uint32_t>& proxies) const override;
+
+		virtual void saveState(StateWriter& writer) const override;
+		virtual void loadState(StateReader& reader) override;
+		virtual bool isValidState() const override;
+
+		void rebuild();
+
+		uint32_t getRoot() const { return _root; }
+		const Node& getNode(uint32_t node) const { return _nodes[node]; }
+		uint32_t getHeight() const { return k_null == _root ? 0 : (uint32_t)_nodes[_root]._height; }
+
+		// Calls fn(proxy) for every proxy whose fat box overlaps aabb; fn
+		// returns false to stop early.
+		template <class F>
+		void query(const Aabb& aabb, F& fn) const;
+	};
+
+	// Sorted box bounds on all three axes. A moved proxy's bounds are
+	// bubbled to their new place, and a min passing a max is a pair that
+	// may start overlapping, so the cost follows how much moved rather
+	// than how many proxies there are. Added and removed proxies are
+	// merged in together, one pass per axis; when most proxies are new
+	// everything is sorted and box pruned instead. Scene queries test
+	// every proxy, so prefer the tree when they are frequent.
+	class SweepAndPrune : public Broadphase
+	{
+	private:
+		struct Endpoint
+		{
+			float _value;
+			uint32_t _data;         // proxy << 1 | is max
+		};
+
+		struct Proxy
+		{
+			Aabb _aabb;
+			uint32_t _user_data;    // next free proxy while on the free list
+			uint32_t _endpoint[3][2];
+			uint32_t _open;         // place in _open while merging
+			bool _is_static;
+			bool _in_use;
+			bool _is_new;
+		};
+
+		std::vector<Proxy> _proxies;
+		std::vector<Endpoint> _endpoints[3];
+		std::vector<uint32_t> _moved;
+		std::vector<uint32_t> _added;
+		std::vector<uint32_t> _removed;     // still in the endpoints until the next merge
+		uint32_t _free;
+		uint32_t _proxy_count;
+
+		// merge scratch
+		std::vector<Endpoint> _merge;
+		std::vector<Endpoint> _scratch;
+		std::vector<uint32_t> _open;
+		std::vector<uint32_t> _open_new;
+
+		// rebuild scratch, proxies by min x and their boxes four to a group
+		std::vector<uint32_t> _order;
+		std::vector<Aabb4> _sorted;
+
+	private:
+		static bool isLess(const Endpoint& lhs, const Endpoint& rhs)
+		{
+			return lhs._value < rhs._value || (lhs._value == rhs._value && (lhs._data & 1) < (rhs._data & 1));
+		}
+
+		void bubble(uint32_t axis, uint32_t index, std::vector<ProxyPair>& pairs);
+		void reportIfOverlapping(uint32_t a, uint32_t b, std::vector<ProxyPair>& pairs) const;
+		void freeRemoved();
+		void merge(std::vector<ProxyPair>& pairs);
+		void rebuild(std::vector<ProxyPair>& pairs);
+
+	public:
+		SweepAndPrune();
+
+		virtual uint32_t createProxy(const Aabb& aabb, uint32_t user_data, bool is_static) override;
+		virtual void destroyProxy(uint32_t proxy) override;
+		virtual bool moveProxy(uint32_t proxy, const Aabb& aabb, const float displacement[3]) override;
+		virtual void updatePairs(std::vector<ProxyPair>& pairs) override;
+
+		virtual const Aabb& getFatAabb(uint32_t proxy) const override { return _proxies[proxy]._aabb; }
+		virtual uint32_t getUserData(uint32_t proxy) const override { return _proxies[proxy]._user_data; }
+		virtual uint32_t getProxyCount() const override { return _proxy_count; }
+		virtual bool isProxy(uint32_t proxy) const override { return proxy < _proxies.size() && _proxies[proxy]._in_use; }
+
+		virtual void clear() override;
+
+		virtual void rayCast(RayPacket& packet, RayCastFunc fn, void* data) const override;
+		virtual void queryAabb(const Aabb& aabb, std::vector<uint32_t>& proxies) const override;
+
+		virtual void saveState(StateWriter& writer) const override;
+		virtual void loadState(StateReader& reader) override;
+		virtual bool isValidState() const override;
+	};
+
+	template <class F>
+	void DynamicTree::query(const Aabb& aabb, F& fn) const
+	{
+		if (k_null == _root)
+		{
+			return;
+		}
+
+		uint32_t stack[k_stack_size];
+		uint32_t count = 0;
+		stack[count++] = _root;
+		while (0 < count)
+		{
+			const Node& node = _nodes[stack[--count]];
+			if (!aabbOverlap(node._aabb, aabb))
+			{
+				continue;
+			}
+
+			if (k_null == node._child[0])
+			{
+				if (!fn((uint32_t)(&node - &_nodes[0])))
+				{
+					return;
+				}
+			}
+			else
+			{
+				assert(count + 2 <= k_stack_size);
+				stack[count++] = node._child[0];
+				stack[count++] = node._child[1];
+			}
+		}
+	}
+}
+
+#endif
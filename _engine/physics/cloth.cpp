@@ -0,0 +1,588 @@
+#include "physics/cloth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <bx/uint32_t.h>
+
+namespace monster
+{
+	static const uint32_t k_color_count = 32;                // one bit each in the particle masks
+	static const uint32_t k_min_colored_constraints = 2048;  // smaller cloths are one job each
+	static const uint32_t k_constraint_grain = 256;
+	static const uint32_t k_particle_grain = 512;
+	static const float k_max_dt = 1.0f / 30.0f;              // longer frames run slow motion rather than blow up
+
+	ClothDesc::ClothDesc()
+		: _positions(nullptr)
+		, _texcoords(nullptr)
+		, _inv_masses(nullptr)
+		, _particle_count(0)
+		, _indices(nullptr)
+		, _index_count(0)
+		, _stretch_compliance(0.0f)
+		, _bend_compliance(0.01f)
+		, _damping(0.1f)
+		, _drag(0.0f)
+		, _thickness(0.02f)
+	{
+		memset(_position, 0, sizeof(_position));
+		_rotation[0] = _rotation[1] = _rotation[2] = 0.0f;
+		_rotation[3] = 1.0f;
+	}
+
+	struct ClothEdge
+	{
+		uint16_t _lower;
+		uint16_t _upper;
+		uint16_t _opposite;     // corner of the triangle across from the edge
+
+		bool operator < (const ClothEdge& other) const
+		{
+			return _lower != other._lower ? _lower < other._lower : _upper < other._upper;
+		}
+	};
+
+	static Transform lerpTransform(const Transform& a, const Transform& b, float t)
+	{
+		Quat q = b.q;
+		if (0.0f > a.q.x * q.x + a.q.y * q.y + a.q.z * q.z + a.q.w * q.w)
+		{
+			q = Quat(-q.x, -q.y, -q.z, -q.w);
+		}
+
+		q = Quat(a.q.x + (q.x - a.q.x) * t, a.q.y + (q.y - a.q.y) * t, a.q.z + (q.z - a.q.z) * t, a.q.w + (q.w - a.q.w) * t);
+		return Transform(a.p + (b.p - a.p) * t, normalize(q));
+	}
+
+	template <class T>
+	static void eraseRange(std::vector<T>& data, uint32_t first, uint32_t count)
+	{
+		data.erase(data.begin() + first, data.begin() + first + count);
+	}
+
+	ClothManager::ClothManager()
+		: _job_system(nullptr)
+		, _gravity(0.0f, -9.81f, 0.0f)
+		, _wind(0.0f, 0.0f, 0.0f)
+		, _substep_count(8)
+		, _h(0.0f)
+	{
+		_decl.begin()
+			.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
+			.end();
+	}
+
+	void ClothManager::initialize(JobSystem* job_system)
+	{
+		shutdown();
+		_job_system = job_system;
+		_gravity = Vec3(0.0f, -9.81f, 0.0f);
+		_wind = Vec3(0.0f, 0.0f, 0.0f);
+		_substep_count = 8;
+	}
+
+	void ClothManager::shutdown()
+	{
+		while (!_cloths.empty())
+		{
+			ClothHandle handle = { _cloth_handle.back() };
+			destroyCloth(handle);
+		}
+
+		_cloth_index.clear();
+		_free_handles.clear();
+	}
+
+	void ClothManager::addConstraint(uint32_t a, uint32_t b, float compliance)
+	{
+		// nothing to do between two pins
+		const uint32_t first = _cloths.back()._first_particle;
+		if (0.0f == _inv_mass[first + a] && 0.0f == _inv_mass[first + b])
+		{
+			return;
+		}
+
+		_constraint_a.push_back((uint16_t)a);
+		_constraint_b.push_back((uint16_t)b);
+		_rest_length.push_back(length(_rest[first + b] - _rest[first + a]));
+		_compliance.push_back(compliance);
+	}
+
+	// greedy, as PhysicsManager colors islands; what doesn't fit in
+	// k_color_count colors goes last and is solved on one thread
+	void ClothManager::colorConstraints(Cloth& cloth)
+	{
+		const uint32_t first = cloth._first_constraint;
+		const uint32_t count = cloth._constraint_count;
+		std::vector<uint32_t> mask(cloth._particle_count, 0);
+		std::vector<uint8_t> color_of(count);
+		uint32_t color_size[k_color_count + 1] = {};
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const uint32_t a = _constraint_a[first + ii];
+			const uint32_t b = _constraint_b[first + ii];
+			const uint32_t used = mask[a] | mask[b];
+			const uint32_t color = UINT32_MAX != used ? bx::uint32_cnttz(~used) : k_color_count;
+			if (k_color_count != color)
+			{
+				mask[a] |= 1u << color;
+				mask[b] |= 1u << color;
+			}
+
+			color_of[ii] = (uint8_t)color;
+			++color_size[color];
+		}
+
+		cloth._first_color = (uint32_t)_colors.size();
+		uint32_t next[k_color_count + 1];
+		uint32_t offset = 0;
+		for (uint32_t ii = 0; ii <= k_color_count; ++ii)
+		{
+			_colors.push_back(offset);
+			next[ii] = offset;
+			offset += color_size[ii];
+		}
+		_colors.push_back(offset);
+
+		std::vector<uint16_t> a(count);
+		std::vector<uint16_t> b(count);
+		std::vector<float> rest_length(count);
+		std::vector<float> compliance(count);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const uint32_t slot = next[color_of[ii]]++;
+			a[slot] = _constraint_a[first + ii];
+			b[slot] = _constraint_b[first + ii];
+			rest_length[slot] = _rest_length[first + ii];
+			compliance[slot] = _compliance[first + ii];
+		}
+
+		std::copy(a.begin(), a.end(), _constraint_a.begin() + first);
+		std::copy(b.begin(), b.end(), _constraint_b.begin() + first);
+		std::copy(rest_length.begin(), rest_length.end(), _rest_length.begin() + first);
+		std::copy(compliance.begin(), compliance.end(), _compliance.begin() + first);
+	}
+
+	ClothHandle ClothManager::createCloth(const ClothDesc& desc)
+	{
+		const uint32_t particle_count = desc._particle_count;
+		if (nullptr == desc._positions || 0 == particle_count || k_max_particles < particle_count
+			|| nullptr == desc._indices || 0 == desc._index_count || 0 != desc._index_count % 3)
+		{
+			return k_invalid_cloth;
+		}
+
+		for (uint32_t ii = 0; ii < desc._index_count; ++ii)
+		{
+			if (particle_count <= desc._indices[ii])
+			{
+				return k_invalid_cloth;
+			}
+		}
+
+		Cloth cloth;
+		cloth._vertex_buffer = bgfx::createDynamicVertexBuffer(particle_count, _decl);
+		cloth._index_buffer = bgfx::createIndexBuffer(bgfx::copy(desc._indices, desc._index_count * (uint32_t)sizeof(uint16_t)));
+		if (!bgfx::isValid(cloth._vertex_buffer) || !bgfx::isValid(cloth._index_buffer))
+		{
+			if (bgfx::isValid(cloth._vertex_buffer))
+			{
+				bgfx::destroyDynamicVertexBuffer(cloth._vertex_buffer);
+			}
+			if (bgfx::isValid(cloth._index_buffer))
+			{
+				bgfx::destroyIndexBuffer(cloth._index_buffer);
+			}
+			return k_invalid_cloth;
+		}
+
+		cloth._first_particle = (uint32_t)_position.size();
+		cloth._particle_count = particle_count;
+		cloth._first_index = (uint32_t)_indices.size();
+		cloth._index_count = desc._index_count;
+		cloth._transform = Transform(Vec3(desc._position), normalize(Quat(desc._rotation[0], desc._rotation[1], desc._rotation[2], desc._rotation[3])));
+		cloth._previous = cloth._transform;
+		cloth._damping = desc._damping;
+		cloth._drag = desc._drag;
+		cloth._thickness = desc._thickness;
+		cloth._collider_count = 0;
+
+		for (uint32_t ii = 0; ii < particle_count; ++ii)
+		{
+			const Vec3 rest(&desc._positions[ii * 3]);
+			const Vec3 position = transformPoint(cloth._transform, rest);
+			_position.push_back(position);
+			_previous.push_back(position);
+			_velocity.push_back(Vec3(0.0f, 0.0f, 0.0f));
+			_rest.push_back(rest);
+			_inv_mass.push_back(nullptr != desc._inv_masses ? desc._inv_masses[ii] : 1.0f);
+			_texcoord.push_back(nullptr != desc._texcoords ? desc._texcoords[ii * 2] : 0.0f);
+			_texcoord.push_back(nullptr != desc._texcoords ? desc._texcoords[ii * 2 + 1] : 0.0f);
+		}
+		_indices.insert(_indices.end(), desc._indices, desc._indices + desc._index_count);
+
+		// every edge once, then a bending constraint across each edge two triangles share
+		std::vector<ClothEdge> edges(desc._index_count);
+		for (uint32_t ii = 0; ii < desc._index_count; ii += 3)
+		{
+			for (uint32_t jj = 0; jj < 3; ++jj)
+			{
+				const uint16_t v0 = desc._indices[ii + jj];
+				const uint16_t v1 = desc._indices[ii + (jj + 1) % 3];
+				ClothEdge& edge = edges[ii + jj];
+				edge._lower = std::min(v0, v1);
+				edge._upper = std::max(v0, v1);
+				edge._opposite = desc._indices[ii + (jj + 2) % 3];
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		_cloths.push_back(cloth);
+		Cloth& added = _cloths.back();
+		added._first_constraint = (uint32_t)_constraint_a.size();
+		for (size_t ii = 0; ii < edges.size(); ++ii)
+		{
+			const ClothEdge& edge = edges[ii];
+			const bool repeated = 0 < ii && !(edges[ii - 1] < edge);
+			if (!repeated)
+			{
+				addConstraint(edge._lower, edge._upper, desc._stretch_compliance);
+			}
+			else if (edges[ii - 1]._opposite != edge._opposite)
+			{
+				addConstraint(edges[ii - 1]._opposite, edge._opposite, desc._bend_compliance);
+			}
+		}
+		added._constraint_count = (uint32_t)_constraint_a.size() - added._first_constraint;
+		colorConstraints(added);
+
+		uint32_t handle;
+		if (_free_handles.empty())
+		{
+			handle = (uint32_t)_cloth_index.size();
+			_cloth_index.push_back(0);
+		}
+		else
+		{
+			handle = _free_handles.back();
+			_free_handles.pop_back();
+		}
+		_cloth_index[handle] = (uint32_t)_cloths.size() - 1;
+		_cloth_handle.push_back(handle);
+
+		ClothHandle result = { handle };
+		return result;
+	}
+
+	void ClothManager::destroyCloth(ClothHandle handle)
+	{
+		const uint32_t index = getCloth(handle);
+		const Cloth cloth = _cloths[index];
+		bgfx::destroyDynamicVertexBuffer(cloth._vertex_buffer);
+		bgfx::destroyIndexBuffer(cloth._index_buffer);
+
+		// ranges stay contiguous, so the cloths after this one move down
+		eraseRange(_position, cloth._first_particle, cloth._particle_count);
+		eraseRange(_previous, cloth._first_particle, cloth._particle_count);
+		eraseRange(_velocity, cloth._first_particle, cloth._particle_count);
+		eraseRange(_rest, cloth._first_particle, cloth._particle_count);
+		eraseRange(_inv_mass, cloth._first_particle, cloth._particle_count);
+		eraseRange(_texcoord, cloth._first_particle * 2, cloth._particle_count * 2);
+		eraseRange(_constraint_a, cloth._first_constraint, cloth._constraint_count);
+		eraseRange(_constraint_b, cloth._first_constraint, cloth._constraint_count);
+		eraseRange(_rest_length, cloth._first_constraint, cloth._constraint_count);
+		eraseRange(_compliance, cloth._first_constraint, cloth._constraint_count);
+		eraseRange(_colors, cloth._first_color, k_color_count + 2);
+		eraseRange(_indices, cloth._first_index, cloth._index_count);
+
+		_cloths.erase(_cloths.begin() + index);
+		_cloth_handle.erase(_cloth_handle.begin() + index);
+		for (uint32_t ii = index; ii < _cloths.size(); ++ii)
+		{
+			Cloth& moved = _cloths[ii];
+			moved._first_particle -= cloth._particle_count;
+			moved._first_constraint -= cloth._constraint_count;
+			moved._first_color -= k_color_count + 2;
+			moved._first_index -= cloth._index_count;
+			_cloth_index[_cloth_handle[ii]] = ii;
+		}
+
+		_free_handles.push_back(handle.idx);
+	}
+
+	void ClothManager::setTransform(ClothHandle handle, const float position[3], const float rotation[4], bool teleport)
+	{
+		Cloth& cloth = _cloths[getCloth(handle)];
+		const Transform transform(Vec3(position), normalize(Quat(rotation[0], rotation[1], rotation[2], rotation[3])));
+		if (teleport)
+		{
+			for (uint32_t ii = cloth._first_particle; ii < cloth._first_particle + cloth._particle_count; ++ii)
+			{
+				_position[ii] = transformPoint(transform, inverseTransformPoint(cloth._transform, _position[ii]));
+				_previous[ii] = _position[ii];
+				_velocity[ii] = rotate(transform.q, inverseRotate(cloth._transform.q, _velocity[ii]));
+			}
+			cloth._previous = transform;
+		}
+		cloth._transform = transform;
+	}
+
+	void ClothManager::setColliders(ClothHandle handle, const ClothCapsule* capsules, uint32_t count)
+	{
+		Cloth& cloth = _cloths[getCloth(handle)];
+		cloth._collider_count = count < k_max_colliders ? count : k_max_colliders;
+		for (uint32_t ii = 0; ii < cloth._collider_count; ++ii)
+		{
+			cloth._colliders[ii]._a = Vec3(capsules[ii]._a);
+			cloth._colliders[ii]._b = Vec3(capsules[ii]._b);
+			cloth._colliders[ii]._radius = capsules[ii]._radius;
+		}
+	}
+
+	void ClothManager::getParticles(ClothHandle handle, float* positions) const
+	{
+		const Cloth& cloth = _cloths[getCloth(handle)];
+		memcpy(positions, &_position[cloth._first_particle], sizeof(Vec3) * cloth._particle_count);
+	}
+
+	// air pushes each triangle along its normal by the wind it faces, once a step
+	void ClothManager::applyWind(const Cloth& cloth)
+	{
+		if (0.0f == cloth._drag)
+		{
+			return;
+		}
+
+		const uint32_t first = cloth._first_particle;
+		const uint16_t* indices = &_indices[cloth._first_index];
+		for (uint32_t ii = 0; ii < cloth._index_count; ii += 3)
+		{
+			const uint32_t a = first + indices[ii];
+			const uint32_t b = first + indices[ii + 1];
+			const uint32_t c = first + indices[ii + 2];
+			const Vec3 area = cross(_position[b] - _position[a], _position[c] - _position[a]);   // twice the area along the normal
+			const float area_length = length(area);
+			if (0.0f == area_length)
+			{
+				continue;
+			}
+
+			const Vec3 relative = _wind - (_velocity[a] + _velocity[b] + _velocity[c]) * (1.0f / 3.0f);
+			const Vec3 impulse = area * (cloth._drag * dot(area, relative) / (6.0f * area_length) * _h);
+			_velocity[a] += impulse * _inv_mass[a];
+			_velocity[b] += impulse * _inv_mass[b];
+			_velocity[c] += impulse * _inv_mass[c];
+		}
+	}
+
+	void ClothManager::predict(const Cloth& cloth, const Transform& pin, uint32_t begin, uint32_t end, float sub_h)
+	{
+		const float damping = 1.0f / (1.0f + sub_h * cloth._damping);
+		for (uint32_t ii = cloth._first_particle + begin; ii < cloth._first_particle + end; ++ii)
+		{
+			_previous[ii] = _position[ii];
+			if (0.0f == _inv_mass[ii])
+			{
+				_position[ii] = transformPoint(pin, _rest[ii]);
+				continue;
+			}
+
+			_velocity[ii] = (_velocity[ii] + _gravity * sub_h) * damping;
+			_position[ii] += _velocity[ii] * sub_h;
+		}
+	}
+
+	void ClothManager::solveConstraints(const Cloth& cloth, uint32_t begin, uint32_t end, float sub_h)
+	{
+		Vec3* position = &_position[cloth._first_particle];
+		const float* inv_mass = &_inv_mass[cloth._first_particle];
+		const float inv_h2 = 1.0f / (sub_h * sub_h);
+		for (uint32_t ii = cloth._first_constraint + begin; ii < cloth._first_constraint + end; ++ii)
+		{
+			const uint32_t a = _constraint_a[ii];
+			const uint32_t b = _constraint_b[ii];
+			const Vec3 delta = position[b] - position[a];
+			const float distance = length(delta);
+			if (1e-6f > distance)
+			{
+				continue;
+			}
+
+			// one iteration per substep, so the accumulated multiplier starts and stays at zero
+			const float lambda = (_rest_length[ii] - distance) / (inv_mass[a] + inv_mass[b] + _compliance[ii] * inv_h2);
+			const Vec3 correction = delta * (lambda / distance);
+			position[a] -= correction * inv_mass[a];
+			position[b] += correction * inv_mass[b];
+		}
+	}
+
+	// pushes particles out of the capsules, then takes the velocity from the substep's motion
+	void ClothManager::collide(const Cloth& cloth, uint32_t begin, uint32_t end, float sub_h)
+	{
+		const float inv_h = 1.0f / sub_h;
+		for (uint32_t ii = cloth._first_particle + begin; ii < cloth._first_particle + end; ++ii)
+		{
+			Vec3& position = _position[ii];
+			for (uint32_t jj = 0; jj < cloth._collider_count && 0.0f != _inv_mass[ii]; ++jj)
+			{
+				const Capsule& capsule = cloth._colliders[jj];
+				const Vec3 axis = capsule._b - capsule._a;
+				const float axis_length = lengthSq(axis);
+				float t = 0.0f < axis_length ? dot(position - capsule._a, axis) / axis_length : 0.0f;
+				t = 0.0f > t ? 0.0f : (1.0f < t ? 1.0f : t);
+				const Vec3 closest = capsule._a + axis * t;
+				const Vec3 offset = position - closest;
+				const float radius = capsule._radius + cloth._thickness;
+				const float distance = lengthSq(offset);
+				if (distance < radius * radius)
+				{
+					position = 1e-12f < distance ? closest + offset * (radius / sqrtf(distance)) : closest + Vec3(0.0f, radius, 0.0f);
+				}
+			}
+
+			_velocity[ii] = (position - _previous[ii]) * inv_h;
+		}
+	}
+
+	void ClothManager::stepCloth(uint32_t index)
+	{
+		const Cloth& cloth = _cloths[index];
+		const float sub_h = _h / _substep_count;
+		applyWind(cloth);
+		for (uint32_t ii = 0; ii < _substep_count; ++ii)
+		{
+			const Transform pin = lerpTransform(cloth._previous, cloth._transform, (float)(ii + 1) / _substep_count);
+			predict(cloth, pin, 0, cloth._particle_count, sub_h);
+			solveConstraints(cloth, 0, cloth._constraint_count, sub_h);
+			collide(cloth, 0, cloth._particle_count, sub_h);
+		}
+	}
+
+	void ClothManager::stepColoredCloth(uint32_t index)
+	{
+		const Cloth& cloth = _cloths[index];
+		const uint32_t* colors = &_colors[cloth._first_color];
+		const float sub_h = _h / _substep_count;
+		applyWind(cloth);
+		for (uint32_t ii = 0; ii < _substep_count; ++ii)
+		{
+			const Transform pin = lerpTransform(cloth._previous, cloth._transform, (float)(ii + 1) / _substep_count);
+			auto predict_range = [&](uint32_t begin, uint32_t end) { predict(cloth, pin, begin, end, sub_h); };
+			parallelFor(cloth._particle_count, k_particle_grain, predict_range);
+
+			// a color's constraints share no particle, the colors themselves run in order
+			for (uint32_t color = 0; color <= k_color_count; ++color)
+			{
+				const uint32_t first = colors[color];
+				const uint32_t count = colors[color + 1] - first;
+				auto solve_range = [&](uint32_t begin, uint32_t end) { solveConstraints(cloth, first + begin, first + end, sub_h); };
+				parallelFor(count, k_color_count == color ? count : k_constraint_grain, solve_range);
+			}
+
+			auto collide_range = [&](uint32_t begin, uint32_t end) { collide(cloth, begin, end, sub_h); };
+			parallelFor(cloth._particle_count, k_particle_grain, collide_range);
+		}
+	}
+
+	void ClothManager::stepCloths(void* data, uint32_t begin, uint32_t end)
+	{
+		ClothManager& manager = *(ClothManager*)data;
+		for (uint32_t ii = begin; ii < end; ++ii)
+		{
+			manager.stepCloth(manager._small_cloths[ii]);
+		}
+	}
+
+	void ClothManager::step(float dt)
+	{
+		_h = dt < k_max_dt ? dt : k_max_dt;
+		if (0.0f >= _h || _cloths.empty())
+		{
+			return;
+		}
+
+		_small_cloths.clear();
+		_large_cloths.clear();
+		for (uint32_t ii = 0; ii < _cloths.size(); ++ii)
+		{
+			(k_min_colored_constraints <= _cloths[ii]._constraint_count ? _large_cloths : _small_cloths).push_back(ii);
+		}
+
+		if (nullptr != _job_system && 1 < _small_cloths.size())
+		{
+			JobCounter counter;
+			_job_system->parallelFor((uint32_t)_small_cloths.size(), 1, stepCloths, this, counter);
+			_job_system->wait(counter);
+		}
+		else
+		{
+			stepCloths(this, 0, (uint32_t)_small_cloths.size());
+		}
+
+		for (uint32_t ii = 0; ii < _large_cloths.size(); ++ii)
+		{
+			stepColoredCloth(_large_cloths[ii]);
+		}
+
+		for (uint32_t ii = 0; ii < _cloths.size(); ++ii)
+		{
+			_cloths[ii]._previous = _cloths[ii]._transform;
+		}
+	}
+
+	void ClothManager::upload()
+	{
+		for (uint32_t ii = 0; ii < _cloths.size(); ++ii)
+		{
+			const Cloth& cloth = _cloths[ii];
+			const bgfx::Memory* memory = bgfx::alloc(cloth._particle_count * (uint32_t)sizeof(ClothVertex));
+			ClothVertex* vertices = (ClothVertex*)memory->data;
+			const Vec3* position = &_position[cloth._first_particle];
+			const float* texcoord = &_texcoord[cloth._first_particle * 2];
+			for (uint32_t jj = 0; jj < cloth._particle_count; ++jj)
+			{
+				ClothVertex& vertex = vertices[jj];
+				memcpy(vertex._position, &position[jj], sizeof(vertex._position));
+				memset(vertex._normal, 0, sizeof(vertex._normal));
+				vertex._texcoord[0] = texcoord[jj * 2];
+				vertex._texcoord[1] = texcoord[jj * 2 + 1];
+			}
+
+			// area weighted vertex normals
+			const uint16_t* indices = &_indices[cloth._first_index];
+			for (uint32_t jj = 0; jj < cloth._index_count; jj += 3)
+			{
+				const uint16_t a = indices[jj];
+				const uint16_t b = indices[jj + 1];
+				const uint16_t c = indices[jj + 2];
+				const Vec3 normal = cross(position[b] - position[a], position[c] - position[a]);
+				for (uint32_t kk = 0; kk < 3; ++kk)
+				{
+					float* sum = vertices[indices[jj + kk]]._normal;
+					sum[0] += normal.x;
+					sum[1] += normal.y;
+					sum[2] += normal.z;
+				}
+			}
+
+			for (uint32_t jj = 0; jj < cloth._particle_count; ++jj)
+			{
+				float* normal = vertices[jj]._normal;
+				const Vec3 unit = normalize(Vec3(normal));
+				memcpy(normal, &unit, sizeof(vertices[jj]._normal));
+			}
+
+			bgfx::updateDynamicVertexBuffer(cloth._vertex_buffer, memory);
+		}
+	}
+
+	void ClothManager::bind(ClothHandle handle) const
+	{
+		const Cloth& cloth = _cloths[getCloth(handle)];
+		bgfx::setVertexBuffer(cloth._vertex_buffer, cloth._particle_count);
+		bgfx::setIndexBuffer(cloth._index_buffer, 0, cloth._index_count);
+	}
+}
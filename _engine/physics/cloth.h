@@ -0,0 +1,204 @@
+#ifndef __MONSTER_CLOTH_H__
+#define __MONSTER_CLOTH_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "bgfx.h"
+
+#include "core/job/job_system.h"
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	struct ClothHandle { uint32_t idx; };
+	static const ClothHandle k_invalid_cloth = { UINT32_MAX };
+	inline bool isValid(ClothHandle handle) { return UINT32_MAX != handle.idx; }
+
+	struct ClothDesc
+	{
+		const float* _positions;       // rest pose in cloth space, xyz per particle
+		const float* _texcoords;       // uv per particle, may be nullptr
+		const float* _inv_masses;      // per particle, 0 pins it to the cloth transform; nullptr for all 1
+		uint32_t _particle_count;      // at most ClothManager::k_max_particles
+		const uint16_t* _indices;      // triangles, counter-clockwise seen from the front
+		uint32_t _index_count;
+		float _position[3];            // cloth transform
+		float _rotation[4];            // quaternion xyzw
+		float _stretch_compliance;     // inverse stiffness, 0 for inextensible
+		float _bend_compliance;
+		float _damping;
+		float _drag;                   // how much the wind pushes, per unit area
+		float _thickness;              // kept from colliders
+
+		ClothDesc();
+	};
+
+	// Collider in world space, usually following a bone of the character
+	// wearing the cloth.
+	struct ClothCapsule
+	{
+		float _a[3];
+		float _b[3];
+		float _radius;
+	};
+
+	// Vertex layout of the buffers cloths are drawn from.
+	struct ClothVertex
+	{
+		float _position[3];
+		float _normal[3];
+		float _texcoord[2];
+	};
+
+	// Position based cloth for capes and flags. Particles of every cloth
+	// live in parallel arrays, each cloth a contiguous range, and are
+	// simulated in world space; pinned particles follow the cloth
+	// transform. Each triangle edge is a distance constraint and each
+	// pair of triangles sharing an edge adds a bending one between their
+	// far corners. Constraints are compliant (XPBD), so stiffness doesn't
+	// depend on the substep count, and are solved Gauss-Seidel, one
+	// iteration per substep.
+	//
+	// A cloth's constraints are graph colored once at creation so no two
+	// of a color share a particle. Cloths are independent jobs; a large
+	// cloth instead solves each color in parallel. Either way the results
+	// don't depend on the thread count.
+	//
+	// Every cloth owns a dynamic vertex buffer that upload() writes the
+	// particles and their normals straight into, with no copy on the way.
+	class ClothManager
+	{
+	public:
+		static const uint32_t k_max_particles = 0x10000;   // indices are 16 bits
+		static const uint32_t k_max_colliders = 8;
+
+	private:
+		struct Capsule
+		{
+			Vec3 _a;
+			Vec3 _b;
+			float _radius;
+		};
+
+		struct Cloth
+		{
+			uint32_t _first_particle;
+			uint32_t _particle_count;
+			uint32_t _first_constraint;     // sorted by color
+			uint32_t _constraint_count;
+			uint32_t _first_color;          // into _colors, k_color_count + 2 offsets
+			uint32_t _first_index;
+			uint32_t _index_count;
+			Transform _previous;            // pins move from here to _transform over a step
+			Transform _transform;
+			float _damping;
+			float _drag;
+			float _thickness;
+			Capsule _colliders[k_max_colliders];
+			uint32_t _collider_count;
+			bgfx::DynamicVertexBufferHandle _vertex_buffer;
+			bgfx::IndexBufferHandle _index_buffer;
+		};
+
+		// per particle, ranges owned by cloths
+		std::vector<Vec3> _position;
+		std::vector<Vec3> _previous;            // start of the substep
+		std::vector<Vec3> _velocity;
+		std::vector<Vec3> _rest;                // cloth space, where pins go
+		std::vector<float> _inv_mass;
+		std::vector<float> _texcoord;           // uv pairs
+
+		// per constraint, particles relative to the cloth's first
+		std::vector<uint16_t> _constraint_a;
+		std::vector<uint16_t> _constraint_b;
+		std::vector<float> _rest_length;
+		std::vector<float> _compliance;
+
+		std::vector<uint32_t> _colors;          // per cloth and color, relative to its first constraint
+		std::vector<uint16_t> _indices;
+
+		std::vector<Cloth> _cloths;
+		std::vector<uint32_t> _cloth_handle;    // cloth index -> handle
+		std::vector<uint32_t> _cloth_index;     // handle -> cloth index
+		std::vector<uint32_t> _free_handles;
+
+		std::vector<uint32_t> _small_cloths;    // step scratch
+		std::vector<uint32_t> _large_cloths;
+
+		bgfx::VertexDecl _decl;
+		JobSystem* _job_system;
+		Vec3 _gravity;
+		Vec3 _wind;
+		uint32_t _substep_count;
+		float _h;                               // of the step being run
+
+	private:
+		uint32_t getCloth(ClothHandle handle) const { return _cloth_index[handle.idx]; }
+
+		void addConstraint(uint32_t a, uint32_t b, float compliance);
+		void colorConstraints(Cloth& cloth);
+
+		void applyWind(const Cloth& cloth);
+		void predict(const Cloth& cloth, const Transform& pin, uint32_t begin, uint32_t end, float sub_h);
+		void solveConstraints(const Cloth& cloth, uint32_t begin, uint32_t end, float sub_h);
+		void collide(const Cloth& cloth, uint32_t begin, uint32_t end, float sub_h);
+		void stepCloth(uint32_t index);
+		void stepColoredCloth(uint32_t index);
+		static void stepCloths(void* data, uint32_t begin, uint32_t end);
+
+		template <class F>
+		void parallelFor(uint32_t count, uint32_t grain, F& fn) const
+		{
+			if (nullptr == _job_system || count <= grain)
+			{
+				fn(0, count);
+				return;
+			}
+			_job_system->parallelFor(count, grain, fn);
+		}
+
+	public:
+		ClothManager();
+		~ClothManager() { shutdown(); }
+
+		ClothManager(const ClothManager&) = delete;
+		ClothManager& operator = (const ClothManager&) = delete;
+
+		// Without a job system everything runs on the calling thread.
+		void initialize(JobSystem* job_system = nullptr);
+		void shutdown();
+
+		void setGravity(const float gravity[3]) { _gravity = Vec3(gravity); }
+		void setWind(const float velocity[3]) { _wind = Vec3(velocity); }
+		void setSubstepCount(uint32_t substep_count) { _substep_count = 0 < substep_count ? substep_count : 1; }
+
+		// Returns k_invalid_cloth if the description is unusable or the
+		// render buffers can't be created.
+		ClothHandle createCloth(const ClothDesc& desc);
+		void destroyCloth(ClothHandle handle);
+		uint32_t getClothCount() const { return (uint32_t)_cloths.size(); }
+		uint32_t getParticleCount() const { return (uint32_t)_position.size(); }
+
+		// Pins reach the new transform over the next step. A teleport moves
+		// the whole cloth along instead, keeping its shape and speed.
+		void setTransform(ClothHandle handle, const float position[3], const float rotation[4], bool teleport = false);
+
+		// Replaces the cloth's colliders, at most k_max_colliders.
+		void setColliders(ClothHandle handle, const ClothCapsule* capsules, uint32_t count);
+
+		void getParticles(ClothHandle handle, float* positions) const;
+
+		// Advances every cloth by dt, which should be one frame's worth;
+		// cloth is cosmetic and doesn't take fixed steps.
+		void step(float dt);
+
+		// Writes every cloth into its vertex buffer, once per frame after step().
+		void upload();
+
+		// Sets the cloth's vertex and index buffers for the next submit.
+		void bind(ClothHandle handle) const;
+	};
+}
+
+#endif
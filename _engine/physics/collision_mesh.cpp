@@ -0,0 +1,348 @@
+#include "physics/collision_mesh.h"
+
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "physics/shape_cast.h"
+
+namespace monster
+{
+	static const uint32_t k_max_depth = 64;   // traversal stack; a tree this deep or deeper fails isValidCollisionMesh()
+	static const float k_epsilon = 1e-9f;
+
+	static uint16_t quantizeDown(float value, float min, float step)
+	{
+		float q = floorf((value - min) / step);
+		return q <= 0.0f ? 0 : (q >= 65535.0f ? 65535 : (uint16_t)q);
+	}
+
+	static uint16_t quantizeUp(float value, float min, float step)
+	{
+		float q = ceilf((value - min) / step);
+		return q <= 0.0f ? 0 : (q >= 65535.0f ? 65535 : (uint16_t)q);
+	}
+
+	static bool isLeaf(const MeshNode& node)
+	{
+		return 0 != (node._data & CollisionMesh::k_leaf_flag);
+	}
+
+	void getTriangle(const CollisionMesh& mesh, uint32_t triangle, Vec3 vertices[3])
+	{
+		const MeshTriangle& indices = mesh._triangles[triangle];
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			vertices[ii] = Vec3(mesh._vertices[indices._vertex[ii] & ~CollisionMesh::k_active_edge]._position);
+		}
+	}
+
+	uint32_t getActiveEdges(const CollisionMesh& mesh, uint32_t triangle)
+	{
+		const MeshTriangle& indices = mesh._triangles[triangle];
+		uint32_t edges = 0;
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			edges |= (indices._vertex[ii] >> 31) << ii;
+		}
+		return edges;
+	}
+
+	void getMeshBounds(const CollisionMesh& mesh, Aabb& aabb)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] = mesh._min[axis];
+			aabb.m_max[axis] = mesh._min[axis] + mesh._step[axis] * 65535.0f;
+		}
+	}
+
+	bool isValidCollisionMesh(const CollisionMesh& mesh)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (!std::isfinite(mesh._min[axis])
+				|| !std::isfinite(mesh._step[axis])
+				|| !(0.0f < mesh._step[axis]))
+			{
+				return false;
+			}
+		}
+
+		const uint32_t vertex_count = mesh._vertices.size();
+		const uint32_t triangle_count = mesh._triangles.size();
+		if (CollisionMesh::k_max_triangles < triangle_count)
+		{
+			return false;
+		}
+
+		for (const MeshTriangle& triangle : mesh._triangles)
+		{
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				if ((triangle._vertex[ii] & ~CollisionMesh::k_active_edge) >= vertex_count)
+				{
+					return false;
+				}
+			}
+		}
+
+		const uint32_t node_count = mesh._nodes.size();
+		if (0 == node_count)
+		{
+			return true;
+		}
+
+		// children come after their parent, so there are no cycles, and a
+		// node reached twice would let the queries visit a subtree twice
+		struct Entry
+		{
+			uint32_t _node;
+			uint32_t _depth;
+		};
+
+		std::vector<uint8_t> reached(node_count, 0);
+		std::vector<Entry> stack(1, Entry{ 0, 0 });
+		uint32_t reached_count = 0;
+		while (!stack.empty())
+		{
+			const Entry entry = stack.back();
+			stack.pop_back();
+			if (0 != reached[entry._node]
+				|| k_max_depth <= entry._depth)
+			{
+				return false;
+			}
+			reached[entry._node] = 1;
+			++reached_count;
+
+			const MeshNode& node = mesh._nodes[entry._node];
+			if (isLeaf(node))
+			{
+				const uint32_t first = node._data & (CollisionMesh::k_max_triangles - 1);
+				const uint32_t count = (node._data >> CollisionMesh::k_count_shift) & CollisionMesh::k_max_leaf_triangles;
+				if (first + count > triangle_count)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			if (entry._node + 1 >= node_count
+				|| node._data <= entry._node + 1
+				|| node._data >= node_count)
+			{
+				return false;
+			}
+
+			stack.push_back(Entry{ entry._node + 1, entry._depth + 1 });
+			stack.push_back(Entry{ node._data, entry._depth + 1 });
+		}
+
+		return reached_count == node_count;
+	}
+
+	bool loadCollisionMesh(BlobFile& file, FileSystem* fs, const char* path)
+	{
+		if (!file.load<CollisionMesh>(fs, path)
+			|| !isValidCollisionMesh(*file.get<CollisionMesh>()))
+		{
+			file.unload();
+			return false;
+		}
+		return true;
+	}
+
+	void queryMesh(const CollisionMesh& mesh, const Aabb& aabb, MeshTriangleFunc fn, void* data)
+	{
+		if (mesh._nodes.empty())
+		{
+			return;
+		}
+
+		uint16_t lower[3];
+		uint16_t upper[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (aabb.m_max[axis] < mesh._min[axis] || aabb.m_min[axis] > mesh._min[axis] + mesh._step[axis] * 65535.0f)
+			{
+				return;
+			}
+
+			lower[axis] = quantizeDown(aabb.m_min[axis], mesh._min[axis], mesh._step[axis]);
+			upper[axis] = quantizeUp(aabb.m_max[axis], mesh._min[axis], mesh._step[axis]);
+		}
+
+		const MeshNode* nodes = mesh._nodes.data();
+		uint32_t stack[k_max_depth];
+		uint32_t count = 0;
+		stack[count++] = 0;
+		while (0 < count)
+		{
+			const MeshNode& node = nodes[stack[--count]];
+			if (node._min[0] > upper[0] || node._max[0] < lower[0]
+				|| node._min[1] > upper[1] || node._max[1] < lower[1]
+				|| node._min[2] > upper[2] || node._max[2] < lower[2])
+			{
+				continue;
+			}
+
+			if (isLeaf(node))
+			{
+				const uint32_t first = node._data & (CollisionMesh::k_max_triangles - 1);
+				const uint32_t end = first + ((node._data >> CollisionMesh::k_count_shift) & CollisionMesh::k_max_leaf_triangles);
+				for (uint32_t ii = first; ii < end; ++ii)
+				{
+					fn(data, ii);
+				}
+				continue;
+			}
+
+			const uint32_t index = (uint32_t)(&node - nodes);
+			assert(count + 2 <= k_max_depth);
+			stack[count++] = node._data;
+			stack[count++] = index + 1;
+		}
+	}
+
+	// entry distance of the ray into the dequantized node bounds, FLT_MAX for a miss
+	static float rayNode(const CollisionMesh& mesh, const MeshNode& node, const Vec3& origin, const Vec3& inv_direction, float max_t)
+	{
+		float enter = 0.0f;
+		float leave = max_t;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			float lo = (mesh._min[axis] + node._min[axis] * mesh._step[axis] - origin[axis]) * inv_direction[axis];
+			float hi = (mesh._min[axis] + node._max[axis] * mesh._step[axis] - origin[axis]) * inv_direction[axis];
+			enter = fmaxf(enter, fminf(lo, hi));
+			leave = fminf(leave, fmaxf(lo, hi));
+		}
+		return enter <= leave ? enter : FLT_MAX;
+	}
+
+	// Moller-Trumbore, both sides
+	static bool rayTriangle(const Vec3* v, const Vec3& origin, const Vec3& direction, float max_t, float& t)
+	{
+		const Vec3 e1 = v[1] - v[0];
+		const Vec3 e2 = v[2] - v[0];
+		const Vec3 p = cross(direction, e2);
+		const float det = dot(e1, p);
+		if (fabsf(det) < k_epsilon)
+		{
+			return false;
+		}
+
+		const float inv_det = 1.0f / det;
+		const Vec3 s = origin - v[0];
+		const float u = dot(s, p) * inv_det;
+		if (0.0f > u || 1.0f < u)
+		{
+			return false;
+		}
+
+		const Vec3 q = cross(s, e1);
+		const float w = dot(direction, q) * inv_det;
+		if (0.0f > w || 1.0f < u + w)
+		{
+			return false;
+		}
+
+		t = dot(e2, q) * inv_det;
+		return 0.0f <= t && t <= max_t;
+	}
+
+	bool rayCastMesh(const CollisionMesh& mesh, const Vec3& origin, const Vec3& direction, float max_t, ShapeHit& hit)
+	{
+		if (mesh._nodes.empty())
+		{
+			return false;
+		}
+
+		Vec3 inv_direction;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			inv_direction[axis] = 0.0f != direction[axis] ? 1.0f / direction[axis] : FLT_MAX;
+		}
+
+		struct Entry
+		{
+			uint32_t _node;
+			float _t;
+		};
+
+		const MeshNode* nodes = mesh._nodes.data();
+		Entry stack[k_max_depth];
+		uint32_t count = 0;
+		uint32_t best = UINT32_MAX;
+		float best_t = max_t;
+
+		float t = rayNode(mesh, nodes[0], origin, inv_direction, best_t);
+		if (FLT_MAX != t)
+		{
+			stack[count]._node = 0;
+			stack[count]._t = t;
+			++count;
+		}
+
+		while (0 < count)
+		{
+			const Entry entry = stack[--count];
+			if (entry._t > best_t)
+			{
+				continue;
+			}
+
+			const MeshNode& node = nodes[entry._node];
+			if (isLeaf(node))
+			{
+				const uint32_t first = node._data & (CollisionMesh::k_max_triangles - 1);
+				const uint32_t end = first + ((node._data >> CollisionMesh::k_count_shift) & CollisionMesh::k_max_leaf_triangles);
+				for (uint32_t ii = first; ii < end; ++ii)
+				{
+					Vec3 v[3];
+					getTriangle(mesh, ii, v);
+					if (rayTriangle(v, origin, direction, best_t, t))
+					{
+						best = ii;
+						best_t = t;
+					}
+				}
+				continue;
+			}
+
+			// the nearer child goes on top
+			assert(count + 2 <= k_max_depth);
+			const uint32_t children[2] = { entry._node + 1, node._data };
+			const float t0 = rayNode(mesh, nodes[children[0]], origin, inv_direction, best_t);
+			const float t1 = rayNode(mesh, nodes[children[1]], origin, inv_direction, best_t);
+			const uint32_t near = t0 <= t1 ? 0 : 1;
+			const float ts[2] = { t0, t1 };
+			if (FLT_MAX != ts[near ^ 1])
+			{
+				stack[count]._node = children[near ^ 1];
+				stack[count]._t = ts[near ^ 1];
+				++count;
+			}
+			if (FLT_MAX != ts[near])
+			{
+				stack[count]._node = children[near];
+				stack[count]._t = ts[near];
+				++count;
+			}
+		}
+
+		if (UINT32_MAX == best)
+		{
+			return false;
+		}
+
+		Vec3 v[3];
+		getTriangle(mesh, best, v);
+		Vec3 normal = normalize(cross(v[1] - v[0], v[2] - v[0]));
+		hit._t = best_t;
+		hit._position = origin + direction * best_t;
+		hit._normal = 0.0f < dot(normal, direction) ? -normal : normal;
+		return true;
+	}
+}
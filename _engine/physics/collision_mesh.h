@@ -0,0 +1,114 @@
+#ifndef __MONSTER_COLLISION_MESH_H__
+#define __MONSTER_COLLISION_MESH_H__
+
+#include <cstdint>
+
+#include "bounds.h"
+
+#include "core/serialization/blob_serializer.h"
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	struct ShapeHit;
+
+	// BVH node with its bounds quantized to 16 bits within the mesh bounds,
+	// rounded outwards. Nodes are depth first: an inner node's first child
+	// follows it and _data is the index of the second; a leaf has
+	// k_leaf_flag set, its triangle count in the next seven bits and the
+	// first of its triangles in the low 24.
+	struct MeshNode
+	{
+		uint16_t _min[3];
+		uint16_t _max[3];
+		uint32_t _data;
+	};
+
+	struct MeshTriangle
+	{
+		uint32_t _vertex[3];   // counter-clockwise seen from the front, k_active_edge set if the edge to the next vertex is active
+	};
+
+	struct MeshVertex
+	{
+		float _position[3];
+	};
+
+	// Static triangle mesh for level collision, baked offline by
+	// bakeCollisionMesh() and stored as a blob (see BlobFile), so it is
+	// used straight out of the mapped file once loadCollisionMesh() has
+	// checked it. Triangles are stored in leaf
+	// order and vertices in the order the triangles first use them, so a
+	// query touches a few contiguous runs of memory. Triangles are one
+	// sided: shapes behind them are left alone.
+	//
+	// An edge is active when it is on the border of the mesh or on a
+	// convex crease. Contacts on the other edges take the normal of the
+	// triangle, so shapes slide across flat seams without catching on them.
+	struct CollisionMesh
+	{
+		static const uint32_t k_active_edge = 0x80000000;
+		static const uint32_t k_leaf_flag = 0x80000000;
+		static const uint32_t k_count_shift = 24;
+		static const uint32_t k_max_leaf_triangles = 0x7f;
+		static const uint32_t k_max_triangles = 1 << k_count_shift;
+
+		float _min[3];         // mesh bounds, origin of the quantized node bounds
+		float _step[3];        // extent / 65535
+		BlobArray<MeshNode> _nodes;
+		BlobArray<MeshTriangle> _triangles;
+		BlobArray<MeshVertex> _vertices;
+	};
+
+	// Called with each triangle whose bounds may overlap the query box.
+	typedef void (*MeshTriangleFunc)(void* data, uint32_t triangle);
+
+	// Checks what the queries trust: every node is reached once from the
+	// root and no deeper than the traversal stack, leaves name triangles
+	// of the mesh, triangles name its vertices and the quantization is
+	// finite. Meshes from disk must pass before createMesh().
+	bool isValidCollisionMesh(const CollisionMesh& mesh);
+
+	// Loads a mesh blob and checks it; file is left empty on failure.
+	bool loadCollisionMesh(BlobFile& file, FileSystem* fs, const char* path);
+
+	void getTriangle(const CollisionMesh& mesh, uint32_t triangle, Vec3 vertices[3]);
+
+	// Bit ii is set when the edge from vertex ii to the next is active.
+	uint32_t getActiveEdges(const CollisionMesh& mesh, uint32_t triangle);
+
+	// Mesh bounds in mesh space.
+	void getMeshBounds(const CollisionMesh& mesh, Aabb& aabb);
+
+	// Triangles whose leaf bounds overlap aabb, both in mesh space. The
+	// query box is quantized once, so nodes are tested on integers.
+	void queryMesh(const CollisionMesh& mesh, const Aabb& aabb, MeshTriangleFunc fn, void* data);
+
+	// Closest triangle along origin + t * direction, t in [0, max_t], in
+	// mesh space. Both sides of a triangle are hit; the normal faces the ray.
+	bool rayCastMesh(const CollisionMesh& mesh, const Vec3& origin, const Vec3& direction, float max_t, ShapeHit& hit);
+}
+
+MONSTER_REFLECT_BEGIN(monster::MeshNode)
+	MONSTER_REFLECT_FIELD(_min)
+	MONSTER_REFLECT_FIELD(_max)
+	MONSTER_REFLECT_FIELD(_data)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::MeshTriangle)
+	MONSTER_REFLECT_FIELD(_vertex)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::MeshVertex)
+	MONSTER_REFLECT_FIELD(_position)
+MONSTER_REFLECT_END()
+
+MONSTER_REFLECT_BEGIN(monster::CollisionMesh)
+	MONSTER_REFLECT_FIELD(_min)
+	MONSTER_REFLECT_FIELD(_step)
+	MONSTER_REFLECT_FIELD(_nodes)
+	MONSTER_REFLECT_FIELD(_triangles)
+	MONSTER_REFLECT_FIELD(_vertices)
+MONSTER_REFLECT_END()
+
+#endif
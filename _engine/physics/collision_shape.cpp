@@ -0,0 +1,452 @@
+#include "physics/collision_shape.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace monster
+{
+	static const float k_pi = 3.14159265f;
+
+	bool ConvexHull::create(const Vec3* points, uint32_t count)
+	{
+		destroy();
+		if (4 > count || k_max_points < count)
+		{
+			return false;
+		}
+
+		Vec3 lower = points[0];
+		Vec3 upper = points[0];
+		for (uint32_t ii = 1; ii < count; ++ii)
+		{
+			lower = vmin(lower, points[ii]);
+			upper = vmax(upper, points[ii]);
+		}
+		const float tolerance = 1e-4f * length(upper - lower);
+
+		// brute force over point triples, fine for the point counts allowed;
+		// a plane with every point behind it is a face
+		std::vector<HullFace> planes;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			for (uint32_t jj = ii + 1; jj < count; ++jj)
+			{
+				for (uint32_t kk = jj + 1; kk < count; ++kk)
+				{
+					Vec3 normal = cross(points[jj] - points[ii], points[kk] - points[ii]);
+					float len = length(normal);
+					if (tolerance * tolerance >= len)
+					{
+						continue;
+					}
+					normal *= 1.0f / len;
+
+					float offset = dot(normal, points[ii]);
+					bool front = false;
+					bool back = false;
+					for (uint32_t pp = 0; pp < count && !(front && back); ++pp)
+					{
+						float distance = dot(normal, points[pp]) - offset;
+						front = front || distance > tolerance;
+						back = back || distance < -tolerance;
+					}
+
+					if (front && back)
+					{
+						continue;
+					}
+
+					if (front)
+					{
+						normal = -normal;
+						offset = -offset;
+					}
+
+					bool duplicate = false;
+					for (const HullFace& plane : planes)
+					{
+						duplicate = duplicate || (dot(plane._normal, normal) > 0.9999f && fabsf(plane._offset - offset) <= tolerance);
+					}
+
+					if (!duplicate)
+					{
+						HullFace plane = { normal, offset, 0, 0 };
+						planes.push_back(plane);
+					}
+				}
+			}
+		}
+
+		if (4 > planes.size())
+		{
+			return false;
+		}
+
+		// face polygons: the points on each plane sorted around their center
+		std::vector<int32_t> remap(count, -1);
+		std::vector<uint32_t> polygon;
+		std::vector<float> angles;
+		for (HullFace& face : planes)
+		{
+			polygon.clear();
+			Vec3 center(0.0f, 0.0f, 0.0f);
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				bool coincident = false;
+				for (uint32_t vertex : polygon)
+				{
+					coincident = coincident || lengthSq(points[vertex] - points[ii]) <= tolerance * tolerance;
+				}
+
+				if (!coincident && fabsf(dot(face._normal, points[ii]) - face._offset) <= tolerance)
+				{
+					polygon.push_back(ii);
+					center += points[ii];
+				}
+			}
+			center *= 1.0f / (float)polygon.size();
+
+			Vec3 axis_u, axis_v;
+			computeBasis(face._normal, axis_u, axis_v);
+			angles.resize(polygon.size());
+			for (uint32_t ii = 0; ii < polygon.size(); ++ii)
+			{
+				Vec3 d = points[polygon[ii]] - center;
+				angles[ii] = atan2f(dot(d, axis_v), dot(d, axis_u));
+			}
+
+			// insertion sort by angle, polygons are small
+			for (uint32_t ii = 1; ii < polygon.size(); ++ii)
+			{
+				for (uint32_t jj = ii; 0 < jj && angles[jj - 1] > angles[jj]; --jj)
+				{
+					std::swap(angles[jj - 1], angles[jj]);
+					std::swap(polygon[jj - 1], polygon[jj]);
+				}
+			}
+
+			// drop points in the middle of an edge
+			for (uint32_t ii = 0; ii < polygon.size() && 3 < polygon.size();)
+			{
+				uint32_t size = (uint32_t)polygon.size();
+				const Vec3& prev = points[polygon[(ii + size - 1) % size]];
+				const Vec3& next = points[polygon[(ii + 1) % size]];
+				const Vec3& point = points[polygon[ii]];
+				if (dot(cross(point - prev, next - point), face._normal) <= tolerance * length(next - prev))
+				{
+					polygon.erase(polygon.begin() + ii);
+					continue;
+				}
+				++ii;
+			}
+
+			face._first = (uint16_t)_face_vertices.size();
+			face._count = (uint16_t)polygon.size();
+			for (uint32_t point : polygon)
+			{
+				if (0 > remap[point])
+				{
+					remap[point] = (int32_t)_vertices.size();
+					_vertices.push_back(points[point]);
+				}
+				_face_vertices.push_back((uint8_t)remap[point]);
+			}
+			_faces.push_back(face);
+		}
+
+		// every polygon side is an edge shared with exactly one other face
+		for (uint32_t face = 0; face < _faces.size(); ++face)
+		{
+			const HullFace& current = _faces[face];
+			const uint8_t* indices = &_face_vertices[current._first];
+			for (uint32_t ii = 0; ii < current._count; ++ii)
+			{
+				uint8_t v0 = indices[ii];
+				uint8_t v1 = indices[(ii + 1) % current._count];
+
+				bool found = false;
+				for (HullEdge& edge : _edges)
+				{
+					if (edge._vertex[0] == v1 && edge._vertex[1] == v0)
+					{
+						edge._face[1] = (uint8_t)face;
+						found = true;
+						break;
+					}
+				}
+
+				if (!found)
+				{
+					HullEdge edge = { { v0, v1 }, { (uint8_t)face, (uint8_t)face } };
+					_edges.push_back(edge);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void ConvexHull::destroy()
+	{
+		_vertices.clear();
+		_faces.clear();
+		_face_vertices.clear();
+		_edges.clear();
+	}
+
+	uint32_t ConvexHull::getSupport(const Vec3& dir) const
+	{
+		uint32_t best = 0;
+		float best_distance = dot(_vertices[0], dir);
+		for (uint32_t ii = 1; ii < _vertices.size(); ++ii)
+		{
+			float distance = dot(_vertices[ii], dir);
+			if (distance > best_distance)
+			{
+				best = ii;
+				best_distance = distance;
+			}
+		}
+		return best;
+	}
+
+	void ConvexHull::translate(const Vec3& offset)
+	{
+		for (Vec3& vertex : _vertices)
+		{
+			vertex += offset;
+		}
+
+		for (HullFace& face : _faces)
+		{
+			face._offset += dot(face._normal, offset);
+		}
+	}
+
+	CollisionShape::CollisionShape()
+		: _type(ShapeType::Sphere)
+		, _mesh(nullptr)
+		, _radius(0.0f)
+		, _offset(0.0f, 0.0f, 0.0f)
+		, _extent(0.0f, 0.0f, 0.0f)
+		, _volume(0.0f)
+		, _unit_inertia(Mat3::zero())
+	{
+		_core[0] = _core[1] = Vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	void CollisionShape::createSphere(float radius)
+	{
+		_hull.destroy();
+		_type = ShapeType::Sphere;
+		_mesh = nullptr;
+		_radius = radius;
+		_core[0] = _core[1] = Vec3(0.0f, 0.0f, 0.0f);
+		_offset = Vec3(0.0f, 0.0f, 0.0f);
+		_extent = Vec3(radius, radius, radius);
+		_volume = 4.0f / 3.0f * k_pi * radius * radius * radius;
+
+		float inertia = 0.4f * radius * radius;
+		_unit_inertia = Mat3::diagonal(inertia, inertia, inertia);
+	}
+
+	void CollisionShape::createCapsule(float radius, float half_height)
+	{
+		_hull.destroy();
+		_type = ShapeType::Capsule;
+		_mesh = nullptr;
+		_radius = radius;
+		_core[0] = Vec3(0.0f, -half_height, 0.0f);
+		_core[1] = Vec3(0.0f, half_height, 0.0f);
+		_offset = Vec3(0.0f, 0.0f, 0.0f);
+		_extent = Vec3(radius, half_height + radius, radius);
+
+		// cylinder plus the two hemispheres moved out to its caps
+		float height = 2.0f * half_height;
+		float r2 = radius * radius;
+		float cylinder = k_pi * r2 * height;
+		float spheres = 4.0f / 3.0f * k_pi * r2 * radius;
+		_volume = cylinder + spheres;
+
+		float axial = cylinder * r2 * 0.5f + spheres * r2 * 0.4f;
+		float lateral = cylinder * (height * height / 12.0f + r2 * 0.25f)
+			+ spheres * (r2 * 0.4f + height * height * 0.25f + 0.375f * height * radius);
+		_unit_inertia = Mat3::diagonal(lateral / _volume, axial / _volume, lateral / _volume);
+	}
+
+	void CollisionShape::createBox(const float half_extents[3])
+	{
+		Vec3 corners[8];
+		for (uint32_t ii = 0; ii < 8; ++ii)
+		{
+			corners[ii] = Vec3(
+				ii & 1 ? half_extents[0] : -half_extents[0],
+				ii & 2 ? half_extents[1] : -half_extents[1],
+				ii & 4 ? half_extents[2] : -half_extents[2]);
+		}
+
+		_hull.create(corners, 8);
+		_type = ShapeType::Box;
+		_mesh = nullptr;
+		_radius = 0.0f;
+		_core[0] = _core[1] = Vec3(0.0f, 0.0f, 0.0f);
+		_offset = Vec3(0.0f, 0.0f, 0.0f);
+		_extent = Vec3(half_extents);
+
+		Vec3 size = 2.0f * _extent;
+		_volume = size.x * size.y * size.z;
+		_unit_inertia = Mat3::diagonal(
+			(size.y * size.y + size.z * size.z) / 12.0f,
+			(size.x * size.x + size.z * size.z) / 12.0f,
+			(size.x * size.x + size.y * size.y) / 12.0f);
+	}
+
+	bool CollisionShape::createConvex(const float* points, uint32_t count, uint32_t stride)
+	{
+		Vec3 input[ConvexHull::k_max_points];
+		if (ConvexHull::k_max_points < count)
+		{
+			return false;
+		}
+
+		const uint8_t* data = (const uint8_t*)points;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			memcpy(&input[ii], data + ii * stride, sizeof(Vec3));
+		}
+
+		if (!_hull.create(input, count))
+		{
+			return false;
+		}
+
+		_type = ShapeType::Convex;
+		_mesh = nullptr;
+		_radius = 0.0f;
+		_core[0] = _core[1] = Vec3(0.0f, 0.0f, 0.0f);
+		computeHullMass();
+		return true;
+	}
+
+	void CollisionShape::createMesh(const CollisionMesh* mesh)
+	{
+		Aabb bounds;
+		getMeshBounds(*mesh, bounds);
+
+		_hull.destroy();
+		_type = ShapeType::Mesh;
+		_mesh = mesh;
+		_radius = 0.0f;
+		_core[0] = _core[1] = (Vec3(bounds.m_min) + Vec3(bounds.m_max)) * 0.5f;   // bounds center
+		_offset = Vec3(0.0f, 0.0f, 0.0f);
+		_extent = (Vec3(bounds.m_max) - Vec3(bounds.m_min)) * 0.5f;
+		_volume = 0.0f;
+		_unit_inertia = Mat3::zero();
+	}
+
+	void CollisionShape::computeHullMass()
+	{
+		// tetrahedra from a point inside to each face triangle; covariance
+		// of the canonical tetrahedron scaled by each one's affine map
+		const Vec3* vertices = _hull.getVertices();
+		Vec3 origin(0.0f, 0.0f, 0.0f);
+		for (uint32_t ii = 0; ii < _hull.getVertexCount(); ++ii)
+		{
+			origin += vertices[ii];
+		}
+		origin *= 1.0f / (float)_hull.getVertexCount();
+
+		float volume = 0.0f;
+		Vec3 center(0.0f, 0.0f, 0.0f);
+		Mat3 covariance = Mat3::zero();
+		for (uint32_t face = 0; face < _hull.getFaceCount(); ++face)
+		{
+			const HullFace& current = _hull.getFace(face);
+			const uint8_t* indices = _hull.getFaceVertices(current);
+			for (uint32_t ii = 1; ii + 1 < current._count; ++ii)
+			{
+				Vec3 a = vertices[indices[0]] - origin;
+				Vec3 b = vertices[indices[ii]] - origin;
+				Vec3 c = vertices[indices[ii + 1]] - origin;
+				float det = dot(a, cross(b, c));
+				volume += det / 6.0f;
+				center += (a + b + c) * (det / 24.0f);
+
+				Vec3 s = a + b + c;
+				for (uint32_t row = 0; row < 3; ++row)
+				{
+					for (uint32_t col = 0; col < 3; ++col)
+					{
+						float value = a[row] * a[col] + b[row] * b[col] + c[row] * c[col] + s[row] * s[col];
+						covariance.c[col][row] += det * value / 120.0f;
+					}
+				}
+			}
+		}
+
+		center *= 1.0f / volume;
+
+		// covariance about the center of mass, then inertia = trace * I - C
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t col = 0; col < 3; ++col)
+			{
+				covariance.c[col][row] -= volume * center[row] * center[col];
+			}
+		}
+
+		float trace = covariance.c[0].x + covariance.c[1].y + covariance.c[2].z;
+		for (uint32_t col = 0; col < 3; ++col)
+		{
+			for (uint32_t row = 0; row < 3; ++row)
+			{
+				float value = (row == col ? trace : 0.0f) - covariance.c[col][row];
+				_unit_inertia.c[col][row] = value / volume;
+			}
+		}
+
+		_offset = origin + center;
+		_hull.translate(-_offset);
+		_volume = volume;
+
+		_extent = Vec3(0.0f, 0.0f, 0.0f);
+		for (uint32_t ii = 0; ii < _hull.getVertexCount(); ++ii)
+		{
+			_extent = vmax(_extent, vabs(vertices[ii]));
+		}
+	}
+
+	void CollisionShape::computeAabb(const Transform& xf, Aabb& aabb) const
+	{
+		Vec3 lower, upper;
+		if (ShapeType::Convex == _type)
+		{
+			lower = upper = transformPoint(xf, _hull.getVertices()[0]);
+			for (uint32_t ii = 1; ii < _hull.getVertexCount(); ++ii)
+			{
+				Vec3 point = transformPoint(xf, _hull.getVertices()[ii]);
+				lower = vmin(lower, point);
+				upper = vmax(upper, point);
+			}
+		}
+		else if (ShapeType::Box == _type || ShapeType::Mesh == _type)
+		{
+			Mat3 rotation = toMatrix(xf.q);
+			Vec3 center = transformPoint(xf, _core[0]);
+			Vec3 half = vabs(rotation.c[0]) * _extent.x + vabs(rotation.c[1]) * _extent.y + vabs(rotation.c[2]) * _extent.z;
+			lower = center - half;
+			upper = center + half;
+		}
+		else
+		{
+			Vec3 a = transformPoint(xf, _core[0]);
+			Vec3 b = transformPoint(xf, _core[1]);
+			Vec3 radius(_radius, _radius, _radius);
+			lower = vmin(a, b) - radius;
+			upper = vmax(a, b) + radius;
+		}
+
+		memcpy(aabb.m_min, &lower, sizeof(aabb.m_min));
+		memcpy(aabb.m_max, &upper, sizeof(aabb.m_max));
+	}
+}
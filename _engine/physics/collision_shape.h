@@ -0,0 +1,123 @@
+#ifndef __MONSTER_COLLISION_SHAPE_H__
+#define __MONSTER_COLLISION_SHAPE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+
+#include "physics/collision_mesh.h"
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	enum class ShapeType : uint8_t
+	{
+		Sphere,
+		Capsule,     // along the local y axis
+		Box,
+		Convex,
+		Mesh         // static bodies only
+	};
+
+	struct HullFace
+	{
+		Vec3 _normal;          // outward, unit length
+		float _offset;         // dot(_normal, point on the face)
+		uint16_t _first;       // into the face vertex list, counter-clockwise about _normal
+		uint16_t _count;
+	};
+
+	struct HullEdge
+	{
+		uint8_t _vertex[2];
+		uint8_t _face[2];      // _face[0] walks the edge from _vertex[0] to _vertex[1]
+	};
+
+	// Convex polyhedron with face polygons and edge adjacency, as SAT and
+	// face clipping need them. Built once from a point cloud.
+	class ConvexHull
+	{
+	public:
+		static const uint32_t k_max_points = 64;
+
+	private:
+		std::vector<Vec3> _vertices;
+		std::vector<HullFace> _faces;
+		std::vector<uint8_t> _face_vertices;
+		std::vector<HullEdge> _edges;
+
+	public:
+		// Points that end up inside the hull are dropped. Fails for fewer
+		// than four non-coplanar points or more than k_max_points.
+		bool create(const Vec3* points, uint32_t count);
+		void destroy();
+
+		uint32_t getVertexCount() const { return (uint32_t)_vertices.size(); }
+		const Vec3* getVertices() const { return _vertices.empty() ? nullptr : &_vertices[0]; }
+		uint32_t getFaceCount() const { return (uint32_t)_faces.size(); }
+		const HullFace& getFace(uint32_t face) const { return _faces[face]; }
+		const uint8_t* getFaceVertices(const HullFace& face) const { return &_face_vertices[face._first]; }
+		uint32_t getEdgeCount() const { return (uint32_t)_edges.size(); }
+		const HullEdge& getEdge(uint32_t edge) const { return _edges[edge]; }
+
+		// Index of the vertex furthest along dir.
+		uint32_t getSupport(const Vec3& dir) const;
+
+		void translate(const Vec3& offset);
+	};
+
+	// Collision geometry and its mass properties per unit density. Shapes
+	// are created by the game and shared by any number of bodies; they must
+	// outlive them. The body origin is the shape's center of mass.
+	class CollisionShape
+	{
+	private:
+		ShapeType _type;
+		const CollisionMesh* _mesh;
+		float _radius;
+		Vec3 _core[2];          // sphere center or capsule segment, radius added
+		ConvexHull _hull;       // box and convex
+		Vec3 _offset;
+		Vec3 _extent;           // local bounds half size about the origin
+		float _volume;
+		Mat3 _unit_inertia;     // inertia about the center of mass for unit mass
+
+	private:
+		void computeHullMass();
+
+	public:
+		CollisionShape();
+
+		CollisionShape(const CollisionShape&) = delete;
+		CollisionShape& operator = (const CollisionShape&) = delete;
+
+		void createSphere(float radius);
+		void createCapsule(float radius, float half_height);
+		void createBox(const float half_extents[3]);
+
+		// The points are recentered on their center of mass; getOffset() is
+		// where that center was in the input space.
+		bool createConvex(const float* points, uint32_t count, uint32_t stride = sizeof(float) * 3);
+
+		// Static level geometry, e.g. from a mapped BlobFile that must
+		// outlive the shape. Has no mass; the body origin is the mesh origin.
+		void createMesh(const CollisionMesh* mesh);
+
+		ShapeType getType() const { return _type; }
+		float getRadius() const { return _radius; }
+		const Vec3* getCore() const { return _core; }
+		uint32_t getCoreCount() const { return ShapeType::Capsule == _type ? 2 : 1; }
+		const ConvexHull& getHull() const { return _hull; }
+		bool isHull() const { return ShapeType::Box == _type || ShapeType::Convex == _type; }
+		const CollisionMesh* getMesh() const { return _mesh; }
+		const Vec3& getOffset() const { return _offset; }
+		const Vec3& getExtent() const { return _extent; }
+		float getVolume() const { return _volume; }
+		const Mat3& getUnitInertia() const { return _unit_inertia; }
+
+		void computeAabb(const Transform& xf, Aabb& aabb) const;
+	};
+}
+
+#endif
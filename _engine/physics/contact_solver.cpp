@@ -0,0 +1,282 @@
+#include "physics/contact_solver.h"
+
+namespace monster
+{
+	static const float k_pi = 3.14159265f;
+
+	ContactSoftness makeSoftness(float hertz, float damping_ratio, float h)
+	{
+		ContactSoftness softness = { 0.0f, 1.0f, 0.0f };
+		if (0.0f >= hertz)
+		{
+			return softness;
+		}
+
+		float omega = 2.0f * k_pi * hertz;
+		float a1 = 2.0f * damping_ratio + h * omega;
+		float a2 = h * omega * a1;
+		float a3 = 1.0f / (1.0f + a2);
+		softness._bias_rate = omega / a1;
+		softness._mass_scale = a2 * a3;
+		softness._impulse_scale = a3;
+		return softness;
+	}
+
+	static float effectiveMass(float inv_mass, const Mat3& inv_inertia_a, const Mat3& inv_inertia_b, const Vec3& ra, const Vec3& rb, const Vec3& axis)
+	{
+		Vec3 rna = cross(ra, axis);
+		Vec3 rnb = cross(rb, axis);
+		float k = inv_mass + dot(rna, inv_inertia_a * rna) + dot(rnb, inv_inertia_b * rnb);
+		return 0.0f < k ? 1.0f / k : 0.0f;
+	}
+
+	// bodies without mass are only read, so jobs sharing one don't race
+	static void storeVelocity(const SolverBodies& bodies, uint32_t body, float inv_mass, const Vec3& v, const Vec3& w)
+	{
+		if (0.0f != inv_mass)
+		{
+			bodies._linear_velocity[body] = v;
+			bodies._angular_velocity[body] = w;
+		}
+	}
+
+	void prepareContact(ContactConstraint& constraint, const ContactManifold& manifold, uint32_t body_a, uint32_t body_b,
+		const Vec3* positions, const SolverBodies& bodies, float friction, float restitution)
+	{
+		constraint._body_a = body_a;
+		constraint._body_b = body_b;
+		constraint._normal = manifold._normal;
+		computeBasis(manifold._normal, constraint._tangent[0], constraint._tangent[1]);
+		constraint._friction = friction;
+		constraint._restitution = restitution;
+		constraint._count = manifold._count;
+
+		const float inv_mass = bodies._inv_mass[body_a] + bodies._inv_mass[body_b];
+		const Mat3& inv_inertia_a = bodies._inv_inertia[body_a];
+		const Mat3& inv_inertia_b = bodies._inv_inertia[body_b];
+		const Vec3& va = bodies._linear_velocity[body_a];
+		const Vec3& wa = bodies._angular_velocity[body_a];
+		const Vec3& vb = bodies._linear_velocity[body_b];
+		const Vec3& wb = bodies._angular_velocity[body_b];
+
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			const ContactPoint& point = manifold._points[ii];
+			ContactConstraintPoint& cp = constraint._points[ii];
+			cp._anchor_a = point._position - positions[body_a];
+			cp._anchor_b = point._position - positions[body_b];
+			cp._base_separation = point._separation - dot(cp._anchor_b - cp._anchor_a, manifold._normal);
+
+			cp._normal_impulse = point._normal_impulse;
+			cp._tangent_impulse[0] = dot(point._friction_impulse, constraint._tangent[0]);
+			cp._tangent_impulse[1] = dot(point._friction_impulse, constraint._tangent[1]);
+			cp._max_normal_impulse = 0.0f;
+
+			cp._normal_mass = effectiveMass(inv_mass, inv_inertia_a, inv_inertia_b, cp._anchor_a, cp._anchor_b, manifold._normal);
+			cp._tangent_mass[0] = effectiveMass(inv_mass, inv_inertia_a, inv_inertia_b, cp._anchor_a, cp._anchor_b, constraint._tangent[0]);
+			cp._tangent_mass[1] = effectiveMass(inv_mass, inv_inertia_a, inv_inertia_b, cp._anchor_a, cp._anchor_b, constraint._tangent[1]);
+
+			Vec3 dv = vb + cross(wb, cp._anchor_b) - va - cross(wa, cp._anchor_a);
+			cp._relative_velocity = dot(dv, manifold._normal);
+		}
+	}
+
+	void warmStartContacts(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies)
+	{
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const ContactConstraint& constraint = constraints[ii];
+			const uint32_t a = constraint._body_a;
+			const uint32_t b = constraint._body_b;
+			const float ma = bodies._inv_mass[a];
+			const float mb = bodies._inv_mass[b];
+			const Mat3& ia = bodies._inv_inertia[a];
+			const Mat3& ib = bodies._inv_inertia[b];
+			Vec3 va = bodies._linear_velocity[a];
+			Vec3 wa = bodies._angular_velocity[a];
+			Vec3 vb = bodies._linear_velocity[b];
+			Vec3 wb = bodies._angular_velocity[b];
+
+			for (uint32_t jj = 0; jj < constraint._count; ++jj)
+			{
+				const ContactConstraintPoint& cp = constraint._points[jj];
+				Vec3 impulse = constraint._normal * cp._normal_impulse
+					+ constraint._tangent[0] * cp._tangent_impulse[0]
+					+ constraint._tangent[1] * cp._tangent_impulse[1];
+
+				va -= impulse * ma;
+				wa -= ia * cross(cp._anchor_a, impulse);
+				vb += impulse * mb;
+				wb += ib * cross(cp._anchor_b, impulse);
+			}
+
+			storeVelocity(bodies, a, ma, va, wa);
+			storeVelocity(bodies, b, mb, vb, wb);
+		}
+	}
+
+	void solveContacts(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies,
+		const ContactSoftness& softness, float inv_h, float max_push_velocity, bool use_bias)
+	{
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			ContactConstraint& constraint = constraints[ii];
+			const uint32_t a = constraint._body_a;
+			const uint32_t b = constraint._body_b;
+			const float ma = bodies._inv_mass[a];
+			const float mb = bodies._inv_mass[b];
+			const Mat3& ia = bodies._inv_inertia[a];
+			const Mat3& ib = bodies._inv_inertia[b];
+			const Vec3 dp = bodies._delta_position[b] - bodies._delta_position[a];
+			const Quat& qa = bodies._delta_rotation[a];
+			const Quat& qb = bodies._delta_rotation[b];
+			const Vec3& normal = constraint._normal;
+			Vec3 va = bodies._linear_velocity[a];
+			Vec3 wa = bodies._angular_velocity[a];
+			Vec3 vb = bodies._linear_velocity[b];
+			Vec3 wb = bodies._angular_velocity[b];
+
+			for (uint32_t jj = 0; jj < constraint._count; ++jj)
+			{
+				ContactConstraintPoint& cp = constraint._points[jj];
+				const Vec3& ra = cp._anchor_a;
+				const Vec3& rb = cp._anchor_b;
+
+				// current separation from how far the bodies moved this step
+				Vec3 d = dp + rotate(qb, rb) - rotate(qa, ra);
+				float separation = dot(d, normal) + cp._base_separation;
+
+				float bias = 0.0f;
+				float mass_scale = 1.0f;
+				float impulse_scale = 0.0f;
+				if (0.0f < separation)
+				{
+					// speculative, allow closing the gap in this substep
+					bias = separation * inv_h;
+				}
+				else if (use_bias)
+				{
+					bias = softness._bias_rate * separation;
+					bias = bias > -max_push_velocity ? bias : -max_push_velocity;
+					mass_scale = softness._mass_scale;
+					impulse_scale = softness._impulse_scale;
+				}
+
+				Vec3 dv = vb + cross(wb, rb) - va - cross(wa, ra);
+				float vn = dot(dv, normal);
+				float impulse = -cp._normal_mass * mass_scale * (vn + bias) - impulse_scale * cp._normal_impulse;
+
+				float accumulated = cp._normal_impulse + impulse;
+				accumulated = 0.0f < accumulated ? accumulated : 0.0f;
+				impulse = accumulated - cp._normal_impulse;
+				cp._normal_impulse = accumulated;
+				cp._max_normal_impulse = accumulated > cp._max_normal_impulse ? accumulated : cp._max_normal_impulse;
+
+				Vec3 p = normal * impulse;
+				va -= p * ma;
+				wa -= ia * cross(ra, p);
+				vb += p * mb;
+				wb += ib * cross(rb, p);
+			}
+
+			// friction inside a circular cone around the normal impulse
+			for (uint32_t jj = 0; jj < constraint._count; ++jj)
+			{
+				ContactConstraintPoint& cp = constraint._points[jj];
+				const Vec3& ra = cp._anchor_a;
+				const Vec3& rb = cp._anchor_b;
+
+				Vec3 dv = vb + cross(wb, rb) - va - cross(wa, ra);
+				float t0 = cp._tangent_impulse[0] - cp._tangent_mass[0] * dot(dv, constraint._tangent[0]);
+				float t1 = cp._tangent_impulse[1] - cp._tangent_mass[1] * dot(dv, constraint._tangent[1]);
+
+				float limit = constraint._friction * cp._normal_impulse;
+				float magnitude_sq = t0 * t0 + t1 * t1;
+				if (magnitude_sq > limit * limit)
+				{
+					float scale = limit / sqrtf(magnitude_sq);
+					t0 *= scale;
+					t1 *= scale;
+				}
+
+				Vec3 p = constraint._tangent[0] * (t0 - cp._tangent_impulse[0]) + constraint._tangent[1] * (t1 - cp._tangent_impulse[1]);
+				cp._tangent_impulse[0] = t0;
+				cp._tangent_impulse[1] = t1;
+
+				va -= p * ma;
+				wa -= ia * cross(ra, p);
+				vb += p * mb;
+				wb += ib * cross(rb, p);
+			}
+
+			storeVelocity(bodies, a, ma, va, wa);
+			storeVelocity(bodies, b, mb, vb, wb);
+		}
+	}
+
+	void applyRestitution(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies, float threshold)
+	{
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			ContactConstraint& constraint = constraints[ii];
+			if (0.0f == constraint._restitution)
+			{
+				continue;
+			}
+
+			const uint32_t a = constraint._body_a;
+			const uint32_t b = constraint._body_b;
+			const float ma = bodies._inv_mass[a];
+			const float mb = bodies._inv_mass[b];
+			const Mat3& ia = bodies._inv_inertia[a];
+			const Mat3& ib = bodies._inv_inertia[b];
+			const Vec3& normal = constraint._normal;
+			Vec3 va = bodies._linear_velocity[a];
+			Vec3 wa = bodies._angular_velocity[a];
+			Vec3 vb = bodies._linear_velocity[b];
+			Vec3 wb = bodies._angular_velocity[b];
+
+			for (uint32_t jj = 0; jj < constraint._count; ++jj)
+			{
+				ContactConstraintPoint& cp = constraint._points[jj];
+
+				// only points that were approaching fast enough and actually touched
+				if (cp._relative_velocity > -threshold || 0.0f == cp._max_normal_impulse)
+				{
+					continue;
+				}
+
+				const Vec3& ra = cp._anchor_a;
+				const Vec3& rb = cp._anchor_b;
+				Vec3 dv = vb + cross(wb, rb) - va - cross(wa, ra);
+				float vn = dot(dv, normal);
+				float impulse = -cp._normal_mass * (vn + constraint._restitution * cp._relative_velocity);
+
+				float accumulated = cp._normal_impulse + impulse;
+				accumulated = 0.0f < accumulated ? accumulated : 0.0f;
+				impulse = accumulated - cp._normal_impulse;
+				cp._normal_impulse = accumulated;
+
+				Vec3 p = normal * impulse;
+				va -= p * ma;
+				wa -= ia * cross(ra, p);
+				vb += p * mb;
+				wb += ib * cross(rb, p);
+			}
+
+			storeVelocity(bodies, a, ma, va, wa);
+			storeVelocity(bodies, b, mb, vb, wb);
+		}
+	}
+
+	void storeImpulses(const ContactConstraint& constraint, ContactManifold& manifold)
+	{
+		for (uint32_t ii = 0; ii < constraint._count; ++ii)
+		{
+			const ContactConstraintPoint& cp = constraint._points[ii];
+			ContactPoint& point = manifold._points[ii];
+			point._normal_impulse = cp._normal_impulse;
+			point._friction_impulse = constraint._tangent[0] * cp._tangent_impulse[0] + constraint._tangent[1] * cp._tangent_impulse[1];
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef __MONSTER_CONTACT_SOLVER_H__
+#define __MONSTER_CONTACT_SOLVER_H__
+
+#include <cstdint>
+
+#include "physics/narrowphase.h"
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	// Body state the solver works on, indexed by body. Static and kinematic
+	// bodies have zero inverse mass and inertia, and their velocities are
+	// never written, so constraints that share only such bodies can be
+	// solved at the same time.
+	struct SolverBodies
+	{
+		Vec3* _linear_velocity;
+		Vec3* _angular_velocity;
+		const Vec3* _delta_position;    // motion since the start of the step
+		const Quat* _delta_rotation;
+		const float* _inv_mass;
+		const Mat3* _inv_inertia;
+	};
+
+	// Soft contact as a damped spring, stiffness relative to the substep.
+	struct ContactSoftness
+	{
+		float _bias_rate;
+		float _mass_scale;
+		float _impulse_scale;
+	};
+
+	ContactSoftness makeSoftness(float hertz, float damping_ratio, float h);
+
+	struct ContactConstraintPoint
+	{
+		Vec3 _anchor_a;                 // contact point relative to the centers of mass
+		Vec3 _anchor_b;
+		float _base_separation;         // separation less the anchors' offset along the normal
+		float _normal_impulse;
+		float _tangent_impulse[2];
+		float _normal_mass;
+		float _tangent_mass[2];
+		float _relative_velocity;       // normal velocity before solving, for restitution
+		float _max_normal_impulse;
+	};
+
+	struct ContactConstraint
+	{
+		uint32_t _body_a;
+		uint32_t _body_b;
+		Vec3 _normal;
+		Vec3 _tangent[2];
+		float _friction;
+		float _restitution;
+		uint32_t _count;
+		ContactConstraintPoint _points[ContactManifold::k_max_points];
+	};
+
+	// Anchors, effective masses and the warm starting impulses of the manifold.
+	void prepareContact(ContactConstraint& constraint, const ContactManifold& manifold, uint32_t body_a, uint32_t body_b,
+		const Vec3* positions, const SolverBodies& bodies, float friction, float restitution);
+
+	void warmStartContacts(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies);
+
+	// One sequential impulse pass. Without use_bias only speculative
+	// contacts keep a bias, which relaxes the velocity the position
+	// correction added.
+	void solveContacts(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies,
+		const ContactSoftness& softness, float inv_h, float max_push_velocity, bool use_bias);
+
+	void applyRestitution(ContactConstraint* constraints, uint32_t count, const SolverBodies& bodies, float threshold);
+
+	// Writes the accumulated impulses back for the next step's warm start.
+	void storeImpulses(const ContactConstraint& constraint, ContactManifold& manifold);
+}
+
+#endif
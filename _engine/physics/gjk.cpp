@@ -0,0 +1,330 @@
+#include "physics/gjk.h"
+
+#include "physics/collision_shape.h"
+
+namespace monster
+{
+	static const uint32_t k_max_iterations = 32;
+
+	uint32_t GjkProxy::getSupport(const Vec3& dir) const
+	{
+		uint32_t best = 0;
+		float best_distance = dot(_vertices[0], dir);
+		for (uint32_t ii = 1; ii < _count; ++ii)
+		{
+			float distance = dot(_vertices[ii], dir);
+			if (distance > best_distance)
+			{
+				best = ii;
+				best_distance = distance;
+			}
+		}
+		return best;
+	}
+
+	GjkProxy makeProxy(const CollisionShape& shape)
+	{
+		GjkProxy proxy;
+		if (shape.isHull())
+		{
+			proxy._vertices = shape.getHull().getVertices();
+			proxy._count = shape.getHull().getVertexCount();
+			proxy._radius = 0.0f;
+		}
+		else
+		{
+			proxy._vertices = shape.getCore();
+			proxy._count = shape.getCoreCount();
+			proxy._radius = shape.getRadius();
+		}
+		return proxy;
+	}
+
+	struct SimplexVertex
+	{
+		Vec3 _wa;          // support point of a
+		Vec3 _wb;          // support point of b
+		Vec3 _w;           // _wb - _wa
+		float _weight;     // barycentric coordinate of the closest point
+		uint32_t _index_a;
+		uint32_t _index_b;
+	};
+
+	struct Simplex
+	{
+		SimplexVertex _v[4];
+		uint32_t _count;
+	};
+
+	// closest point of a segment to the origin, keeping only the vertices in use
+	static void solveSegment(Simplex& simplex)
+	{
+		const Vec3 a = simplex._v[0]._w;
+		const Vec3 e = simplex._v[1]._w - a;
+		float t = -dot(a, e);
+		if (0.0f >= t)
+		{
+			simplex._v[0]._weight = 1.0f;
+			simplex._count = 1;
+			return;
+		}
+
+		float denom = dot(e, e);
+		if (t >= denom)
+		{
+			simplex._v[0] = simplex._v[1];
+			simplex._v[0]._weight = 1.0f;
+			simplex._count = 1;
+			return;
+		}
+
+		t /= denom;
+		simplex._v[0]._weight = 1.0f - t;
+		simplex._v[1]._weight = t;
+	}
+
+	// Voronoi regions of a triangle, see Ericson, Real-Time Collision Detection 5.1.5
+	static void solveTriangle(Simplex& simplex)
+	{
+		SimplexVertex v0 = simplex._v[0];
+		SimplexVertex v1 = simplex._v[1];
+		SimplexVertex v2 = simplex._v[2];
+		const Vec3 a = v0._w;
+		const Vec3 b = v1._w;
+		const Vec3 c = v2._w;
+		const Vec3 ab = b - a;
+		const Vec3 ac = c - a;
+
+		float d1 = -dot(ab, a);
+		float d2 = -dot(ac, a);
+		if (0.0f >= d1 && 0.0f >= d2)
+		{
+			simplex._v[0]._weight = 1.0f;
+			simplex._count = 1;
+			return;
+		}
+
+		float d3 = -dot(ab, b);
+		float d4 = -dot(ac, b);
+		if (0.0f <= d3 && d4 <= d3)
+		{
+			simplex._v[0] = v1;
+			simplex._v[0]._weight = 1.0f;
+			simplex._count = 1;
+			return;
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+		if (0.0f >= vc && 0.0f <= d1 && 0.0f >= d3)
+		{
+			float t = d1 / (d1 - d3);
+			simplex._v[0]._weight = 1.0f - t;
+			simplex._v[1]._weight = t;
+			simplex._count = 2;
+			return;
+		}
+
+		float d5 = -dot(ab, c);
+		float d6 = -dot(ac, c);
+		if (0.0f <= d6 && d5 <= d6)
+		{
+			simplex._v[0] = v2;
+			simplex._v[0]._weight = 1.0f;
+			simplex._count = 1;
+			return;
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+		if (0.0f >= vb && 0.0f <= d2 && 0.0f >= d6)
+		{
+			float t = d2 / (d2 - d6);
+			simplex._v[1] = v2;
+			simplex._v[0]._weight = 1.0f - t;
+			simplex._v[1]._weight = t;
+			simplex._count = 2;
+			return;
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (0.0f >= va && 0.0f <= d4 - d3 && 0.0f <= d5 - d6)
+		{
+			float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			simplex._v[0] = v1;
+			simplex._v[1] = v2;
+			simplex._v[0]._weight = 1.0f - t;
+			simplex._v[1]._weight = t;
+			simplex._count = 2;
+			return;
+		}
+
+		// degenerate, the triangle is a segment
+		if (0.0f >= va + vb + vc)
+		{
+			simplex._count = 2;
+			solveSegment(simplex);
+			return;
+		}
+
+		float denom = 1.0f / (va + vb + vc);
+		simplex._v[1]._weight = vb * denom;
+		simplex._v[2]._weight = vc * denom;
+		simplex._v[0]._weight = 1.0f - simplex._v[1]._weight - simplex._v[2]._weight;
+	}
+
+	// the closest of the faces the origin is in front of, or contained
+	static bool solveTetrahedron(Simplex& simplex)
+	{
+		static const uint8_t s_faces[4][4] =
+		{
+			{ 0, 1, 2, 3 },
+			{ 0, 2, 3, 1 },
+			{ 0, 3, 1, 2 },
+			{ 1, 3, 2, 0 },
+		};
+
+		// a flat tetrahedron adds nothing, fall back to the last triangle
+		const Vec3 ab = simplex._v[1]._w - simplex._v[0]._w;
+		const Vec3 ac = simplex._v[2]._w - simplex._v[0]._w;
+		const Vec3 ad = simplex._v[3]._w - simplex._v[0]._w;
+		const Vec3 normal = cross(ab, ac);
+		if (fabsf(dot(normal, ad)) <= 1e-6f * length(normal) * length(ad))
+		{
+			simplex._count = 3;
+			solveTriangle(simplex);
+			return true;
+		}
+
+		Simplex best;
+		float best_distance = 0.0f;
+		bool outside = false;
+		for (uint32_t face = 0; face < 4; ++face)
+		{
+			const SimplexVertex& a = simplex._v[s_faces[face][0]];
+			const SimplexVertex& b = simplex._v[s_faces[face][1]];
+			const SimplexVertex& c = simplex._v[s_faces[face][2]];
+			const SimplexVertex& d = simplex._v[s_faces[face][3]];
+			Vec3 normal = cross(b._w - a._w, c._w - a._w);
+			float origin_side = -dot(normal, a._w);
+			float opposite_side = dot(normal, d._w - a._w);
+			if (origin_side * opposite_side >= 0.0f)
+			{
+				continue;
+			}
+
+			Simplex candidate;
+			candidate._v[0] = a;
+			candidate._v[1] = b;
+			candidate._v[2] = c;
+			candidate._count = 3;
+			solveTriangle(candidate);
+
+			Vec3 point(0.0f, 0.0f, 0.0f);
+			for (uint32_t ii = 0; ii < candidate._count; ++ii)
+			{
+				point += candidate._v[ii]._w * candidate._v[ii]._weight;
+			}
+
+			float distance = lengthSq(point);
+			if (!outside || distance < best_distance)
+			{
+				best = candidate;
+				best_distance = distance;
+				outside = true;
+			}
+		}
+
+		if (outside)
+		{
+			simplex = best;
+		}
+		return outside;
+	}
+
+	void gjkDistance(const GjkProxy& a, const Transform& xf_a, const GjkProxy& b, const Transform& xf_b, GjkOutput& output)
+	{
+		// b in the space of a
+		const Transform xf = relativeTransform(xf_a, xf_b);
+
+		Simplex simplex;
+		SimplexVertex& first = simplex._v[0];
+		first._index_a = 0;
+		first._index_b = 0;
+		first._wa = a._vertices[0];
+		first._wb = transformPoint(xf, b._vertices[0]);
+		first._w = first._wb - first._wa;
+		first._weight = 1.0f;
+		simplex._count = 1;
+
+		Vec3 closest = first._w;
+		bool overlap = false;
+		uint32_t iteration = 0;
+		for (; iteration < k_max_iterations; ++iteration)
+		{
+			if (4 == simplex._count)
+			{
+				overlap = !solveTetrahedron(simplex);
+			}
+			else if (3 == simplex._count)
+			{
+				solveTriangle(simplex);
+			}
+			else if (2 == simplex._count)
+			{
+				solveSegment(simplex);
+			}
+
+			if (overlap)
+			{
+				break;
+			}
+
+			closest = Vec3(0.0f, 0.0f, 0.0f);
+			for (uint32_t ii = 0; ii < simplex._count; ++ii)
+			{
+				closest += simplex._v[ii]._w * simplex._v[ii]._weight;
+			}
+
+			float distance_sq = lengthSq(closest);
+			if (1e-12f >= distance_sq)
+			{
+				overlap = true;
+				break;
+			}
+
+			// support of b - a towards the origin
+			SimplexVertex vertex;
+			vertex._index_a = a.getSupport(closest);
+			vertex._index_b = b.getSupport(inverseRotate(xf.q, -closest));
+			vertex._wa = a._vertices[vertex._index_a];
+			vertex._wb = transformPoint(xf, b._vertices[vertex._index_b]);
+			vertex._w = vertex._wb - vertex._wa;
+
+			// no progress, or a vertex already in the simplex: converged
+			bool duplicate = false;
+			for (uint32_t ii = 0; ii < simplex._count; ++ii)
+			{
+				duplicate = duplicate || (simplex._v[ii]._index_a == vertex._index_a && simplex._v[ii]._index_b == vertex._index_b);
+			}
+
+			if (duplicate || distance_sq - dot(closest, vertex._w) <= 1e-5f * distance_sq)
+			{
+				break;
+			}
+
+			simplex._v[simplex._count++] = vertex;
+		}
+
+		Vec3 point_a(0.0f, 0.0f, 0.0f);
+		Vec3 point_b(0.0f, 0.0f, 0.0f);
+		for (uint32_t ii = 0; ii < simplex._count; ++ii)
+		{
+			point_a += simplex._v[ii]._wa * simplex._v[ii]._weight;
+			point_b += simplex._v[ii]._wb * simplex._v[ii]._weight;
+		}
+
+		output._point_a = transformPoint(xf_a, point_a);
+		output._point_b = overlap ? output._point_a : transformPoint(xf_a, point_b);
+		output._distance = overlap ? 0.0f : length(point_b - point_a);
+		output._iterations = iteration;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef __MONSTER_GJK_H__
+#define __MONSTER_GJK_H__
+
+#include <cstdint>
+
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	class CollisionShape;
+
+	// Point cloud in shape space plus a radius: a sphere is one point, a
+	// capsule two, hulls their vertices with no radius.
+	struct GjkProxy
+	{
+		const Vec3* _vertices;
+		uint32_t _count;
+		float _radius;
+
+		uint32_t getSupport(const Vec3& dir) const;
+	};
+
+	GjkProxy makeProxy(const CollisionShape& shape);
+
+	struct GjkOutput
+	{
+		Vec3 _point_a;         // closest points of the core shapes, world space
+		Vec3 _point_b;
+		float _distance;       // between the cores, radii not subtracted; 0 when they overlap
+		uint32_t _iterations;
+	};
+
+	// Distance between the cores of two convex proxies.
+	void gjkDistance(const GjkProxy& a, const Transform& xf_a, const GjkProxy& b, const Transform& xf_b, GjkOutput& output);
+}
+
+#endif
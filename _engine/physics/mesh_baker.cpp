@@ -0,0 +1,515 @@
+#include "physics/mesh_baker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "core/serialization/blob_serializer.h"
+
+namespace monster
+{
+	static const uint32_t k_max_bins = 64;
+	static const uint32_t k_median_depth = 32;   // deeper than this, splits halve the count to bound the depth
+
+	static const char* skipSpace(const char* str)
+	{
+		while (' ' == *str || '\t' == *str || '\r' == *str)
+		{
+			++str;
+		}
+		return str;
+	}
+
+	bool parseObj(const char* text, size_t size, RawMesh& mesh)
+	{
+		mesh._positions.clear();
+		mesh._indices.clear();
+
+		std::string line;
+		const char* end = text + size;
+		while (text < end)
+		{
+			const char* next = text;
+			while (next < end && '\n' != *next)
+			{
+				++next;
+			}
+			line.assign(text, next);
+			text = next + 1;
+
+			const char* str = skipSpace(line.c_str());
+			if ('v' == str[0] && (' ' == str[1] || '\t' == str[1]))
+			{
+				char* cursor = (char*)str + 1;
+				for (uint32_t ii = 0; ii < 3; ++ii)
+				{
+					char* number_end;
+					float value = strtof(cursor, &number_end);
+					if (number_end == cursor)
+					{
+						return false;
+					}
+					mesh._positions.push_back(value);
+					cursor = number_end;
+				}
+			}
+			else if ('f' == str[0] && (' ' == str[1] || '\t' == str[1]))
+			{
+				// v, v/vt, v//vn or v/vt/vn; negative indices count back from the last vertex
+				const int64_t vertex_count = (int64_t)mesh._positions.size() / 3;
+				uint32_t polygon[3];
+				uint32_t count = 0;
+				const char* cursor = skipSpace(str + 1);
+				while ('\0' != *cursor)
+				{
+					char* number_end;
+					int64_t index = strtoll(cursor, &number_end, 10);
+					if (number_end == cursor)
+					{
+						return false;
+					}
+
+					index = 0 > index ? vertex_count + index : index - 1;
+					if (0 > index || vertex_count <= index)
+					{
+						return false;
+					}
+
+					cursor = number_end;
+					while ('\0' != *cursor && ' ' != *cursor && '\t' != *cursor && '\r' != *cursor)
+					{
+						++cursor;
+					}
+					cursor = skipSpace(cursor);
+
+					if (2 > count)
+					{
+						polygon[count++] = (uint32_t)index;
+						continue;
+					}
+
+					polygon[2] = (uint32_t)index;
+					mesh._indices.insert(mesh._indices.end(), polygon, polygon + 3);
+					polygon[1] = polygon[2];
+				}
+			}
+		}
+
+		return !mesh._indices.empty();
+	}
+
+	struct BuildNode
+	{
+		Aabb _aabb;
+		uint32_t _data;
+	};
+
+	struct Bin
+	{
+		Aabb _aabb;
+		uint32_t _count;
+	};
+
+	static void emptyAabb(Aabb& aabb)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] = 1e30f;
+			aabb.m_max[axis] = -1e30f;
+		}
+	}
+
+	static void growAabb(Aabb& aabb, const Aabb& other)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] = std::min(aabb.m_min[axis], other.m_min[axis]);
+			aabb.m_max[axis] = std::max(aabb.m_max[axis], other.m_max[axis]);
+		}
+	}
+
+	static float halfArea(const Aabb& aabb)
+	{
+		float x = aabb.m_max[0] - aabb.m_min[0];
+		float y = aabb.m_max[1] - aabb.m_min[1];
+		float z = aabb.m_max[2] - aabb.m_min[2];
+		return 0.0f > x ? 0.0f : x * y + y * z + z * x;
+	}
+
+	// top down binned SAH over triangle bounds, nodes written depth first
+	class TreeBuilder
+	{
+	private:
+		const MeshBakeSettings& _settings;
+		const std::vector<Aabb>& _bounds;
+		std::vector<Vec3> _centers;
+
+	public:
+		std::vector<uint32_t> _order;       // triangles in leaf order
+		std::vector<BuildNode> _nodes;
+		uint32_t _depth;
+
+	private:
+		uint32_t getBin(const Aabb& centers, uint32_t axis, uint32_t triangle) const
+		{
+			const float extent = centers.m_max[axis] - centers.m_min[axis];
+			uint32_t bin = (uint32_t)((_centers[triangle][axis] - centers.m_min[axis]) / extent * _settings._bin_count);
+			return bin < _settings._bin_count ? bin : _settings._bin_count - 1;
+		}
+
+		// best split as axis and first bin of the right side; false when a leaf is cheaper
+		bool findSplit(uint32_t begin, uint32_t end, const Aabb& aabb, const Aabb& centers, uint32_t& best_axis, uint32_t& best_bin) const
+		{
+			const uint32_t bin_count = _settings._bin_count;
+			const uint32_t count = end - begin;
+			float best_cost = (float)count * halfArea(aabb);   // leaf, in units of one triangle test
+			bool found = false;
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				if (centers.m_max[axis] <= centers.m_min[axis])
+				{
+					continue;
+				}
+
+				Bin bins[k_max_bins];
+				for (uint32_t ii = 0; ii < bin_count; ++ii)
+				{
+					emptyAabb(bins[ii]._aabb);
+					bins[ii]._count = 0;
+				}
+
+				for (uint32_t ii = begin; ii < end; ++ii)
+				{
+					Bin& bin = bins[getBin(centers, axis, _order[ii])];
+					growAabb(bin._aabb, _bounds[_order[ii]]);
+					++bin._count;
+				}
+
+				// sweep from the right for the cost of each right side, then from the left
+				float right_cost[k_max_bins];
+				Aabb right;
+				emptyAabb(right);
+				uint32_t right_count = 0;
+				for (uint32_t ii = bin_count - 1; 0 < ii; --ii)
+				{
+					growAabb(right, bins[ii]._aabb);
+					right_count += bins[ii]._count;
+					right_cost[ii] = right_count * halfArea(right);
+				}
+
+				Aabb left;
+				emptyAabb(left);
+				uint32_t left_count = 0;
+				for (uint32_t ii = 1; ii < bin_count; ++ii)
+				{
+					growAabb(left, bins[ii - 1]._aabb);
+					left_count += bins[ii - 1]._count;
+					if (0 == left_count || count == left_count)
+					{
+						continue;
+					}
+
+					// one box test for each child per triangle test
+					float cost = 2.0f * halfArea(aabb) + left_count * halfArea(left) + right_cost[ii];
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_bin = ii;
+						found = true;
+					}
+				}
+			}
+			return found;
+		}
+
+		uint32_t build(uint32_t begin, uint32_t end, uint32_t depth)
+		{
+			_depth = std::max(_depth, depth);
+
+			Aabb aabb;
+			Aabb centers;
+			emptyAabb(aabb);
+			emptyAabb(centers);
+			for (uint32_t ii = begin; ii < end; ++ii)
+			{
+				growAabb(aabb, _bounds[_order[ii]]);
+				const Vec3& center = _centers[_order[ii]];
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					centers.m_min[axis] = std::min(centers.m_min[axis], center[axis]);
+					centers.m_max[axis] = std::max(centers.m_max[axis], center[axis]);
+				}
+			}
+
+			const uint32_t index = (uint32_t)_nodes.size();
+			_nodes.push_back(BuildNode());
+			_nodes[index]._aabb = aabb;
+
+			const uint32_t count = end - begin;
+			uint32_t axis = 0;
+			uint32_t bin = 0;
+			uint32_t middle = begin;
+			if (k_median_depth > depth && findSplit(begin, end, aabb, centers, axis, bin))
+			{
+				middle = (uint32_t)(std::partition(_order.begin() + begin, _order.begin() + end,
+					[&](uint32_t triangle) { return getBin(centers, axis, triangle) < bin; }) - _order.begin());
+			}
+			else if (count > _settings._max_leaf_triangles)
+			{
+				// all centers in one spot, or too deep: halve along the longest axis
+				for (uint32_t ii = 1; ii < 3; ++ii)
+				{
+					axis = aabb.m_max[ii] - aabb.m_min[ii] > aabb.m_max[axis] - aabb.m_min[axis] ? ii : axis;
+				}
+				middle = begin + count / 2;
+				std::nth_element(_order.begin() + begin, _order.begin() + middle, _order.begin() + end,
+					[&](uint32_t a, uint32_t b) { return _centers[a][axis] < _centers[b][axis]; });
+			}
+
+			if (middle == begin)
+			{
+				_nodes[index]._data = CollisionMesh::k_leaf_flag | (count << CollisionMesh::k_count_shift) | begin;
+				return index;
+			}
+
+			build(begin, middle, depth + 1);
+			const uint32_t second = build(middle, end, depth + 1);
+			_nodes[index]._data = second;
+			return index;
+		}
+
+	public:
+		TreeBuilder(const MeshBakeSettings& settings, const std::vector<Aabb>& bounds)
+			: _settings(settings)
+			, _bounds(bounds)
+			, _depth(0)
+		{
+			const uint32_t count = (uint32_t)bounds.size();
+			_centers.resize(count);
+			_order.resize(count);
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				_centers[ii] = (Vec3(bounds[ii].m_min) + Vec3(bounds[ii].m_max)) * 0.5f;
+				_order[ii] = ii;
+			}
+
+			build(0, count, 0);
+		}
+	};
+
+	struct EdgeUse
+	{
+		uint32_t _lower;        // vertex indices, sorted
+		uint32_t _upper;
+		uint32_t _triangle;
+		uint32_t _edge;
+
+		bool operator < (const EdgeUse& other) const
+		{
+			return _lower != other._lower ? _lower < other._lower : _upper < other._upper;
+		}
+	};
+
+	static Vec3 getVertex(const std::vector<MeshVertex>& vertices, const MeshTriangle& triangle, uint32_t ii)
+	{
+		return Vec3(vertices[triangle._vertex[ii] & ~CollisionMesh::k_active_edge]._position);
+	}
+
+	static Vec3 getNormal(const std::vector<MeshVertex>& vertices, const MeshTriangle& triangle)
+	{
+		const Vec3 v0 = getVertex(vertices, triangle, 0);
+		return normalize(cross(getVertex(vertices, triangle, 1) - v0, getVertex(vertices, triangle, 2) - v0));
+	}
+
+	// an edge stays inactive only between two consistently wound triangles
+	// that are flat or concave across it; returns the number of active edges
+	static uint32_t flagActiveEdges(std::vector<MeshTriangle>& triangles, const std::vector<MeshVertex>& vertices, float active_edge_cos)
+	{
+		std::vector<EdgeUse> uses(triangles.size() * 3);
+		for (uint32_t ii = 0; ii < triangles.size(); ++ii)
+		{
+			for (uint32_t jj = 0; jj < 3; ++jj)
+			{
+				EdgeUse& use = uses[ii * 3 + jj];
+				const uint32_t v0 = triangles[ii]._vertex[jj];
+				const uint32_t v1 = triangles[ii]._vertex[(jj + 1) % 3];
+				use._lower = std::min(v0, v1);
+				use._upper = std::max(v0, v1);
+				use._triangle = ii;
+				use._edge = jj;
+			}
+		}
+		std::sort(uses.begin(), uses.end());
+
+		uint32_t active_count = 0;
+		for (size_t begin = 0; begin < uses.size();)
+		{
+			size_t end = begin + 1;
+			while (end < uses.size() && !(uses[begin] < uses[end]))
+			{
+				++end;
+			}
+
+			bool active = true;
+			if (2 == end - begin)
+			{
+				const EdgeUse& a = uses[begin];
+				const EdgeUse& b = uses[begin + 1];
+				const MeshTriangle& ta = triangles[a._triangle];
+				const MeshTriangle& tb = triangles[b._triangle];
+				const Vec3 na = getNormal(vertices, ta);
+				const Vec3 nb = getNormal(vertices, tb);
+				const Vec3 edge = getVertex(vertices, ta, a._edge);
+				const Vec3 opposite = getVertex(vertices, tb, (b._edge + 2) % 3);
+				const bool opposed = ta._vertex[a._edge] == tb._vertex[(b._edge + 1) % 3];
+				const bool convex = 0.0f > dot(na, opposite - edge);
+				active = !opposed || (convex && dot(na, nb) < active_edge_cos);
+			}
+
+			for (size_t ii = begin; ii < end; ++ii)
+			{
+				if (active)
+				{
+					triangles[uses[ii]._triangle]._vertex[uses[ii]._edge] |= CollisionMesh::k_active_edge;
+					++active_count;
+				}
+			}
+			begin = end;
+		}
+		return active_count;
+	}
+
+	bool bakeCollisionMesh(const RawMesh& raw, const MeshBakeSettings& settings, std::vector<uint8_t>& blob, MeshBakeStats* stats)
+	{
+		const uint32_t vertex_count = (uint32_t)(raw._positions.size() / 3);
+		if (0 == settings._max_leaf_triangles
+			|| CollisionMesh::k_max_leaf_triangles < settings._max_leaf_triangles
+			|| 2 > settings._bin_count
+			|| k_max_bins < settings._bin_count
+			|| CollisionMesh::k_active_edge <= vertex_count
+			|| 0 != raw._indices.size() % 3)
+		{
+			return false;
+		}
+
+		// degenerate triangles can never be hit
+		std::vector<uint32_t> triangles;
+		std::vector<Aabb> bounds;
+		for (size_t ii = 0; ii < raw._indices.size(); ii += 3)
+		{
+			Vec3 v[3];
+			for (uint32_t jj = 0; jj < 3; ++jj)
+			{
+				const uint32_t vertex = raw._indices[ii + jj];
+				if (vertex_count <= vertex)
+				{
+					return false;
+				}
+				v[jj] = Vec3(&raw._positions[vertex * 3]);
+			}
+
+			if (0.0f == lengthSq(cross(v[1] - v[0], v[2] - v[0])))
+			{
+				continue;
+			}
+
+			const Vec3 lower = vmin(v[0], vmin(v[1], v[2]));
+			const Vec3 upper = vmax(v[0], vmax(v[1], v[2]));
+			Aabb aabb;
+			memcpy(aabb.m_min, &lower, sizeof(aabb.m_min));
+			memcpy(aabb.m_max, &upper, sizeof(aabb.m_max));
+			bounds.push_back(aabb);
+			triangles.push_back((uint32_t)ii);
+		}
+
+		if (triangles.empty() || CollisionMesh::k_max_triangles <= triangles.size())
+		{
+			return false;
+		}
+
+		TreeBuilder tree(settings, bounds);
+
+		// triangles in leaf order, vertices in order of first use
+		std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+		std::vector<MeshTriangle> mesh_triangles(triangles.size());
+		std::vector<MeshVertex> mesh_vertices;
+		for (size_t ii = 0; ii < tree._order.size(); ++ii)
+		{
+			const uint32_t first = triangles[tree._order[ii]];
+			for (uint32_t jj = 0; jj < 3; ++jj)
+			{
+				const uint32_t vertex = raw._indices[first + jj];
+				if (UINT32_MAX == remap[vertex])
+				{
+					remap[vertex] = (uint32_t)mesh_vertices.size();
+					MeshVertex mesh_vertex;
+					memcpy(mesh_vertex._position, &raw._positions[vertex * 3], sizeof(mesh_vertex._position));
+					mesh_vertices.push_back(mesh_vertex);
+				}
+				mesh_triangles[ii]._vertex[jj] = remap[vertex];
+			}
+		}
+		const uint32_t active_edge_count = flagActiveEdges(mesh_triangles, mesh_vertices, settings._active_edge_cos);
+
+		CollisionMesh mesh;
+		const Aabb& root = tree._nodes[0]._aabb;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float extent = root.m_max[axis] - root.m_min[axis];
+			mesh._min[axis] = root.m_min[axis];
+			mesh._step[axis] = 0.0f < extent ? extent / 65535.0f : 1e-9f;
+		}
+
+		// rounded outwards, and once more where the division came out a hair inside
+		std::vector<MeshNode> nodes(tree._nodes.size());
+		for (size_t ii = 0; ii < nodes.size(); ++ii)
+		{
+			const BuildNode& node = tree._nodes[ii];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				const float min = mesh._min[axis];
+				const float step = mesh._step[axis];
+				float lower = floorf((node._aabb.m_min[axis] - min) / step);
+				float upper = ceilf((node._aabb.m_max[axis] - min) / step);
+				lower = std::max(0.0f, std::min(65535.0f, lower));
+				upper = std::max(0.0f, std::min(65535.0f, upper));
+				if (0.0f < lower && min + lower * step > node._aabb.m_min[axis])
+				{
+					lower -= 1.0f;
+				}
+				if (65535.0f > upper && min + upper * step < node._aabb.m_max[axis])
+				{
+					upper += 1.0f;
+				}
+				nodes[ii]._min[axis] = (uint16_t)lower;
+				nodes[ii]._max[axis] = (uint16_t)upper;
+			}
+			nodes[ii]._data = node._data;
+		}
+
+		mesh._nodes.set(&nodes[0], (uint32_t)nodes.size());
+		mesh._triangles.set(&mesh_triangles[0], (uint32_t)mesh_triangles.size());
+		mesh._vertices.set(&mesh_vertices[0], (uint32_t)mesh_vertices.size());
+
+		if (!writeBlob(mesh, blob))
+		{
+			return false;
+		}
+
+		if (nullptr != stats)
+		{
+			stats->_triangle_count = (uint32_t)mesh_triangles.size();
+			stats->_vertex_count = (uint32_t)mesh_vertices.size();
+			stats->_active_edge_count = active_edge_count;
+			stats->_node_count = (uint32_t)nodes.size();
+			stats->_depth = tree._depth;
+			stats->_size = (uint32_t)blob.size();
+		}
+
+		return true;
+	}
+}
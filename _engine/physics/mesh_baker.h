@@ -0,0 +1,54 @@
+#ifndef __MONSTER_MESH_BAKER_H__
+#define __MONSTER_MESH_BAKER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "physics/collision_mesh.h"
+
+namespace monster
+{
+	// Uncooked input: positions and an index triple per triangle.
+	struct RawMesh
+	{
+		std::vector<float> _positions;      // xyz
+		std::vector<uint32_t> _indices;
+	};
+
+	// Reads the positions and faces of a Wavefront .obj, as geometryc does:
+	// polygons are split into fans, normals, texture coordinates, groups
+	// and materials are ignored. text need not be terminated.
+	bool parseObj(const char* text, size_t size, RawMesh& mesh);
+
+	struct MeshBakeSettings
+	{
+		uint32_t _max_leaf_triangles;   // at most CollisionMesh::k_max_leaf_triangles
+		uint32_t _bin_count;            // SAH candidate splits per axis and node
+		float _active_edge_cos;         // creases flatter than this angle stay inactive
+
+		MeshBakeSettings()
+			: _max_leaf_triangles(4)
+			, _bin_count(16)
+			, _active_edge_cos(0.996f)  // 5 degrees
+		{
+		}
+	};
+
+	struct MeshBakeStats
+	{
+		uint32_t _triangle_count;       // after dropping degenerate ones
+		uint32_t _vertex_count;         // after dropping unused ones
+		uint32_t _active_edge_count;    // triangle sides, so a shared edge counts twice
+		uint32_t _node_count;
+		uint32_t _depth;
+		uint32_t _size;                 // of the blob
+	};
+
+	// Offline step: builds a binned SAH tree over the triangles, reorders
+	// triangles and vertices to match it, flags the active edges, quantizes
+	// the node bounds and writes the result as a CollisionMesh blob. Edges
+	// are matched by vertex index, so shared corners must be one vertex.
+	bool bakeCollisionMesh(const RawMesh& raw, const MeshBakeSettings& settings, std::vector<uint8_t>& blob, MeshBakeStats* stats = nullptr);
+}
+
+#endif
@@ -0,0 +1,1269 @@
+#include "physics/narrowphase.h"
+
+#include <cfloat>
+#include <cmath>
+
+#include "physics/collision_shape.h"
+#include "physics/gjk.h"
+
+namespace monster
+{
+	static const float k_epsilon = 1e-5f;
+	static const uint32_t k_max_clip_vertices = 2 * ConvexHull::k_max_points;
+	static const uint32_t k_max_hull_faces = 2 * ConvexHull::k_max_points;
+	static const uint32_t k_max_mesh_manifolds = 4;
+	static const uint32_t k_max_group_points = 16;
+	static const float k_group_dot = 0.95f;     // triangle manifolds with normals this close share one
+	static const float k_weld_distance = 0.01f; // points of neighbouring triangles this close are one
+	static const float k_edge_distance = 0.001f; // closest points this close to a triangle edge are on it
+
+	static float clamp01(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	}
+
+	static void addPoint(ContactManifold& manifold, const Vec3& position, float separation, uint32_t id)
+	{
+		ContactPoint& point = manifold._points[manifold._count++];
+		point._position = position;
+		point._separation = separation;
+		point._id = id;
+		point._normal_impulse = 0.0f;
+		point._friction_impulse = Vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	static Vec3 closestOnSegment(const Vec3& p0, const Vec3& p1, const Vec3& point)
+	{
+		Vec3 e = p1 - p0;
+		float denom = dot(e, e);
+		return k_epsilon < denom ? p0 + e * clamp01(dot(point - p0, e) / denom) : p0;
+	}
+
+	// Ericson, Real-Time Collision Detection 5.1.9
+	static void closestSegments(const Vec3& p1, const Vec3& q1, const Vec3& p2, const Vec3& q2, Vec3& c1, Vec3& c2)
+	{
+		const Vec3 d1 = q1 - p1;
+		const Vec3 d2 = q2 - p2;
+		const Vec3 r = p1 - p2;
+		float a = dot(d1, d1);
+		float e = dot(d2, d2);
+		float f = dot(d2, r);
+		float s = 0.0f;
+		float t = 0.0f;
+
+		if (k_epsilon >= a && k_epsilon >= e)
+		{
+		}
+		else if (k_epsilon >= a)
+		{
+			t = clamp01(f / e);
+		}
+		else
+		{
+			float c = dot(d1, r);
+			if (k_epsilon >= e)
+			{
+				s = clamp01(-c / a);
+			}
+			else
+			{
+				float b = dot(d1, d2);
+				float denom = a * e - b * b;
+				s = 0.0f != denom ? clamp01((b * f - c * e) / denom) : 0.0f;
+				t = (b * s + f) / e;
+				if (0.0f > t)
+				{
+					t = 0.0f;
+					s = clamp01(-c / a);
+				}
+				else if (1.0f < t)
+				{
+					t = 1.0f;
+					s = clamp01((b - c) / a);
+				}
+			}
+		}
+
+		c1 = p1 + d1 * s;
+		c2 = p2 + d2 * t;
+	}
+
+	// spheres and capsules: a segment each, degenerate for spheres
+	static bool collideCores(const Vec3& a0, const Vec3& a1, float ra, const Vec3& b0, const Vec3& b1, float rb, float margin, ContactManifold& manifold)
+	{
+		Vec3 pa, pb;
+		closestSegments(a0, a1, b0, b1, pa, pb);
+
+		Vec3 d = pb - pa;
+		float distance = length(d);
+		if (distance > ra + rb + margin)
+		{
+			return false;
+		}
+
+		Vec3 ea = a1 - a0;
+		Vec3 eb = b1 - b0;
+		Vec3 normal;
+		if (k_epsilon < distance)
+		{
+			normal = d * (1.0f / distance);
+		}
+		else
+		{
+			// cores touch, any direction across a's segment separates them
+			Vec3 t1, t2;
+			computeBasis(k_epsilon < lengthSq(ea) ? normalize(ea) : Vec3(1.0f, 0.0f, 0.0f), t1, t2);
+			normal = t1;
+		}
+
+		// parallel capsules rest on each other along a line, contact both ends of the overlap
+		float la = lengthSq(ea);
+		float lb = lengthSq(eb);
+		if (k_epsilon < la && k_epsilon < lb && lengthSq(cross(ea, eb)) < 0.0025f * la * lb)
+		{
+			float t0 = clamp01(dot(b0 - a0, ea) / la);
+			float t1 = clamp01(dot(b1 - a0, ea) / la);
+			float lower = t0 < t1 ? t0 : t1;
+			float upper = t0 < t1 ? t1 : t0;
+			if (upper - lower > 0.01f)
+			{
+				manifold._normal = normal;
+				manifold._count = 0;
+				const float ends[2] = { lower, upper };
+				for (uint32_t ii = 0; ii < 2; ++ii)
+				{
+					Vec3 p = a0 + ea * ends[ii];
+					Vec3 q = closestOnSegment(b0, b1, p);
+					float separation = dot(q - p, normal) - ra - rb;
+					addPoint(manifold, p + normal * (ra + 0.5f * separation), separation, ii);
+				}
+				return true;
+			}
+		}
+
+		float separation = distance - ra - rb;
+		manifold._normal = normal;
+		manifold._count = 0;
+		addPoint(manifold, pa + normal * (ra + 0.5f * separation), separation, 0);
+		return true;
+	}
+
+	// Clips a capsule segment, in hull space, to the sides of a face and
+	// adds its ends with the face as reference. normal is from the capsule
+	// to the hull.
+	static bool clipSegmentToFace(const ConvexHull& hull, uint32_t face_index, Vec3 p0, Vec3 p1, float radius, float margin, ContactManifold& manifold)
+	{
+		const HullFace& face = hull.getFace(face_index);
+		const uint8_t* indices = hull.getFaceVertices(face);
+		const Vec3* vertices = hull.getVertices();
+		for (uint32_t ii = 0; ii < face._count; ++ii)
+		{
+			const Vec3& v0 = vertices[indices[ii]];
+			const Vec3& v1 = vertices[indices[(ii + 1) % face._count]];
+			Vec3 side = cross(v1 - v0, face._normal);
+			float d0 = dot(side, p0 - v0);
+			float d1 = dot(side, p1 - v0);
+			if (0.0f < d0 && 0.0f < d1)
+			{
+				return false;
+			}
+
+			if (0.0f < d0)
+			{
+				p0 = p0 + (p1 - p0) * (d0 / (d0 - d1));
+			}
+			else if (0.0f < d1)
+			{
+				p1 = p1 + (p0 - p1) * (d1 / (d1 - d0));
+			}
+		}
+
+		manifold._normal = -face._normal;
+		manifold._count = 0;
+		const Vec3 ends[2] = { p0, p1 };
+		for (uint32_t ii = 0; ii < 2; ++ii)
+		{
+			float separation = dot(face._normal, ends[ii]) - face._offset - radius;
+			if (separation <= margin)
+			{
+				addPoint(manifold, ends[ii] - face._normal * (radius + 0.5f * separation), separation, ii);
+			}
+		}
+		return 0 < manifold._count;
+	}
+
+	// sphere or capsule a against hull b, computed in b's space
+	static bool collideCoreHull(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin, ContactManifold& manifold)
+	{
+		const ConvexHull& hull = b.getHull();
+		const Transform a_in_b = relativeTransform(xf_b, xf_a);
+		const uint32_t core_count = a.getCoreCount();
+		const float radius = a.getRadius();
+		Vec3 core[2];
+		core[0] = transformPoint(a_in_b, a.getCore()[0]);
+		core[1] = transformPoint(a_in_b, a.getCore()[core_count - 1]);
+
+		const Transform identity(Vec3(0.0f, 0.0f, 0.0f), Quat::identity());
+		const GjkProxy core_proxy = { core, core_count, 0.0f };
+		GjkOutput output;
+		gjkDistance(core_proxy, identity, makeProxy(b), identity, output);
+		if (output._distance > radius + margin)
+		{
+			return false;
+		}
+
+		bool found = false;
+		if (k_epsilon < output._distance)
+		{
+			Vec3 normal = (output._point_b - output._point_a) * (1.0f / output._distance);
+
+			// a capsule lying flat on a face gets both ends
+			if (2 == core_count)
+			{
+				uint32_t best = 0;
+				float best_dot = dot(hull.getFace(0)._normal, normal);
+				for (uint32_t ii = 1; ii < hull.getFaceCount(); ++ii)
+				{
+					float value = dot(hull.getFace(ii)._normal, normal);
+					if (value < best_dot)
+					{
+						best = ii;
+						best_dot = value;
+					}
+				}
+
+				Vec3 axis = core[1] - core[0];
+				float axis_dot = dot(axis, hull.getFace(best)._normal);
+				if (-0.99f > best_dot && axis_dot * axis_dot < 0.0025f * lengthSq(axis))
+				{
+					found = clipSegmentToFace(hull, best, core[0], core[1], radius, margin, manifold);
+				}
+			}
+
+			if (!found)
+			{
+				float separation = output._distance - radius;
+				manifold._normal = normal;
+				manifold._count = 0;
+				addPoint(manifold, output._point_a + normal * (radius + 0.5f * separation), separation, 0);
+				found = true;
+			}
+		}
+		else
+		{
+			// the core is inside, push out through the least penetrated face
+			uint32_t best = 0;
+			float best_separation = -1e30f;
+			for (uint32_t ii = 0; ii < hull.getFaceCount(); ++ii)
+			{
+				const HullFace& face = hull.getFace(ii);
+				float separation = dot(face._normal, core[0]);
+				float other = dot(face._normal, core[1]);
+				separation = (separation < other ? separation : other) - face._offset;
+				if (separation > best_separation)
+				{
+					best = ii;
+					best_separation = separation;
+				}
+			}
+
+			if (2 == core_count)
+			{
+				found = clipSegmentToFace(hull, best, core[0], core[1], radius, margin, manifold);
+			}
+
+			if (!found)
+			{
+				const HullFace& face = hull.getFace(best);
+				const Vec3& point = dot(face._normal, core[0]) < dot(face._normal, core[1]) ? core[0] : core[1];
+				float separation = best_separation - radius;
+				manifold._normal = -face._normal;
+				manifold._count = 0;
+				addPoint(manifold, point - face._normal * (radius + 0.5f * separation), separation, 0);
+				found = true;
+			}
+		}
+
+		manifold._normal = rotate(xf_b.q, manifold._normal);
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			manifold._points[ii]._position = transformPoint(xf_b, manifold._points[ii]._position);
+		}
+		return true;
+	}
+
+	struct FaceQuery
+	{
+		uint32_t _face;
+		float _separation;
+	};
+
+	struct EdgeQuery
+	{
+		uint32_t _edge_a;
+		uint32_t _edge_b;
+		Vec3 _normal;
+		float _separation;
+	};
+
+	// faces of a against b's vertices, both in a's space
+	static FaceQuery queryFaces(const ConvexHull& a, const Vec3* b_vertices, uint32_t b_count)
+	{
+		FaceQuery query = { 0, -1e30f };
+		for (uint32_t ii = 0; ii < a.getFaceCount(); ++ii)
+		{
+			const HullFace& face = a.getFace(ii);
+			float lowest = dot(face._normal, b_vertices[0]);
+			for (uint32_t jj = 1; jj < b_count; ++jj)
+			{
+				float distance = dot(face._normal, b_vertices[jj]);
+				lowest = distance < lowest ? distance : lowest;
+			}
+
+			float separation = lowest - face._offset;
+			if (separation > query._separation)
+			{
+				query._face = ii;
+				query._separation = separation;
+			}
+		}
+		return query;
+	}
+
+	// Whether the arcs a-b and c-d on the Gauss map cross, i.e. the two
+	// edges form a face of the Minkowski difference (Gregorius, GDC 2013).
+	static bool isMinkowskiFace(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+	{
+		Vec3 bxa = cross(b, a);
+		Vec3 dxc = cross(d, c);
+		float cba = dot(c, bxa);
+		float dba = dot(d, bxa);
+		float adc = dot(a, dxc);
+		float bdc = dot(b, dxc);
+		return 0.0f > cba * dba && 0.0f > adc * bdc && 0.0f < cba * bdc;
+	}
+
+	// edge pairs with b's vertices and face normals given in a's space; a is centered on its origin
+	static EdgeQuery queryEdges(const ConvexHull& a, const ConvexHull& b, const Vec3* b_vertices, const Vec3* b_normals)
+	{
+		EdgeQuery query = { 0, 0, Vec3(0.0f, 0.0f, 0.0f), -1e30f };
+		const Vec3* a_vertices = a.getVertices();
+		for (uint32_t ii = 0; ii < a.getEdgeCount(); ++ii)
+		{
+			const HullEdge& edge_a = a.getEdge(ii);
+			const Vec3& pa = a_vertices[edge_a._vertex[0]];
+			const Vec3 da = a_vertices[edge_a._vertex[1]] - pa;
+			const Vec3& ua = a.getFace(edge_a._face[0])._normal;
+			const Vec3& va = a.getFace(edge_a._face[1])._normal;
+
+			for (uint32_t jj = 0; jj < b.getEdgeCount(); ++jj)
+			{
+				const HullEdge& edge_b = b.getEdge(jj);
+				if (!isMinkowskiFace(ua, va, -b_normals[edge_b._face[0]], -b_normals[edge_b._face[1]]))
+				{
+					continue;
+				}
+
+				const Vec3& pb = b_vertices[edge_b._vertex[0]];
+				const Vec3 db = b_vertices[edge_b._vertex[1]] - pb;
+				Vec3 axis = cross(da, db);
+				float len = length(axis);
+				if (len < 1e-5f * sqrtf(lengthSq(da) * lengthSq(db)))
+				{
+					continue;
+				}
+
+				axis *= 1.0f / len;
+				if (0.0f > dot(axis, pa))
+				{
+					axis = -axis;
+				}
+
+				float separation = dot(axis, pb - pa);
+				if (separation > query._separation)
+				{
+					query._edge_a = ii;
+					query._edge_b = jj;
+					query._normal = axis;
+					query._separation = separation;
+				}
+			}
+		}
+		return query;
+	}
+
+	struct ClipVertex
+	{
+		Vec3 _position;
+		uint32_t _id;
+	};
+
+	// Sutherland-Hodgman against one plane, keeping dot(normal, p) <= offset
+	static uint32_t clipPolygon(const ClipVertex* input, uint32_t count, const Vec3& normal, float offset, uint32_t plane, ClipVertex* output)
+	{
+		uint32_t result = 0;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const ClipVertex& v0 = input[ii];
+			const ClipVertex& v1 = input[(ii + 1) % count];
+			float d0 = dot(normal, v0._position) - offset;
+			float d1 = dot(normal, v1._position) - offset;
+
+			if (0.0f >= d0)
+			{
+				output[result++] = v0;
+			}
+
+			if (((0.0f > d0 && 0.0f < d1) || (0.0f < d0 && 0.0f > d1)) && result < k_max_clip_vertices)
+			{
+				ClipVertex& vertex = output[result++];
+				vertex._position = v0._position + (v1._position - v0._position) * (d0 / (d0 - d1));
+				vertex._id = 0x4000 | ((plane & 0x7f) << 7) | (v0._id & 0x7f);
+			}
+		}
+		return result;
+	}
+
+	// Keeps the deepest point, the one furthest from it and the two that
+	// span the largest area with them.
+	static void reduceManifold(ContactManifold& manifold, const ContactPoint* points, uint32_t count)
+	{
+		const Vec3& normal = manifold._normal;
+		uint32_t selected[4];
+
+		selected[0] = 0;
+		for (uint32_t ii = 1; ii < count; ++ii)
+		{
+			selected[0] = points[ii]._separation < points[selected[0]]._separation ? ii : selected[0];
+		}
+
+		float best = -1.0f;
+		selected[1] = selected[0];
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			float distance = lengthSq(points[ii]._position - points[selected[0]]._position);
+			if (distance > best)
+			{
+				best = distance;
+				selected[1] = ii;
+			}
+		}
+
+		best = -1.0f;
+		selected[2] = selected[0];
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const Vec3& p0 = points[selected[0]]._position;
+			float area = fabsf(dot(normal, cross(points[selected[1]]._position - p0, points[ii]._position - p0)));
+			if (area > best)
+			{
+				best = area;
+				selected[2] = ii;
+			}
+		}
+
+		// counter-clockwise about the normal, then the point furthest outside an edge
+		const Vec3 p0 = points[selected[0]]._position;
+		if (0.0f > dot(normal, cross(points[selected[1]]._position - p0, points[selected[2]]._position - p0)))
+		{
+			uint32_t swap = selected[1];
+			selected[1] = selected[2];
+			selected[2] = swap;
+		}
+
+		best = 0.0f;
+		selected[3] = selected[0];
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			float outside = 0.0f;
+			for (uint32_t edge = 0; edge < 3; ++edge)
+			{
+				const Vec3& e0 = points[selected[edge]]._position;
+				const Vec3& e1 = points[selected[(edge + 1) % 3]]._position;
+				float area = -dot(normal, cross(e1 - e0, points[ii]._position - e0));
+				outside = area > outside ? area : outside;
+			}
+
+			if (outside > best)
+			{
+				best = outside;
+				selected[3] = ii;
+			}
+		}
+
+		manifold._count = 0;
+		for (uint32_t ii = 0; ii < 4; ++ii)
+		{
+			bool duplicate = false;
+			for (uint32_t jj = 0; jj < ii; ++jj)
+			{
+				duplicate = duplicate || selected[jj] == selected[ii];
+			}
+
+			if (!duplicate)
+			{
+				manifold._points[manifold._count++] = points[selected[ii]];
+			}
+		}
+	}
+
+	// Clips the incident face of hull inc against the reference face of
+	// hull ref; inc's vertices and face normals are given in ref's space.
+	static bool clipFaces(const ConvexHull& ref, uint32_t ref_face, const ConvexHull& inc, const Vec3* inc_vertices, const Vec3* inc_normals, float margin, bool flip, ContactManifold& manifold)
+	{
+		const HullFace& reference = ref.getFace(ref_face);
+
+		uint32_t inc_face = 0;
+		float lowest = dot(inc_normals[0], reference._normal);
+		for (uint32_t ii = 1; ii < inc.getFaceCount(); ++ii)
+		{
+			float value = dot(inc_normals[ii], reference._normal);
+			if (value < lowest)
+			{
+				lowest = value;
+				inc_face = ii;
+			}
+		}
+
+		ClipVertex buffers[2][k_max_clip_vertices];
+		const HullFace& incident = inc.getFace(inc_face);
+		const uint8_t* inc_indices = inc.getFaceVertices(incident);
+		uint32_t count = incident._count;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			buffers[0][ii]._position = inc_vertices[inc_indices[ii]];
+			buffers[0][ii]._id = ii;
+		}
+
+		const Vec3* ref_vertices = ref.getVertices();
+		const uint8_t* ref_indices = ref.getFaceVertices(reference);
+		uint32_t current = 0;
+		for (uint32_t ii = 0; ii < reference._count && 0 < count; ++ii)
+		{
+			const Vec3& v0 = ref_vertices[ref_indices[ii]];
+			const Vec3& v1 = ref_vertices[ref_indices[(ii + 1) % reference._count]];
+			Vec3 side = normalize(cross(v1 - v0, reference._normal));
+			count = clipPolygon(buffers[current], count, side, dot(side, v0), ii, buffers[current ^ 1]);
+			current ^= 1;
+		}
+
+		ContactPoint points[k_max_clip_vertices];
+		uint32_t point_count = 0;
+		const uint32_t face_id = (flip ? 0x80000000 : 0) | ((ref_face & 0x7f) << 24) | ((inc_face & 0xff) << 16);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const ClipVertex& vertex = buffers[current][ii];
+			float separation = dot(reference._normal, vertex._position) - reference._offset;
+			if (separation <= margin)
+			{
+				ContactPoint& point = points[point_count++];
+				point._position = vertex._position - reference._normal * (0.5f * separation);
+				point._separation = separation;
+				point._id = face_id | vertex._id;
+				point._normal_impulse = 0.0f;
+				point._friction_impulse = Vec3(0.0f, 0.0f, 0.0f);
+			}
+		}
+
+		if (0 == point_count)
+		{
+			return false;
+		}
+
+		manifold._normal = flip ? -reference._normal : reference._normal;
+		if (ContactManifold::k_max_points < point_count)
+		{
+			reduceManifold(manifold, points, point_count);
+		}
+		else
+		{
+			manifold._count = point_count;
+			for (uint32_t ii = 0; ii < point_count; ++ii)
+			{
+				manifold._points[ii] = points[ii];
+			}
+		}
+		return true;
+	}
+
+	static bool collideHulls(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin, ContactManifold& manifold)
+	{
+		const ConvexHull& hull_a = a.getHull();
+		const ConvexHull& hull_b = b.getHull();
+		const Transform b_in_a = relativeTransform(xf_a, xf_b);
+		const Transform a_in_b = relativeTransform(xf_b, xf_a);
+
+		Vec3 b_vertices[ConvexHull::k_max_points];
+		Vec3 a_vertices[ConvexHull::k_max_points];
+		for (uint32_t ii = 0; ii < hull_b.getVertexCount(); ++ii)
+		{
+			b_vertices[ii] = transformPoint(b_in_a, hull_b.getVertices()[ii]);
+		}
+
+		FaceQuery face_a = queryFaces(hull_a, b_vertices, hull_b.getVertexCount());
+		if (face_a._separation > margin)
+		{
+			return false;
+		}
+
+		for (uint32_t ii = 0; ii < hull_a.getVertexCount(); ++ii)
+		{
+			a_vertices[ii] = transformPoint(a_in_b, hull_a.getVertices()[ii]);
+		}
+
+		FaceQuery face_b = queryFaces(hull_b, a_vertices, hull_a.getVertexCount());
+		if (face_b._separation > margin)
+		{
+			return false;
+		}
+
+		Vec3 b_normals[k_max_hull_faces];
+		for (uint32_t ii = 0; ii < hull_b.getFaceCount(); ++ii)
+		{
+			b_normals[ii] = rotate(b_in_a.q, hull_b.getFace(ii)._normal);
+		}
+
+		EdgeQuery edge = queryEdges(hull_a, hull_b, b_vertices, b_normals);
+		if (edge._separation > margin)
+		{
+			return false;
+		}
+
+		// faces win ties, they give more points and more stable ids
+		const float k_relative = 0.98f;
+		const float k_absolute = 0.001f;
+		float max_face = face_a._separation > face_b._separation ? face_a._separation : face_b._separation;
+		if (edge._separation > k_relative * max_face + k_absolute)
+		{
+			const HullEdge& edge_a = hull_a.getEdge(edge._edge_a);
+			const HullEdge& edge_b = hull_b.getEdge(edge._edge_b);
+			Vec3 pa, pb;
+			closestSegments(hull_a.getVertices()[edge_a._vertex[0]], hull_a.getVertices()[edge_a._vertex[1]],
+				b_vertices[edge_b._vertex[0]], b_vertices[edge_b._vertex[1]], pa, pb);
+
+			manifold._normal = rotate(xf_a.q, edge._normal);
+			manifold._count = 0;
+			addPoint(manifold, transformPoint(xf_a, (pa + pb) * 0.5f), edge._separation, 0x40000000 | (edge._edge_a << 8) | edge._edge_b);
+			return true;
+		}
+
+		if (face_b._separation > k_relative * face_a._separation + k_absolute)
+		{
+			Vec3 a_normals[k_max_hull_faces];
+			for (uint32_t ii = 0; ii < hull_a.getFaceCount(); ++ii)
+			{
+				a_normals[ii] = rotate(a_in_b.q, hull_a.getFace(ii)._normal);
+			}
+
+			if (!clipFaces(hull_b, face_b._face, hull_a, a_vertices, a_normals, margin, true, manifold))
+			{
+				return false;
+			}
+
+			manifold._normal = rotate(xf_b.q, manifold._normal);
+			for (uint32_t ii = 0; ii < manifold._count; ++ii)
+			{
+				manifold._points[ii]._position = transformPoint(xf_b, manifold._points[ii]._position);
+			}
+			return true;
+		}
+
+		if (!clipFaces(hull_a, face_a._face, hull_b, b_vertices, b_normals, margin, false, manifold))
+		{
+			return false;
+		}
+
+		manifold._normal = rotate(xf_a.q, manifold._normal);
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			manifold._points[ii]._position = transformPoint(xf_a, manifold._points[ii]._position);
+		}
+		return true;
+	}
+
+	static void copyPoints(ContactManifold& manifold, const ContactPoint* points, uint32_t count)
+	{
+		if (ContactManifold::k_max_points < count)
+		{
+			reduceManifold(manifold, points, count);
+			return;
+		}
+
+		manifold._count = count;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			manifold._points[ii] = points[ii];
+		}
+	}
+
+	// Clips a capsule segment to the sides of a triangle and adds its ends
+	// with the triangle as reference, as clipSegmentToFace() does for hulls.
+	static bool clipSegmentToTriangle(const Vec3* v, const Vec3& normal, Vec3 p0, Vec3 p1, float radius, float margin, ContactManifold& manifold)
+	{
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			const Vec3& v0 = v[ii];
+			Vec3 side = cross(v[(ii + 1) % 3] - v0, normal);
+			float d0 = dot(side, p0 - v0);
+			float d1 = dot(side, p1 - v0);
+			if (0.0f < d0 && 0.0f < d1)
+			{
+				return false;
+			}
+
+			if (0.0f < d0)
+			{
+				p0 = p0 + (p1 - p0) * (d0 / (d0 - d1));
+			}
+			else if (0.0f < d1)
+			{
+				p1 = p1 + (p0 - p1) * (d1 / (d1 - d0));
+			}
+		}
+
+		manifold._normal = -normal;
+		manifold._count = 0;
+		const Vec3 ends[2] = { p0, p1 };
+		for (uint32_t ii = 0; ii < 2; ++ii)
+		{
+			float separation = dot(normal, ends[ii] - v[0]) - radius;
+			if (separation <= margin)
+			{
+				addPoint(manifold, ends[ii] - normal * (radius + 0.5f * separation), separation, ii);
+			}
+		}
+		return 0 < manifold._count;
+	}
+
+	// true when point lies only on inactive edges of the triangle, bit ii of
+	// active_edges standing for the edge from v[ii] to the next vertex
+	static bool onInactiveEdge(const Vec3* v, uint32_t active_edges, const Vec3& point)
+	{
+		bool on_edge = false;
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			const Vec3 edge = v[(ii + 1) % 3] - v[ii];
+			const Vec3 closest = v[ii] + edge * clamp01(dot(point - v[ii], edge) / lengthSq(edge));
+			if (lengthSq(point - closest) <= k_edge_distance * k_edge_distance)
+			{
+				if (0 != (active_edges & (1 << ii)))
+				{
+					return false;
+				}
+				on_edge = true;
+			}
+		}
+		return on_edge;
+	}
+
+	// sphere or capsule core against a triangle with the given front normal, all in one space
+	static bool collideCoreTriangle(const Vec3* core, uint32_t core_count, float radius, const Vec3* v, const Vec3& normal, uint32_t active_edges,
+		float margin, ContactManifold& manifold, bool& flat)
+	{
+		flat = false;
+		const Transform identity(Vec3(0.0f, 0.0f, 0.0f), Quat::identity());
+		const GjkProxy core_proxy = { core, core_count, 0.0f };
+		const GjkProxy triangle_proxy = { v, 3, 0.0f };
+		GjkOutput output;
+		gjkDistance(core_proxy, identity, triangle_proxy, identity, output);
+		if (output._distance > radius + margin)
+		{
+			return false;
+		}
+
+		Vec3 direction = k_epsilon < output._distance ? (output._point_b - output._point_a) * (1.0f / output._distance) : -normal;
+		if (2 == core_count && -0.99f > dot(direction, normal))
+		{
+			// a capsule lying flat on the triangle gets both ends
+			Vec3 axis = core[1] - core[0];
+			float axis_dot = dot(axis, normal);
+			if (axis_dot * axis_dot < 0.0025f * lengthSq(axis)
+				&& clipSegmentToTriangle(v, normal, core[0], core[1], radius, margin, manifold))
+			{
+				flat = true;
+				return true;
+			}
+		}
+
+		manifold._count = 0;
+		if (k_epsilon < output._distance)
+		{
+			float separation = output._distance - radius;
+			if (-0.9999f < dot(direction, normal) && onInactiveEdge(v, active_edges, output._point_b))
+			{
+				// a seam inside a flat or concave stretch, the neighbour has the real contact
+				manifold._normal = -normal;
+				addPoint(manifold, output._point_b + normal * (0.5f * separation), separation, 0);
+				return true;
+			}
+
+			manifold._normal = direction;
+			addPoint(manifold, output._point_a + direction * (radius + 0.5f * separation), separation, 0);
+			return true;
+		}
+
+		// the core cuts the triangle, push out along its normal from the deeper end
+		const Vec3& point = 2 == core_count && dot(normal, core[1]) < dot(normal, core[0]) ? core[1] : core[0];
+		float separation = dot(normal, point - v[0]) - radius;
+		manifold._normal = -normal;
+		addPoint(manifold, point - normal * (radius + 0.5f * separation), separation, 0);
+		return true;
+	}
+
+	// hull against a triangle, both in the hull's space: SAT over the
+	// triangle normal, the hull faces and the edge pairs, then clipping
+	// against whichever face is the reference
+	static bool collideHullTriangle(const ConvexHull& hull, const Vec3* v, const Vec3& normal, uint32_t active_edges, float margin, ContactManifold& manifold)
+	{
+		const Vec3* vertices = hull.getVertices();
+
+		float triangle_separation = dot(normal, vertices[hull.getSupport(-normal)] - v[0]);
+		if (triangle_separation > margin)
+		{
+			return false;
+		}
+
+		FaceQuery face = queryFaces(hull, v, 3);
+		if (face._separation > margin)
+		{
+			return false;
+		}
+
+		EdgeQuery edge = { 0, 0, Vec3(0.0f, 0.0f, 0.0f), -1e30f };
+		for (uint32_t ii = 0; ii < hull.getEdgeCount(); ++ii)
+		{
+			const HullEdge& hull_edge = hull.getEdge(ii);
+			const Vec3& pa = vertices[hull_edge._vertex[0]];
+			const Vec3 da = vertices[hull_edge._vertex[1]] - pa;
+			for (uint32_t jj = 0; jj < 3; ++jj)
+			{
+				// inactive edges can't separate, the face next to them covers it
+				if (0 == (active_edges & (1 << jj)))
+				{
+					continue;
+				}
+
+				const Vec3 db = v[(jj + 1) % 3] - v[jj];
+				Vec3 axis = cross(da, db);
+				float len = length(axis);
+				if (len < 1e-5f * sqrtf(lengthSq(da) * lengthSq(db)))
+				{
+					continue;
+				}
+
+				axis *= 1.0f / len;
+				if (0.0f > dot(axis, pa))
+				{
+					axis = -axis;
+				}
+
+				float lowest = dot(axis, v[0]);
+				lowest = fminf(lowest, fminf(dot(axis, v[1]), dot(axis, v[2])));
+				float separation = lowest - dot(axis, vertices[hull.getSupport(axis)]);
+				if (separation > margin)
+				{
+					return false;
+				}
+
+				if (separation > edge._separation)
+				{
+					edge._edge_a = ii;
+					edge._edge_b = jj;
+					edge._normal = axis;
+					edge._separation = separation;
+				}
+			}
+		}
+
+		// the triangle face wins ties, it keeps sliding over seams smooth
+		const float k_relative = 0.98f;
+		const float k_absolute = 0.001f;
+		float max_face = face._separation > triangle_separation ? face._separation : triangle_separation;
+		if (edge._separation > k_relative * max_face + k_absolute)
+		{
+			const HullEdge& hull_edge = hull.getEdge(edge._edge_a);
+			Vec3 pa, pb;
+			closestSegments(vertices[hull_edge._vertex[0]], vertices[hull_edge._vertex[1]], v[edge._edge_b], v[(edge._edge_b + 1) % 3], pa, pb);
+
+			manifold._normal = edge._normal;
+			manifold._count = 0;
+			addPoint(manifold, (pa + pb) * 0.5f, edge._separation, 0x40000000 | (edge._edge_a << 8) | edge._edge_b);
+			return true;
+		}
+
+		ClipVertex buffers[2][k_max_clip_vertices];
+		ContactPoint points[k_max_clip_vertices];
+		uint32_t point_count = 0;
+		uint32_t current = 0;
+		uint32_t count;
+
+		if (face._separation > k_relative * triangle_separation + k_absolute)
+		{
+			// hull face as reference, the triangle clipped to its sides
+			const HullFace& reference = hull.getFace(face._face);
+			const uint8_t* indices = hull.getFaceVertices(reference);
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				buffers[0][ii]._position = v[ii];
+				buffers[0][ii]._id = ii;
+			}
+
+			count = 3;
+			for (uint32_t ii = 0; ii < reference._count && 0 < count; ++ii)
+			{
+				const Vec3& v0 = vertices[indices[ii]];
+				const Vec3& v1 = vertices[indices[(ii + 1) % reference._count]];
+				Vec3 side = normalize(cross(v1 - v0, reference._normal));
+				count = clipPolygon(buffers[current], count, side, dot(side, v0), ii, buffers[current ^ 1]);
+				current ^= 1;
+			}
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const ClipVertex& vertex = buffers[current][ii];
+				float separation = dot(reference._normal, vertex._position) - reference._offset;
+				if (separation <= margin)
+				{
+					ContactPoint& point = points[point_count++];
+					point._position = vertex._position - reference._normal * (0.5f * separation);
+					point._separation = separation;
+					point._id = 0x80000000 | ((face._face & 0x7f) << 24) | vertex._id;
+					point._normal_impulse = 0.0f;
+					point._friction_impulse = Vec3(0.0f, 0.0f, 0.0f);
+				}
+			}
+			manifold._normal = reference._normal;
+		}
+		else
+		{
+			// triangle as reference, the hull face most against it clipped to the triangle's sides
+			uint32_t incident = 0;
+			float lowest = dot(hull.getFace(0)._normal, normal);
+			for (uint32_t ii = 1; ii < hull.getFaceCount(); ++ii)
+			{
+				float value = dot(hull.getFace(ii)._normal, normal);
+				if (value < lowest)
+				{
+					lowest = value;
+					incident = ii;
+				}
+			}
+
+			const HullFace& incident_face = hull.getFace(incident);
+			const uint8_t* indices = hull.getFaceVertices(incident_face);
+			count = incident_face._count;
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				buffers[0][ii]._position = vertices[indices[ii]];
+				buffers[0][ii]._id = ii;
+			}
+
+			for (uint32_t ii = 0; ii < 3 && 0 < count; ++ii)
+			{
+				Vec3 side = normalize(cross(v[(ii + 1) % 3] - v[ii], normal));
+				count = clipPolygon(buffers[current], count, side, dot(side, v[ii]), ii, buffers[current ^ 1]);
+				current ^= 1;
+			}
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const ClipVertex& vertex = buffers[current][ii];
+				float separation = dot(normal, vertex._position - v[0]);
+				if (separation <= margin)
+				{
+					ContactPoint& point = points[point_count++];
+					point._position = vertex._position - normal * (0.5f * separation);
+					point._separation = separation;
+					point._id = ((incident & 0xff) << 16) | vertex._id;
+					point._normal_impulse = 0.0f;
+					point._friction_impulse = Vec3(0.0f, 0.0f, 0.0f);
+				}
+			}
+			manifold._normal = -normal;
+		}
+
+		if (0 == point_count)
+		{
+			return false;
+		}
+
+		copyPoints(manifold, points, point_count);
+		return true;
+	}
+
+	// Triangle manifolds of one shape, grouped by normal in mesh space. A
+	// sphere or capsule touches a surface at its deepest point, or at both
+	// ends when lying flat, as it would touch a box; keeping just those
+	// instead of a point per triangle keeps the ids steady.
+	struct MeshGroup
+	{
+		Vec3 _normal;               // of the deepest manifold in the group
+		float _deepest;
+		ContactPoint _points[k_max_group_points];
+		uint32_t _count;
+		ContactPoint _closest;      // FLT_MAX separation if none
+		ContactPoint _ends[2];      // of a flat capsule, furthest towards each end of the core
+		float _end_t[2];            // along the core, FLT_MAX and -FLT_MAX if none
+	};
+
+	struct MeshCollider
+	{
+		const CollisionShape* _shape;
+		Transform _xf;              // of the shape in mesh space
+		const CollisionMesh* _mesh;
+		float _margin;
+		MeshGroup _groups[k_max_mesh_manifolds];
+		uint32_t _group_count;
+		uint32_t _capacity;
+	};
+
+	static void addGroupPoint(MeshGroup& group, const ContactPoint& point)
+	{
+		// a point on an edge shared by two triangles would otherwise count twice
+		for (uint32_t ii = 0; ii < group._count; ++ii)
+		{
+			ContactPoint& other = group._points[ii];
+			if (lengthSq(other._position - point._position) <= k_weld_distance * k_weld_distance)
+			{
+				if (point._separation < other._separation)
+				{
+					other._position = point._position;
+					other._separation = point._separation;
+				}
+				return;
+			}
+		}
+
+		if (k_max_group_points == group._count)
+		{
+			ContactManifold reduced;
+			reduced._normal = group._normal;
+			reduceManifold(reduced, group._points, group._count);
+			group._count = reduced._count;
+			for (uint32_t ii = 0; ii < reduced._count; ++ii)
+			{
+				group._points[ii] = reduced._points[ii];
+			}
+		}
+
+		group._points[group._count++] = point;
+	}
+
+	static MeshGroup& findGroup(MeshCollider& collider, const ContactManifold& manifold)
+	{
+		float deepest = manifold._points[0]._separation;
+		for (uint32_t ii = 1; ii < manifold._count; ++ii)
+		{
+			deepest = fminf(deepest, manifold._points[ii]._separation);
+		}
+
+		uint32_t best = UINT32_MAX;
+		float best_dot = -2.0f;
+		for (uint32_t ii = 0; ii < collider._group_count; ++ii)
+		{
+			float value = dot(collider._groups[ii]._normal, manifold._normal);
+			if (value > best_dot)
+			{
+				best = ii;
+				best_dot = value;
+			}
+		}
+
+		if (k_group_dot > best_dot && collider._group_count < collider._capacity)
+		{
+			best = collider._group_count++;
+			MeshGroup& group = collider._groups[best];
+			group._normal = manifold._normal;
+			group._deepest = deepest;
+			group._count = 0;
+			group._closest._separation = FLT_MAX;
+			group._end_t[0] = FLT_MAX;
+			group._end_t[1] = -FLT_MAX;
+		}
+
+		MeshGroup& group = collider._groups[best];
+		if (deepest < group._deepest)
+		{
+			group._normal = manifold._normal;
+			group._deepest = deepest;
+		}
+		return group;
+	}
+
+	static void addHullManifold(MeshCollider& collider, const ContactManifold& manifold, uint32_t triangle)
+	{
+		MeshGroup& group = findGroup(collider, manifold);
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			ContactPoint point = manifold._points[ii];
+			point._id ^= triangle * 0x9e3779b1u;
+			addGroupPoint(group, point);
+		}
+	}
+
+	// a flat manifold has the ends of the clipped core, ids 0 and 1 for the sides of core[0] and core[1]
+	static void addCoreManifold(MeshCollider& collider, const ContactManifold& manifold, uint32_t triangle, bool flat, const Vec3& axis)
+	{
+		MeshGroup& group = findGroup(collider, manifold);
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			ContactPoint point = manifold._points[ii];
+			point._id ^= triangle * 0x9e3779b1u;
+			if (!flat)
+			{
+				if (point._separation < group._closest._separation)
+				{
+					group._closest = point;
+				}
+				continue;
+			}
+
+			const uint32_t end = manifold._points[ii]._id;
+			const float t = dot(axis, point._position);
+			if (0 == end ? t < group._end_t[0] : t > group._end_t[1])
+			{
+				group._ends[end] = point;
+				group._end_t[end] = t;
+			}
+		}
+	}
+
+	static void collideTriangle(void* data, uint32_t triangle)
+	{
+		MeshCollider& collider = *(MeshCollider*)data;
+		const CollisionShape& shape = *collider._shape;
+
+		Vec3 v[3];
+		getTriangle(*collider._mesh, triangle, v);
+		const Vec3 normal = normalize(cross(v[1] - v[0], v[2] - v[0]));
+
+		// one sided: whatever is behind the triangle is left alone
+		const Vec3 center = transformPoint(collider._xf, (shape.getCore()[0] + shape.getCore()[shape.getCoreCount() - 1]) * 0.5f);
+		if (0.0f > dot(normal, center - v[0]))
+		{
+			return;
+		}
+
+		const uint32_t active_edges = getActiveEdges(*collider._mesh, triangle);
+		ContactManifold manifold;
+		if (shape.isHull())
+		{
+			Vec3 local[3];
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				local[ii] = inverseTransformPoint(collider._xf, v[ii]);
+			}
+
+			if (!collideHullTriangle(shape.getHull(), local, inverseRotate(collider._xf.q, normal), active_edges, collider._margin, manifold))
+			{
+				return;
+			}
+
+			manifold._normal = rotate(collider._xf.q, manifold._normal);
+			for (uint32_t ii = 0; ii < manifold._count; ++ii)
+			{
+				manifold._points[ii]._position = transformPoint(collider._xf, manifold._points[ii]._position);
+			}
+		}
+		else
+		{
+			const uint32_t core_count = shape.getCoreCount();
+			Vec3 core[2];
+			core[0] = transformPoint(collider._xf, shape.getCore()[0]);
+			core[1] = transformPoint(collider._xf, shape.getCore()[core_count - 1]);
+			bool flat;
+			if (collideCoreTriangle(core, core_count, shape.getRadius(), v, normal, active_edges, collider._margin, manifold, flat))
+			{
+				addCoreManifold(collider, manifold, triangle, flat, core[1] - core[0]);
+			}
+			return;
+		}
+
+		addHullManifold(collider, manifold, triangle);
+	}
+
+	uint32_t collideMesh(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin,
+		ContactManifold* manifolds, uint32_t capacity)
+	{
+		MeshCollider collider;
+		collider._shape = &a;
+		collider._xf = relativeTransform(xf_b, xf_a);
+		collider._mesh = b.getMesh();
+		collider._margin = margin;
+		collider._group_count = 0;
+		collider._capacity = capacity < k_max_mesh_manifolds ? capacity : k_max_mesh_manifolds;
+
+		Aabb aabb;
+		a.computeAabb(collider._xf, aabb);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] -= margin;
+			aabb.m_max[axis] += margin;
+		}
+		queryMesh(*collider._mesh, aabb, collideTriangle, &collider);
+
+		for (uint32_t ii = 0; ii < collider._group_count; ++ii)
+		{
+			MeshGroup& group = collider._groups[ii];
+			if (FLT_MAX != group._end_t[0] || -FLT_MAX != group._end_t[1])
+			{
+				for (uint32_t jj = 0; jj < 2; ++jj)
+				{
+					if (FLT_MAX != fabsf(group._end_t[jj]))
+					{
+						addGroupPoint(group, group._ends[jj]);
+					}
+				}
+			}
+			else if (FLT_MAX != group._closest._separation)
+			{
+				addGroupPoint(group, group._closest);
+			}
+
+			ContactManifold& manifold = manifolds[ii];
+			manifold._normal = group._normal;
+			copyPoints(manifold, group._points, group._count);
+
+			manifold._normal = rotate(xf_b.q, manifold._normal);
+			for (uint32_t jj = 0; jj < manifold._count; ++jj)
+			{
+				manifold._points[jj]._position = transformPoint(xf_b, manifold._points[jj]._position);
+			}
+		}
+		return collider._group_count;
+	}
+
+	bool collideShapes(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin, ContactManifold& manifold)
+	{
+		// the simpler shape first; swapped results get their normal flipped
+		if (a.getType() > b.getType())
+		{
+			if (!collideShapes(b, xf_b, a, xf_a, margin, manifold))
+			{
+				return false;
+			}
+
+			manifold._normal = -manifold._normal;
+			return true;
+		}
+
+		if (ShapeType::Mesh == b.getType())
+		{
+			return ShapeType::Mesh != a.getType() && 0 < collideMesh(a, xf_a, b, xf_b, margin, &manifold, 1);
+		}
+
+		if (b.isHull())
+		{
+			return a.isHull()
+				? collideHulls(a, xf_a, b, xf_b, margin, manifold)
+				: collideCoreHull(a, xf_a, b, xf_b, margin, manifold);
+		}
+
+		const uint32_t last_a = a.getCoreCount() - 1;
+		const uint32_t last_b = b.getCoreCount() - 1;
+		return collideCores(
+			transformPoint(xf_a, a.getCore()[0]), transformPoint(xf_a, a.getCore()[last_a]), a.getRadius(),
+			transformPoint(xf_b, b.getCore()[0]), transformPoint(xf_b, b.getCore()[last_b]), b.getRadius(),
+			margin, manifold);
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef __MONSTER_NARROWPHASE_H__
+#define __MONSTER_NARROWPHASE_H__
+
+#include <cstdint>
+
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	class CollisionShape;
+
+	struct ContactPoint
+	{
+		Vec3 _position;             // midway between the surfaces, world space
+		float _separation;          // negative when penetrating
+		uint32_t _id;               // feature pair, stable while the contact persists
+		float _normal_impulse;      // accumulated by the solver, kept for warm starting
+		Vec3 _friction_impulse;
+	};
+
+	struct ContactManifold
+	{
+		static const uint32_t k_max_points = 4;
+
+		Vec3 _normal;               // world space, from a to b
+		ContactPoint _points[k_max_points];
+		uint32_t _count;
+	};
+
+	// Contact points of two shapes closer than margin, so speculative
+	// contacts are included. Impulses of the points are zero. Returns false
+	// when there are none.
+	bool collideShapes(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin, ContactManifold& manifold);
+
+	// Convex a against the triangles of mesh shape b. One manifold holds a
+	// single normal, so the triangles' contacts are grouped by normal into
+	// at most capacity manifolds, e.g. floor and wall for a box in a
+	// corner. Returns how many were written.
+	uint32_t collideMesh(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b, float margin,
+		ContactManifold* manifolds, uint32_t capacity);
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "physics/pair_set.h"
+
+#include "physics/state_stream.h"
+
+namespace monster
+{
+	const uint64_t PairSet::k_empty;
+
+	void PairSet::grow(uint32_t capacity)
+	{
+		std::vector<uint64_t> keys(capacity, k_empty);
+		std::vector<uint32_t> values(capacity);
+		_keys.swap(keys);
+		_values.swap(values);
+		_mask = capacity - 1;
+
+		for (uint32_t ii = 0; ii < keys.size(); ++ii)
+		{
+			if (k_empty == keys[ii])
+			{
+				continue;
+			}
+
+			uint32_t slot = hash(keys[ii]) & _mask;
+			while (k_empty != _keys[slot])
+			{
+				slot = (slot + 1) & _mask;
+			}
+			_keys[slot] = keys[ii];
+			_values[slot] = values[ii];
+		}
+	}
+
+	void PairSet::reserve(uint32_t count)
+	{
+		uint32_t capacity = 16;
+		while (capacity < 2 * count)
+		{
+			capacity *= 2;
+		}
+
+		if (capacity > _keys.size())
+		{
+			grow(capacity);
+		}
+	}
+
+	void PairSet::clear()
+	{
+		_keys.assign(_keys.size(), k_empty);
+		_count = 0;
+	}
+
+	uint32_t PairSet::find(uint32_t a, uint32_t b) const
+	{
+		if (0 == _count)
+		{
+			return k_not_found;
+		}
+
+		const uint64_t key = makeKey(a, b);
+		uint32_t slot = hash(key) & _mask;
+		while (k_empty != _keys[slot])
+		{
+			if (key == _keys[slot])
+			{
+				return _values[slot];
+			}
+			slot = (slot + 1) & _mask;
+		}
+		return k_not_found;
+	}
+
+	bool PairSet::insert(uint32_t a, uint32_t b, uint32_t value)
+	{
+		if (2 * (_count + 1) > _keys.size())
+		{
+			grow(_keys.empty() ? 16 : 2 * (uint32_t)_keys.size());
+		}
+
+		const uint64_t key = makeKey(a, b);
+		uint32_t slot = hash(key) & _mask;
+		while (k_empty != _keys[slot])
+		{
+			if (key == _keys[slot])
+			{
+				return false;
+			}
+			slot = (slot + 1) & _mask;
+		}
+
+		_keys[slot] = key;
+		_values[slot] = value;
+		++_count;
+		return true;
+	}
+
+	bool PairSet::erase(uint32_t a, uint32_t b)
+	{
+		if (0 == _count)
+		{
+			return false;
+		}
+
+		const uint64_t key = makeKey(a, b);
+		uint32_t slot = hash(key) & _mask;
+		while (key != _keys[slot])
+		{
+			if (k_empty == _keys[slot])
+			{
+				return false;
+			}
+			slot = (slot + 1) & _mask;
+		}
+
+		// shift back every following entry that probed past the hole
+		uint32_t hole = slot;
+		uint32_t next = (hole + 1) & _mask;
+		while (k_empty != _keys[next])
+		{
+			uint32_t home = hash(_keys[next]) & _mask;
+			if (((next - home) & _mask) >= ((next - hole) & _mask))
+			{
+				_keys[hole] = _keys[next];
+				_values[hole] = _values[next];
+				hole = next;
+			}
+			next = (next + 1) & _mask;
+		}
+
+		_keys[hole] = k_empty;
+		--_count;
+		return true;
+	}
+
+	void PairSet::saveState(StateWriter& writer) const
+	{
+		writer.write(_keys);
+		writer.write(_values);
+		writer.write(_count);
+		writer.write(_mask);
+	}
+
+	void PairSet::loadState(StateReader& reader)
+	{
+		reader.read(_keys);
+		reader.read(_values);
+		reader.read(_count);
+		reader.read(_mask);
+	}
+
+	bool PairSet::isValidState(uint32_t id_count, uint32_t value_count) const
+	{
+		// at most half full, or probing for a missing pair never ends
+		const uint32_t size = (uint32_t)_keys.size();
+		if (size != _values.size()
+			|| (0 < size && (0 != (size & (size - 1)) || size - 1 != _mask))
+			|| 2 * (uint64_t)_count > size)
+		{
+			return false;
+		}
+
+		uint32_t count = 0;
+		for (uint32_t ii = 0; ii < size; ++ii)
+		{
+			if (k_empty == _keys[ii])
+			{
+				continue;
+			}
+
+			const uint32_t a = (uint32_t)(_keys[ii] >> 32);
+			const uint32_t b = (uint32_t)_keys[ii];
+			if (a > b || b >= id_count || _values[ii] >= value_count)
+			{
+				return false;
+			}
+			++count;
+		}
+		return count == _count;
+	}
+}
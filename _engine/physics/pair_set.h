@@ -0,0 +1,71 @@
+#ifndef __MONSTER_PAIR_SET_H__
+#define __MONSTER_PAIR_SET_H__
+
+#include <cstdint>
+#include <vector>
+
+namespace monster
+{
+	class StateReader;
+	class StateWriter;
+
+	// Unordered id pairs mapped to a value, in one open addressing table
+	// with linear probing. Removal shifts the following entries back, so
+	// there are no tombstones, and the table only grows (doubling at half
+	// load), so inserting allocates nothing once it is large enough.
+	class PairSet
+	{
+	public:
+		static const uint32_t k_not_found = UINT32_MAX;
+
+	private:
+		static const uint64_t k_empty = UINT64_MAX;
+
+		std::vector<uint64_t> _keys;
+		std::vector<uint32_t> _values;
+		uint32_t _count;
+		uint32_t _mask;
+
+	private:
+		static uint64_t makeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+		}
+
+		static uint32_t hash(uint64_t key)
+		{
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdull;
+			key ^= key >> 33;
+			key *= 0xc4ceb9fe1a85ec53ull;
+			key ^= key >> 33;
+			return (uint32_t)key;
+		}
+
+		void grow(uint32_t capacity);
+
+	public:
+		PairSet() : _count(0), _mask(0) {}
+
+		void reserve(uint32_t count);
+		void clear();
+
+		uint32_t getCount() const { return _count; }
+
+		uint32_t find(uint32_t a, uint32_t b) const;
+
+		// Returns false, leaving the value alone, when the pair is already in.
+		bool insert(uint32_t a, uint32_t b, uint32_t value);
+
+		bool erase(uint32_t a, uint32_t b);
+
+		// The table as is, slots included, so lookups after loading probe
+		// exactly as before. isValidState() checks a loaded table: its
+		// shape, ids below id_count and values below value_count.
+		void saveState(StateWriter& writer) const;
+		void loadState(StateReader& reader);
+		bool isValidState(uint32_t id_count, uint32_t value_count) const;
+	};
+}
+
+#endif
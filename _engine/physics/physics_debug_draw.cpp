@@ -0,0 +1,205 @@
+#include "physics/physics_debug_draw.h"
+
+#include "physics/collision_shape.h"
+#include "physics/narrowphase.h"
+#include "physics/physics_manager.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace monster
+{
+	static const float k_pi = 3.14159265f;
+	static const uint32_t k_circle_segments = 16;
+	static const float k_normal_length = 0.2f;
+	static const uint32_t k_penetrating_color = 0xff2020ff;
+	static const uint32_t k_speculative_color = 0xff20ffff;
+
+	PhysicsDebugDraw::PhysicsDebugDraw()
+		: _used(0)
+	{
+		_decl.begin()
+			.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+			.add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Uint8, true)
+			.end();
+	}
+
+	void PhysicsDebugDraw::initialize(uint32_t max_lines)
+	{
+		_vertices.resize(max_lines * 2);
+		_used = 0;
+	}
+
+	void PhysicsDebugDraw::addLine(const Vec3& a, const Vec3& b, uint32_t abgr)
+	{
+		if (_used + 2 > _vertices.size())
+		{
+			return;
+		}
+
+		DebugVertex* vertices = &_vertices[_used];
+		memcpy(vertices[0]._position, &a, sizeof(vertices[0]._position));
+		memcpy(vertices[1]._position, &b, sizeof(vertices[1]._position));
+		vertices[0]._abgr = abgr;
+		vertices[1]._abgr = abgr;
+		_used += 2;
+	}
+
+	void PhysicsDebugDraw::addAabb(const Aabb& aabb, uint32_t abgr)
+	{
+		// corner ii takes max on the axes whose bit is set
+		Vec3 corners[8];
+		for (uint32_t ii = 0; ii < 8; ++ii)
+		{
+			corners[ii] = Vec3(ii & 1 ? aabb.m_max[0] : aabb.m_min[0], ii & 2 ? aabb.m_max[1] : aabb.m_min[1], ii & 4 ? aabb.m_max[2] : aabb.m_min[2]);
+		}
+
+		for (uint32_t ii = 0; ii < 8; ++ii)
+		{
+			for (uint32_t bit = 1; bit < 8; bit <<= 1)
+			{
+				if (0 == (ii & bit))
+				{
+					addLine(corners[ii], corners[ii | bit], abgr);
+				}
+			}
+		}
+	}
+
+	// arc of the circle center + (u cos t + v sin t) * radius
+	static void addArc(PhysicsDebugDraw& draw, const Vec3& center, const Vec3& u, const Vec3& v, float radius,
+		float begin, float end, uint32_t segments, uint32_t abgr)
+	{
+		const float step = (end - begin) / segments;
+		Vec3 previous = center + u * (cosf(begin) * radius) + v * (sinf(begin) * radius);
+		for (uint32_t ii = 1; ii <= segments; ++ii)
+		{
+			const float angle = begin + step * ii;
+			const Vec3 point = center + u * (cosf(angle) * radius) + v * (sinf(angle) * radius);
+			draw.addLine(previous, point, abgr);
+			previous = point;
+		}
+	}
+
+	void PhysicsDebugDraw::addShape(const CollisionShape& shape, const Transform& xf, uint32_t abgr)
+	{
+		const Vec3 x = rotate(xf.q, Vec3(1.0f, 0.0f, 0.0f));
+		const Vec3 y = rotate(xf.q, Vec3(0.0f, 1.0f, 0.0f));
+		const Vec3 z = rotate(xf.q, Vec3(0.0f, 0.0f, 1.0f));
+		const float radius = shape.getRadius();
+		switch (shape.getType())
+		{
+		case ShapeType::Sphere:
+			{
+				const Vec3 center = transformPoint(xf, shape.getCore()[0]);
+				addArc(*this, center, x, y, radius, 0.0f, 2.0f * k_pi, k_circle_segments, abgr);
+				addArc(*this, center, y, z, radius, 0.0f, 2.0f * k_pi, k_circle_segments, abgr);
+				addArc(*this, center, z, x, radius, 0.0f, 2.0f * k_pi, k_circle_segments, abgr);
+			}
+			break;
+
+		case ShapeType::Capsule:
+			{
+				// rings at both ends, four lines between them and a cap arc per side
+				const Vec3 bottom = transformPoint(xf, shape.getCore()[0]);
+				const Vec3 top = transformPoint(xf, shape.getCore()[1]);
+				addArc(*this, bottom, x, z, radius, 0.0f, 2.0f * k_pi, k_circle_segments, abgr);
+				addArc(*this, top, x, z, radius, 0.0f, 2.0f * k_pi, k_circle_segments, abgr);
+				addArc(*this, top, x, y, radius, 0.0f, k_pi, k_circle_segments / 2, abgr);
+				addArc(*this, top, z, y, radius, 0.0f, k_pi, k_circle_segments / 2, abgr);
+				addArc(*this, bottom, x, -y, radius, 0.0f, k_pi, k_circle_segments / 2, abgr);
+				addArc(*this, bottom, z, -y, radius, 0.0f, k_pi, k_circle_segments / 2, abgr);
+				addLine(bottom + x * radius, top + x * radius, abgr);
+				addLine(bottom - x * radius, top - x * radius, abgr);
+				addLine(bottom + z * radius, top + z * radius, abgr);
+				addLine(bottom - z * radius, top - z * radius, abgr);
+			}
+			break;
+
+		case ShapeType::Box:
+		case ShapeType::Convex:
+			{
+				const ConvexHull& hull = shape.getHull();
+				const Vec3* vertices = hull.getVertices();
+				for (uint32_t ii = 0; ii < hull.getEdgeCount(); ++ii)
+				{
+					const HullEdge& edge = hull.getEdge(ii);
+					addLine(transformPoint(xf, vertices[edge._vertex[0]]), transformPoint(xf, vertices[edge._vertex[1]]), abgr);
+				}
+			}
+			break;
+
+		case ShapeType::Mesh:
+			{
+				// every edge of a level is a lot of lines, the active ones outline it
+				const CollisionMesh& mesh = *shape.getMesh();
+				for (uint32_t ii = 0; ii < mesh._triangles.size(); ++ii)
+				{
+					const uint32_t active = getActiveEdges(mesh, ii);
+					if (0 == active)
+					{
+						continue;
+					}
+
+					Vec3 vertices[3];
+					getTriangle(mesh, ii, vertices);
+					for (uint32_t jj = 0; jj < 3; ++jj)
+					{
+						if (0 != (active & (1 << jj)))
+						{
+							addLine(transformPoint(xf, vertices[jj]), transformPoint(xf, vertices[(jj + 1) % 3]), abgr);
+						}
+					}
+				}
+			}
+			break;
+		}
+	}
+
+	void PhysicsDebugDraw::addManifold(const ContactManifold& manifold)
+	{
+		for (uint32_t ii = 0; ii < manifold._count; ++ii)
+		{
+			const ContactPoint& point = manifold._points[ii];
+			addLine(point._position, point._position + manifold._normal * k_normal_length,
+				0.0f > point._separation ? k_penetrating_color : k_speculative_color);
+		}
+	}
+
+	bool PhysicsDebugDraw::submit(uint8_t view, bgfx::ProgramHandle program)
+	{
+		if (0 == _used)
+		{
+			return true;
+		}
+
+		if (!bgfx::checkAvailTransientVertexBuffer(_used, _decl))
+		{
+			return false;
+		}
+
+		bgfx::TransientVertexBuffer tvb;
+		bgfx::allocTransientVertexBuffer(&tvb, _used, _decl);
+		memcpy(tvb.data, &_vertices[0], _used * sizeof(DebugVertex));
+
+		bgfx::setProgram(program);
+		bgfx::setVertexBuffer(&tvb);
+		bgfx::setState(BGFX_STATE_RGB_WRITE | BGFX_STATE_DEPTH_TEST_LEQUAL | BGFX_STATE_PT_LINES);
+		bgfx::submit(view);
+		return true;
+	}
+
+	uint16_t printPhysicsProfile(const PhysicsProfile& profile, uint16_t x, uint16_t y, uint8_t attr)
+	{
+		bgfx::dbgTextPrintf(x, y++, attr, "physics: %u steps %6.2f ms", profile._step_count, profile._step);
+		bgfx::dbgTextPrintf(x, y++, attr, "  broadphase %5.2f  narrowphase %5.2f  islands %5.2f  solve %5.2f  integrate %5.2f  continuous %5.2f",
+			profile._broadphase, profile._narrowphase, profile._islands, profile._solve, profile._integrate, profile._continuous);
+		bgfx::dbgTextPrintf(x, y++, attr, "  bodies %u (%u awake)  proxies %u  tree height %u",
+			profile._body_count, profile._awake_body_count, profile._proxy_count, profile._tree_height);
+		bgfx::dbgTextPrintf(x, y++, attr, "  pairs %u  manifolds %u  points %u",
+			profile._pair_count, profile._manifold_count, profile._point_count);
+		bgfx::dbgTextPrintf(x, y++, attr, "  islands %u (%u awake, %u colored)  largest awake %u bodies",
+			profile._island_count, profile._awake_island_count, profile._colored_island_count, profile._largest_island);
+		return y;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __MONSTER_PHYSICS_DEBUG_DRAW_H__
+#define __MONSTER_PHYSICS_DEBUG_DRAW_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "bgfx.h"
+#include "bounds.h"
+
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	class CollisionShape;
+	struct ContactManifold;
+	struct PhysicsProfile;
+
+	enum PhysicsDebugFlags : uint32_t
+	{
+		k_debug_draw_none     = 0,
+		k_debug_draw_shapes   = 0x1,   // colored by body type, darker while asleep; meshes show their active edges
+		k_debug_draw_contacts = 0x2,   // a normal per point, red when penetrating
+		k_debug_draw_bounds   = 0x4,   // fat broadphase boxes
+		k_debug_draw_tree     = 0x8,   // inner dynamic tree nodes, colored by depth
+	};
+
+	struct DebugVertex
+	{
+		float _position[3];
+		uint32_t _abgr;
+	};
+
+	// Lines of one frame's physics debug view. Anything may add lines
+	// during the frame, PhysicsManager::debugDraw() among them, and
+	// submit() copies them into a single transient vertex buffer drawn by
+	// one submit. Lines past the capacity are dropped rather than grown
+	// into, so a frame never allocates.
+	class PhysicsDebugDraw
+	{
+	private:
+		std::vector<DebugVertex> _vertices;
+		uint32_t _used;
+		bgfx::VertexDecl _decl;
+
+	public:
+		PhysicsDebugDraw();
+
+		PhysicsDebugDraw(const PhysicsDebugDraw&) = delete;
+		PhysicsDebugDraw& operator = (const PhysicsDebugDraw&) = delete;
+
+		// The lines share bgfx's transient vertex memory with the rest of
+		// the frame, 16 bytes a vertex.
+		void initialize(uint32_t max_lines);
+
+		void reset() { _used = 0; }
+		uint32_t getLineCount() const { return _used / 2; }
+
+		void addLine(const Vec3& a, const Vec3& b, uint32_t abgr);
+		void addAabb(const Aabb& aabb, uint32_t abgr);
+		void addShape(const CollisionShape& shape, const Transform& xf, uint32_t abgr);
+		void addManifold(const ContactManifold& manifold);
+
+		// Draws the lines on view with a position and color program.
+		// Returns false when the transient memory can't take them this
+		// frame, in which case nothing is drawn.
+		bool submit(uint8_t view, bgfx::ProgramHandle program);
+	};
+
+	// Prints the profile with the debug text overlay from row y down and
+	// returns the row below it.
+	uint16_t printPhysicsProfile(const PhysicsProfile& profile, uint16_t x, uint16_t y, uint8_t attr = 0x0f);
+}
+
+#endif
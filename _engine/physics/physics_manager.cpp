@@ -1,12 +1,2394 @@
 #include "physics/physics_manager.h"
 
+#include "physics/physics_debug_draw.h"
+#include "physics/state_stream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <bx/timer.h>
+#include <bx/uint32_t.h>
+
 namespace monster
 {
-	void PhysicsManager::initialize()
+	static const float k_speculative_distance = 0.02f;
+	static const uint32_t k_max_mesh_manifolds = 4;
+	static const float k_contact_hertz = 30.0f;
+	static const float k_contact_damping_ratio = 10.0f;
+	static const float k_max_push_velocity = 3.0f;
+	static const float k_restitution_threshold = 1.0f;
+
+	static const float k_sleep_linear_velocity = 0.05f;
+	static const float k_sleep_angular_velocity = 0.1f;
+	static const float k_time_to_sleep = 0.5f;
+
+	// islands with at least this many contacts are colored and solved a color at a time
+	static const uint32_t k_min_colored_contacts = 256;
+	static const uint32_t k_color_count = 32;       // one bit each in _color_mask
+	static const uint32_t k_island_batch = 32;      // small islands taken through the solver stages together
+	static const uint32_t k_body_grain = 128;
+	static const uint32_t k_contact_grain = 64;
+	static const uint32_t k_packet_grain = 16;      // four rays each
+	static const uint32_t k_query_grain = 16;
+
+	static const float k_character_skin = 0.01f;    // gap kept to the world, above the cast tolerance
+	static const uint32_t k_max_slide_iterations = 4;
+	static const uint32_t k_character_grain = 8;
+	static const float k_edge_inset = 0.02f;        // how far past an edge its face is probed
+	static const float k_edge_probe = 0.05f;
+
+	static const float k_fast_motion = 0.5f;        // of the smallest half extent, slower fast bodies aren't swept
+	static const float k_fast_skin = 0.005f;        // gap left to the hit, inside the speculative distance
+	static const uint32_t k_fast_grain = 32;
+
+	static const uint32_t k_state_magic = 0x54535950;  // "PYST"
+	static const uint32_t k_state_version = 5;
+
+	// debug draw colors, abgr
+	static const uint32_t k_static_color = 0xff808080;
+	static const uint32_t k_kinematic_color = 0xffff8040;
+	static const uint32_t k_awake_color = 0xff40ff40;
+	static const uint32_t k_sleeping_color = 0xff207020;
+	static const uint32_t k_bounds_color = 0xff40c0ff;
+	static const uint32_t k_tree_colors[] = { 0xffffffff, 0xffff40ff, 0xffffff40, 0xff40ffff, 0xff4080ff, 0xffff8080 };
+	static const uint32_t k_tree_color_count = sizeof(k_tree_colors) / sizeof(k_tree_colors[0]);
+
+	BodyDesc::BodyDesc()
+		: _shape(nullptr)
+		, _type(BodyType::Dynamic)
+		, _density(1000.0f)
+		, _friction(0.6f)
+		, _restitution(0.0f)
+		, _linear_damping(0.0f)
+		, _angular_damping(0.05f)
+		, _is_fast(false)
+	{
+		memset(_position, 0, sizeof(_position));
+		memset(_linear_velocity, 0, sizeof(_linear_velocity));
+		memset(_angular_velocity, 0, sizeof(_angular_velocity));
+		_rotation[0] = _rotation[1] = _rotation[2] = 0.0f;
+		_rotation[3] = 1.0f;
+	}
+
+	template <class T>
+	static void removeAt(std::vector<T>& data, uint32_t index)
+	{
+		data[index] = data.back();
+		data.pop_back();
+	}
+
+	CharacterDesc::CharacterDesc()
+		: _shape(nullptr)
+		, _max_slope(0.7854f)
+		, _step_height(0.3f)
+		, _snap_distance(0.2f)
 	{
+		memset(_position, 0, sizeof(_position));
 	}
-	
+
+	PhysicsManager::PhysicsManager()
+		: _fast_count(0)
+		, _broadphase(&_tree)
+		, _broadphase_type(BroadphaseType::DynamicTree)
+		, _job_system(nullptr)
+		, _gravity(0.0f, -9.81f, 0.0f)
+		, _fixed_dt(1.0f / 60.0f)
+		, _accumulator(0.0f)
+		, _substep_count(4)
+		, _times()
+		, _solve_ticks(0)
+		, _integrate_ticks(0)
+		, _profiling(false)
+	{
+	}
+
+	void PhysicsManager::initialize(JobSystem* job_system)
+	{
+		clear();
+		_job_system = job_system;
+		_gravity = Vec3(0.0f, -9.81f, 0.0f);
+		_fixed_dt = 1.0f / 60.0f;
+		_substep_count = 4;
+		_profiling = false;
+	}
+
 	void PhysicsManager::clear()
 	{
+		_position.clear();
+		_rotation.clear();
+		_linear_velocity.clear();
+		_angular_velocity.clear();
+		_force.clear();
+		_torque.clear();
+		_inv_mass.clear();
+		_inv_inertia_local.clear();
+		_inv_inertia.clear();
+		_shape.clear();
+		_type.clear();
+		_friction.clear();
+		_restitution.clear();
+		_linear_damping.clear();
+		_angular_damping.clear();
+		_sleep_time.clear();
+		_awake.clear();
+		_fast.clear();
+		_aabb.clear();
+		_proxy.clear();
+		_handle.clear();
+		_body.clear();
+		_free_handles.clear();
+		_fast_count = 0;
+		_characters.clear();
+		_character_handle.clear();
+		_character_index.clear();
+		_free_character_handles.clear();
+		_tree.clear();
+		_sweep_and_prune.clear();
+		_contacts.clear();
+		_free_contacts.clear();
+		_contact_map.clear();
+		_first_contact.clear();
+		_touching.clear();
+		_constraints.clear();
+		_islands.clear();
+		_small_islands.clear();
+		_colored_islands.clear();
+		_accumulator = 0.0f;
+		_times = StepTimes();
+	}
+
+	void PhysicsManager::reserve(uint32_t body_count)
+	{
+		_position.reserve(body_count);
+		_rotation.reserve(body_count);
+		_linear_velocity.reserve(body_count);
+		_angular_velocity.reserve(body_count);
+		_force.reserve(body_count);
+		_torque.reserve(body_count);
+		_inv_mass.reserve(body_count);
+		_inv_inertia_local.reserve(body_count);
+		_inv_inertia.reserve(body_count);
+		_shape.reserve(body_count);
+		_type.reserve(body_count);
+		_friction.reserve(body_count);
+		_restitution.reserve(body_count);
+		_linear_damping.reserve(body_count);
+		_angular_damping.reserve(body_count);
+		_sleep_time.reserve(body_count);
+		_awake.reserve(body_count);
+		_fast.reserve(body_count);
+		_aabb.reserve(body_count);
+		_proxy.reserve(body_count);
+		_handle.reserve(body_count);
+		_body.reserve(body_count);
+		_generation.reserve(body_count);
+		_first_contact.reserve(body_count);
+		_delta_position.reserve(body_count);
+		_delta_rotation.reserve(body_count);
+	}
+
+	void PhysicsManager::setTimestep(float fixed_dt, uint32_t substep_count)
+	{
+		assert(0.0f < fixed_dt && 0 < substep_count);
+		_fixed_dt = fixed_dt;
+		_substep_count = substep_count;
+	}
+
+	void PhysicsManager::setBroadphase(BroadphaseType type)
+	{
+		if (type == _broadphase_type)
+		{
+			return;
+		}
+
+		_broadphase->clear();
+		_broadphase_type = type;
+		_broadphase = BroadphaseType::DynamicTree == type ? (Broadphase*)&_tree : (Broadphase*)&_sweep_and_prune;
+
+		// the new broadphase reports the existing pairs again, the contact map drops them
+		for (uint32_t ii = 0; ii < _handle.size(); ++ii)
+		{
+			_proxy[ii] = _broadphase->createProxy(_aabb[ii], _handle[ii], BodyType::Static == _type[ii]);
+		}
+	}
+
+	BodyHandle PhysicsManager::createBody(const BodyDesc& desc)
+	{
+		assert(nullptr != desc._shape);
+		assert(ShapeType::Mesh != desc._shape->getType() || BodyType::Static == desc._type);
+
+		uint32_t handle;
+		if (_free_handles.empty())
+		{
+			handle = (uint32_t)_body.size();
+			_body.push_back(0);
+			_first_contact.push_back(UINT32_MAX);
+			if (_generation.size() == handle)
+			{
+				_generation.push_back(0);
+			}
+		}
+		else
+		{
+			handle = _free_handles.back();
+			_free_handles.pop_back();
+		}
+
+		uint32_t index = (uint32_t)_handle.size();
+		_body[handle] = index;
+		_handle.push_back(handle);
+
+		const CollisionShape& shape = *desc._shape;
+		float inv_mass = 0.0f;
+		Mat3 inv_inertia = Mat3::zero();
+		if (BodyType::Dynamic == desc._type)
+		{
+			float mass = desc._density * shape.getVolume();
+			inv_mass = 0.0f < mass ? 1.0f / mass : 0.0f;
+			const Mat3& unit = shape.getUnitInertia();
+			Mat3 inertia;
+			inertia.c[0] = unit.c[0] * mass;
+			inertia.c[1] = unit.c[1] * mass;
+			inertia.c[2] = unit.c[2] * mass;
+			inv_inertia = inverse(inertia);
+		}
+
+		Quat rotation = normalize(Quat(desc._rotation[0], desc._rotation[1], desc._rotation[2], desc._rotation[3]));
+		_position.push_back(Vec3(desc._position));
+		_rotation.push_back(rotation);
+		_linear_velocity.push_back(BodyType::Static == desc._type ? Vec3(0.0f, 0.0f, 0.0f) : Vec3(desc._linear_velocity));
+		_angular_velocity.push_back(BodyType::Static == desc._type ? Vec3(0.0f, 0.0f, 0.0f) : Vec3(desc._angular_velocity));
+		_force.push_back(Vec3(0.0f, 0.0f, 0.0f));
+		_torque.push_back(Vec3(0.0f, 0.0f, 0.0f));
+		_inv_mass.push_back(inv_mass);
+		_inv_inertia_local.push_back(inv_inertia);
+		_inv_inertia.push_back(Mat3::zero());
+		_shape.push_back(&shape);
+		_type.push_back(desc._type);
+		_friction.push_back(desc._friction);
+		_restitution.push_back(desc._restitution);
+		_linear_damping.push_back(desc._linear_damping);
+		_angular_damping.push_back(desc._angular_damping);
+		_sleep_time.push_back(0.0f);
+		_awake.push_back(BodyType::Static == desc._type ? 0 : 1);
+		_fast.push_back(BodyType::Dynamic == desc._type && desc._is_fast ? 1 : 0);
+		_fast_count += _fast.back();
+
+		_aabb.push_back(Aabb());
+		computeAabb(index);
+		_proxy.push_back(_broadphase->createProxy(_aabb[index], handle, BodyType::Static == desc._type));
+
+		return makeHandle(handle);
+	}
+
+	void PhysicsManager::destroyBody(BodyHandle handle)
+	{
+		if (!isAlive(handle))
+		{
+			return;
+		}
+
+		uint32_t index = getBody(handle);
+		uint32_t last = (uint32_t)_handle.size() - 1;
+
+		// a recycled handle must not pick up the old contacts, and whatever rested on the body falls
+		while (UINT32_MAX != _first_contact[handle.idx])
+		{
+			const uint32_t contact = _first_contact[handle.idx];
+			const uint32_t other = _contacts[contact]._a == handle.idx ? _contacts[contact]._b : _contacts[contact]._a;
+			for (uint32_t ii = contact; UINT32_MAX != ii; ii = _contacts[ii]._next)
+			{
+				if (0 < _contacts[ii]._manifold._count)
+				{
+					wake(_body[other]);
+					break;
+				}
+			}
+
+			// extras go with the head of their chain
+			destroyContact(contact);
+		}
+		_broadphase->destroyProxy(_proxy[index]);
+
+		removeAt(_position, index);
+		removeAt(_rotation, index);
+		removeAt(_linear_velocity, index);
+		removeAt(_angular_velocity, index);
+		removeAt(_force, index);
+		removeAt(_torque, index);
+		removeAt(_inv_mass, index);
+		removeAt(_inv_inertia_local, index);
+		removeAt(_inv_inertia, index);
+		removeAt(_shape, index);
+		removeAt(_type, index);
+		removeAt(_friction, index);
+		removeAt(_restitution, index);
+		removeAt(_linear_damping, index);
+		removeAt(_angular_damping, index);
+		removeAt(_sleep_time, index);
+		_fast_count -= _fast[index];
+		removeAt(_awake, index);
+		removeAt(_fast, index);
+		removeAt(_aabb, index);
+		removeAt(_proxy, index);
+		removeAt(_handle, index);
+
+		if (index != last)
+		{
+			_body[_handle[index]] = index;
+		}
+		_body[handle.idx] = UINT32_MAX;
+		++_generation[handle.idx];
+		_free_handles.push_back(handle.idx);
+
+		for (Character& character : _characters)
+		{
+			if (character._ground == handle.idx)
+			{
+				character._ground = UINT32_MAX;
+			}
+		}
+	}
+
+	bool PhysicsManager::isAlive(BodyHandle handle) const
+	{
+		return handle.idx < _body.size()
+			&& UINT32_MAX != _body[handle.idx]
+			&& _generation[handle.idx] == handle.generation;
+	}
+
+	void PhysicsManager::getPosition(BodyHandle handle, float position[3]) const
+	{
+		memcpy(position, &_position[getBody(handle)], sizeof(float) * 3);
+	}
+
+	void PhysicsManager::getRotation(BodyHandle handle, float rotation[4]) const
+	{
+		memcpy(rotation, &_rotation[getBody(handle)], sizeof(float) * 4);
+	}
+
+	void PhysicsManager::setTransform(BodyHandle handle, const float position[3], const float rotation[4])
+	{
+		uint32_t index = getBody(handle);
+		_position[index] = Vec3(position);
+		_rotation[index] = normalize(Quat(rotation[0], rotation[1], rotation[2], rotation[3]));
+		computeAabb(index);
+		wake(index);
+
+		const float no_displacement[3] = { 0.0f, 0.0f, 0.0f };
+		_broadphase->moveProxy(_proxy[index], _aabb[index], no_displacement);
+	}
+
+	void PhysicsManager::getLinearVelocity(BodyHandle handle, float velocity[3]) const
+	{
+		memcpy(velocity, &_linear_velocity[getBody(handle)], sizeof(float) * 3);
+	}
+
+	void PhysicsManager::setLinearVelocity(BodyHandle handle, const float velocity[3])
+	{
+		uint32_t index = getBody(handle);
+		if (BodyType::Static != _type[index])
+		{
+			_linear_velocity[index] = Vec3(velocity);
+			wake(index);
+		}
+	}
+
+	void PhysicsManager::getAngularVelocity(BodyHandle handle, float velocity[3]) const
+	{
+		memcpy(velocity, &_angular_velocity[getBody(handle)], sizeof(float) * 3);
+	}
+
+	void PhysicsManager::setAngularVelocity(BodyHandle handle, const float velocity[3])
+	{
+		uint32_t index = getBody(handle);
+		if (BodyType::Static != _type[index])
+		{
+			_angular_velocity[index] = Vec3(velocity);
+			wake(index);
+		}
+	}
+
+	void PhysicsManager::applyForce(BodyHandle handle, const float force[3])
+	{
+		uint32_t index = getBody(handle);
+		_force[index] += Vec3(force);
+		wake(index);
+	}
+
+	void PhysicsManager::applyTorque(BodyHandle handle, const float torque[3])
+	{
+		uint32_t index = getBody(handle);
+		_torque[index] += Vec3(torque);
+		wake(index);
+	}
+
+	void PhysicsManager::applyImpulse(BodyHandle handle, const float impulse[3], const float point[3])
+	{
+		uint32_t index = getBody(handle);
+		Vec3 p(impulse);
+		Mat3 inv_inertia = toMatrix(_rotation[index]) * _inv_inertia_local[index] * transpose(toMatrix(_rotation[index]));
+		_linear_velocity[index] += p * _inv_mass[index];
+		_angular_velocity[index] += inv_inertia * cross(Vec3(point) - _position[index], p);
+		wake(index);
+	}
+
+	void PhysicsManager::wakeBody(BodyHandle handle)
+	{
+		wake(getBody(handle));
+	}
+
+	SolverBodies PhysicsManager::getSolverBodies()
+	{
+		SolverBodies bodies;
+		bodies._linear_velocity = &_linear_velocity[0];
+		bodies._angular_velocity = &_angular_velocity[0];
+		bodies._delta_position = &_delta_position[0];
+		bodies._delta_rotation = &_delta_rotation[0];
+		bodies._inv_mass = &_inv_mass[0];
+		bodies._inv_inertia = &_inv_inertia[0];
+		return bodies;
+	}
+
+	void PhysicsManager::computeAabb(uint32_t index)
+	{
+		Aabb& aabb = _aabb[index];
+		_shape[index]->computeAabb(Transform(_position[index], _rotation[index]), aabb);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] -= k_speculative_distance;
+			aabb.m_max[axis] += k_speculative_distance;
+		}
+	}
+
+	void PhysicsManager::wake(uint32_t index)
+	{
+		if (BodyType::Static != _type[index])
+		{
+			_awake[index] = 1;
+			_sleep_time[index] = 0.0f;
+		}
+	}
+
+	uint32_t PhysicsManager::createContact(uint32_t a, uint32_t b)
+	{
+		uint32_t contact;
+		if (_free_contacts.empty())
+		{
+			contact = (uint32_t)_contacts.size();
+			_contacts.push_back(Contact());
+		}
+		else
+		{
+			contact = _free_contacts.back();
+			_free_contacts.pop_back();
+		}
+
+		Contact& data = _contacts[contact];
+		data._a = a;
+		data._b = b;
+		data._next = UINT32_MAX;
+		data._next_link[0] = UINT32_MAX;
+		data._next_link[1] = UINT32_MAX;
+		data._prev_link[0] = UINT32_MAX;
+		data._prev_link[1] = UINT32_MAX;
+		data._is_extra = false;
+		data._manifold._count = 0;
+		return contact;
+	}
+
+	void PhysicsManager::destroyContact(uint32_t contact)
+	{
+		if (!_contacts[contact]._is_extra)
+		{
+			_contact_map.erase(_contacts[contact]._a, _contacts[contact]._b);
+			unlinkContact(contact);
+		}
+
+		while (UINT32_MAX != contact)
+		{
+			Contact& data = _contacts[contact];
+			data._a = UINT32_MAX;
+			data._b = UINT32_MAX;
+			_free_contacts.push_back(contact);
+			contact = data._next;
+		}
+	}
+
+	// a static ground can be in thousands of contacts, so the lists are
+	// doubly linked and a contact leaves them without a walk
+	void PhysicsManager::linkContact(uint32_t contact)
+	{
+		Contact& data = _contacts[contact];
+		for (uint32_t side = 0; side < 2; ++side)
+		{
+			const uint32_t handle = 0 == side ? data._a : data._b;
+			const uint32_t next = _first_contact[handle];
+			if (UINT32_MAX != next)
+			{
+				Contact& next_data = _contacts[next];
+				next_data._prev_link[handle == next_data._a ? 0 : 1] = contact;
+			}
+			data._next_link[side] = next;
+			data._prev_link[side] = UINT32_MAX;
+			_first_contact[handle] = contact;
+		}
+	}
+
+	void PhysicsManager::unlinkContact(uint32_t contact)
+	{
+		const Contact& data = _contacts[contact];
+		for (uint32_t side = 0; side < 2; ++side)
+		{
+			const uint32_t handle = 0 == side ? data._a : data._b;
+			const uint32_t next = data._next_link[side];
+			const uint32_t prev = data._prev_link[side];
+			if (UINT32_MAX == prev)
+			{
+				_first_contact[handle] = next;
+			}
+			else
+			{
+				Contact& prev_data = _contacts[prev];
+				prev_data._next_link[handle == prev_data._a ? 0 : 1] = next;
+			}
+
+			if (UINT32_MAX != next)
+			{
+				Contact& next_data = _contacts[next];
+				next_data._prev_link[handle == next_data._a ? 0 : 1] = prev;
+			}
+		}
+	}
+
+	void PhysicsManager::findPairs(float h)
+	{
+		const uint32_t body_count = (uint32_t)_handle.size();
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			if (0 != _awake[ii])
+			{
+				const Vec3 displacement = _linear_velocity[ii] * h;
+				_broadphase->moveProxy(_proxy[ii], _aabb[ii], &displacement.x);
+			}
+		}
+
+		_new_pairs.clear();
+		_broadphase->updatePairs(_new_pairs);
+
+		for (const ProxyPair& pair : _new_pairs)
+		{
+			if (BodyType::Dynamic != _type[_body[pair._a]] && BodyType::Dynamic != _type[_body[pair._b]])
+			{
+				continue;
+			}
+
+			// pairs come again while they keep overlapping
+			if (PairSet::k_not_found != _contact_map.find(pair._a, pair._b))
+			{
+				continue;
+			}
+
+			const uint32_t contact = createContact(pair._a, pair._b);
+			_contact_map.insert(pair._a, pair._b, contact);
+			linkContact(contact);
+		}
+	}
+
+	void PhysicsManager::collide()
+	{
+		_touching.clear();
+		for (uint32_t ii = 0; ii < _contacts.size(); ++ii)
+		{
+			Contact& contact = _contacts[ii];
+			if (UINT32_MAX == contact._a || contact._is_extra)
+			{
+				continue;
+			}
+
+			const uint32_t a = _body[contact._a];
+			const uint32_t b = _body[contact._b];
+
+			// nothing moved, the manifolds from before they fell asleep still hold
+			if (0 == _awake[a] && 0 == _awake[b])
+			{
+				for (uint32_t jj = ii; UINT32_MAX != jj; jj = _contacts[jj]._next)
+				{
+					if (0 < _contacts[jj]._manifold._count)
+					{
+						_touching.push_back(jj);
+					}
+				}
+				continue;
+			}
+
+			if (!_broadphase->testOverlap(_proxy[a], _proxy[b]))
+			{
+				destroyContact(ii);
+				continue;
+			}
+
+			if (ShapeType::Mesh == _shape[a]->getType() || ShapeType::Mesh == _shape[b]->getType())
+			{
+				collideMesh(ii);
+				continue;
+			}
+
+			// the fat boxes overlap for a while before the bodies get close
+			ContactManifold manifold;
+			if (!aabbOverlap(_aabb[a], _aabb[b])
+			|| !collideShapes(*_shape[a], Transform(_position[a], _rotation[a]), *_shape[b], Transform(_position[b], _rotation[b]),
+				k_speculative_distance, manifold))
+			{
+				contact._manifold._count = 0;
+				continue;
+			}
+
+			const ContactManifold& old = contact._manifold;
+			for (uint32_t jj = 0; jj < manifold._count; ++jj)
+			{
+				ContactPoint& point = manifold._points[jj];
+				for (uint32_t kk = 0; kk < old._count; ++kk)
+				{
+					if (old._points[kk]._id == point._id)
+					{
+						point._normal_impulse = old._points[kk]._normal_impulse;
+						point._friction_impulse = old._points[kk]._friction_impulse;
+						break;
+					}
+				}
+			}
+
+			contact._manifold = manifold;
+			_touching.push_back(ii);
+		}
+	}
+
+	void PhysicsManager::collideMesh(uint32_t contact)
+	{
+		const uint32_t a = _body[_contacts[contact]._a];
+		const uint32_t b = _body[_contacts[contact]._b];
+		const bool flip = ShapeType::Mesh == _shape[a]->getType();
+		const uint32_t convex = flip ? b : a;
+		const uint32_t mesh = flip ? a : b;
+
+		ContactManifold manifolds[k_max_mesh_manifolds];
+		uint32_t count = 0;
+		if (aabbOverlap(_aabb[a], _aabb[b]))
+		{
+			count = monster::collideMesh(*_shape[convex], getTransform(convex), *_shape[mesh], getTransform(mesh),
+				k_speculative_distance, manifolds, k_max_mesh_manifolds);
+		}
+
+		// points keep their impulses whichever manifold of the chain they move to
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			ContactManifold& manifold = manifolds[ii];
+			manifold._normal = flip ? -manifold._normal : manifold._normal;
+			for (uint32_t jj = 0; jj < manifold._count; ++jj)
+			{
+				ContactPoint& point = manifold._points[jj];
+				for (uint32_t old = contact; UINT32_MAX != old; old = _contacts[old]._next)
+				{
+					const ContactManifold& previous = _contacts[old]._manifold;
+					uint32_t kk = 0;
+					while (kk < previous._count && previous._points[kk]._id != point._id)
+					{
+						++kk;
+					}
+
+					if (kk < previous._count)
+					{
+						point._normal_impulse = previous._points[kk]._normal_impulse;
+						point._friction_impulse = previous._points[kk]._friction_impulse;
+						break;
+					}
+				}
+			}
+		}
+
+		// one manifold per link, growing the chain as needed and dropping what is left over
+		_contacts[contact]._manifold._count = 0;
+		uint32_t last = contact;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			if (0 < ii)
+			{
+				if (UINT32_MAX == _contacts[last]._next)
+				{
+					const uint32_t extra = createContact(_contacts[contact]._a, _contacts[contact]._b);
+					_contacts[extra]._is_extra = true;
+					_contacts[last]._next = extra;
+				}
+				last = _contacts[last]._next;
+			}
+
+			_contacts[last]._manifold = manifolds[ii];
+			_touching.push_back(last);
+		}
+
+		const uint32_t rest = _contacts[last]._next;
+		if (UINT32_MAX != rest)
+		{
+			_contacts[last]._next = UINT32_MAX;
+			destroyContact(rest);
+		}
+	}
+
+	uint32_t PhysicsManager::findRoot(uint32_t index)
+	{
+		uint32_t* parent = &_island_parent[0];
+		while (parent[index] != index)
+		{
+			parent[index] = parent[parent[index]];
+			index = parent[index];
+		}
+		return index;
+	}
+
+	void PhysicsManager::buildIslands()
+	{
+		const uint32_t body_count = (uint32_t)_handle.size();
+		_island_parent.resize(body_count);
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			_island_parent[ii] = ii;
+		}
+
+		// the lower root wins, so islands don't depend on the contact order
+		for (uint32_t contact : _touching)
+		{
+			const uint32_t a = _body[_contacts[contact]._a];
+			const uint32_t b = _body[_contacts[contact]._b];
+			if (BodyType::Static == _type[a] || BodyType::Static == _type[b])
+			{
+				continue;
+			}
+
+			uint32_t root_a = findRoot(a);
+			uint32_t root_b = findRoot(b);
+			if (root_a != root_b)
+			{
+				_island_parent[root_a > root_b ? root_a : root_b] = root_a < root_b ? root_a : root_b;
+			}
+		}
+
+		// islands in order of their lowest body, which is the root
+		_islands.clear();
+		_island_index.resize(body_count);
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			if (BodyType::Static == _type[ii])
+			{
+				continue;
+			}
+
+			const uint32_t root = findRoot(ii);
+			if (root == ii)
+			{
+				_island_index[ii] = (uint32_t)_islands.size();
+				Island island = { 0, 0, 0, 0, UINT32_MAX, false };
+				_islands.push_back(island);
+			}
+
+			Island& island = _islands[_island_index[root]];
+			++island._body_count;
+			island._awake = island._awake || 0 != _awake[ii];
+		}
+
+		for (uint32_t contact : _touching)
+		{
+			const uint32_t a = _body[_contacts[contact]._a];
+			const uint32_t b = _body[_contacts[contact]._b];
+			++_islands[_island_index[findRoot(BodyType::Static == _type[a] ? b : a)]]._contact_count;
+		}
+
+		uint32_t body_offset = 0;
+		uint32_t contact_offset = 0;
+		for (Island& island : _islands)
+		{
+			island._first_body = body_offset;
+			island._first_contact = contact_offset;
+			body_offset += island._body_count;
+			contact_offset += island._contact_count;
+			island._body_count = 0;
+			island._contact_count = 0;
+		}
+
+		_island_bodies.resize(body_offset);
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			if (BodyType::Static != _type[ii])
+			{
+				Island& island = _islands[_island_index[findRoot(ii)]];
+				_island_bodies[island._first_body + island._body_count++] = ii;
+			}
+		}
+
+		_grouped.resize(_touching.size());
+		for (uint32_t contact : _touching)
+		{
+			const uint32_t a = _body[_contacts[contact]._a];
+			const uint32_t b = _body[_contacts[contact]._b];
+			Island& island = _islands[_island_index[findRoot(BodyType::Static == _type[a] ? b : a)]];
+			_grouped[island._first_contact + island._contact_count++] = contact;
+		}
+		_touching.swap(_grouped);
+
+		// one awake body wakes its whole island, others are skipped until then
+		_small_islands.clear();
+		_colored_islands.clear();
+		_colors.clear();
+		for (uint32_t ii = 0; ii < _islands.size(); ++ii)
+		{
+			Island& island = _islands[ii];
+			if (!island._awake)
+			{
+				continue;
+			}
+
+			for (uint32_t jj = 0; jj < island._body_count; ++jj)
+			{
+				const uint32_t body = _island_bodies[island._first_body + jj];
+				if (0 == _awake[body])
+				{
+					wake(body);
+					Mat3 rotation = toMatrix(_rotation[body]);
+					_inv_inertia[body] = rotation * _inv_inertia_local[body] * transpose(rotation);
+				}
+			}
+
+			if (k_min_colored_contacts <= island._contact_count)
+			{
+				colorIsland(island);
+				_colored_islands.push_back(ii);
+			}
+			else
+			{
+				_small_islands.push_back(ii);
+			}
+		}
+	}
+
+	// Greedy coloring in contact order: each contact takes the lowest color
+	// neither of its dynamic bodies has yet. Contacts left without one go
+	// in a last group that is solved by a single job.
+	void PhysicsManager::colorIsland(Island& island)
+	{
+		_color_mask.resize(_handle.size());
+		for (uint32_t ii = 0; ii < island._body_count; ++ii)
+		{
+			_color_mask[_island_bodies[island._first_body + ii]] = 0;
+		}
+
+		_contact_color.resize(_touching.size());
+		uint32_t* contacts = &_touching[island._first_contact];
+		uint8_t* color_of = &_contact_color[island._first_contact];
+		uint32_t color_size[k_color_count + 1] = {};
+		for (uint32_t ii = 0; ii < island._contact_count; ++ii)
+		{
+			const uint32_t a = _body[_contacts[contacts[ii]]._a];
+			const uint32_t b = _body[_contacts[contacts[ii]]._b];
+			const bool dynamic_a = BodyType::Dynamic == _type[a];
+			const bool dynamic_b = BodyType::Dynamic == _type[b];
+
+			uint32_t used = (dynamic_a ? _color_mask[a] : 0) | (dynamic_b ? _color_mask[b] : 0);
+			uint32_t color = UINT32_MAX != used ? bx::uint32_cnttz(~used) : k_color_count;
+			if (k_color_count != color)
+			{
+				_color_mask[a] |= dynamic_a ? 1u << color : 0;
+				_color_mask[b] |= dynamic_b ? 1u << color : 0;
+			}
+
+			color_of[ii] = (uint8_t)color;
+			++color_size[color];
+		}
+
+		island._first_color = (uint32_t)_colors.size();
+		uint32_t next[k_color_count + 1];
+		uint32_t offset = island._first_contact;
+		for (uint32_t ii = 0; ii <= k_color_count; ++ii)
+		{
+			_colors.push_back(offset);
+			next[ii] = offset - island._first_contact;
+			offset += color_size[ii];
+		}
+		_colors.push_back(offset);
+
+		// stable counting sort by color, through the grouping scratch
+		uint32_t* sorted = &_grouped[island._first_contact];
+		for (uint32_t ii = 0; ii < island._contact_count; ++ii)
+		{
+			sorted[next[color_of[ii]]++] = contacts[ii];
+		}
+		memcpy(contacts, sorted, sizeof(uint32_t) * island._contact_count);
+	}
+
+	void PhysicsManager::integrateVelocities(const uint32_t* bodies, uint32_t count, float h)
+	{
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const uint32_t body = bodies[ii];
+			if (BodyType::Dynamic != _type[body])
+			{
+				continue;
+			}
+
+			Vec3 v = _linear_velocity[body] + (_gravity + _force[body] * _inv_mass[body]) * h;
+			Vec3 w = _angular_velocity[body] + (_inv_inertia[body] * _torque[body]) * h;
+			_linear_velocity[body] = v * (1.0f / (1.0f + h * _linear_damping[body]));
+			_angular_velocity[body] = w * (1.0f / (1.0f + h * _angular_damping[body]));
+		}
+	}
+
+	void PhysicsManager::integratePositions(const uint32_t* bodies, uint32_t count, float h)
+	{
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const uint32_t body = bodies[ii];
+			const Vec3& v = _linear_velocity[body];
+			const Vec3& w = _angular_velocity[body];
+			_position[body] += v * h;
+			_delta_position[body] += v * h;
+			_rotation[body] = integrateRotation(_rotation[body], w, h);
+			_delta_rotation[body] = integrateRotation(_delta_rotation[body], w, h);
+		}
+	}
+
+	void PhysicsManager::prepareContacts(uint32_t first, uint32_t count)
+	{
+		for (uint32_t ii = first; ii < first + count; ++ii)
+		{
+			const Contact& contact = _contacts[_touching[ii]];
+			const uint32_t a = _body[contact._a];
+			const uint32_t b = _body[contact._b];
+			float friction = sqrtf(_friction[a] * _friction[b]);
+			float restitution = _restitution[a] > _restitution[b] ? _restitution[a] : _restitution[b];
+			prepareContact(_constraints[ii], contact._manifold, a, b, &_position[0], _step._bodies, friction, restitution);
+		}
+	}
+
+	void PhysicsManager::finishContacts(uint32_t first, uint32_t count)
+	{
+		for (uint32_t ii = first; ii < first + count; ++ii)
+		{
+			storeImpulses(_constraints[ii], _contacts[_touching[ii]]._manifold);
+		}
+	}
+
+	// An island sleeps once all its bodies have been slow for k_time_to_sleep.
+	void PhysicsManager::updateSleep(const Island& island)
+	{
+		const uint32_t* bodies = &_island_bodies[island._first_body];
+		float min_sleep_time = FLT_MAX;
+		for (uint32_t ii = 0; ii < island._body_count; ++ii)
+		{
+			const uint32_t body = bodies[ii];
+			const Vec3& v = _linear_velocity[body];
+			const Vec3& w = _angular_velocity[body];
+			if (dot(v, v) > k_sleep_linear_velocity * k_sleep_linear_velocity
+			|| dot(w, w) > k_sleep_angular_velocity * k_sleep_angular_velocity)
+			{
+				_sleep_time[body] = 0.0f;
+			}
+			else
+			{
+				_sleep_time[body] += _step._h;
+			}
+			min_sleep_time = _sleep_time[body] < min_sleep_time ? _sleep_time[body] : min_sleep_time;
+		}
+
+		if (min_sleep_time < k_time_to_sleep)
+		{
+			return;
+		}
+
+		for (uint32_t ii = 0; ii < island._body_count; ++ii)
+		{
+			const uint32_t body = bodies[ii];
+			_awake[body] = 0;
+			_linear_velocity[body] = Vec3(0.0f, 0.0f, 0.0f);
+			_angular_velocity[body] = Vec3(0.0f, 0.0f, 0.0f);
+			computeAabb(body);
+		}
+	}
+
+	int64_t PhysicsManager::getTicks() const
+	{
+		return _profiling ? bx::getHPCounter() : 0;
+	}
+
+	void PhysicsManager::addTicks(int64_t solve, int64_t integrate)
+	{
+		if (_profiling)
+		{
+			atomicAdd(&_solve_ticks, (int32_t)solve);
+			atomicAdd(&_integrate_ticks, (int32_t)integrate);
+		}
+	}
+
+	// Islands share nothing, so a batch of them goes through the stages
+	// together; each island sees the same operations in the same order as
+	// on its own, and profiling reads the clock per stage, not per island.
+	void PhysicsManager::solveIslandBatch(const uint32_t* islands, uint32_t count, int64_t& integrate)
+	{
+		const SolverBodies& solver_bodies = _step._bodies;
+		const float sub_h = _step._sub_h;
+		const float inv_sub_h = 1.0f / sub_h;
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const Island& island = _islands[islands[ii]];
+			prepareContacts(island._first_contact, island._contact_count);
+		}
+
+		for (uint32_t substep = 0; substep < _substep_count; ++substep)
+		{
+			int64_t start = getTicks();
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const Island& island = _islands[islands[ii]];
+				integrateVelocities(&_island_bodies[island._first_body], island._body_count, sub_h);
+			}
+			integrate += getTicks() - start;
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const Island& island = _islands[islands[ii]];
+				ContactConstraint* constraints = 0 < island._contact_count ? &_constraints[island._first_contact] : nullptr;
+				warmStartContacts(constraints, island._contact_count, solver_bodies);
+				solveContacts(constraints, island._contact_count, solver_bodies, _step._softness, inv_sub_h, k_max_push_velocity, true);
+			}
+
+			start = getTicks();
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const Island& island = _islands[islands[ii]];
+				integratePositions(&_island_bodies[island._first_body], island._body_count, sub_h);
+			}
+			integrate += getTicks() - start;
+
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				const Island& island = _islands[islands[ii]];
+				ContactConstraint* constraints = 0 < island._contact_count ? &_constraints[island._first_contact] : nullptr;
+				solveContacts(constraints, island._contact_count, solver_bodies, _step._softness, inv_sub_h, k_max_push_velocity, false);
+			}
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			const Island& island = _islands[islands[ii]];
+			ContactConstraint* constraints = 0 < island._contact_count ? &_constraints[island._first_contact] : nullptr;
+			applyRestitution(constraints, island._contact_count, solver_bodies, k_restitution_threshold);
+			finishContacts(island._first_contact, island._contact_count);
+			updateSleep(island);
+		}
+	}
+
+	// The same stages as solveIslandBatch, each one spread over jobs. The
+	// contacts of one color share no dynamic body, so a color needs no
+	// locking, only a wait before the next one starts.
+	void PhysicsManager::solveColoredIsland(const Island& island)
+	{
+		enum Stage { WarmStart, Solve, Relax, Restitution };
+
+		const uint32_t* bodies = &_island_bodies[island._first_body];
+		const uint32_t* colors = &_colors[island._first_color];
+		const SolverBodies& solver_bodies = _step._bodies;
+		const float sub_h = _step._sub_h;
+		const float inv_sub_h = 1.0f / sub_h;
+
+		// each range times itself, waiting on a stage may run other islands' jobs
+		auto prepare = [&](uint32_t begin, uint32_t end)
+		{
+			const int64_t start = getTicks();
+			prepareContacts(island._first_contact + begin, end - begin);
+			addTicks(getTicks() - start, 0);
+		};
+		auto finish = [&](uint32_t begin, uint32_t end)
+		{
+			const int64_t start = getTicks();
+			finishContacts(island._first_contact + begin, end - begin);
+			addTicks(getTicks() - start, 0);
+		};
+		auto integrate_velocities = [&](uint32_t begin, uint32_t end)
+		{
+			const int64_t start = getTicks();
+			integrateVelocities(bodies + begin, end - begin, sub_h);
+			addTicks(0, getTicks() - start);
+		};
+		auto integrate_positions = [&](uint32_t begin, uint32_t end)
+		{
+			const int64_t start = getTicks();
+			integratePositions(bodies + begin, end - begin, sub_h);
+			addTicks(0, getTicks() - start);
+		};
+
+		Stage stage = WarmStart;
+		uint32_t first = 0;
+		auto solve_range = [&](uint32_t begin, uint32_t end)
+		{
+			const int64_t start = getTicks();
+			ContactConstraint* constraints = &_constraints[first + begin];
+			const uint32_t count = end - begin;
+			switch (stage)
+			{
+			case WarmStart: warmStartContacts(constraints, count, solver_bodies); break;
+			case Solve: solveContacts(constraints, count, solver_bodies, _step._softness, inv_sub_h, k_max_push_velocity, true); break;
+			case Relax: solveContacts(constraints, count, solver_bodies, _step._softness, inv_sub_h, k_max_push_velocity, false); break;
+			case Restitution: applyRestitution(constraints, count, solver_bodies, k_restitution_threshold); break;
+			}
+			addTicks(getTicks() - start, 0);
+		};
+
+		// the uncolored rest goes last in one job, its contacts may share bodies
+		auto solve_colors = [&](Stage current)
+		{
+			stage = current;
+			for (uint32_t color = 0; color <= k_color_count; ++color)
+			{
+				first = colors[color];
+				const uint32_t count = colors[color + 1] - first;
+				parallelFor(count, k_color_count == color ? count : k_contact_grain, solve_range);
+			}
+		};
+
+		parallelFor(island._contact_count, k_contact_grain, prepare);
+
+		for (uint32_t substep = 0; substep < _substep_count; ++substep)
+		{
+			parallelFor(island._body_count, k_body_grain, integrate_velocities);
+			solve_colors(WarmStart);
+			solve_colors(Solve);
+			parallelFor(island._body_count, k_body_grain, integrate_positions);
+			solve_colors(Relax);
+		}
+
+		solve_colors(Restitution);
+		parallelFor(island._contact_count, k_contact_grain, finish);
+
+		const int64_t start = getTicks();
+		updateSleep(island);
+		addTicks(getTicks() - start, 0);
+	}
+
+	void PhysicsManager::solveIslands(void* data, uint32_t begin, uint32_t end)
+	{
+		PhysicsManager& manager = *(PhysicsManager*)data;
+		const int64_t start = manager.getTicks();
+		int64_t integrate = 0;
+		for (uint32_t ii = begin; ii < end; ii += k_island_batch)
+		{
+			const uint32_t count = end - ii < k_island_batch ? end - ii : k_island_batch;
+			manager.solveIslandBatch(&manager._small_islands[ii], count, integrate);
+		}
+		manager.addTicks(manager.getTicks() - start - integrate, integrate);
+	}
+
+	// Sweeps the step's translation from where the body started against
+	// the static bodies in its swept box and stops it at the first one it
+	// moves into. The velocity is kept for the contact to deal with.
+	void PhysicsManager::sweepFastBody(uint32_t index, std::vector<uint32_t>& candidates)
+	{
+		const Vec3& translation = _delta_position[index];
+		const Vec3& extent = _shape[index]->getExtent();
+		float size = extent.x < extent.y ? extent.x : extent.y;
+		size = (size < extent.z ? size : extent.z) * k_fast_motion;
+		if (lengthSq(translation) <= size * size)
+		{
+			return;
+		}
+
+		const Transform xf(_position[index] - translation, _rotation[index]);
+		Aabb swept;
+		_shape[index]->computeAabb(xf, swept);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			swept.m_min[axis] += translation[axis] < 0.0f ? translation[axis] : 0.0f;
+			swept.m_max[axis] += translation[axis] > 0.0f ? translation[axis] : 0.0f;
+		}
+
+		candidates.clear();
+		_broadphase->queryAabb(swept, candidates);
+
+		ShapeHit hit;
+		hit._t = 1.0f;
+		bool found = false;
+		for (uint32_t proxy : candidates)
+		{
+			const uint32_t other = _body[_broadphase->getUserData(proxy)];
+			ShapeHit candidate;
+			if (BodyType::Static == _type[other]
+				&& castShape(*_shape[index], xf, translation, *_shape[other], getTransform(other), candidate)
+				&& candidate._t < hit._t
+				&& 0.0f > dot(candidate._normal, translation))    // sliding along or leaving isn't a hit
+			{
+				hit = candidate;
+				found = true;
+			}
+		}
+
+		if (found)
+		{
+			float t = hit._t - k_fast_skin / length(translation);
+			t = 0.0f < t ? t : 0.0f;
+			_position[index] = xf.p + translation * t;
+		}
+	}
+
+	// Each job sweeps its own bodies against static ones only, so nothing
+	// it reads is written meanwhile.
+	void PhysicsManager::sweepFastBodies()
+	{
+		_fast_moving.clear();
+		const uint32_t body_count = (uint32_t)_handle.size();
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			if (0 != (_fast[ii] & _awake[ii]))
+			{
+				_fast_moving.push_back(ii);
+			}
+		}
+
+		const uint32_t count = (uint32_t)_fast_moving.size();
+		const uint32_t range_count = (count + k_fast_grain - 1) / k_fast_grain;
+		if (_fast_candidates.size() < range_count)
+		{
+			_fast_candidates.resize(range_count);
+		}
+
+		auto fn = [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint32_t>& candidates = _fast_candidates[begin / k_fast_grain];
+			for (uint32_t ii = begin; ii < end; ++ii)
+			{
+				sweepFastBody(_fast_moving[ii], candidates);
+			}
+		};
+		parallelFor(count, k_fast_grain, fn);
+	}
+
+	void PhysicsManager::simulate(float h)
+	{
+		const uint32_t body_count = (uint32_t)_handle.size();
+		if (0 == body_count)
+		{
+			return;
+		}
+
+		const int64_t start = getTicks();
+		_solve_ticks = 0;
+		_integrate_ticks = 0;
+
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			if (0 != _awake[ii])
+			{
+				Mat3 rotation = toMatrix(_rotation[ii]);
+				_inv_inertia[ii] = rotation * _inv_inertia_local[ii] * transpose(rotation);
+				computeAabb(ii);
+			}
+		}
+
+		findPairs(h);
+		const int64_t broadphase = getTicks();
+		collide();
+		const int64_t narrowphase = getTicks();
+		buildIslands();
+		const int64_t islands = getTicks();
+
+		_delta_position.assign(body_count, Vec3(0.0f, 0.0f, 0.0f));
+		_delta_rotation.assign(body_count, Quat::identity());
+		_constraints.resize(_touching.size());
+
+		_step._bodies = getSolverBodies();
+		_step._h = h;
+		_step._sub_h = h / (float)_substep_count;
+
+		// stiffer than a quarter of the substep rate starts to ring
+		float hertz = 0.25f / _step._sub_h;
+		hertz = hertz < k_contact_hertz ? hertz : k_contact_hertz;
+		_step._softness = makeSoftness(hertz, k_contact_damping_ratio, _step._sub_h);
+
+		// small islands go out as jobs first, and waiting on the colored
+		// stages helps run them
+		const uint32_t small_count = (uint32_t)_small_islands.size();
+		JobCounter counter;
+		if (nullptr != _job_system)
+		{
+			const uint32_t job_count = 4 * (_job_system->getWorkerCount() + 1);
+			_job_system->parallelFor(small_count, (small_count + job_count - 1) / job_count, solveIslands, this, counter);
+		}
+		else
+		{
+			solveIslands(this, 0, small_count);
+		}
+
+		for (uint32_t island : _colored_islands)
+		{
+			solveColoredIsland(_islands[island]);
+		}
+
+		if (nullptr != _job_system)
+		{
+			_job_system->wait(counter);
+		}
+
+		const int64_t solved = getTicks();
+		if (0 != _fast_count)
+		{
+			sweepFastBodies();
+		}
+		const int64_t swept = getTicks();
+
+		for (uint32_t ii = 0; ii < body_count; ++ii)
+		{
+			_force[ii] = Vec3(0.0f, 0.0f, 0.0f);
+			_torque[ii] = Vec3(0.0f, 0.0f, 0.0f);
+		}
+
+		_times._step += getTicks() - start;
+		_times._broadphase += broadphase - start;
+		_times._narrowphase += narrowphase - broadphase;
+		_times._islands += islands - narrowphase;
+		_times._solve += _solve_ticks;
+		_times._integrate += _integrate_ticks;
+		_times._continuous += swept - solved;
+	}
+
+	uint32_t PhysicsManager::step(float dt)
+	{
+		_accumulator += dt;
+
+		// an update without a step keeps showing the last one's times
+		if (_accumulator >= _fixed_dt)
+		{
+			_times = StepTimes();
+		}
+
+		uint32_t steps = 0;
+		while (_accumulator >= _fixed_dt && steps < k_max_steps_per_update)
+		{
+			simulate(_fixed_dt);
+			_accumulator -= _fixed_dt;
+			++steps;
+		}
+		_times._step_count += steps;
+
+		// too far behind, drop the time rather than spiral
+		if (_accumulator >= _fixed_dt)
+		{
+			_accumulator = 0.0f;
+		}
+
+		return steps;
+	}
+
+	void PhysicsManager::getProfile(PhysicsProfile& profile) const
+	{
+		const float ms_per_tick = 1000.0f / (float)bx::getHPFrequency();
+		profile._step_count = _times._step_count;
+		profile._step = _times._step * ms_per_tick;
+		profile._broadphase = _times._broadphase * ms_per_tick;
+		profile._narrowphase = _times._narrowphase * ms_per_tick;
+		profile._islands = _times._islands * ms_per_tick;
+		profile._solve = _times._solve * ms_per_tick;
+		profile._integrate = _times._integrate * ms_per_tick;
+		profile._continuous = _times._continuous * ms_per_tick;
+
+		profile._body_count = (uint32_t)_handle.size();
+		profile._awake_body_count = 0;
+		for (uint8_t awake : _awake)
+		{
+			profile._awake_body_count += awake;
+		}
+
+		profile._proxy_count = _broadphase->getProxyCount();
+		profile._tree_height = BroadphaseType::DynamicTree == _broadphase_type ? _tree.getHeight() : 0;
+		profile._pair_count = _contact_map.getCount();
+		profile._manifold_count = (uint32_t)_touching.size();
+		profile._point_count = 0;
+		for (uint32_t contact : _touching)
+		{
+			profile._point_count += _contacts[contact]._manifold._count;
+		}
+
+		profile._island_count = (uint32_t)_islands.size();
+		profile._awake_island_count = getAwakeIslandCount();
+		profile._colored_island_count = (uint32_t)_colored_islands.size();
+		profile._largest_island = 0;
+		for (const Island& island : _islands)
+		{
+			if (island._awake && profile._largest_island < island._body_count)
+			{
+				profile._largest_island = island._body_count;
+			}
+		}
+	}
+
+	void PhysicsManager::debugDraw(PhysicsDebugDraw& draw, uint32_t flags) const
+	{
+		const uint32_t body_count = (uint32_t)_handle.size();
+		if (0 != (flags & k_debug_draw_shapes))
+		{
+			for (uint32_t ii = 0; ii < body_count; ++ii)
+			{
+				uint32_t color = 0 != _awake[ii] ? k_awake_color : k_sleeping_color;
+				color = BodyType::Kinematic == _type[ii] ? k_kinematic_color : color;
+				color = BodyType::Static == _type[ii] ? k_static_color : color;
+				draw.addShape(*_shape[ii], getTransform(ii), color);
+			}
+		}
+
+		if (0 != (flags & k_debug_draw_contacts))
+		{
+			for (uint32_t contact : _touching)
+			{
+				draw.addManifold(_contacts[contact]._manifold);
+			}
+		}
+
+		if (0 != (flags & k_debug_draw_bounds))
+		{
+			for (uint32_t ii = 0; ii < body_count; ++ii)
+			{
+				draw.addAabb(_broadphase->getFatAabb(_proxy[ii]), k_bounds_color);
+			}
+		}
+
+		if (0 != (flags & k_debug_draw_tree) && BroadphaseType::DynamicTree == _broadphase_type && Broadphase::k_null != _tree.getRoot())
+		{
+			uint32_t stack[DynamicTree::k_stack_size];
+			uint32_t depth[DynamicTree::k_stack_size];
+			uint32_t count = 0;
+			stack[count] = _tree.getRoot();
+			depth[count++] = 0;
+			while (0 < count)
+			{
+				--count;
+				const DynamicTree::Node& node = _tree.getNode(stack[count]);
+				const uint32_t level = depth[count];
+				if (Broadphase::k_null == node._child[0])
+				{
+					continue;
+				}
+
+				draw.addAabb(node._aabb, k_tree_colors[level % k_tree_color_count]);
+				assert(count + 2 <= DynamicTree::k_stack_size);
+				for (uint32_t ii = 0; ii < 2; ++ii)
+				{
+					stack[count] = node._child[ii];
+					depth[count++] = level + 1;
+				}
+			}
+		}
+	}
+
+	void PhysicsManager::saveState(std::vector<uint8_t>& buffer) const
+	{
+		buffer.clear();
+		StateWriter writer(buffer);
+		writer.write(k_state_magic);
+		writer.write(k_state_version);
+		writer.write(_accumulator);
+
+		writer.write(_position);
+		writer.write(_rotation);
+		writer.write(_linear_velocity);
+		writer.write(_angular_velocity);
+		writer.write(_force);
+		writer.write(_torque);
+		writer.write(_inv_mass);
+		writer.write(_inv_inertia_local);
+		writer.write(_inv_inertia);
+		writer.write(_shape);
+		writer.write(_type);
+		writer.write(_friction);
+		writer.write(_restitution);
+		writer.write(_linear_damping);
+		writer.write(_angular_damping);
+		writer.write(_sleep_time);
+		writer.write(_awake);
+		writer.write(_fast);
+		writer.write(_aabb);
+		writer.write(_proxy);
+		writer.write(_handle);
+		writer.write(_body);
+		writer.write(_free_handles);
+		writer.write(_generation);
+
+		writer.write(_characters);
+		writer.write(_character_handle);
+		writer.write(_character_index);
+		writer.write(_free_character_handles);
+		writer.write(_character_generation);
+
+		writer.write(_broadphase_type);
+		_broadphase->saveState(writer);
+
+		writer.write(_contacts);
+		writer.write(_free_contacts);
+		_contact_map.saveState(writer);
+		writer.write(_first_contact);
+	}
+
+	bool PhysicsManager::loadState(const void* data, size_t size)
+	{
+		StateReader reader(data, size);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		reader.read(magic);
+		reader.read(version);
+		if (k_state_magic != magic || k_state_version != version)
+		{
+			return false;
+		}
+
+		LoadedState& state = _loaded;
+		reader.read(state._accumulator);
+
+		reader.read(state._position);
+		reader.read(state._rotation);
+		reader.read(state._linear_velocity);
+		reader.read(state._angular_velocity);
+		reader.read(state._force);
+		reader.read(state._torque);
+		reader.read(state._inv_mass);
+		reader.read(state._inv_inertia_local);
+		reader.read(state._inv_inertia);
+		reader.read(state._shape);
+		reader.read(state._type);
+		reader.read(state._friction);
+		reader.read(state._restitution);
+		reader.read(state._linear_damping);
+		reader.read(state._angular_damping);
+		reader.read(state._sleep_time);
+		reader.read(state._awake);
+		reader.read(state._fast);
+		reader.read(state._aabb);
+		reader.read(state._proxy);
+		reader.read(state._handle);
+		reader.read(state._body);
+		reader.read(state._free_handles);
+		reader.read(state._generation);
+
+		reader.read(state._characters);
+		reader.read(state._character_handle);
+		reader.read(state._character_index);
+		reader.read(state._free_character_handles);
+		reader.read(state._character_generation);
+
+		// the other broadphase was emptied when this one was picked
+		reader.read(state._broadphase_type);
+		state._tree.clear();
+		state._sweep_and_prune.clear();
+		if (BroadphaseType::DynamicTree == state._broadphase_type)
+		{
+			state._tree.loadState(reader);
+		}
+		else if (BroadphaseType::SweepAndPrune == state._broadphase_type)
+		{
+			state._sweep_and_prune.loadState(reader);
+		}
+		else
+		{
+			return false;
+		}
+
+		reader.read(state._contacts);
+		reader.read(state._free_contacts);
+		state._contact_map.loadState(reader);
+		reader.read(state._first_contact);
+
+		if (!reader.isValid()
+			|| !reader.isAtEnd()
+			|| !isValidLoad())
+		{
+			return false;
+		}
+
+		std::swap(_accumulator, state._accumulator);
+		_position.swap(state._position);
+		_rotation.swap(state._rotation);
+		_linear_velocity.swap(state._linear_velocity);
+		_angular_velocity.swap(state._angular_velocity);
+		_force.swap(state._force);
+		_torque.swap(state._torque);
+		_inv_mass.swap(state._inv_mass);
+		_inv_inertia_local.swap(state._inv_inertia_local);
+		_inv_inertia.swap(state._inv_inertia);
+		_shape.swap(state._shape);
+		_type.swap(state._type);
+		_friction.swap(state._friction);
+		_restitution.swap(state._restitution);
+		_linear_damping.swap(state._linear_damping);
+		_angular_damping.swap(state._angular_damping);
+		_sleep_time.swap(state._sleep_time);
+		_awake.swap(state._awake);
+		_fast.swap(state._fast);
+		_aabb.swap(state._aabb);
+		_proxy.swap(state._proxy);
+		_handle.swap(state._handle);
+		_body.swap(state._body);
+		_free_handles.swap(state._free_handles);
+		_generation.swap(state._generation);
+		_characters.swap(state._characters);
+		_character_handle.swap(state._character_handle);
+		_character_index.swap(state._character_index);
+		_free_character_handles.swap(state._free_character_handles);
+		_character_generation.swap(state._character_generation);
+		std::swap(_tree, state._tree);
+		std::swap(_sweep_and_prune, state._sweep_and_prune);
+		_contacts.swap(state._contacts);
+		_free_contacts.swap(state._free_contacts);
+		std::swap(_contact_map, state._contact_map);
+		_first_contact.swap(state._first_contact);
+
+		_broadphase_type = state._broadphase_type;
+		if (BroadphaseType::DynamicTree == _broadphase_type)
+		{
+			_sweep_and_prune.clear();
+			_broadphase = &_tree;
+		}
+		else
+		{
+			_tree.clear();
+			_broadphase = &_sweep_and_prune;
+		}
+
+		_fast_count = 0;
+		for (uint8_t fast : _fast)
+		{
+			_fast_count += fast;
+		}
+
+		_touching.clear();
+		_islands.clear();
+		_small_islands.clear();
+		_colored_islands.clear();
+		return true;
+	}
+
+	template <class T>
+	static bool isAliveIn(const std::vector<uint32_t>& index, const std::vector<T>& values, const std::vector<uint32_t>& handles, uint32_t handle)
+	{
+		return handle < index.size()
+			&& index[handle] < values.size()
+			&& handles[index[handle]] == handle;
+	}
+
+	bool PhysicsManager::isValidLoad() const
+	{
+		const LoadedState& state = _loaded;
+		const uint32_t count = (uint32_t)state._handle.size();
+		const uint32_t handle_count = (uint32_t)state._body.size();
+		if (count != state._position.size()
+			|| count != state._rotation.size()
+			|| count != state._linear_velocity.size()
+			|| count != state._angular_velocity.size()
+			|| count != state._force.size()
+			|| count != state._torque.size()
+			|| count != state._inv_mass.size()
+			|| count != state._inv_inertia_local.size()
+			|| count != state._inv_inertia.size()
+			|| count != state._shape.size()
+			|| count != state._type.size()
+			|| count != state._friction.size()
+			|| count != state._restitution.size()
+			|| count != state._linear_damping.size()
+			|| count != state._angular_damping.size()
+			|| count != state._sleep_time.size()
+			|| count != state._awake.size()
+			|| count != state._fast.size()
+			|| count != state._aabb.size()
+			|| count != state._proxy.size()
+			|| handle_count != count + state._free_handles.size()
+			|| handle_count > state._generation.size())
+		{
+			return false;
+		}
+
+		const Broadphase& broadphase = BroadphaseType::DynamicTree == state._broadphase_type
+			? (const Broadphase&)state._tree
+			: (const Broadphase&)state._sweep_and_prune;
+		if (!broadphase.isValidState()
+			|| count != broadphase.getProxyCount())
+		{
+			return false;
+		}
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			if (!isAliveIn(state._body, state._handle, state._handle, state._handle[ii])
+				|| state._body[state._handle[ii]] != ii
+				|| nullptr == state._shape[ii]
+				|| BodyType::Dynamic < state._type[ii]
+				|| 1 < state._awake[ii]
+				|| 1 < state._fast[ii]
+				|| !broadphase.isProxy(state._proxy[ii])
+				|| broadphase.getUserData(state._proxy[ii]) != state._handle[ii])
+			{
+				return false;
+			}
+		}
+
+		for (uint32_t handle : state._free_handles)
+		{
+			if (handle >= handle_count
+				|| UINT32_MAX != state._body[handle])
+			{
+				return false;
+			}
+		}
+
+		const uint32_t character_count = (uint32_t)state._characters.size();
+		if (character_count != state._character_handle.size()
+			|| state._character_index.size() != character_count + state._free_character_handles.size()
+			|| state._character_index.size() > state._character_generation.size())
+		{
+			return false;
+		}
+
+		for (uint32_t ii = 0; ii < character_count; ++ii)
+		{
+			const Character& character = state._characters[ii];
+			const uint32_t handle = state._character_handle[ii];
+			if (!isAliveIn(state._character_index, state._characters, state._character_handle, handle)
+				|| state._character_index[handle] != ii
+				|| nullptr == character._shape
+				|| (UINT32_MAX != character._ground && !isAliveIn(state._body, state._handle, state._handle, character._ground)))
+			{
+				return false;
+			}
+		}
+
+		for (uint32_t handle : state._free_character_handles)
+		{
+			if (handle >= state._character_index.size()
+				|| UINT32_MAX != state._character_index[handle])
+			{
+				return false;
+			}
+		}
+
+		// every live head is in the map under its pair and nothing else is,
+		// and the chains are finite and made of live extras
+		const uint32_t contact_count = (uint32_t)state._contacts.size();
+		if (!state._contact_map.isValidState(handle_count, contact_count))
+		{
+			return false;
+		}
+
+		uint32_t head_count = 0;
+		uint32_t chained_count = 0;
+		for (uint32_t ii = 0; ii < contact_count; ++ii)
+		{
+			const Contact& contact = state._contacts[ii];
+			if (UINT32_MAX == contact._a)
+			{
+				continue;
+			}
+
+			if (!isAliveIn(state._body, state._handle, state._handle, contact._a)
+				|| !isAliveIn(state._body, state._handle, state._handle, contact._b)
+				|| contact._a == contact._b
+				|| ContactManifold::k_max_points < contact._manifold._count
+				|| (UINT32_MAX != contact._next && contact._next >= contact_count))
+			{
+				return false;
+			}
+
+			if (contact._is_extra)
+			{
+				continue;
+			}
+
+			++head_count;
+			if (state._contact_map.find(contact._a, contact._b) != ii)
+			{
+				return false;
+			}
+
+			for (uint32_t next = contact._next; UINT32_MAX != next; next = state._contacts[next]._next)
+			{
+				if (next >= contact_count)
+				{
+					return false;
+				}
+
+				const Contact& extra = state._contacts[next];
+				if (!extra._is_extra
+					|| extra._a != contact._a
+					|| extra._b != contact._b
+					|| ++chained_count > contact_count)
+				{
+					return false;
+				}
+			}
+		}
+
+		if (head_count != state._contact_map.getCount()
+			|| handle_count != state._first_contact.size())
+		{
+			return false;
+		}
+
+		// the lists hold only heads of their body, so each head shows up
+		// at most once in each of its two and a loop runs past the count
+		uint32_t linked_count = 0;
+		for (uint32_t handle = 0; handle < handle_count; ++handle)
+		{
+			uint32_t prev = UINT32_MAX;
+			for (uint32_t contact = state._first_contact[handle]; UINT32_MAX != contact; )
+			{
+				if (contact >= contact_count
+					|| ++linked_count > 2 * head_count)
+				{
+					return false;
+				}
+
+				const Contact& data = state._contacts[contact];
+				if (UINT32_MAX == data._a
+					|| data._is_extra
+					|| (handle != data._a && handle != data._b))
+				{
+					return false;
+				}
+
+				const uint32_t side = handle == data._a ? 0 : 1;
+				if (data._prev_link[side] != prev)
+				{
+					return false;
+				}
+				prev = contact;
+				contact = data._next_link[side];
+			}
+		}
+
+		if (2 * head_count != linked_count)
+		{
+			return false;
+		}
+
+		for (uint32_t contact : state._free_contacts)
+		{
+			if (contact >= contact_count
+				|| UINT32_MAX != state._contacts[contact]._a)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// FNV-1a over the raw bits, so -0 and 0 or two NaNs differ as they should
+	static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t ii = 0; ii < size; ++ii)
+		{
+			hash ^= bytes[ii];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	template <class T>
+	static uint64_t hashArray(uint64_t hash, const std::vector<T>& values)
+	{
+		return values.empty() ? hash : hashBytes(hash, values.data(), sizeof(T) * values.size());
+	}
+
+	uint64_t PhysicsManager::computeStateHash() const
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		hash = hashArray(hash, _handle);
+		hash = hashArray(hash, _position);
+		hash = hashArray(hash, _rotation);
+		hash = hashArray(hash, _linear_velocity);
+		hash = hashArray(hash, _angular_velocity);
+		hash = hashArray(hash, _awake);
+		hash = hashArray(hash, _sleep_time);
+		for (const Character& character : _characters)
+		{
+			hash = hashBytes(hash, &character._position, sizeof(character._position));
+			hash = hashBytes(hash, &character._ground, sizeof(character._ground));
+		}
+
+		// free slots keep stale manifolds, only live contacts count
+		for (const Contact& contact : _contacts)
+		{
+			if (UINT32_MAX == contact._a)
+			{
+				continue;
+			}
+
+			hash = hashBytes(hash, &contact._a, sizeof(contact._a));
+			hash = hashBytes(hash, &contact._b, sizeof(contact._b));
+			const ContactManifold& manifold = contact._manifold;
+			hash = hashBytes(hash, &manifold._count, sizeof(manifold._count));
+			for (uint32_t ii = 0; ii < manifold._count; ++ii)
+			{
+				const ContactPoint& point = manifold._points[ii];
+				hash = hashBytes(hash, &point._normal_impulse, sizeof(point._normal_impulse));
+				hash = hashBytes(hash, &point._friction_impulse, sizeof(point._friction_impulse));
+			}
+		}
+		return hash;
+	}
+
+	static void setMiss(QueryHit& hit)
+	{
+		hit._body = k_invalid_body;
+		hit._distance = FLT_MAX;
+	}
+
+	static void setHit(QueryHit& hit, BodyHandle body, const ShapeHit& shape_hit, float distance)
+	{
+		hit._body = body;
+		memcpy(hit._position, &shape_hit._position, sizeof(hit._position));
+		memcpy(hit._normal, &shape_hit._normal, sizeof(hit._normal));
+		hit._distance = distance;
+	}
+
+	void PhysicsManager::rayCastProxy(void* data, uint32_t proxy, uint32_t lanes, RayPacket& packet)
+	{
+		const RayCastContext& context = *(const RayCastContext*)data;
+		const PhysicsManager& manager = *context._manager;
+		const uint32_t handle = manager._broadphase->getUserData(proxy);
+		const uint32_t index = manager._body[handle];
+		const Transform xf = manager.getTransform(index);
+
+		for (; 0 != lanes; lanes &= lanes - 1)
+		{
+			const uint32_t lane = bx::uint32_cnttz(lanes);
+			const RayCastInput& ray = context._rays[lane];
+
+			// the lane's _max_t is the closest hit so far, so any hit replaces it
+			ShapeHit hit;
+			if (rayCastShape(*manager._shape[index], xf, Vec3(ray._origin), context._direction[lane], packet._max_t[lane], hit))
+			{
+				packet._max_t[lane] = hit._t;
+				setHit(context._hits[lane], manager.makeHandle(handle), hit, hit._t);
+			}
+		}
+	}
+
+	void PhysicsManager::rayCast(const RayCastInput* rays, uint32_t count, QueryHit* hits) const
+	{
+		auto fn = [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t packet_index = begin; packet_index < end; ++packet_index)
+			{
+				const uint32_t first = packet_index * 4;
+				const uint32_t lane_count = count - first < 4 ? count - first : 4;
+
+				RayPacket packet;
+				RayCastContext context;
+				context._manager = this;
+				context._rays = rays + first;
+				context._hits = hits + first;
+				for (uint32_t lane = 0; lane < lane_count; ++lane)
+				{
+					const RayCastInput& ray = rays[first + lane];
+					context._direction[lane] = normalize(Vec3(ray._direction));
+					packet.setRay(lane, ray._origin, &context._direction[lane].x, ray._max_distance);
+					setMiss(hits[first + lane]);
+				}
+
+				_broadphase->rayCast(packet, rayCastProxy, &context);
+			}
+		};
+		parallelFor((count + 3) / 4, k_packet_grain, fn);
+	}
+
+	void PhysicsManager::sweep(const SweepInput* sweeps, uint32_t count, QueryHit* hits) const
+	{
+		auto fn = [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint32_t> proxies;
+			for (uint32_t ii = begin; ii < end; ++ii)
+			{
+				const SweepInput& input = sweeps[ii];
+				QueryHit& result = hits[ii];
+				setMiss(result);
+
+				const Transform xf(Vec3(input._position), Quat(input._rotation[0], input._rotation[1], input._rotation[2], input._rotation[3]));
+				const Vec3 translation = normalize(Vec3(input._direction)) * input._max_distance;
+
+				// everything along the way is in the box around both ends
+				Aabb aabb;
+				input._shape->computeAabb(xf, aabb);
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					aabb.m_min[axis] += translation[axis] < 0.0f ? translation[axis] : 0.0f;
+					aabb.m_max[axis] += translation[axis] > 0.0f ? translation[axis] : 0.0f;
+				}
+
+				proxies.clear();
+				_broadphase->queryAabb(aabb, proxies);
+
+				float closest = 1.0f;
+				for (uint32_t proxy : proxies)
+				{
+					const uint32_t handle = _broadphase->getUserData(proxy);
+					const uint32_t index = _body[handle];
+
+					ShapeHit hit;
+					if (castShape(*input._shape, xf, translation, *_shape[index], getTransform(index), hit) && hit._t < closest)
+					{
+						closest = hit._t;
+						setHit(result, makeHandle(handle), hit, hit._t * input._max_distance);
+					}
+				}
+			}
+		};
+		parallelFor(count, k_query_grain, fn);
+	}
+
+	void PhysicsManager::overlap(const OverlapInput* queries, uint32_t count, BodyHandle* bodies, uint32_t capacity, uint32_t* counts) const
+	{
+		auto fn = [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint32_t> proxies;
+			for (uint32_t ii = begin; ii < end; ++ii)
+			{
+				const OverlapInput& input = queries[ii];
+				const Transform xf(Vec3(input._position), Quat(input._rotation[0], input._rotation[1], input._rotation[2], input._rotation[3]));
+
+				Aabb aabb;
+				input._shape->computeAabb(xf, aabb);
+				proxies.clear();
+				_broadphase->queryAabb(aabb, proxies);
+
+				BodyHandle* result = bodies + ii * capacity;
+				uint32_t found = 0;
+				for (uint32_t jj = 0; jj < proxies.size() && found < capacity; ++jj)
+				{
+					const uint32_t handle = _broadphase->getUserData(proxies[jj]);
+					const uint32_t index = _body[handle];
+					if (overlapShapes(*input._shape, xf, *_shape[index], getTransform(index)))
+					{
+						result[found++] = makeHandle(handle);
+					}
+				}
+				counts[ii] = found;
+			}
+		};
+		parallelFor(count, k_query_grain, fn);
+	}
+
+	CharacterHandle PhysicsManager::createCharacter(const CharacterDesc& desc)
+	{
+		assert(nullptr != desc._shape && ShapeType::Capsule == desc._shape->getType());
+
+		uint32_t handle;
+		if (_free_character_handles.empty())
+		{
+			handle = (uint32_t)_character_index.size();
+			_character_index.push_back(0);
+			if (_character_generation.size() == handle)
+			{
+				_character_generation.push_back(0);
+			}
+		}
+		else
+		{
+			handle = _free_character_handles.back();
+			_free_character_handles.pop_back();
+		}
+
+		_character_index[handle] = (uint32_t)_characters.size();
+		_character_handle.push_back(handle);
+
+		Character character;
+		character._shape = desc._shape;
+		character._position = Vec3(desc._position);
+		character._ground_normal = Vec3(0.0f, 1.0f, 0.0f);
+		character._ground = UINT32_MAX;
+		character._min_ground_y = cosf(desc._max_slope);
+		character._step_height = desc._step_height;
+		character._snap_distance = desc._snap_distance;
+		_characters.push_back(character);
+
+		CharacterHandle result = { handle, _character_generation[handle] };
+		return result;
+	}
+
+	void PhysicsManager::destroyCharacter(CharacterHandle handle)
+	{
+		if (!isAlive(handle))
+		{
+			return;
+		}
+
+		uint32_t index = getCharacter(handle);
+		uint32_t last = (uint32_t)_characters.size() - 1;
+		removeAt(_characters, index);
+		removeAt(_character_handle, index);
+		if (index != last)
+		{
+			_character_index[_character_handle[index]] = index;
+		}
+		_character_index[handle.idx] = UINT32_MAX;
+		++_character_generation[handle.idx];
+		_free_character_handles.push_back(handle.idx);
+	}
+
+	bool PhysicsManager::isAlive(CharacterHandle handle) const
+	{
+		return handle.idx < _character_index.size()
+			&& UINT32_MAX != _character_index[handle.idx]
+			&& _character_generation[handle.idx] == handle.generation;
+	}
+
+	void PhysicsManager::getCharacterPosition(CharacterHandle handle, float position[3]) const
+	{
+		memcpy(position, &_characters[getCharacter(handle)]._position, sizeof(float) * 3);
+	}
+
+	void PhysicsManager::setCharacterPosition(CharacterHandle handle, const float position[3])
+	{
+		Character& character = _characters[getCharacter(handle)];
+		character._position = Vec3(position);
+		character._ground = UINT32_MAX;
+	}
+
+	BodyHandle PhysicsManager::getCharacterGround(CharacterHandle handle, float normal[3]) const
+	{
+		const Character& character = _characters[getCharacter(handle)];
+		memcpy(normal, &character._ground_normal, sizeof(float) * 3);
+		return UINT32_MAX != character._ground ? makeHandle(character._ground) : k_invalid_body;
+	}
+
+	void PhysicsManager::gatherCandidates(const Character& character, const Vec3& displacement, std::vector<uint32_t>& candidates) const
+	{
+		// one box around everywhere the move can reach, step and snap included
+		Aabb aabb;
+		character._shape->computeAabb(Transform(character._position, Quat::identity()), aabb);
+		const float reach = length(displacement) + character._step_height + character._snap_distance + k_character_skin;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] -= reach;
+			aabb.m_max[axis] += reach;
+		}
+
+		candidates.clear();
+		_broadphase->queryAabb(aabb, candidates);
+
+		// proxies to the indices of static bodies, in place
+		uint32_t count = 0;
+		for (uint32_t proxy : candidates)
+		{
+			const uint32_t index = _body[_broadphase->getUserData(proxy)];
+			if (BodyType::Static == _type[index])
+			{
+				candidates[count++] = index;
+			}
+		}
+		candidates.resize(count);
+	}
+
+	bool PhysicsManager::sweepCharacter(const Character& character, const Vec3& position, const Vec3& translation,
+		const std::vector<uint32_t>& candidates, ShapeHit& hit, uint32_t& body) const
+	{
+		const Transform xf(position, Quat::identity());
+		Aabb swept;
+		character._shape->computeAabb(xf, swept);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			swept.m_min[axis] += translation[axis] < 0.0f ? translation[axis] : 0.0f;
+			swept.m_max[axis] += translation[axis] > 0.0f ? translation[axis] : 0.0f;
+		}
+
+		bool found = false;
+		hit._t = 1.0f;
+		for (uint32_t index : candidates)
+		{
+			ShapeHit candidate;
+			if (aabbOverlap(_aabb[index], swept)
+				&& castShape(*character._shape, xf, translation, *_shape[index], getTransform(index), candidate)
+				&& candidate._t < hit._t
+				&& 0.0f > dot(candidate._normal, translation))    // touching what it moves along or away from is no hit
+			{
+				hit = candidate;
+				body = index;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	bool PhysicsManager::findGround(const Character& character, const Vec3& position, const ShapeHit& hit, uint32_t body, Vec3& normal) const
+	{
+		normal = hit._normal;
+		if (normal.y >= character._min_ground_y)
+		{
+			return true;
+		}
+
+		// the rounded bottom dropping onto an edge reports a tilted normal; the
+		// face just past the edge says whether it can be stood on. An edge
+		// above where the drop started is beside the capsule, not under it
+		const Vec3* core = character._shape->getCore();
+		const float foot = position.y + (core[0].y < core[1].y ? core[0].y : core[1].y) - character._shape->getRadius();
+		Vec3 inward(-normal.x, 0.0f, -normal.z);
+		if (0.0f >= normal.y || 0.0f == lengthSq(inward) || hit._position.y > foot)
+		{
+			return false;
+		}
+
+		const Vec3 down(0.0f, -1.0f, 0.0f);
+		const Vec3 origin = hit._position + normalize(inward) * k_edge_inset + Vec3(0.0f, k_edge_probe, 0.0f);
+		ShapeHit face;
+		if (rayCastShape(*_shape[body], getTransform(body), origin, down, 2.0f * k_edge_probe, face)
+			&& 0.0f < face._t
+			&& face._normal.y >= character._min_ground_y)
+		{
+			normal = face._normal;
+			return true;
+		}
+		return false;
+	}
+
+	Vec3 PhysicsManager::slideCharacter(const Character& character, Vec3 position, Vec3 translation, bool walls_only,
+		const std::vector<uint32_t>& candidates) const
+	{
+		Vec3 previous(0.0f, 0.0f, 0.0f);
+		for (uint32_t iteration = 0; iteration < k_max_slide_iterations; ++iteration)
+		{
+			ShapeHit hit;
+			uint32_t body;
+			if (k_character_skin * k_character_skin > lengthSq(translation)
+				|| !sweepCharacter(character, position, translation, candidates, hit, body))
+			{
+				return position + translation;
+			}
+
+			// stop a skin short of the surface, measured along its normal
+			const float approach = -dot(translation, hit._normal);
+			const float t = hit._t - (0.0f < approach ? k_character_skin / approach : 0.0f);
+			position += translation * (0.0f < t ? t : 0.0f);
+
+			// walking into a slope too steep to stand on is walking into a wall
+			Vec3 normal = hit._normal;
+			if (walls_only && 0.0f < normal.y && normal.y < character._min_ground_y)
+			{
+				Vec3 flat(normal.x, 0.0f, normal.z);
+				normal = 0.0f < lengthSq(flat) ? normalize(flat) : normal;
+			}
+
+			translation = translation * (1.0f - hit._t);
+			translation -= normal * dot(translation, normal);
+
+			// in a crease between two surfaces, follow their seam
+			if (0.0f > dot(translation, previous))
+			{
+				Vec3 seam = normalize(cross(previous, normal));
+				translation = seam * dot(seam, translation);
+			}
+			previous = normal;
+		}
+		return position;
+	}
+
+	void PhysicsManager::moveCharacter(Character& character, const Vec3& displacement, const std::vector<uint32_t>& candidates) const
+	{
+		const Vec3 up(0.0f, 1.0f, 0.0f);
+		const Vec3 horizontal(displacement.x, 0.0f, displacement.z);
+		const bool was_grounded = UINT32_MAX != character._ground;
+		character._ground = UINT32_MAX;
+		character._ground_normal = up;
+
+		if (0.0f < displacement.y)
+		{
+			Vec3 position = slideCharacter(character, character._position, horizontal, true, candidates);
+			character._position = slideCharacter(character, position, up * displacement.y, false, candidates);
+			return;
+		}
+
+		// up a step, across, and back down onto walkable ground; a step
+		// that lands on a steep slope is taken again without it
+		const bool try_step = was_grounded && 0.0f < character._step_height && 0.0f < lengthSq(horizontal);
+		for (uint32_t attempt = try_step ? 0 : 1; attempt < 2; ++attempt)
+		{
+			Vec3 position = character._position;
+			float lift = 0.0f;
+			ShapeHit hit;
+			uint32_t body;
+			if (0 == attempt)
+			{
+				lift = character._step_height;
+				if (sweepCharacter(character, position, up * lift, candidates, hit, body))
+				{
+					lift = hit._t * lift - k_character_skin;
+					lift = 0.0f < lift ? lift : 0.0f;
+				}
+				position.y += lift;
+			}
+
+			position = slideCharacter(character, position, horizontal, true, candidates);
+
+			// back down by the lift and the fall, and while walking a bit further to stay on the ground
+			const float down = lift - displacement.y;
+			const float probe = down + (was_grounded ? character._snap_distance : 0.0f);
+			if (0.0f >= probe)
+			{
+				character._position = position;
+				return;
+			}
+
+			if (!sweepCharacter(character, position, up * -probe, candidates, hit, body))
+			{
+				position.y -= down;
+				character._position = position;
+				return;
+			}
+
+			Vec3 normal;
+			if (findGround(character, position, hit, body, normal))
+			{
+				const float clearance = hit._normal.y > character._min_ground_y ? hit._normal.y : character._min_ground_y;
+				const float drop = hit._t * probe - k_character_skin / clearance;
+				position.y -= 0.0f < drop ? drop : 0.0f;
+				character._position = position;
+				character._ground = _handle[body];
+				character._ground_normal = normal;
+				return;
+			}
+
+			if (0 == attempt)
+			{
+				continue;
+			}
+
+			// too steep to stand on, slide down it with what is left of the fall
+			character._position = slideCharacter(character, position, up * -down, false, candidates);
+		}
+	}
+
+	void PhysicsManager::moveCharacters(const CharacterMove* moves, uint32_t count)
+	{
+		const uint32_t range_count = (count + k_character_grain - 1) / k_character_grain;
+		if (_character_candidates.size() < range_count)
+		{
+			_character_candidates.resize(range_count);
+		}
+
+		auto fn = [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint32_t>& candidates = _character_candidates[begin / k_character_grain];
+			for (uint32_t ii = begin; ii < end; ++ii)
+			{
+				const CharacterMove& move = moves[ii];
+				Character& character = _characters[getCharacter(move._character)];
+				const Vec3 displacement(move._displacement);
+				gatherCandidates(character, displacement, candidates);
+				moveCharacter(character, displacement, candidates);
+			}
+		};
+		parallelFor(count, k_character_grain, fn);
 	}
-}
\ No newline at end of file
+}
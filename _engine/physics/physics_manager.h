@@ -1,17 +1,563 @@
 #ifndef __MONSTER_PHYSICS_MANAGER_H__
 #define __MONSTER_PHYSICS_MANAGER_H__
 
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+
+#include "core/job/job_system.h"
+#include "physics/broadphase.h"
+#include "physics/collision_shape.h"
+#include "physics/contact_solver.h"
+#include "physics/narrowphase.h"
+#include "physics/pair_set.h"
+#include "physics/shape_cast.h"
+
 namespace monster
 {
+	enum class BodyType : uint8_t
+	{
+		Static,
+		Kinematic,    // moved by its velocity only, pushes dynamic bodies
+		Dynamic
+	};
+
+	// Generational like TransformHandle: a slot is reused after
+	// destroyBody(), its generation is not, so stale handles fail isAlive().
+	struct BodyHandle { uint32_t idx; uint32_t generation; };
+	static const BodyHandle k_invalid_body = { UINT32_MAX, 0 };
+	inline bool isValid(BodyHandle handle) { return UINT32_MAX != handle.idx; }
+
+	struct BodyDesc
+	{
+		const CollisionShape* _shape;
+		BodyType _type;
+		float _position[3];            // center of mass
+		float _rotation[4];            // quaternion xyzw
+		float _linear_velocity[3];
+		float _angular_velocity[3];
+		float _density;
+		float _friction;
+		float _restitution;
+		float _linear_damping;
+		float _angular_damping;
+		bool _is_fast;                 // swept against static bodies only, for projectiles; can still pass through thin moving ones
+
+		BodyDesc();
+	};
+
+	struct RayCastInput
+	{
+		float _origin[3];
+		float _direction[3];           // normalized by the query
+		float _max_distance;
+	};
+
+	// Shape moved along _direction from the given transform.
+	struct SweepInput
+	{
+		const CollisionShape* _shape;
+		float _position[3];
+		float _rotation[4];
+		float _direction[3];           // normalized by the query
+		float _max_distance;
+	};
+
+	struct OverlapInput
+	{
+		const CollisionShape* _shape;
+		float _position[3];
+		float _rotation[4];
+	};
+
+	// Closest hit of a ray or sweep; _body is k_invalid_body for a miss.
+	struct QueryHit
+	{
+		BodyHandle _body;
+		float _position[3];
+		float _normal[3];              // out of the body that was hit
+		float _distance;
+	};
+
+	struct CharacterHandle { uint32_t idx; uint32_t generation; };
+	static const CharacterHandle k_invalid_character = { UINT32_MAX, 0 };
+	inline bool isValid(CharacterHandle handle) { return UINT32_MAX != handle.idx; }
+
+	struct CharacterDesc
+	{
+		const CollisionShape* _shape;  // capsule, kept upright
+		float _position[3];            // capsule center
+		float _max_slope;              // radians, steeper ground acts as a wall
+		float _step_height;
+		float _snap_distance;          // walking follows ground this far down
+
+		CharacterDesc();
+	};
+
+	struct CharacterMove
+	{
+		CharacterHandle _character;
+		float _displacement[3];        // wanted for this update, gravity included
+	};
+
+	// Where the last update's fixed steps went, summed over them, in
+	// milliseconds. Solve and integrate run together inside the island
+	// jobs, so theirs is the time of every job added up rather than wall
+	// clock. The counts are of the world as the last step left it.
+	struct PhysicsProfile
+	{
+		uint32_t _step_count;
+		float _step;
+		float _broadphase;             // bounds and new pairs
+		float _narrowphase;
+		float _islands;                // grouping, waking and coloring
+		float _solve;
+		float _integrate;
+		float _continuous;             // sweeping fast bodies
+		uint32_t _body_count;
+		uint32_t _awake_body_count;
+		uint32_t _proxy_count;
+		uint32_t _tree_height;         // 0 for sweep and prune
+		uint32_t _pair_count;          // overlapping fat boxes, touching or not
+		uint32_t _manifold_count;
+		uint32_t _point_count;
+		uint32_t _island_count;
+		uint32_t _awake_island_count;
+		uint32_t _colored_island_count;
+		uint32_t _largest_island;      // bodies of the largest awake island
+	};
+
+	class PhysicsDebugDraw;
+
+	// Rigid body world. Bodies live in parallel arrays indexed by a dense
+	// body index that handles map to, so the solver and integrator stream
+	// through memory. step() advances in fixed steps, each split into
+	// substeps that reuse the step's contacts: collide once, then per
+	// substep integrate velocities, warm start and solve soft contacts,
+	// integrate positions and relax. Contacts persist while the bodies'
+	// broadphase boxes overlap, in slots found by a PairSet, and keep
+	// their impulses there for warm starting.
+	//
+	// Touching contacts join bodies into islands, found with union-find
+	// every step; static bodies don't join islands. An island whose bodies
+	// have all been still for a while goes to sleep and costs nothing
+	// until an awake body touches it. Islands are solved as independent
+	// jobs, and a large island is graph colored so that each color's
+	// contacts share no dynamic body and are solved in parallel. The
+	// coloring doesn't depend on the thread count, so the same inputs give
+	// the same results with or without a job system.
+	//
+	// Static bodies may use baked triangle meshes (see CollisionMesh). A
+	// body touching a mesh gets a manifold per contact normal, up to
+	// four, so it can rest in a corner.
+	//
+	// Fast bodies that moved more than half their size in a step are swept
+	// from where they started against the static bodies the broadphase
+	// finds in the swept box, and stopped short of the first hit; the
+	// next step's speculative contact takes them from there. Only the
+	// translation is swept, and only against static bodies: kinematic and
+	// dynamic ones are left to the ordinary contacts, so a fast body can
+	// still pass through a thin moving door or crate, and two fast bodies
+	// can pass through each other. Worlds without fast bodies skip all of
+	// it.
+	//
+	// Characters are kinematic capsules moved by sliding sweeps against
+	// static bodies: up by the step height, across, then back down onto
+	// walkable ground. Dynamic bodies neither push nor block them.
+	//
+	// Scene queries come in batches run on the job system. Rays are traced
+	// four at a time through the broadphase, so rays next to each other in
+	// a batch should be alike, e.g. all of one AI agent's sight lines.
+	// Queries only read the world and must not overlap step().
+	//
+	// getProfile() reports stage timings, while profiling is on, and the
+	// pair, contact and island counts behind them; debugDraw() adds the
+	// world's shapes, contacts and broadphase boxes to a PhysicsDebugDraw.
 	class PhysicsManager
 	{
-		protected:
-		
-		public:
-			void initialize();
-			void clear();
-		
+	public:
+		static const uint32_t k_max_steps_per_update = 4;
+
+	private:
+		// A mesh pair can need several manifolds; the contact in the map
+		// heads a chain of extra ones that live and die with it.
+		struct Contact
+		{
+			uint32_t _a;    // handles, UINT32_MAX while the slot is free
+			uint32_t _b;
+			uint32_t _next; // next manifold of a mesh pair, UINT32_MAX at the end
+			uint32_t _next_link[2]; // heads only, neighbours in the lists of _a and of _b
+			uint32_t _prev_link[2]; // UINT32_MAX at the ends
+			bool _is_extra; // not the head of its chain
+			ContactManifold _manifold;
+		};
+
+		struct Island
+		{
+			uint32_t _first_body;       // into _island_bodies
+			uint32_t _body_count;
+			uint32_t _first_contact;    // into _touching and _constraints
+			uint32_t _contact_count;
+			uint32_t _first_color;      // into _colors, UINT32_MAX unless colored
+			bool _awake;
+		};
+
+		struct StepContext
+		{
+			SolverBodies _bodies;
+			ContactSoftness _softness;
+			float _h;
+			float _sub_h;
+		};
+
+		// bx::getHPCounter() ticks, summed over an update's steps
+		struct StepTimes
+		{
+			uint32_t _step_count;
+			int64_t _step;
+			int64_t _broadphase;
+			int64_t _narrowphase;
+			int64_t _islands;
+			int64_t _solve;
+			int64_t _integrate;
+			int64_t _continuous;
+		};
+
+		// per body, by body index
+		std::vector<Vec3> _position;
+		std::vector<Quat> _rotation;
+		std::vector<Vec3> _linear_velocity;
+		std::vector<Vec3> _angular_velocity;
+		std::vector<Vec3> _force;
+		std::vector<Vec3> _torque;
+		std::vector<float> _inv_mass;
+		std::vector<Mat3> _inv_inertia_local;
+		std::vector<Mat3> _inv_inertia;         // world space, as of the start of the step
+		std::vector<const CollisionShape*> _shape;
+		std::vector<BodyType> _type;
+		std::vector<float> _friction;
+		std::vector<float> _restitution;
+		std::vector<float> _linear_damping;
+		std::vector<float> _angular_damping;
+		std::vector<float> _sleep_time;         // how long the body has been nearly still
+		std::vector<uint8_t> _awake;            // always 0 for static bodies
+		std::vector<uint8_t> _fast;
+		std::vector<Aabb> _aabb;                // fattened by the speculative distance
+		std::vector<uint32_t> _proxy;
+		std::vector<uint32_t> _handle;          // body index -> handle
+
+		std::vector<uint32_t> _body;            // handle -> body index, UINT32_MAX when free
+		std::vector<uint32_t> _free_handles;
+		std::vector<uint32_t> _generation;      // per handle, kept by clear()
+		uint32_t _fast_count;                   // bodies with _fast set
+
+		DynamicTree _tree;
+		SweepAndPrune _sweep_and_prune;
+		Broadphase* _broadphase;
+		BroadphaseType _broadphase_type;
+
+		struct Character
+		{
+			const CollisionShape* _shape;
+			Vec3 _position;
+			Vec3 _ground_normal;
+			uint32_t _ground;           // body handle, UINT32_MAX in the air
+			float _min_ground_y;        // of a unit normal, from the max slope
+			float _step_height;
+			float _snap_distance;
+		};
+
+		std::vector<Character> _characters;
+		std::vector<uint32_t> _character_handle;        // character index -> handle
+		std::vector<uint32_t> _character_index;         // handle -> character index, UINT32_MAX when free
+		std::vector<uint32_t> _free_character_handles;
+		std::vector<uint32_t> _character_generation;    // per handle, kept by clear()
+
+		std::vector<Contact> _contacts;
+		std::vector<uint32_t> _free_contacts;
+		PairSet _contact_map;                   // handle pair -> contact
+		std::vector<uint32_t> _first_contact;   // per handle, its heads through _next_link
+
+		// loadState() reads into this and swaps it in only once it checks
+		// out, so it then holds the old state and rollbacks stop allocating
+		struct LoadedState
+		{
+			float _accumulator;
+			std::vector<Vec3> _position;
+			std::vector<Quat> _rotation;
+			std::vector<Vec3> _linear_velocity;
+			std::vector<Vec3> _angular_velocity;
+			std::vector<Vec3> _force;
+			std::vector<Vec3> _torque;
+			std::vector<float> _inv_mass;
+			std::vector<Mat3> _inv_inertia_local;
+			std::vector<Mat3> _inv_inertia;
+			std::vector<const CollisionShape*> _shape;
+			std::vector<BodyType> _type;
+			std::vector<float> _friction;
+			std::vector<float> _restitution;
+			std::vector<float> _linear_damping;
+			std::vector<float> _angular_damping;
+			std::vector<float> _sleep_time;
+			std::vector<uint8_t> _awake;
+			std::vector<uint8_t> _fast;
+			std::vector<Aabb> _aabb;
+			std::vector<uint32_t> _proxy;
+			std::vector<uint32_t> _handle;
+			std::vector<uint32_t> _body;
+			std::vector<uint32_t> _free_handles;
+			std::vector<uint32_t> _generation;
+			std::vector<Character> _characters;
+			std::vector<uint32_t> _character_handle;
+			std::vector<uint32_t> _character_index;
+			std::vector<uint32_t> _free_character_handles;
+			std::vector<uint32_t> _character_generation;
+			BroadphaseType _broadphase_type;
+			DynamicTree _tree;
+			SweepAndPrune _sweep_and_prune;
+			std::vector<Contact> _contacts;
+			std::vector<uint32_t> _free_contacts;
+			PairSet _contact_map;
+			std::vector<uint32_t> _first_contact;
+		};
+
+		LoadedState _loaded;
+
+		// step scratch, reused so stepping doesn't allocate once warmed up
+		std::vector<Vec3> _delta_position;
+		std::vector<Quat> _delta_rotation;
+		std::vector<ProxyPair> _new_pairs;
+		std::vector<uint32_t> _touching;        // contacts with points, by island once grouped
+		std::vector<ContactConstraint> _constraints;
+
+		// island scratch, by body index unless noted
+		std::vector<uint32_t> _island_parent;   // union-find
+		std::vector<uint32_t> _island_index;    // for island roots
+		std::vector<uint32_t> _island_bodies;
+		std::vector<uint32_t> _color_mask;
+		std::vector<uint8_t> _contact_color;    // by position in _touching
+		std::vector<uint32_t> _grouped;         // contacts by island, then by color
+		std::vector<Island> _islands;
+		std::vector<uint32_t> _small_islands;   // awake ones solved whole by one job
+		std::vector<uint32_t> _colored_islands;
+		std::vector<uint32_t> _colors;          // k_color_count + 2 offsets per colored island
+		StepContext _step;
+		std::vector<std::vector<uint32_t> > _character_candidates;   // per job range
+		std::vector<uint32_t> _fast_moving;     // body indices to sweep this step
+		std::vector<std::vector<uint32_t> > _fast_candidates;        // per job range
+
+		JobSystem* _job_system;
+
+		Vec3 _gravity;
+		float _fixed_dt;
+		float _accumulator;
+		uint32_t _substep_count;
+
+		StepTimes _times;
+		volatile int32_t _solve_ticks;          // of the step, added to by the island jobs
+		volatile int32_t _integrate_ticks;
+		bool _profiling;
+
+	private:
+		uint32_t getBody(BodyHandle handle) const
+		{
+			assert(isAlive(handle));
+			return _body[handle.idx];
+		}
+
+		uint32_t getCharacter(CharacterHandle handle) const
+		{
+			assert(isAlive(handle));
+			return _character_index[handle.idx];
+		}
+
+		BodyHandle makeHandle(uint32_t handle) const
+		{
+			BodyHandle result = { handle, _generation[handle] };
+			return result;
+		}
+
+		// Every array length, index and handle in _loaded in range, so a
+		// broken snapshot is turned away before any of it is used.
+		bool isValidLoad() const;
+		SolverBodies getSolverBodies();
+
+		void computeAabb(uint32_t index);
+		void wake(uint32_t index);
+		uint32_t createContact(uint32_t a, uint32_t b);
+		void destroyContact(uint32_t contact);
+		void linkContact(uint32_t contact);
+		void unlinkContact(uint32_t contact);
+		void findPairs(float h);
+		void collide();
+		void collideMesh(uint32_t contact);
+
+		uint32_t findRoot(uint32_t index);
+		void buildIslands();
+		void colorIsland(Island& island);
+
+		void integrateVelocities(const uint32_t* bodies, uint32_t count, float h);
+		void integratePositions(const uint32_t* bodies, uint32_t count, float h);
+		void prepareContacts(uint32_t first, uint32_t count);
+		void finishContacts(uint32_t first, uint32_t count);
+		void updateSleep(const Island& island);
+		int64_t getTicks() const;
+		void addTicks(int64_t solve, int64_t integrate);
+		void solveIslandBatch(const uint32_t* islands, uint32_t count, int64_t& integrate);
+		void solveColoredIsland(const Island& island);
+		static void solveIslands(void* data, uint32_t begin, uint32_t end);
+		void sweepFastBody(uint32_t index, std::vector<uint32_t>& candidates);
+		void sweepFastBodies();
+
+		struct RayCastContext
+		{
+			const PhysicsManager* _manager;
+			const RayCastInput* _rays;      // the packet's four
+			QueryHit* _hits;
+			Vec3 _direction[4];             // normalized
+		};
+
+		static void rayCastProxy(void* data, uint32_t proxy, uint32_t lanes, RayPacket& packet);
+
+		void gatherCandidates(const Character& character, const Vec3& displacement, std::vector<uint32_t>& candidates) const;
+		bool sweepCharacter(const Character& character, const Vec3& position, const Vec3& translation,
+			const std::vector<uint32_t>& candidates, ShapeHit& hit, uint32_t& body) const;
+		bool findGround(const Character& character, const Vec3& position, const ShapeHit& hit, uint32_t body, Vec3& normal) const;
+		Vec3 slideCharacter(const Character& character, Vec3 position, Vec3 translation, bool walls_only,
+			const std::vector<uint32_t>& candidates) const;
+		void moveCharacter(Character& character, const Vec3& displacement, const std::vector<uint32_t>& candidates) const;
+
+		Transform getTransform(uint32_t index) const { return Transform(_position[index], _rotation[index]); }
+
+		void simulate(float h);
+
+		template <class F>
+		void parallelFor(uint32_t count, uint32_t grain, F& fn) const
+		{
+			if (nullptr == _job_system || count <= grain)
+			{
+				fn(0, count);
+				return;
+			}
+			_job_system->parallelFor(count, grain, fn);
+		}
+
+	public:
+		PhysicsManager();
+
+		PhysicsManager(const PhysicsManager&) = delete;
+		PhysicsManager& operator = (const PhysicsManager&) = delete;
+
+		// Resets the settings to their defaults and removes every body.
+		// Without a job system everything runs on the calling thread.
+		void initialize(JobSystem* job_system = nullptr);
+		void clear();
+
+		void reserve(uint32_t body_count);
+
+		void setGravity(const float gravity[3]) { _gravity = Vec3(gravity); }
+		void setTimestep(float fixed_dt, uint32_t substep_count);
+
+		// The dynamic tree suits most worlds; sweep and prune is cheaper
+		// when nearly everything is static. Switching keeps the contacts.
+		void setBroadphase(BroadphaseType type);
+		BroadphaseType getBroadphaseType() const { return _broadphase_type; }
+		const Broadphase& getBroadphase() const { return *_broadphase; }
+
+		// Destroying wakes what touched the body and drops any character
+		// off it. Stale handles are ignored.
+		BodyHandle createBody(const BodyDesc& desc);
+		void destroyBody(BodyHandle handle);
+		bool isAlive(BodyHandle handle) const;
+		uint32_t getBodyCount() const { return (uint32_t)_handle.size(); }
+
+		void getPosition(BodyHandle handle, float position[3]) const;
+		void getRotation(BodyHandle handle, float rotation[4]) const;
+		void setTransform(BodyHandle handle, const float position[3], const float rotation[4]);
+
+		void getLinearVelocity(BodyHandle handle, float velocity[3]) const;
+		void setLinearVelocity(BodyHandle handle, const float velocity[3]);
+		void getAngularVelocity(BodyHandle handle, float velocity[3]) const;
+		void setAngularVelocity(BodyHandle handle, const float velocity[3]);
+
+		// Forces and torques act for the next fixed step, then are cleared.
+		void applyForce(BodyHandle handle, const float force[3]);
+		void applyTorque(BodyHandle handle, const float torque[3]);
+		void applyImpulse(BodyHandle handle, const float impulse[3], const float point[3]);
+
+		// Setting a transform or velocity, or applying a force, wakes the body too.
+		bool isAwake(BodyHandle handle) const { return 0 != _awake[getBody(handle)]; }
+		void wakeBody(BodyHandle handle);
+
+		// Runs as many fixed steps as dt covers, at most
+		// k_max_steps_per_update, and returns how many ran.
+		uint32_t step(float dt);
+
+		// Fraction of a fixed step left over, for interpolating rendering.
+		float getInterpolationAlpha() const { return _accumulator / _fixed_dt; }
+
+		// Batched scene queries, hits[ii] answers queries[ii]. Overlaps
+		// store at most capacity bodies per query, those of query ii from
+		// bodies + ii * capacity, and their number in counts[ii].
+		void rayCast(const RayCastInput* rays, uint32_t count, QueryHit* hits) const;
+		void sweep(const SweepInput* sweeps, uint32_t count, QueryHit* hits) const;
+		void overlap(const OverlapInput* queries, uint32_t count, BodyHandle* bodies, uint32_t capacity, uint32_t* counts) const;
+
+		bool rayCast(const RayCastInput& ray, QueryHit& hit) const
+		{
+			rayCast(&ray, 1, &hit);
+			return isValid(hit._body);
+		}
+
+		// Stale handles are ignored by destroyCharacter().
+		CharacterHandle createCharacter(const CharacterDesc& desc);
+		void destroyCharacter(CharacterHandle handle);
+		bool isAlive(CharacterHandle handle) const;
+		uint32_t getCharacterCount() const { return (uint32_t)_characters.size(); }
+
+		void getCharacterPosition(CharacterHandle handle, float position[3]) const;
+		void setCharacterPosition(CharacterHandle handle, const float position[3]);
+
+		// Body the last move ended standing on, k_invalid_body in the air.
+		BodyHandle getCharacterGround(CharacterHandle handle, float normal[3]) const;
+
+		// Moves a batch of characters on the job system, at most one move
+		// per character. Scratch is kept per job range, so a steady batch
+		// size allocates nothing. Must not overlap step().
+		void moveCharacters(const CharacterMove* moves, uint32_t count);
+
+		// Rollback snapshots. saveState() writes everything later steps
+		// depend on, characters, contacts with their warm starting
+		// impulses and the broadphase included, and loading it back
+		// replays bit for bit.
+		// Shapes are saved by pointer and the bytes are raw, so a snapshot
+		// only loads into this build while its shapes are alive. Gravity,
+		// the timestep and the job system are kept; the counters below
+		// catch up on the next step. A broken snapshot fails to load and
+		// leaves the world as it was.
+		void saveState(std::vector<uint8_t>& buffer) const;
+		bool loadState(const void* data, size_t size);
+
+		// Hash of the bodies and contact impulses, the same across runs of
+		// one build as long as the simulation is.
+		uint64_t computeStateHash() const;
+
+		// Touching contacts, sleeping ones included.
+		uint32_t getManifoldCount() const { return (uint32_t)_touching.size(); }
+		uint32_t getIslandCount() const { return (uint32_t)_islands.size(); }
+		uint32_t getAwakeIslandCount() const { return (uint32_t)(_small_islands.size() + _colored_islands.size()); }
+
+		// Timing reads the clock around every integration pass, so it is
+		// off by default; the profile's timings stay zero until it's on.
+		void setProfiling(bool enabled) { _profiling = enabled; }
+		bool isProfiling() const { return _profiling; }
+		void getProfile(PhysicsProfile& profile) const;
+
+		// Adds what flags (PhysicsDebugFlags) ask for to draw.
+		void debugDraw(PhysicsDebugDraw& draw, uint32_t flags) const;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
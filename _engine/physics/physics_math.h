@@ -0,0 +1,206 @@
+#ifndef __MONSTER_PHYSICS_MATH_H__
+#define __MONSTER_PHYSICS_MATH_H__
+
+#include <cmath>
+#include <cstdint>
+
+namespace monster
+{
+	// Small value types for the physics code. Everything is scalar and
+	// evaluated in a fixed order, so results only depend on the build.
+	struct Vec3
+	{
+		float x, y, z;
+
+		Vec3() {}
+		Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+		explicit Vec3(const float* v) : x(v[0]), y(v[1]), z(v[2]) {}
+
+		float& operator [] (uint32_t ii) { return (&x)[ii]; }
+		float operator [] (uint32_t ii) const { return (&x)[ii]; }
+
+		Vec3 operator - () const { return Vec3(-x, -y, -z); }
+		Vec3& operator += (const Vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+		Vec3& operator -= (const Vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+		Vec3& operator *= (float s) { x *= s; y *= s; z *= s; return *this; }
+	};
+
+	inline Vec3 operator + (const Vec3& a, const Vec3& b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline Vec3 operator - (const Vec3& a, const Vec3& b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline Vec3 operator * (const Vec3& a, float s) { return Vec3(a.x * s, a.y * s, a.z * s); }
+	inline Vec3 operator * (float s, const Vec3& a) { return Vec3(a.x * s, a.y * s, a.z * s); }
+
+	inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline Vec3 cross(const Vec3& a, const Vec3& b) { return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	inline Vec3 mul(const Vec3& a, const Vec3& b) { return Vec3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	inline Vec3 vmin(const Vec3& a, const Vec3& b) { return Vec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z); }
+	inline Vec3 vmax(const Vec3& a, const Vec3& b) { return Vec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z); }
+	inline Vec3 vabs(const Vec3& a) { return Vec3(fabsf(a.x), fabsf(a.y), fabsf(a.z)); }
+	inline float lengthSq(const Vec3& a) { return dot(a, a); }
+	inline float length(const Vec3& a) { return sqrtf(dot(a, a)); }
+
+	inline Vec3 normalize(const Vec3& a)
+	{
+		float len = length(a);
+		return 0.0f < len ? a * (1.0f / len) : Vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	// Two unit vectors completing n to an orthonormal basis.
+	inline void computeBasis(const Vec3& n, Vec3& t1, Vec3& t2)
+	{
+		if (fabsf(n.x) >= 0.57735f)
+		{
+			t1 = normalize(Vec3(n.y, -n.x, 0.0f));
+		}
+		else
+		{
+			t1 = normalize(Vec3(0.0f, n.z, -n.y));
+		}
+		t2 = cross(n, t1);
+	}
+
+	// xyzw, unit length
+	struct Quat
+	{
+		float x, y, z, w;
+
+		Quat() {}
+		Quat(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+
+		static Quat identity() { return Quat(0.0f, 0.0f, 0.0f, 1.0f); }
+	};
+
+	inline Quat operator * (const Quat& a, const Quat& b)
+	{
+		return Quat(
+			a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+			a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+			a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+			a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+	}
+
+	inline Quat conjugate(const Quat& q) { return Quat(-q.x, -q.y, -q.z, q.w); }
+
+	inline Quat normalize(const Quat& q)
+	{
+		float len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		float inv = 0.0f < len ? 1.0f / len : 0.0f;
+		return 0.0f < len ? Quat(q.x * inv, q.y * inv, q.z * inv, q.w * inv) : Quat::identity();
+	}
+
+	inline Vec3 rotate(const Quat& q, const Vec3& v)
+	{
+		Vec3 u(q.x, q.y, q.z);
+		Vec3 t = 2.0f * cross(u, v);
+		return v + q.w * t + cross(u, t);
+	}
+
+	inline Vec3 inverseRotate(const Quat& q, const Vec3& v)
+	{
+		return rotate(conjugate(q), v);
+	}
+
+	// q advanced by angular velocity w over h, first order and renormalized
+	inline Quat integrateRotation(const Quat& q, const Vec3& w, float h)
+	{
+		Quat dq = Quat(w.x, w.y, w.z, 0.0f) * q;
+		float half_h = 0.5f * h;
+		return normalize(Quat(q.x + dq.x * half_h, q.y + dq.y * half_h, q.z + dq.z * half_h, q.w + dq.w * half_h));
+	}
+
+	// Column vector convention: m * v, columns in c[3].
+	struct Mat3
+	{
+		Vec3 c[3];
+
+		static Mat3 zero()
+		{
+			Mat3 m;
+			m.c[0] = m.c[1] = m.c[2] = Vec3(0.0f, 0.0f, 0.0f);
+			return m;
+		}
+
+		static Mat3 diagonal(float x, float y, float z)
+		{
+			Mat3 m = zero();
+			m.c[0].x = x;
+			m.c[1].y = y;
+			m.c[2].z = z;
+			return m;
+		}
+	};
+
+	inline Vec3 operator * (const Mat3& m, const Vec3& v)
+	{
+		return m.c[0] * v.x + m.c[1] * v.y + m.c[2] * v.z;
+	}
+
+	inline Mat3 operator * (const Mat3& a, const Mat3& b)
+	{
+		Mat3 m;
+		m.c[0] = a * b.c[0];
+		m.c[1] = a * b.c[1];
+		m.c[2] = a * b.c[2];
+		return m;
+	}
+
+	inline Mat3 transpose(const Mat3& m)
+	{
+		Mat3 t;
+		t.c[0] = Vec3(m.c[0].x, m.c[1].x, m.c[2].x);
+		t.c[1] = Vec3(m.c[0].y, m.c[1].y, m.c[2].y);
+		t.c[2] = Vec3(m.c[0].z, m.c[1].z, m.c[2].z);
+		return t;
+	}
+
+	inline Mat3 toMatrix(const Quat& q)
+	{
+		Mat3 m;
+		m.c[0] = rotate(q, Vec3(1.0f, 0.0f, 0.0f));
+		m.c[1] = rotate(q, Vec3(0.0f, 1.0f, 0.0f));
+		m.c[2] = rotate(q, Vec3(0.0f, 0.0f, 1.0f));
+		return m;
+	}
+
+	// Inverse of a symmetric positive semi-definite matrix, zero when singular.
+	inline Mat3 inverse(const Mat3& m)
+	{
+		Vec3 r0 = cross(m.c[1], m.c[2]);
+		Vec3 r1 = cross(m.c[2], m.c[0]);
+		Vec3 r2 = cross(m.c[0], m.c[1]);
+		float det = dot(m.c[0], r0);
+		if (0.0f == det)
+		{
+			return Mat3::zero();
+		}
+
+		float inv = 1.0f / det;
+		Mat3 rows;
+		rows.c[0] = r0 * inv;
+		rows.c[1] = r1 * inv;
+		rows.c[2] = r2 * inv;
+		return transpose(rows);
+	}
+
+	// Rigid transform: rotation then translation.
+	struct Transform
+	{
+		Vec3 p;
+		Quat q;
+
+		Transform() {}
+		Transform(const Vec3& p_, const Quat& q_) : p(p_), q(q_) {}
+	};
+
+	inline Vec3 transformPoint(const Transform& xf, const Vec3& v) { return rotate(xf.q, v) + xf.p; }
+	inline Vec3 inverseTransformPoint(const Transform& xf, const Vec3& v) { return inverseRotate(xf.q, v - xf.p); }
+
+	// b relative to a: inverse(a) * b
+	inline Transform relativeTransform(const Transform& a, const Transform& b)
+	{
+		Quat qa = conjugate(a.q);
+		return Transform(rotate(qa, b.p - a.p), qa * b.q);
+	}
+}
+
+#endif
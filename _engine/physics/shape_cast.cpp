@@ -0,0 +1,344 @@
+#include "physics/shape_cast.h"
+
+#include "physics/collision_shape.h"
+#include "physics/gjk.h"
+
+namespace monster
+{
+	static const float k_epsilon = 1e-6f;
+	static const float k_cast_tolerance = 0.005f;
+	static const uint32_t k_max_cast_iterations = 20;
+
+	// local space rays from here on, direction need not be unit length
+	static bool raySphere(const Vec3& origin, const Vec3& direction, const Vec3& center, float radius, float max_t, float& t, Vec3& normal)
+	{
+		Vec3 m = origin - center;
+		float a = dot(direction, direction);
+		float b = dot(m, direction);
+		float c = dot(m, m) - radius * radius;
+		if (0.0f >= c)
+		{
+			t = 0.0f;
+			normal = -normalize(direction);
+			return true;
+		}
+
+		float discriminant = b * b - a * c;
+		if (0.0f < b || 0.0f > discriminant || k_epsilon > a)
+		{
+			return false;
+		}
+
+		t = (-b - sqrtf(discriminant)) / a;
+		if (t > max_t)
+		{
+			return false;
+		}
+
+		normal = normalize(m + direction * t);
+		return true;
+	}
+
+	static bool rayCapsule(const Vec3& origin, const Vec3& direction, const Vec3& p0, const Vec3& p1, float radius, float max_t, float& t, Vec3& normal)
+	{
+		Vec3 axis = p1 - p0;
+		float dd = dot(axis, axis);
+		if (k_epsilon > dd)
+		{
+			return raySphere(origin, direction, p0, radius, max_t, t, normal);
+		}
+
+		// infinite cylinder around the segment, scaled by dd to stay free of divisions
+		Vec3 m = origin - p0;
+		float md = dot(m, axis);
+		float inside = md < 0.0f ? 0.0f : (md > dd ? 1.0f : md / dd);
+		if (lengthSq(m - axis * inside) <= radius * radius)
+		{
+			t = 0.0f;
+			normal = -normalize(direction);
+			return true;
+		}
+
+		float nd = dot(direction, axis);
+		float a = dd * dot(direction, direction) - nd * nd;
+		float b = dd * dot(m, direction) - nd * md;
+		float c = dd * (dot(m, m) - radius * radius) - md * md;
+		if (k_epsilon * dd < a)
+		{
+			float discriminant = b * b - a * c;
+			if (0.0f > discriminant)
+			{
+				return false;
+			}
+
+			float t_side = (-b - sqrtf(discriminant)) / a;
+			float s = md + t_side * nd;
+			if (0.0f <= t_side && 0.0f <= s && s <= dd)
+			{
+				if (t_side > max_t)
+				{
+					return false;
+				}
+
+				t = t_side;
+				normal = normalize(m + direction * t_side - axis * (s / dd));
+				return true;
+			}
+		}
+
+		// the caps are inside the cylinder, so missing the side leaves them
+		float t0, t1;
+		Vec3 n0, n1;
+		bool hit0 = raySphere(origin, direction, p0, radius, max_t, t0, n0);
+		bool hit1 = raySphere(origin, direction, p1, radius, max_t, t1, n1);
+		if (hit0 && (!hit1 || t0 <= t1))
+		{
+			t = t0;
+			normal = n0;
+			return true;
+		}
+
+		t = t1;
+		normal = n1;
+		return hit1;
+	}
+
+	static bool rayHull(const ConvexHull& hull, const Vec3& origin, const Vec3& direction, float max_t, float& t, Vec3& normal)
+	{
+		float t_enter = 0.0f;
+		float t_exit = max_t;
+		uint32_t enter_face = UINT32_MAX;
+		for (uint32_t ii = 0; ii < hull.getFaceCount(); ++ii)
+		{
+			const HullFace& face = hull.getFace(ii);
+			float denom = dot(face._normal, direction);
+			float distance = dot(face._normal, origin) - face._offset;
+			if (0.0f == denom)
+			{
+				if (0.0f < distance)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			float t_face = -distance / denom;
+			if (0.0f > denom)
+			{
+				if (t_face > t_enter)
+				{
+					t_enter = t_face;
+					enter_face = ii;
+				}
+			}
+			else if (t_face < t_exit)
+			{
+				t_exit = t_face;
+			}
+
+			if (t_enter > t_exit)
+			{
+				return false;
+			}
+		}
+
+		t = t_enter;
+		normal = UINT32_MAX != enter_face ? hull.getFace(enter_face)._normal : -normalize(direction);
+		return true;
+	}
+
+	bool rayCastShape(const CollisionShape& shape, const Transform& xf, const Vec3& origin, const Vec3& direction, float max_t, ShapeHit& hit)
+	{
+		Vec3 local_origin = inverseTransformPoint(xf, origin);
+		Vec3 local_direction = inverseRotate(xf.q, direction);
+
+		float t;
+		Vec3 normal;
+		bool result;
+		if (ShapeType::Mesh == shape.getType())
+		{
+			ShapeHit local;
+			result = rayCastMesh(*shape.getMesh(), local_origin, local_direction, max_t, local);
+			t = local._t;
+			normal = local._normal;
+		}
+		else if (shape.isHull())
+		{
+			result = rayHull(shape.getHull(), local_origin, local_direction, max_t, t, normal);
+		}
+		else
+		{
+			const Vec3* core = shape.getCore();
+			result = rayCapsule(local_origin, local_direction, core[0], core[shape.getCoreCount() - 1], shape.getRadius(), max_t, t, normal);
+		}
+
+		if (!result)
+		{
+			return false;
+		}
+
+		hit._t = t;
+		hit._position = origin + direction * t;
+		hit._normal = rotate(xf.q, normal);
+		return true;
+	}
+
+	static bool castProxies(const GjkProxy& proxy_a, const Transform& xf_a, const Vec3& translation, const GjkProxy& proxy_b, const Transform& xf_b, ShapeHit& hit)
+	{
+		const float radius = proxy_a._radius + proxy_b._radius;
+
+		float t = 0.0f;
+		for (uint32_t iteration = 0; iteration < k_max_cast_iterations; ++iteration)
+		{
+			GjkOutput output;
+			gjkDistance(proxy_a, Transform(xf_a.p + translation * t, xf_a.q), proxy_b, xf_b, output);
+
+			// cores overlap, only possible when starting out that way
+			if (k_epsilon >= output._distance)
+			{
+				hit._t = t;
+				hit._position = output._point_b;
+				hit._normal = -normalize(translation);
+				return true;
+			}
+
+			Vec3 normal = (output._point_b - output._point_a) * (1.0f / output._distance);
+			float separation = output._distance - radius;
+			if (k_cast_tolerance >= separation)
+			{
+				hit._t = t;
+				hit._position = output._point_b - normal * proxy_b._radius;
+				hit._normal = -normal;
+				return true;
+			}
+
+			// b can't be closer than separation along normal, so this never steps past it
+			float closing = dot(translation, normal);
+			if (0.0f >= closing)
+			{
+				return false;
+			}
+
+			t += (separation - 0.5f * k_cast_tolerance) / closing;
+			if (1.0f < t)
+			{
+				return false;
+			}
+		}
+		return false;
+	}
+
+	// a swept or overlapped against the triangles of a mesh, one at a time
+	struct MeshCast
+	{
+		GjkProxy _proxy;
+		Transform _xf;              // of a, in mesh space
+		Vec3 _translation;          // in mesh space, zero for overlaps
+		const CollisionMesh* _mesh;
+		ShapeHit _hit;
+		bool _found;
+	};
+
+	static void castTriangle(void* data, uint32_t triangle)
+	{
+		MeshCast& cast = *(MeshCast*)data;
+		Vec3 v[3];
+		getTriangle(*cast._mesh, triangle, v);
+
+		const Transform identity(Vec3(0.0f, 0.0f, 0.0f), Quat::identity());
+		const GjkProxy proxy = { v, 3, 0.0f };
+		ShapeHit hit;
+		if (castProxies(cast._proxy, cast._xf, cast._translation, proxy, identity, hit)
+			&& (!cast._found || hit._t < cast._hit._t))
+		{
+			cast._hit = hit;
+			cast._found = true;
+		}
+	}
+
+	static void overlapTriangle(void* data, uint32_t triangle)
+	{
+		MeshCast& cast = *(MeshCast*)data;
+		if (cast._found)
+		{
+			return;
+		}
+
+		Vec3 v[3];
+		getTriangle(*cast._mesh, triangle, v);
+
+		const Transform identity(Vec3(0.0f, 0.0f, 0.0f), Quat::identity());
+		const GjkProxy proxy = { v, 3, 0.0f };
+		GjkOutput output;
+		gjkDistance(cast._proxy, cast._xf, proxy, identity, output);
+		cast._found = output._distance <= cast._proxy._radius;
+	}
+
+	// a's bounds in mesh space, grown along the translation
+	static void startMeshCast(MeshCast& cast, const CollisionShape& a, const Transform& xf_a, const Vec3& translation, const CollisionShape& b, const Transform& xf_b, Aabb& aabb)
+	{
+		cast._proxy = makeProxy(a);
+		cast._xf = relativeTransform(xf_b, xf_a);
+		cast._translation = inverseRotate(xf_b.q, translation);
+		cast._mesh = b.getMesh();
+		cast._found = false;
+
+		a.computeAabb(cast._xf, aabb);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			aabb.m_min[axis] += cast._translation[axis] < 0.0f ? cast._translation[axis] : 0.0f;
+			aabb.m_max[axis] += cast._translation[axis] > 0.0f ? cast._translation[axis] : 0.0f;
+		}
+	}
+
+	bool castShape(const CollisionShape& a, const Transform& xf_a, const Vec3& translation, const CollisionShape& b, const Transform& xf_b, ShapeHit& hit)
+	{
+		if (ShapeType::Mesh == a.getType())
+		{
+			return false;
+		}
+
+		if (ShapeType::Mesh != b.getType())
+		{
+			return castProxies(makeProxy(a), xf_a, translation, makeProxy(b), xf_b, hit);
+		}
+
+		MeshCast cast;
+		Aabb aabb;
+		startMeshCast(cast, a, xf_a, translation, b, xf_b, aabb);
+		queryMesh(*cast._mesh, aabb, castTriangle, &cast);
+		if (!cast._found)
+		{
+			return false;
+		}
+
+		hit._t = cast._hit._t;
+		hit._position = transformPoint(xf_b, cast._hit._position);
+		hit._normal = rotate(xf_b.q, cast._hit._normal);
+		return true;
+	}
+
+	bool overlapShapes(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b)
+	{
+		if (ShapeType::Mesh == a.getType())
+		{
+			return false;
+		}
+
+		if (ShapeType::Mesh == b.getType())
+		{
+			MeshCast cast;
+			Aabb aabb;
+			startMeshCast(cast, a, xf_a, Vec3(0.0f, 0.0f, 0.0f), b, xf_b, aabb);
+			queryMesh(*cast._mesh, aabb, overlapTriangle, &cast);
+			return cast._found;
+		}
+
+		const GjkProxy proxy_a = makeProxy(a);
+		const GjkProxy proxy_b = makeProxy(b);
+
+		GjkOutput output;
+		gjkDistance(proxy_a, xf_a, proxy_b, xf_b, output);
+		return output._distance <= proxy_a._radius + proxy_b._radius;
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef __MONSTER_SHAPE_CAST_H__
+#define __MONSTER_SHAPE_CAST_H__
+
+#include <cstdint>
+
+#include "physics/physics_math.h"
+
+namespace monster
+{
+	class CollisionShape;
+
+	struct ShapeHit
+	{
+		float _t;              // along the ray or translation
+		Vec3 _position;        // on the surface of the shape that was hit, world space
+		Vec3 _normal;          // out of that shape
+	};
+
+	// Ray origin + t * direction against shape at xf, for t in [0, max_t].
+	// A ray starting inside hits at t = 0, facing back along direction.
+	bool rayCastShape(const CollisionShape& shape, const Transform& xf, const Vec3& origin, const Vec3& direction, float max_t, ShapeHit& hit);
+
+	// First contact of a moved from xf_a by t * translation, for t in
+	// [0, 1], with b. Shapes that start out touching hit at t = 0. Found
+	// by conservative advancement on the GJK distance, so only the
+	// translation is swept. b may be a mesh, tested triangle by triangle;
+	// a may not.
+	bool castShape(const CollisionShape& a, const Transform& xf_a, const Vec3& translation, const CollisionShape& b, const Transform& xf_b, ShapeHit& hit);
+
+	// True when the shapes touch or overlap. b may be a mesh, a may not.
+	bool overlapShapes(const CollisionShape& a, const Transform& xf_a, const CollisionShape& b, const Transform& xf_b);
+}
+
+#endif
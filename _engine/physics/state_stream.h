@@ -0,0 +1,112 @@
+#ifndef __MONSTER_STATE_STREAM_H__
+#define __MONSTER_STATE_STREAM_H__
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace monster
+{
+	// Raw copies of trivially copyable state into a flat buffer, for
+	// rolling a world back within one run of one build. Nothing is
+	// converted, so it is no format for disk or the network. Writing
+	// appends, so a buffer that is cleared and reused stops allocating.
+	class StateWriter
+	{
+	private:
+		std::vector<uint8_t>& _buffer;
+
+	public:
+		explicit StateWriter(std::vector<uint8_t>& buffer) : _buffer(buffer) {}
+
+		void write(const void* data, size_t size)
+		{
+			const size_t offset = _buffer.size();
+			_buffer.resize(offset + size);
+			if (0 < size)
+			{
+				memcpy(&_buffer[offset], data, size);
+			}
+		}
+
+		template <class T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state is copied as bytes");
+			write(&value, sizeof(T));
+		}
+
+		template <class T>
+		void write(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state is copied as bytes");
+			const uint32_t count = (uint32_t)values.size();
+			write(count);
+			write(values.data(), sizeof(T) * count);
+		}
+	};
+
+	// Reads back what a StateWriter wrote, in the same order. Running past
+	// the end marks the stream invalid and reads zeros from then on.
+	class StateReader
+	{
+	private:
+		const uint8_t* _data;
+		const uint8_t* _end;
+		bool _valid;
+
+	public:
+		StateReader(const void* data, size_t size)
+			: _data((const uint8_t*)data)
+			, _end((const uint8_t*)data + size)
+			, _valid(true)
+		{
+		}
+
+		bool isValid() const { return _valid; }
+		bool isAtEnd() const { return _data == _end; }
+
+		void read(void* data, size_t size)
+		{
+			if (!_valid || (size_t)(_end - _data) < size)
+			{
+				_valid = false;
+				memset(data, 0, size);
+				return;
+			}
+
+			if (0 < size)
+			{
+				memcpy(data, _data, size);
+			}
+			_data += size;
+		}
+
+		template <class T>
+		void read(T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state is copied as bytes");
+			read(&value, sizeof(T));
+		}
+
+		template <class T>
+		void read(std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state is copied as bytes");
+			uint32_t count = 0;
+			read(count);
+			if (!_valid || (size_t)(_end - _data) / sizeof(T) < count)
+			{
+				_valid = false;
+				values.clear();
+				return;
+			}
+
+			values.resize(count);
+			read(values.data(), sizeof(T) * count);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,752 @@
+#include "resource/asset_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <bx/hash.h>
+#include <bx/readerwriter.h>
+
+#if MONSTER_PLATFORM_LINUX
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace bgfx
+{
+	int32_t read(bx::ReaderI* _reader, bgfx::VertexDecl& _decl);
+}
+
+namespace monster
+{
+#define MONSTER_CHUNK_MAGIC_VB  BX_MAKEFOURCC('V', 'B', ' ', 0x1)
+#define MONSTER_CHUNK_MAGIC_IB  BX_MAKEFOURCC('I', 'B', ' ', 0x0)
+#define MONSTER_CHUNK_MAGIC_PRI BX_MAKEFOURCC('P', 'R', 'I', 0x0)
+
+	// sphere + aabb + obb written by geometryc in front of every group and primitive
+	static const int64_t k_mesh_bounds_size = sizeof(float) * (4 + 6 + 16);
+
+	static bool readFile(const char* path, std::vector<uint8_t>& data)
+	{
+		FILE* file = fopen(path, "rb");
+		if (nullptr == file)
+		{
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		data.resize(size > 0 ? size : 0);
+		size_t read = data.empty() ? 0 : fread(&data[0], 1, data.size(), file);
+		fclose(file);
+
+		return read == data.size();
+	}
+
+	static uint32_t hashString(const char* str)
+	{
+		bx::HashMurmur2A murmur;
+		murmur.begin();
+		murmur.add(str, (int)strlen(str));
+		return murmur.end();
+	}
+
+	static uint32_t hashContent(const std::vector<uint8_t>& data)
+	{
+		bx::HashMurmur2A murmur;
+		murmur.begin();
+		murmur.add(data.empty() ? nullptr : &data[0], (int)data.size());
+		return murmur.end();
+	}
+
+	// the terminators keep "ab" + "c" apart from "a" + "bc"
+	static void makeName(const char* path, const char* path2, std::string& name)
+	{
+		name.assign(path, strlen(path) + 1);
+		name.append(path2, strlen(path2) + 1);
+	}
+
+	static uint32_t hashKey(AssetType type, uint32_t flags, const std::string& name)
+	{
+		bx::HashMurmur2A murmur;
+		murmur.begin();
+		murmur.add((uint8_t)type);
+		murmur.add(flags);
+		murmur.add(name.data(), (int)name.size());
+		return murmur.end();
+	}
+
+	static void destroyGroup(const Mesh::Group& group)
+	{
+		if (bgfx::isValid(group._vbh))
+		{
+			bgfx::destroyVertexBuffer(group._vbh);
+		}
+		if (bgfx::isValid(group._ibh))
+		{
+			bgfx::destroyIndexBuffer(group._ibh);
+		}
+	}
+
+	static const bgfx::Memory* copyTerminated(const std::vector<uint8_t>& data)
+	{
+		const bgfx::Memory* mem = bgfx::alloc((uint32_t)data.size() + 1);
+		if (!data.empty())
+		{
+			memcpy(mem->data, &data[0], data.size());
+		}
+		mem->data[mem->size - 1] = '\0';
+		return mem;
+	}
+
+	bool Mesh::load(const void* data, uint32_t size)
+	{
+		bx::MemoryReader reader(data, size);
+
+		Group group;
+		group._vbh.idx = bgfx::invalidHandle;
+		group._ibh.idx = bgfx::invalidHandle;
+
+		uint32_t chunk;
+		while (4 == bx::read(&reader, chunk))
+		{
+			switch (chunk)
+			{
+				case MONSTER_CHUNK_MAGIC_VB:
+				{
+					bx::skip(&reader, k_mesh_bounds_size);
+					bgfx::read(&reader, _decl);
+
+					uint16_t num_vertices;
+					bx::read(&reader, num_vertices);
+					const bgfx::Memory* mem = bgfx::alloc(num_vertices * _decl.getStride());
+					bx::read(&reader, mem->data, mem->size);
+					group._vbh = bgfx::createVertexBuffer(mem, _decl);
+				}
+				break;
+
+				case MONSTER_CHUNK_MAGIC_IB:
+				{
+					uint32_t num_indices;
+					bx::read(&reader, num_indices);
+					const bgfx::Memory* mem = bgfx::alloc(num_indices * 2);
+					bx::read(&reader, mem->data, mem->size);
+					group._ibh = bgfx::createIndexBuffer(mem);
+				}
+				break;
+
+				case MONSTER_CHUNK_MAGIC_PRI:
+				{
+					uint16_t len;
+					bx::read(&reader, len);
+					bx::skip(&reader, len); // material
+
+					uint16_t num;
+					bx::read(&reader, num);
+					for (uint32_t ii = 0; ii < num; ++ii)
+					{
+						bx::read(&reader, len);
+						bx::skip(&reader, len); // name
+
+						Primitive prim;
+						bx::read(&reader, prim._start_index);
+						bx::read(&reader, prim._num_indices);
+						bx::read(&reader, prim._start_vertex);
+						bx::read(&reader, prim._num_vertices);
+						bx::skip(&reader, k_mesh_bounds_size);
+						group._prims.push_back(prim);
+					}
+
+					_groups.push_back(group);
+					group._vbh.idx = bgfx::invalidHandle;
+					group._ibh.idx = bgfx::invalidHandle;
+					group._prims.clear();
+				}
+				break;
+
+				default:
+				{
+					// compressed index buffers need ib-compress which the engine doesn't link
+					destroyGroup(group);
+					unload();
+					return false;
+				}
+			}
+		}
+
+		// buffers of a group without primitives are never drawn
+		destroyGroup(group);
+		return !_groups.empty();
+	}
+
+	void Mesh::unload()
+	{
+		for (const Group& group : _groups)
+		{
+			destroyGroup(group);
+		}
+		_groups.clear();
+	}
+
+	AssetCache::AssetCache() : _notify_fd(-1), _quit(false)
+	{
+	}
+
+	AssetCache::~AssetCache()
+	{
+		clear();
+	}
+
+	void AssetCache::initialize(bool hot_reload)
+	{
+#if MONSTER_PLATFORM_LINUX
+		if (hot_reload)
+		{
+			_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (0 <= _notify_fd)
+			{
+				_quit = false;
+				_watcher.init(watcherFunc, this);
+			}
+		}
+#else
+		(void)hot_reload;
+#endif
+	}
+
+	void AssetCache::clear()
+	{
+		if (_watcher.isRunning())
+		{
+			_quit = true;
+			_watcher.shutdown();
+		}
+
+#if MONSTER_PLATFORM_LINUX
+		if (0 <= _notify_fd)
+		{
+			close(_notify_fd);
+			_notify_fd = -1;
+		}
+#endif
+
+		MutexScope lock(_mutex);
+		while (0 != _handles.getNumHandles())
+		{
+			uint16_t idx = _handles.getHandleAt(0);
+			destroyResource(_entries[idx]);
+			_entries[idx]._name.clear();
+			_entries[idx]._path.clear();
+			_entries[idx]._path_hash = 0;
+			_handles.free(idx);
+		}
+
+		_lookup.clear();
+		_watches.clear();
+		_reloads.clear();
+	}
+
+	AssetHandle AssetCache::acquire(AssetType type, const char* path, const char* path2, uint32_t flags, bool& is_new)
+	{
+		std::string name;
+		makeName(path, path2, name);
+		const uint32_t key = hashKey(type, flags, name);
+
+		// different assets can share a key, the name tells them apart
+		for (auto range = _lookup.equal_range(key); range.first != range.second; ++range.first)
+		{
+			Entry& entry = _entries[range.first->second];
+			if (type == entry._type
+				&& flags == entry._flags
+				&& name == entry._name)
+			{
+				++entry._ref_count;
+				is_new = false;
+				return { range.first->second };
+			}
+		}
+
+		is_new = true;
+
+		MutexScope lock(_mutex);
+		uint16_t idx = _handles.alloc();
+		if (HandleAllocT<k_max_asset_count>::invalid == idx)
+		{
+			return { UINT16_MAX };
+		}
+
+		Entry& entry = _entries[idx];
+		entry._path = '\0' == *path2 ? path : "";   // a program has no file of its own to watch
+		entry._path_hash = hashString(entry._path.c_str());
+		entry._name.swap(name);
+		entry._key = key;
+		entry._content_hash = 0;
+		entry._flags = flags;
+		entry._ref_count = 1;
+		entry._type = type;
+		entry._idx = bgfx::invalidHandle;
+		entry._deps[0] = UINT16_MAX;
+		entry._deps[1] = UINT16_MAX;
+		entry._mesh = nullptr;
+
+		_lookup.insert(std::make_pair(key, idx));
+		return { idx };
+	}
+
+	bool AssetCache::import(uint16_t idx, const std::vector<uint8_t>& data)
+	{
+		Entry& entry = _entries[idx];
+
+		switch (entry._type)
+		{
+			case AssetType::Texture:
+			{
+				bgfx::TextureHandle handle = bgfx::createTexture(bgfx::copy(data.empty() ? nullptr : &data[0], (uint32_t)data.size()), entry._flags);
+				if (!bgfx::isValid(handle))
+				{
+					return false;
+				}
+
+				destroyResource(entry);
+				entry._idx = handle.idx;
+			}
+			break;
+
+			case AssetType::Shader:
+			{
+				bgfx::ShaderHandle handle = bgfx::createShader(copyTerminated(data));
+				if (!bgfx::isValid(handle))
+				{
+					return false;
+				}
+
+				bgfx::ShaderHandle old = { entry._idx };
+				entry._idx = handle.idx;
+
+				// relink programs before the shader they were built from goes away
+				for (uint16_t ii = 0, num = _handles.getNumHandles(); ii < num; ++ii)
+				{
+					uint16_t program = _handles.getHandleAt(ii);
+					if (AssetType::Program == _entries[program]._type
+						&& (idx == _entries[program]._deps[0] || idx == _entries[program]._deps[1]))
+					{
+						import(program, data);
+					}
+				}
+
+				if (bgfx::isValid(old))
+				{
+					bgfx::destroyShader(old);
+				}
+			}
+			break;
+
+			case AssetType::Program:
+			{
+				bgfx::ShaderHandle vsh = getShader({ entry._deps[0] });
+				bgfx::ShaderHandle fsh = getShader({ entry._deps[1] });
+				if (!bgfx::isValid(vsh)
+					|| !bgfx::isValid(fsh))
+				{
+					return false;
+				}
+
+				bgfx::ProgramHandle handle = bgfx::createProgram(vsh, fsh, false);
+				if (!bgfx::isValid(handle))
+				{
+					return false;
+				}
+
+				destroyResource(entry);
+				entry._idx = handle.idx;
+			}
+			break;
+
+			case AssetType::Mesh:
+			{
+				Mesh* mesh = new Mesh;
+				if (data.empty()
+					|| !mesh->load(&data[0], (uint32_t)data.size()))
+				{
+					delete mesh;
+					return false;
+				}
+
+				destroyResource(entry);
+				entry._mesh = mesh;
+			}
+			break;
+
+			default:
+				return false;
+		}
+
+		return true;
+	}
+
+	void AssetCache::destroyResource(Entry& entry)
+	{
+		switch (entry._type)
+		{
+			case AssetType::Texture:
+			{
+				bgfx::TextureHandle handle = { entry._idx };
+				if (bgfx::isValid(handle))
+				{
+					bgfx::destroyTexture(handle);
+				}
+			}
+			break;
+
+			case AssetType::Shader:
+			{
+				bgfx::ShaderHandle handle = { entry._idx };
+				if (bgfx::isValid(handle))
+				{
+					bgfx::destroyShader(handle);
+				}
+			}
+			break;
+
+			case AssetType::Program:
+			{
+				bgfx::ProgramHandle handle = { entry._idx };
+				if (bgfx::isValid(handle))
+				{
+					bgfx::destroyProgram(handle);
+				}
+			}
+			break;
+
+			case AssetType::Mesh:
+			{
+				if (nullptr != entry._mesh)
+				{
+					entry._mesh->unload();
+					delete entry._mesh;
+				}
+			}
+			break;
+
+			default:
+				break;
+		}
+
+		entry._idx = bgfx::invalidHandle;
+		entry._mesh = nullptr;
+	}
+
+	AssetHandle AssetCache::loadTexture(const char* path, uint32_t flags)
+	{
+		bool is_new;
+		AssetHandle handle = acquire(AssetType::Texture, path, "", flags, is_new);
+		if (!is_new
+			|| !isValid(handle))
+		{
+			return handle;
+		}
+
+		std::vector<uint8_t> data;
+		if (!readFile(path, data)
+			|| !import(handle.idx, data))
+		{
+			release(handle);
+			return { UINT16_MAX };
+		}
+
+		_entries[handle.idx]._content_hash = hashContent(data);
+		watch(path);
+		return handle;
+	}
+
+	AssetHandle AssetCache::loadShader(const char* path)
+	{
+		bool is_new;
+		AssetHandle handle = acquire(AssetType::Shader, path, "", 0, is_new);
+		if (!is_new
+			|| !isValid(handle))
+		{
+			return handle;
+		}
+
+		std::vector<uint8_t> data;
+		if (!readFile(path, data)
+			|| !import(handle.idx, data))
+		{
+			release(handle);
+			return { UINT16_MAX };
+		}
+
+		_entries[handle.idx]._content_hash = hashContent(data);
+		watch(path);
+		return handle;
+	}
+
+	AssetHandle AssetCache::loadProgram(const char* vs_path, const char* fs_path)
+	{
+		bool is_new;
+		AssetHandle handle = acquire(AssetType::Program, vs_path, fs_path, 0, is_new);
+		if (!is_new
+			|| !isValid(handle))
+		{
+			return handle;
+		}
+
+		AssetHandle vsh = loadShader(vs_path);
+		AssetHandle fsh = loadShader(fs_path);
+		_entries[handle.idx]._deps[0] = vsh.idx;
+		_entries[handle.idx]._deps[1] = fsh.idx;
+
+		if (!import(handle.idx, std::vector<uint8_t>()))
+		{
+			release(handle);
+			return { UINT16_MAX };
+		}
+
+		return handle;
+	}
+
+	AssetHandle AssetCache::loadMesh(const char* path)
+	{
+		bool is_new;
+		AssetHandle handle = acquire(AssetType::Mesh, path, "", 0, is_new);
+		if (!is_new
+			|| !isValid(handle))
+		{
+			return handle;
+		}
+
+		std::vector<uint8_t> data;
+		if (!readFile(path, data)
+			|| !import(handle.idx, data))
+		{
+			release(handle);
+			return { UINT16_MAX };
+		}
+
+		_entries[handle.idx]._content_hash = hashContent(data);
+		watch(path);
+		return handle;
+	}
+
+	// failed loads hand out the invalid handle, which may come straight back
+	static bool isInRange(AssetHandle handle)
+	{
+		return isValid(handle) && AssetCache::k_max_asset_count > handle.idx;
+	}
+
+	void AssetCache::retain(AssetHandle handle)
+	{
+		if (!isInRange(handle)
+			|| !_handles.isValid(handle.idx))
+		{
+			return;
+		}
+
+		++_entries[handle.idx]._ref_count;
+	}
+
+	void AssetCache::release(AssetHandle handle)
+	{
+		if (!isInRange(handle)
+			|| !_handles.isValid(handle.idx))
+		{
+			return;
+		}
+
+		Entry& entry = _entries[handle.idx];
+		if (0 != --entry._ref_count)
+		{
+			return;
+		}
+
+		destroyResource(entry);
+
+		for (uint16_t dep : entry._deps)
+		{
+			if (UINT16_MAX != dep)
+			{
+				release({ dep });
+			}
+		}
+
+		for (auto range = _lookup.equal_range(entry._key); range.first != range.second; ++range.first)
+		{
+			if (handle.idx == range.first->second)
+			{
+				_lookup.erase(range.first);
+				break;
+			}
+		}
+
+		MutexScope lock(_mutex);
+		entry._name.clear();
+		entry._path.clear();
+		entry._path_hash = 0;
+		_handles.free(handle.idx);
+	}
+
+	bgfx::TextureHandle AssetCache::getTexture(AssetHandle handle) const
+	{
+		bgfx::TextureHandle result = { isInRange(handle) ? _entries[handle.idx]._idx : bgfx::invalidHandle };
+		return result;
+	}
+
+	bgfx::ShaderHandle AssetCache::getShader(AssetHandle handle) const
+	{
+		bgfx::ShaderHandle result = { isInRange(handle) ? _entries[handle.idx]._idx : bgfx::invalidHandle };
+		return result;
+	}
+
+	bgfx::ProgramHandle AssetCache::getProgram(AssetHandle handle) const
+	{
+		bgfx::ProgramHandle result = { isInRange(handle) ? _entries[handle.idx]._idx : bgfx::invalidHandle };
+		return result;
+	}
+
+	const Mesh* AssetCache::getMesh(AssetHandle handle) const
+	{
+		return isInRange(handle) ? _entries[handle.idx]._mesh : nullptr;
+	}
+
+	void AssetCache::update()
+	{
+		std::vector<Reload> reloads;
+		{
+			MutexScope lock(_mutex);
+			reloads.swap(_reloads);
+		}
+
+		for (const Reload& reload : reloads)
+		{
+			// the entry may have been released, or its slot reused, while the file was being read
+			const Entry& entry = _entries[reload._entry];
+			if (!_handles.isValid(reload._entry)
+				|| entry._path_hash != reload._path_hash
+				|| entry._content_hash == reload._content_hash)
+			{
+				continue;
+			}
+
+			if (import(reload._entry, reload._data))
+			{
+				_entries[reload._entry]._content_hash = reload._content_hash;
+			}
+		}
+	}
+
+	void AssetCache::watch(const char* path)
+	{
+#if MONSTER_PLATFORM_LINUX
+		if (0 > _notify_fd)
+		{
+			return;
+		}
+
+		const char* slash = strrchr(path, '/');
+		std::string dir = nullptr != slash ? std::string(path, slash - path) : std::string(".");
+
+		MutexScope lock(_mutex);
+		for (const auto& it : _watches)
+		{
+			if (it.second == dir)
+			{
+				return;
+			}
+		}
+
+		int32_t wd = inotify_add_watch(_notify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (0 <= wd)
+		{
+			_watches[wd] = nullptr != slash ? dir : std::string();
+		}
+#else
+		(void)path;
+#endif
+	}
+
+	void AssetCache::watcherProcess()
+	{
+#if MONSTER_PLATFORM_LINUX
+		alignas(inotify_event) char buffer[4096];
+
+		while (!_quit)
+		{
+			pollfd pfd = { _notify_fd, POLLIN, 0 };
+			if (0 >= poll(&pfd, 1, 100))
+			{
+				continue;
+			}
+
+			ssize_t len = ::read(_notify_fd, buffer, sizeof(buffer));
+			for (ssize_t offset = 0; offset < len; )
+			{
+				const inotify_event* ev = (const inotify_event*)&buffer[offset];
+				offset += sizeof(inotify_event) + ev->len;
+
+				if (0 == ev->len)
+				{
+					continue;
+				}
+
+				std::string path;
+				uint32_t path_hash = 0;
+				std::vector<uint16_t> targets;
+				{
+					MutexScope lock(_mutex);
+					auto it = _watches.find(ev->wd);
+					if (it == _watches.end())
+					{
+						continue;
+					}
+
+					path = it->second.empty() ? std::string(ev->name) : it->second + "/" + ev->name;
+					path_hash = hashString(path.c_str());
+
+					for (uint16_t ii = 0, num = _handles.getNumHandles(); ii < num; ++ii)
+					{
+						uint16_t idx = _handles.getHandleAt(ii);
+						if (path_hash == _entries[idx]._path_hash
+							&& path == _entries[idx]._path)
+						{
+							targets.push_back(idx);
+						}
+					}
+				}
+
+				if (targets.empty())
+				{
+					continue;
+				}
+
+				std::vector<uint8_t> data;
+				if (!readFile(path.c_str(), data))
+				{
+					continue;
+				}
+
+				uint32_t content_hash = hashContent(data);
+
+				MutexScope lock(_mutex);
+				for (uint16_t idx : targets)
+				{
+					Reload reload;
+					reload._entry = idx;
+					reload._path_hash = path_hash;
+					reload._content_hash = content_hash;
+					reload._data = data;
+					_reloads.push_back(std::move(reload));
+				}
+			}
+		}
+#endif
+	}
+
+	int32_t AssetCache::watcherFunc(void* user_data)
+	{
+		AssetCache* cache = (AssetCache*)user_data;
+		cache->watcherProcess();
+		return 0;
+	}
+}
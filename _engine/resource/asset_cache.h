@@ -0,0 +1,136 @@
+#ifndef __MONSTER_ASSET_CACHE_H__
+#define __MONSTER_ASSET_CACHE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "bgfx.h"
+#include "core/mutex.h"
+#include "core/thread.h"
+#include "core/memory/handle_allocator.h"
+
+namespace monster
+{
+	enum class AssetType : uint8_t
+	{
+		Texture,
+		Shader,
+		Program,
+		Mesh,
+
+		k_count
+	};
+
+	struct AssetHandle { uint16_t idx; };
+	inline bool isValid(AssetHandle handle) { return UINT16_MAX != handle.idx; }
+
+	class Mesh
+	{
+	public:
+		struct Primitive
+		{
+			uint32_t _start_index;
+			uint32_t _num_indices;
+			uint32_t _start_vertex;
+			uint32_t _num_vertices;
+		};
+
+		struct Group
+		{
+			bgfx::VertexBufferHandle _vbh;
+			bgfx::IndexBufferHandle _ibh;
+			std::vector<Primitive> _prims;
+		};
+
+		bgfx::VertexDecl _decl;
+		std::vector<Group> _groups;
+
+		bool load(const void* data, uint32_t size);
+		void unload();
+	};
+
+	// Deduplicates asset loads by path and reference-counts the bgfx
+	// handles behind them. Changed files are re-imported on a background
+	// thread and swapped in by update(), which must be called once per frame
+	// before any draw call uses the cached handles.
+	class AssetCache
+	{
+	public:
+		static const uint16_t k_max_asset_count = 4096;
+
+	private:
+		struct Entry
+		{
+			std::string _path;
+			std::string _name;      // what the key was hashed from, both shader paths for a program
+			uint32_t _key;
+			uint32_t _path_hash;
+			uint32_t _content_hash;
+			uint32_t _flags;
+			int32_t _ref_count;
+			AssetType _type;
+			uint16_t _idx;          // bgfx handle index for texture/shader/program
+			uint16_t _deps[2];      // program -> vertex/fragment shader entries
+			Mesh* _mesh;
+		};
+
+		struct Reload
+		{
+			uint16_t _entry;
+			uint32_t _path_hash;
+			uint32_t _content_hash;
+			std::vector<uint8_t> _data;
+		};
+
+		Entry _entries[k_max_asset_count];
+		HandleAllocT<k_max_asset_count> _handles;
+		std::unordered_multimap<uint32_t, uint16_t> _lookup;
+
+		Mutex _mutex;                       // guards _entries paths/hashes, _watches and _reloads
+		std::vector<Reload> _reloads;
+		std::unordered_map<int32_t, std::string> _watches;
+
+		Thread _watcher;
+		int32_t _notify_fd;
+		volatile bool _quit;
+
+	private:
+		AssetHandle acquire(AssetType type, const char* path, const char* path2, uint32_t flags, bool& is_new);
+		bool import(uint16_t entry, const std::vector<uint8_t>& data);
+		void destroyResource(Entry& entry);
+		void watch(const char* path);
+		void watcherProcess();
+
+		static int32_t watcherFunc(void* user_data);
+
+	public:
+		AssetCache();
+		~AssetCache();
+
+		AssetCache(const AssetCache&) = delete;
+		AssetCache& operator = (const AssetCache&) = delete;
+
+		void initialize(bool hot_reload);
+		void clear();
+
+		// Applies pending re-imports. Call at the frame boundary, before submitting.
+		void update();
+
+		AssetHandle loadTexture(const char* path, uint32_t flags = BGFX_TEXTURE_NONE);
+		AssetHandle loadShader(const char* path);
+		AssetHandle loadProgram(const char* vs_path, const char* fs_path);
+		AssetHandle loadMesh(const char* path);
+
+		void retain(AssetHandle handle);
+		void release(AssetHandle handle);
+
+		bgfx::TextureHandle getTexture(AssetHandle handle) const;
+		bgfx::ShaderHandle getShader(AssetHandle handle) const;
+		bgfx::ProgramHandle getProgram(AssetHandle handle) const;
+		const Mesh* getMesh(AssetHandle handle) const;
+	};
+}
+
+#endif
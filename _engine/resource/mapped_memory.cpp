@@ -0,0 +1,38 @@
+#include "resource/mapped_memory.h"
+
+namespace monster
+{
+	struct MappedRef
+	{
+		FileSystem* _fs;
+		MappedRegion _region;
+	};
+
+	static void releaseMappedRef(void* /*ptr*/, void* user_data)
+	{
+		MappedRef* ref = (MappedRef*)user_data;
+		ref->_fs->unmap(ref->_region);
+		delete ref;
+	}
+
+	const bgfx::Memory* makeMappedRef(FileSystem* fs, const char* path, size_t offset, size_t size)
+	{
+		MappedRef* ref = new MappedRef;
+		ref->_fs = fs;
+
+		if (!fs->map(path, offset, size, ref->_region))
+		{
+			delete ref;
+			return nullptr;
+		}
+
+		if (ref->_region._size > UINT32_MAX)
+		{
+			fs->unmap(ref->_region);
+			delete ref;
+			return nullptr;
+		}
+
+		return bgfx::makeRef(ref->_region._data, (uint32_t)ref->_region._size, releaseMappedRef, ref);
+	}
+}
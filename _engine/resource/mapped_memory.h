@@ -0,0 +1,17 @@
+#ifndef __MONSTER_MAPPED_MEMORY_H__
+#define __MONSTER_MAPPED_MEMORY_H__
+
+#include "bgfx.h"
+#include "core/filesystem/filesystem.h"
+
+namespace monster
+{
+	// Maps a file region through fs and wraps it as a bgfx::Memory reference
+	// without copying. bgfx unmaps the region through its release callback
+	// once the render thread has consumed it, so the result must be handed
+	// to exactly one bgfx create/update call. Returns NULL if the region
+	// can't be mapped or is larger than bgfx::Memory can describe.
+	const bgfx::Memory* makeMappedRef(FileSystem* fs, const char* path, size_t offset = 0, size_t size = 0);
+}
+
+#endif
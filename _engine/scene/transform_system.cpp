@@ -0,0 +1,334 @@
+#include "scene/transform_system.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "bgfx.h"
+
+namespace monster
+{
+	const uint32_t TransformSystem::k_no_parent;
+	static const uint32_t k_unknown_depth = UINT32_MAX;
+
+	uint32_t TransformSystem::getNode(TransformHandle handle) const
+	{
+		assert(isAlive(handle));
+		return _node[handle.idx];
+	}
+
+	void TransformSystem::reserve(uint32_t count)
+	{
+		_local.reserve(count);
+		_world.reserve(count);
+		_parent.reserve(count);
+		_handle.reserve(count);
+		_dirty.reserve(count);
+		_dead.reserve(count);
+		_node.reserve(count);
+		_generation.reserve(count);
+	}
+
+	TransformHandle TransformSystem::create(TransformHandle parent)
+	{
+		TransformHandle handle;
+		if (!_free_handles.empty())
+		{
+			handle.idx = _free_handles.back();
+			_free_handles.pop_back();
+		}
+		else
+		{
+			handle.idx = (uint32_t)_node.size();
+			_node.push_back(0);
+			_generation.push_back(0);
+		}
+		handle.generation = _generation[handle.idx];
+
+		// appending keeps parent before child, so no re-sort is needed
+		uint32_t node = (uint32_t)_parent.size();
+		_node[handle.idx] = node;
+
+		bx::float4x4_t identity;
+		identity.col[0] = bx::float4_ld(1.0f, 0.0f, 0.0f, 0.0f);
+		identity.col[1] = bx::float4_ld(0.0f, 1.0f, 0.0f, 0.0f);
+		identity.col[2] = bx::float4_ld(0.0f, 0.0f, 1.0f, 0.0f);
+		identity.col[3] = bx::float4_ld(0.0f, 0.0f, 0.0f, 1.0f);
+
+		Local local;
+		local._position = bx::float4_zero();
+		local._rotation = bx::float4_ld(0.0f, 0.0f, 0.0f, 1.0f);
+		local._scale = bx::float4_ld(1.0f, 1.0f, 1.0f, 0.0f);
+		_local.push_back(local);
+		_world.push_back(identity);
+		_parent.push_back(isValid(parent) ? getNode(parent) : k_no_parent);
+		_handle.push_back(handle.idx);
+		_dirty.push_back(1);
+		_dead.push_back(0);
+
+		return handle;
+	}
+
+	void TransformSystem::destroy(TransformHandle handle)
+	{
+		if (!isAlive(handle))
+		{
+			return;
+		}
+
+		// the node and its descendants are dropped and their handles freed on the next sort
+		_dead[getNode(handle)] = 1;
+		_needs_sort = true;
+	}
+
+	bool TransformSystem::isAlive(TransformHandle handle) const
+	{
+		return handle.idx < _node.size()
+			&& UINT32_MAX != _node[handle.idx]
+			&& _generation[handle.idx] == handle.generation;
+	}
+
+	void TransformSystem::setParent(TransformHandle handle, TransformHandle parent)
+	{
+		uint32_t node = getNode(handle);
+		uint32_t parent_node = isValid(parent) ? getNode(parent) : k_no_parent;
+
+		for (uint32_t ii = parent_node; k_no_parent != ii; ii = _parent[ii])
+		{
+			assert(ii != node && "setParent would create a cycle");
+		}
+
+		_parent[node] = parent_node;
+		_dirty[node] = 1;
+
+		if (k_no_parent != parent_node && parent_node > node)
+		{
+			_needs_sort = true;
+		}
+	}
+
+	TransformHandle TransformSystem::getParent(TransformHandle handle) const
+	{
+		uint32_t parent = _parent[getNode(handle)];
+		if (k_no_parent == parent)
+		{
+			return k_invalid_transform;
+		}
+
+		TransformHandle result = { _handle[parent], _generation[_handle[parent]] };
+		return result;
+	}
+
+	void TransformSystem::setPosition(TransformHandle handle, const float position[3])
+	{
+		uint32_t node = getNode(handle);
+		_local[node]._position = bx::float4_ld(position[0], position[1], position[2], 0.0f);
+		_dirty[node] = 1;
+	}
+
+	void TransformSystem::setRotation(TransformHandle handle, const float quat[4])
+	{
+		uint32_t node = getNode(handle);
+		_local[node]._rotation = bx::float4_ld(quat[0], quat[1], quat[2], quat[3]);
+		_dirty[node] = 1;
+	}
+
+	void TransformSystem::setScale(TransformHandle handle, const float scale[3])
+	{
+		uint32_t node = getNode(handle);
+		_local[node]._scale = bx::float4_ld(scale[0], scale[1], scale[2], 0.0f);
+		_dirty[node] = 1;
+	}
+
+	void TransformSystem::setLocal(TransformHandle handle, const float position[3], const float quat[4], const float scale[3])
+	{
+		uint32_t node = getNode(handle);
+		Local& local = _local[node];
+		local._position = bx::float4_ld(position[0], position[1], position[2], 0.0f);
+		local._rotation = bx::float4_ld(quat[0], quat[1], quat[2], quat[3]);
+		local._scale = bx::float4_ld(scale[0], scale[1], scale[2], 0.0f);
+		_dirty[node] = 1;
+	}
+
+	// the old order is left in sorted, whose capacity the next sort reuses
+	template <class V>
+	void TransformSystem::permute(V& data, V& sorted)
+	{
+		sorted.resize(_order.size());
+		for (uint32_t ii = 0; ii < _order.size(); ++ii)
+		{
+			sorted[ii] = data[_order[ii]];
+		}
+		data.swap(sorted);
+	}
+
+	void TransformSystem::sort()
+	{
+		uint32_t count = (uint32_t)_parent.size();
+
+		// depth of every node, walking up only until a known depth is reached;
+		// a dead ancestor kills the whole subtree on the way down
+		_depth.assign(count, k_unknown_depth);
+		_order.clear();
+		uint32_t max_depth = 0;
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			uint32_t node = ii;
+			while (k_unknown_depth == _depth[node])
+			{
+				_order.push_back(node);
+				if (k_no_parent == _parent[node])
+				{
+					break;
+				}
+				node = _parent[node];
+			}
+
+			while (!_order.empty())
+			{
+				node = _order.back();
+				_order.pop_back();
+
+				uint32_t parent = _parent[node];
+				if (k_no_parent == parent)
+				{
+					_depth[node] = 0;
+				}
+				else
+				{
+					_depth[node] = _depth[parent] + 1;
+					_dead[node] |= _dead[parent];
+				}
+				max_depth = _depth[node] > max_depth ? _depth[node] : max_depth;
+			}
+		}
+
+		// stable counting sort by depth, skipping dead nodes
+		_remap.assign(max_depth + 2, 0);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			if (!_dead[ii])
+			{
+				++_remap[_depth[ii] + 1];
+			}
+		}
+		for (uint32_t ii = 1; ii < _remap.size(); ++ii)
+		{
+			_remap[ii] += _remap[ii - 1];
+		}
+
+		uint32_t live = _remap.back();
+		_order.resize(live);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			if (!_dead[ii])
+			{
+				_order[_remap[_depth[ii]]++] = ii;
+			}
+			else
+			{
+				_free_handles.push_back(_handle[ii]);
+				_node[_handle[ii]] = UINT32_MAX;
+				++_generation[_handle[ii]];
+			}
+		}
+
+		// old node index -> new node index
+		_remap.assign(count, k_no_parent);
+		for (uint32_t ii = 0; ii < live; ++ii)
+		{
+			_remap[_order[ii]] = ii;
+		}
+
+		permute(_local, _sorted_local);
+		permute(_world, _sorted_world);
+		permute(_parent, _sorted_index);
+		permute(_handle, _sorted_index);
+		permute(_dirty, _sorted_flag);
+		permute(_dead, _sorted_flag);
+
+		for (uint32_t ii = 0; ii < live; ++ii)
+		{
+			if (k_no_parent != _parent[ii])
+			{
+				_parent[ii] = _remap[_parent[ii]];
+			}
+			_node[_handle[ii]] = ii;
+		}
+
+		_needs_sort = false;
+	}
+
+	void TransformSystem::update()
+	{
+		if (_needs_sort)
+		{
+			sort();
+		}
+
+		uint32_t count = (uint32_t)_parent.size();
+		BX_ALIGN_DECL_16(float q[4]);
+		BX_ALIGN_DECL_16(float s[4]);
+
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			uint32_t parent = _parent[ii];
+			if (k_no_parent != parent)
+			{
+				_dirty[ii] |= _dirty[parent];
+			}
+
+			if (!_dirty[ii])
+			{
+				continue;
+			}
+
+			const Local& source = _local[ii];
+			bx::float4_st(q, source._rotation);
+			bx::float4_st(s, source._scale);
+
+			const float x = q[0], y = q[1], z = q[2], w = q[3];
+			const float x2 = x + x, y2 = y + y, z2 = z + z;
+			const float xx = x * x2, xy = x * y2, xz = x * z2;
+			const float yy = y * y2, yz = y * z2, zz = z * z2;
+			const float wx = w * x2, wy = w * y2, wz = w * z2;
+
+			// scale * rotation * translation; rows are the rotated basis vectors,
+			// i.e. the transpose of what bx::mtxQuat produces
+			bx::float4x4_t local;
+			local.col[0] = bx::float4_mul(bx::float4_ld(1.0f - (yy + zz), xy + wz, xz - wy, 0.0f), bx::float4_splat(s[0]));
+			local.col[1] = bx::float4_mul(bx::float4_ld(xy - wz, 1.0f - (xx + zz), yz + wx, 0.0f), bx::float4_splat(s[1]));
+			local.col[2] = bx::float4_mul(bx::float4_ld(xz + wy, yz - wx, 1.0f - (xx + yy), 0.0f), bx::float4_splat(s[2]));
+			local.col[3] = bx::float4_or(source._position, bx::float4_ld(0.0f, 0.0f, 0.0f, 1.0f));
+
+			if (k_no_parent == parent)
+			{
+				_world[ii] = local;
+			}
+			else
+			{
+				bx::float4x4_mul(&_world[ii], &local, &_world[parent]);
+			}
+		}
+
+		if (0 != count)
+		{
+			memset(&_dirty[0], 0, count);
+		}
+	}
+
+	uint32_t TransformSystem::setTransform(TransformHandle handle) const
+	{
+		return bgfx::setTransform(getWorld(handle));
+	}
+
+	uint32_t TransformSystem::allocTransforms(const TransformHandle* handles, uint16_t count) const
+	{
+		bgfx::Transform transform;
+		uint32_t first = bgfx::allocTransform(&transform, count);
+		for (uint16_t ii = 0; ii < count; ++ii)
+		{
+			memcpy(&transform.data[ii * 16], getWorld(handles[ii]), 16 * sizeof(float));
+		}
+		return first;
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef __MONSTER_TRANSFORM_SYSTEM_H__
+#define __MONSTER_TRANSFORM_SYSTEM_H__
+
+#include <cstdint>
+#include <vector>
+#include <bx/float4x4_t.h>
+
+#include "core/memory/aligned_allocator.h"
+
+namespace monster
+{
+	// Generational like Entity: a slot is reused after destroy(), its
+	// generation is not, so stale handles fail isAlive().
+	struct TransformHandle { uint32_t idx; uint32_t generation; };
+	static const TransformHandle k_invalid_transform = { UINT32_MAX, 0 };
+	inline bool isValid(TransformHandle handle) { return UINT32_MAX != handle.idx; }
+
+	// Scene graph transforms stored as parallel arrays ordered parent before
+	// child, so one forward pass can propagate dirty flags and compute every
+	// world matrix from an already final parent. Handles stay stable while
+	// the arrays are re-sorted underneath them.
+	class TransformSystem
+	{
+	private:
+		static const uint32_t k_no_parent = UINT32_MAX;
+
+		struct Local
+		{
+			bx::float4_t _position;
+			bx::float4_t _rotation;             // quaternion xyzw
+			bx::float4_t _scale;
+		};
+
+		// per node, in hierarchy order
+		AlignedVector<Local> _local;
+		AlignedVector<bx::float4x4_t> _world;
+		std::vector<uint32_t> _parent;          // node index, k_no_parent for roots
+		std::vector<uint32_t> _handle;          // node index -> handle
+		std::vector<uint8_t> _dirty;
+		std::vector<uint8_t> _dead;
+
+		std::vector<uint32_t> _node;            // handle -> node index
+		std::vector<uint32_t> _generation;      // per handle
+		std::vector<uint32_t> _free_handles;
+
+		bool _needs_sort;
+
+		// scratch reused by sort() so re-sorting doesn't allocate once warmed
+		// up; permute() swaps each array with the scratch of its type
+		std::vector<uint32_t> _depth;
+		std::vector<uint32_t> _order;
+		std::vector<uint32_t> _remap;
+		AlignedVector<Local> _sorted_local;
+		AlignedVector<bx::float4x4_t> _sorted_world;
+		std::vector<uint32_t> _sorted_index;
+		std::vector<uint8_t> _sorted_flag;
+
+	private:
+		uint32_t getNode(TransformHandle handle) const;
+		void sort();
+
+		template <class V>
+		void permute(V& data, V& sorted);
+
+	public:
+		TransformSystem() : _needs_sort(false) {}
+
+		void reserve(uint32_t count);
+
+		TransformHandle create(TransformHandle parent = k_invalid_transform);
+
+		// Destroys the node and its whole subtree. Their handles stay alive
+		// until the next update(). Stale handles are ignored.
+		void destroy(TransformHandle handle);
+		bool isAlive(TransformHandle handle) const;
+
+		void setParent(TransformHandle handle, TransformHandle parent);
+		TransformHandle getParent(TransformHandle handle) const;
+
+		void setPosition(TransformHandle handle, const float position[3]);
+		void setRotation(TransformHandle handle, const float quat[4]);
+		void setScale(TransformHandle handle, const float scale[3]);
+		void setLocal(TransformHandle handle, const float position[3], const float quat[4], const float scale[3]);
+
+		// World matrix as of the last update(), in bx/bgfx row-vector layout.
+		const float* getWorld(TransformHandle handle) const { return (const float*)&_world[getNode(handle)]; }
+
+		uint32_t getCount() const { return (uint32_t)_parent.size(); }
+
+		// Recomputes world matrices of dirty nodes and everything below them.
+		void update();
+
+		// bgfx::setTransform for one node; returns the matrix cache index.
+		uint32_t setTransform(TransformHandle handle) const;
+
+		// Copies the world matrices of many nodes into the bgfx matrix cache
+		// in one allocation. Node ii ends up at the returned index + ii.
+		uint32_t allocTransforms(const TransformHandle* handles, uint16_t count) const;
+	};
+}
+
+#endif
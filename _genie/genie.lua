@@ -30,12 +30,17 @@ solution "monster"
 dofile ("toolchain.lua")
 dofile (BGFX_DIR .. "scripts/bgfx.lua")
 dofile ("monster.lua")
+dofile ("tests.lua")
 
 toolchain(MONSTER_BUILD_DIR, MONSTER_THIRD_DIR)
 
 group "libs"
 bgfxProject("", "StaticLib", os.is("windows") and { "BGFX_CONFIG_RENDERER_DIRECT3D9=1" } or {})
 
+-- before the engine, which the install commands below apply to
+group "tests"
+monster_tests()
+
 group "engine"
 monster_project("", "ConsoleApp", {})
 
@@ -8,6 +8,7 @@ function monster_project(_name, _kind, _defines)
 			MONSTER_DIR .. "_engine",
 			MONSTER_THIRD_DIR .. "bgfx/include",
 			MONSTER_THIRD_DIR .. "bx/include",
+			MONSTER_THIRD_DIR .. "bgfx/examples/common",
 		}
 
 		defines {
@@ -73,7 +74,9 @@ function monster_project(_name, _kind, _defines)
 			MONSTER_DIR .. "_engine/**.h",
 			MONSTER_DIR .. "_engine/**.cpp",
 			MONSTER_DIR .. "_engine/*/**.h",
-			MONSTER_DIR .. "_engine/*/**.cpp"
+			MONSTER_DIR .. "_engine/*/**.cpp",
+			MONSTER_THIRD_DIR .. "bgfx/examples/common/bounds.h",
+			MONSTER_THIRD_DIR .. "bgfx/examples/common/bounds.cpp",
 		}
 
 		strip()
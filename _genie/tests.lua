@@ -0,0 +1,62 @@
+-- Every _tests/*.cpp is its own console app, linked against the engine
+-- modules without the windowed client around them. Tests return non-zero
+-- on failure; benchmarks print their numbers and fail only on bad results.
+function monster_tests()
+
+	for _, file in ipairs(os.matchfiles(MONSTER_DIR .. "_tests/*.cpp")) do
+
+		project ("monster_" .. path.getbasename(file))
+			kind "ConsoleApp"
+
+			includedirs {
+				MONSTER_DIR .. "_engine",
+				MONSTER_THIRD_DIR .. "bgfx/include",
+				MONSTER_THIRD_DIR .. "bx/include",
+				MONSTER_THIRD_DIR .. "bgfx/examples/common",
+			}
+
+			links {
+				"bgfx"
+			}
+
+			configuration { "debug or development" }
+				defines {
+					"_DEBUG",
+					"MONSTER_DEBUG=1"
+				}
+
+			configuration { "release" }
+				defines {
+					"NDEBUG"
+				}
+
+			configuration { "vs*" }
+				links {
+					"OpenGL32",
+					"dbghelp",
+				}
+
+			-- bgfx's GL backend and its thread and library loading
+			configuration { "linux" }
+				links {
+					"GL",
+					"X11",
+					"pthread",
+					"dl",
+				}
+
+			configuration {}
+
+			files {
+				file,
+				MONSTER_DIR .. "_engine/*/**.h",
+				MONSTER_DIR .. "_engine/*/**.cpp",
+				MONSTER_THIRD_DIR .. "bgfx/examples/common/bounds.h",
+				MONSTER_THIRD_DIR .. "bgfx/examples/common/bounds.cpp",
+			}
+
+			strip()
+
+			configuration {} -- reset configuration
+	end
+end
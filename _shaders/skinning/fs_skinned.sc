@@ -0,0 +1,10 @@
+$input v_normal
+
+#include <bgfx_shader.sh>
+
+void main()
+{
+	vec3 light = normalize(vec3(0.3, 1.0, 0.5) );
+	float diffuse = max(dot(normalize(v_normal), light), 0.0);
+	gl_FragColor = vec4(vec3_splat(0.2 + 0.8 * diffuse), 1.0);
+}
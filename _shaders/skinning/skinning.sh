@@ -0,0 +1,53 @@
+#include <bgfx_shader.sh>
+
+// Palette written by monster::SkinningPalette; the offset of the instance's
+// first joint comes in i_data4.x.
+uniform vec4 u_skinning;    // 1 / width, 1 / height, width, texels per joint
+SAMPLER2D(s_skinning, 0);
+
+vec4 fetchSkinning(float _texel)
+{
+	float row = floor(_texel * u_skinning.x);
+	float column = _texel - row * u_skinning.z;
+	return texture2DLod(s_skinning, vec2( (column + 0.5) * u_skinning.x, (row + 0.5) * u_skinning.y), 0.0);
+}
+
+mat4 instanceWorld()
+{
+	mat4 world;
+	world[0] = i_data0;
+	world[1] = i_data1;
+	world[2] = i_data2;
+	world[3] = i_data3;
+	return world;
+}
+
+// three texels per joint: the first three columns of the 4x3 matrix
+void addJointMatrix(float _joint, float _weight, inout vec4 _c0, inout vec4 _c1, inout vec4 _c2)
+{
+	float texel = _joint * 3.0;
+	_c0 += fetchSkinning(texel) * _weight;
+	_c1 += fetchSkinning(texel + 1.0) * _weight;
+	_c2 += fetchSkinning(texel + 2.0) * _weight;
+}
+
+// two texels per joint: real and dual part, blended in the pivot's hemisphere
+void addJointDualQuat(float _joint, float _weight, vec4 _pivot, inout vec4 _real, inout vec4 _dual)
+{
+	float texel = _joint * 2.0;
+	vec4 real = fetchSkinning(texel);
+	vec4 dual = fetchSkinning(texel + 1.0);
+	float weight = dot(real, _pivot) < 0.0 ? -_weight : _weight;
+	_real += real * weight;
+	_dual += dual * weight;
+}
+
+vec3 rotateDualQuat(vec4 _real, vec3 _vec)
+{
+	return _vec + 2.0 * cross(_real.xyz, cross(_real.xyz, _vec) + _real.w * _vec);
+}
+
+vec3 translateDualQuat(vec4 _real, vec4 _dual)
+{
+	return 2.0 * (_real.w * _dual.xyz - _dual.w * _real.xyz + cross(_real.xyz, _dual.xyz) );
+}
@@ -0,0 +1,28 @@
+$input a_position, a_normal, a_indices, a_weight, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_normal
+
+#include "skinning.sh"
+
+void main()
+{
+	vec4 joints = floor(a_indices + 0.5) + i_data4.x;
+	vec4 pivot = fetchSkinning(joints.x * 2.0);
+
+	vec4 real = vec4_splat(0.0);
+	vec4 dual = vec4_splat(0.0);
+	addJointDualQuat(joints.x, a_weight.x, pivot, real, dual);
+	addJointDualQuat(joints.y, a_weight.y, pivot, real, dual);
+	addJointDualQuat(joints.z, a_weight.z, pivot, real, dual);
+	addJointDualQuat(joints.w, a_weight.w, pivot, real, dual);
+
+	float inv_length = 1.0 / length(real);
+	real *= inv_length;
+	dual *= inv_length;
+
+	vec3 skinned = rotateDualQuat(real, a_position) + translateDualQuat(real, dual);
+	vec3 skinned_normal = rotateDualQuat(real, a_normal);
+
+	mat4 world = instanceWorld();
+	gl_Position = mul(u_viewProj, instMul(world, vec4(skinned, 1.0) ) );
+	v_normal = instMul(world, vec4(skinned_normal, 0.0) ).xyz;
+}
@@ -0,0 +1,26 @@
+$input a_position, a_normal, a_indices, a_weight, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_normal
+
+#include "skinning.sh"
+
+void main()
+{
+	vec4 joints = floor(a_indices + 0.5) + i_data4.x;
+
+	vec4 c0 = vec4_splat(0.0);
+	vec4 c1 = vec4_splat(0.0);
+	vec4 c2 = vec4_splat(0.0);
+	addJointMatrix(joints.x, a_weight.x, c0, c1, c2);
+	addJointMatrix(joints.y, a_weight.y, c0, c1, c2);
+	addJointMatrix(joints.z, a_weight.z, c0, c1, c2);
+	addJointMatrix(joints.w, a_weight.w, c0, c1, c2);
+
+	vec4 position = vec4(a_position, 1.0);
+	vec4 normal = vec4(a_normal, 0.0);
+	vec3 skinned = vec3(dot(position, c0), dot(position, c1), dot(position, c2) );
+	vec3 skinned_normal = vec3(dot(normal, c0), dot(normal, c1), dot(normal, c2) );
+
+	mat4 world = instanceWorld();
+	gl_Position = mul(u_viewProj, instMul(world, vec4(skinned, 1.0) ) );
+	v_normal = instMul(world, vec4(skinned_normal, 0.0) ).xyz;
+}
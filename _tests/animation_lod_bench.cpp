@@ -0,0 +1,245 @@
+// Measures what animation LOD saves on a crowd: the cost per character of
+// every level, then 500 characters spread in front of the camera, all at
+// full detail and with AnimationLod picking their level from screen size.
+// Also checks that a sampler limited to the first joints decodes the same
+// poses for them as a full one, and that bindPoseToModel() agrees with
+// localToModel() over the bind pose.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <bx/fpumath.h>
+#include <bx/timer.h>
+
+#include "animation/animation_lod.h"
+#include "animation/clip_compressor.h"
+
+using namespace monster;
+
+static const uint32_t k_joint_count = 64;
+static const uint32_t k_clip_count = 6;
+static const uint32_t k_level_count = 4;
+static const uint32_t k_level_character_count = 200;
+static const uint32_t k_crowd_count = 500;
+static const uint32_t k_crowd_row = 25;
+static const uint32_t k_frame_count = 240;
+
+static void makeClip(float phase, float amplitude, std::vector<uint8_t>& blob)
+{
+	RawAnimation raw;
+	raw._frame_rate = 30.0f;
+	raw._frame_count = 60;
+	raw._track_count = k_joint_count;
+	raw._frames.resize(raw._frame_count * k_joint_count);
+
+	for (uint32_t frame = 0; frame < raw._frame_count; ++frame)
+	{
+		const float t = frame / raw._frame_rate;
+		for (uint32_t track = 0; track < k_joint_count; ++track)
+		{
+			JointTransform& joint = raw._frames[frame * k_joint_count + track];
+			joint._translation[0] = 0.1f * track + amplitude * sinf(t + phase);
+			joint._translation[1] = 0.5f;
+			joint._translation[2] = 0.0f;
+			bx::quatRotateY(joint._rotation, amplitude * sinf(t * 2.0f + track + phase));
+			joint._scale[0] = joint._scale[1] = joint._scale[2] = 1.0f;
+		}
+	}
+
+	compressClip(raw, ClipCompressionSettings(), blob);
+}
+
+static float getMaxError(const float* a, const float* b, uint32_t count)
+{
+	float error = 0.0f;
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		error = std::max(error, fabsf(a[ii] - b[ii]));
+	}
+	return error;
+}
+
+static double updateCrowd(BlendTreeEvaluator& evaluator, BlendTreeInstance** instances, uint32_t count, uint32_t frame_count,
+	const AnimationLod* lod, const float* screen_sizes)
+{
+	const int64_t start = bx::getHPCounter();
+	for (uint32_t frame = 0; frame < frame_count; ++frame)
+	{
+		if (nullptr != lod)
+		{
+			for (uint32_t ii = 0; ii < count; ++ii)
+			{
+				lod->apply(*instances[ii], screen_sizes[ii]);
+			}
+		}
+		evaluator.update(instances, count, 1.0f / 60.0f);
+	}
+	return double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency()) / frame_count;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	std::vector<SkeletonJoint> joints(k_joint_count);
+	std::vector<std::string> names(k_joint_count);
+	for (uint32_t ii = 0; ii < k_joint_count; ++ii)
+	{
+		names[ii] = "joint" + std::to_string(ii);
+		setString(joints[ii]._name, names[ii].c_str());
+		joints[ii]._parent = 0 == ii ? -1 : (int32_t)((ii - 1) / 2);
+		JointTransform bind = { { 0.1f * ii, 0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+		bx::quatRotateX(bind._rotation, 0.1f * ii);
+		joints[ii]._bind = bind;
+	}
+
+	SkeletonData data;
+	data._joints.set(&joints[0], k_joint_count);
+	Skeleton skeleton;
+	if (!skeleton.create(data))
+	{
+		printf("skeleton creation failed\n");
+		return 1;
+	}
+
+	int result = 0;
+	{
+		AlignedVector<bx::float4x4_t> from_local(k_joint_count);
+		AlignedVector<bx::float4x4_t> from_bind(k_joint_count);
+		localToModel(skeleton, skeleton.getBindPose(), &from_local[0]);
+		bindPoseToModel(skeleton, &from_bind[0], 0);
+		const float error = getMaxError((const float*)&from_local[0], (const float*)&from_bind[0], k_joint_count * 16);
+		printf("bindPoseToModel error %g\n", error);
+		result |= error < 1e-4f ? 0 : 1;
+	}
+
+	std::vector<uint8_t> blobs[k_clip_count];
+	const AnimationClip* clips[k_clip_count];
+	for (uint32_t ii = 0; ii < k_clip_count; ++ii)
+	{
+		makeClip(ii * 0.7f, 0.2f + 0.1f * ii, blobs[ii]);
+		clips[ii] = (const AnimationClip*)getBlobRoot(&blobs[ii][0], blobs[ii].size(), getTypeInfo<AnimationClip>());
+	}
+
+	// a sampler limited to two groups decodes those like a full one, also
+	// across loops and after widening again
+	{
+		const uint32_t soa_count = skeleton.getSoaCount();
+		AlignedVector<SoaTransform> full(soa_count);
+		AlignedVector<SoaTransform> limited(soa_count);
+		ClipSampler full_sampler;
+		ClipSampler limited_sampler;
+		full_sampler.bind(clips[0]);
+		limited_sampler.bind(clips[0]);
+
+		float error = 0.0f;
+		for (uint32_t frame = 0; frame < 300; frame += 3)
+		{
+			const float time = fmodf(frame / 60.0f, clips[0]->_duration);
+			const uint32_t limit = 200 > frame ? 2 : 0;
+			full_sampler.sample(time, &full[0]);
+			limited_sampler.sample(time, &limited[0], limit);
+			const uint32_t compared = 0 == limit ? soa_count : limit;
+			error = std::max(error, getMaxError((const float*)&full[0], (const float*)&limited[0], compared * sizeof(SoaTransform) / sizeof(float)));
+		}
+		printf("limited sampler error %g\n", error);
+		result |= 0.0f == error ? 0 : 1;
+	}
+
+	LayerMask upper;
+	upper.create(skeleton, 0.0f);
+	upper.setSubtreeWeight(skeleton, 1, 1.0f);
+
+	BlendTree tree;
+	const uint16_t move_x = tree.addParameter(0.0f);
+	const uint16_t move_y = tree.addParameter(0.0f);
+	const uint16_t speed = tree.addParameter(0.5f);
+	const uint16_t layer_weight = tree.addParameter(1.0f);
+	const uint16_t additive_weight = tree.addParameter(0.5f);
+
+	uint16_t clip_nodes[k_clip_count];
+	for (uint32_t ii = 0; ii < k_clip_count; ++ii)
+	{
+		clip_nodes[ii] = tree.addClip(clips[ii]);
+	}
+
+	const float positions_2d[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f };
+	const uint16_t locomotion = tree.addBlendSpace2D(clip_nodes, positions_2d, 4, move_x, move_y);
+	const float positions_1d[] = { 0.0f, 1.0f };
+	const uint16_t upper_body = tree.addBlendSpace1D(clip_nodes + 4, positions_1d, 2, speed);
+	const uint16_t layered = tree.addLerp(locomotion, upper_body, layer_weight, &upper);
+	tree.setRoot(tree.addAdditive(layered, clip_nodes[5], additive_weight));
+
+	AnimationLod lod;
+	lod.addLevel({ 0.25f, 0, 1, false, false });
+	lod.addLevel({ 0.1f, 32, 2, true, false });
+	lod.addLevel({ 0.04f, 16, 4, true, false });
+	lod.addLevel({ 0.0f, 8, 8, false, true });
+
+	BlendTreeEvaluator evaluator;
+	evaluator.initialize(nullptr);
+
+	double level_us[k_level_count];
+	for (uint32_t level = 0; level < k_level_count; ++level)
+	{
+		const AnimationLodLevel& settings = lod.getLevel(level);
+		std::vector<BlendTreeInstance> instances(k_level_character_count);
+		std::vector<BlendTreeInstance*> pointers(k_level_character_count);
+		for (uint32_t ii = 0; ii < k_level_character_count; ++ii)
+		{
+			instances[ii].create(&tree, &skeleton);
+			instances[ii].setLod((uint8_t)level, settings._joint_count, settings._update_interval, settings._interpolate, settings._dominant_only);
+			pointers[ii] = &instances[ii];
+		}
+
+		evaluator.update(&pointers[0], k_level_character_count, 1.0f / 60.0f);
+		level_us[level] = updateCrowd(evaluator, &pointers[0], k_level_character_count, k_frame_count, nullptr, nullptr) * 1e3 / k_level_character_count;
+		printf("level %u (%u joints, every %u, %s%s): %.2f us per character\n", level, 0 == settings._joint_count ? k_joint_count : settings._joint_count,
+			settings._update_interval, settings._interpolate ? "interpolated" : "held", settings._dominant_only ? ", dominant only" : "", level_us[level]);
+	}
+
+	// rows of characters stretching away from the camera
+	float view[16];
+	float proj[16];
+	const float eye[3] = { 0.0f, 1.7f, 0.0f };
+	const float at[3] = { 0.0f, 1.5f, 10.0f };
+	bx::mtxLookAt(view, eye, at);
+	bx::mtxProj(proj, 60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+	const Sphere bounds = { { 0.0f, 1.0f, 0.0f }, 1.0f };
+
+	std::vector<BlendTreeInstance> crowd(k_crowd_count);
+	std::vector<BlendTreeInstance*> pointers(k_crowd_count);
+	std::vector<float> screen_sizes(k_crowd_count);
+	for (uint32_t ii = 0; ii < k_crowd_count; ++ii)
+	{
+		float world[16];
+		bx::mtxTranslate(world, (ii % k_crowd_row) * 2.0f - 25.0f, 0.0f, 2.0f + (ii / k_crowd_row) * 5.0f);
+		screen_sizes[ii] = getScreenSize(bounds, world, view, proj);
+
+		crowd[ii].create(&tree, &skeleton);
+		crowd[ii].setParameter(move_x, sinf(ii * 0.1f));
+		pointers[ii] = &crowd[ii];
+	}
+
+	evaluator.update(&pointers[0], k_crowd_count, 1.0f / 60.0f);
+	const double full_ms = updateCrowd(evaluator, &pointers[0], k_crowd_count, k_frame_count, nullptr, nullptr);
+	const double lod_ms = updateCrowd(evaluator, &pointers[0], k_crowd_count, k_frame_count, &lod, &screen_sizes[0]);
+
+	uint32_t histogram[k_level_count] = {};
+	for (uint32_t ii = 0; ii < k_crowd_count; ++ii)
+	{
+		histogram[crowd[ii].getLodLevel()]++;
+	}
+
+	double expected_us = 0.0;
+	for (uint32_t level = 0; level < k_level_count; ++level)
+	{
+		expected_us += histogram[level] * level_us[level];
+	}
+
+	printf("crowd of %u at levels %u/%u/%u/%u: full %.3f ms, lod %.3f ms per frame, %.1fx (%.1f%% of the lod cost is level 0)\n",
+		k_crowd_count, histogram[0], histogram[1], histogram[2], histogram[3], full_ms, lod_ms, full_ms / lod_ms,
+		100.0 * histogram[0] * level_us[0] / expected_us);
+
+	evaluator.shutdown();
+	return result;
+}
@@ -0,0 +1,186 @@
+// Evaluates a crowd of blend tree instances through BlendTreeEvaluator with
+// a growing number of job workers and prints ms per frame and the speedup
+// over the calling thread alone. Also counts heap allocations during the
+// timed frames, which must stay at zero once the scratch pool has grown.
+// Speedups only mean something when the machine has the cores; the core
+// count is printed first.
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <bx/fpumath.h>
+#include <bx/timer.h>
+
+#include "animation/blend_tree.h"
+#include "animation/clip_compressor.h"
+#include "core/job/job_system.h"
+
+using namespace monster;
+
+static std::atomic<uint32_t> s_allocations(0);
+
+void* operator new(size_t size)
+{
+	++s_allocations;
+	return malloc(0 != size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+static const uint32_t k_joint_count = 64;
+static const uint32_t k_clip_count = 6;
+static const uint32_t k_character_count = 500;
+static const uint32_t k_frame_count = 100;
+
+static void makeClip(float phase, float amplitude, std::vector<uint8_t>& blob)
+{
+	RawAnimation raw;
+	raw._frame_rate = 30.0f;
+	raw._frame_count = 60;
+	raw._track_count = k_joint_count;
+	raw._frames.resize(raw._frame_count * k_joint_count);
+
+	for (uint32_t frame = 0; frame < raw._frame_count; ++frame)
+	{
+		const float t = frame / raw._frame_rate;
+		for (uint32_t track = 0; track < k_joint_count; ++track)
+		{
+			JointTransform& joint = raw._frames[frame * k_joint_count + track];
+			joint._translation[0] = 0.1f * track + amplitude * sinf(t + phase);
+			joint._translation[1] = 0.5f;
+			joint._translation[2] = 0.0f;
+			bx::quatRotateY(joint._rotation, amplitude * sinf(t * 2.0f + track + phase));
+			joint._scale[0] = joint._scale[1] = joint._scale[2] = 1.0f;
+		}
+	}
+
+	compressClip(raw, ClipCompressionSettings(), blob);
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	// a binary tree of joints
+	std::vector<SkeletonJoint> joints(k_joint_count);
+	std::vector<std::string> names(k_joint_count);
+	for (uint32_t ii = 0; ii < k_joint_count; ++ii)
+	{
+		names[ii] = "joint" + std::to_string(ii);
+		setString(joints[ii]._name, names[ii].c_str());
+		joints[ii]._parent = 0 == ii ? -1 : (int32_t)((ii - 1) / 2);
+		const JointTransform bind = { { 0.1f * ii, 0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+		joints[ii]._bind = bind;
+	}
+
+	SkeletonData data;
+	data._joints.set(&joints[0], k_joint_count);
+	Skeleton skeleton;
+	if (!skeleton.create(data))
+	{
+		printf("skeleton creation failed\n");
+		return 1;
+	}
+
+	std::vector<uint8_t> blobs[k_clip_count];
+	const AnimationClip* clips[k_clip_count];
+	for (uint32_t ii = 0; ii < k_clip_count; ++ii)
+	{
+		makeClip(ii * 0.7f, 0.2f + 0.1f * ii, blobs[ii]);
+		clips[ii] = (const AnimationClip*)getBlobRoot(&blobs[ii][0], blobs[ii].size(), getTypeInfo<AnimationClip>());
+	}
+
+	// locomotion 2D blend space, upper body layer and an additive on top
+	LayerMask upper;
+	upper.create(skeleton, 0.0f);
+	upper.setSubtreeWeight(skeleton, 1, 1.0f);
+
+	BlendTree tree;
+	const uint16_t move_x = tree.addParameter(0.0f);
+	const uint16_t move_y = tree.addParameter(0.0f);
+	const uint16_t speed = tree.addParameter(0.5f);
+	const uint16_t layer_weight = tree.addParameter(1.0f);
+	const uint16_t additive_weight = tree.addParameter(0.5f);
+
+	uint16_t clip_nodes[k_clip_count];
+	for (uint32_t ii = 0; ii < k_clip_count; ++ii)
+	{
+		clip_nodes[ii] = tree.addClip(clips[ii]);
+	}
+
+	const float positions_2d[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f };
+	const uint16_t locomotion = tree.addBlendSpace2D(clip_nodes, positions_2d, 4, move_x, move_y);
+	const float positions_1d[] = { 0.0f, 1.0f };
+	const uint16_t upper_body = tree.addBlendSpace1D(clip_nodes + 4, positions_1d, 2, speed);
+	const uint16_t layered = tree.addLerp(locomotion, upper_body, layer_weight, &upper);
+	tree.setRoot(tree.addAdditive(layered, clip_nodes[5], additive_weight));
+
+	std::vector<BlendTreeInstance> instances(k_character_count);
+	std::vector<BlendTreeInstance*> pointers(k_character_count);
+	for (uint32_t ii = 0; ii < k_character_count; ++ii)
+	{
+		instances[ii].create(&tree, &skeleton);
+		instances[ii].setParameter(move_x, sinf(ii * 0.1f));
+		instances[ii].setParameter(move_y, cosf(ii * 0.1f));
+		instances[ii].setTime(0, ii * 0.01f);
+		pointers[ii] = &instances[ii];
+	}
+
+	const uint32_t core_count = std::thread::hardware_concurrency();
+	printf("%u cores; %u characters, %u joints, %u scratch poses\n", core_count, k_character_count, k_joint_count, tree.getScratchCount());
+
+	// 0 workers runs the jobs on the calling thread
+	const uint32_t max_workers = core_count > 4 ? core_count - 1 : 3;
+	double single_ms = 0.0;
+	int result = 0;
+	for (uint32_t workers = 0; workers <= max_workers; ++workers)
+	{
+		JobSystem job_system;
+		if (0 < workers)
+		{
+			job_system.initialize(workers);
+		}
+
+		BlendTreeEvaluator evaluator;
+		evaluator.initialize(0 < workers ? &job_system : nullptr);
+		evaluator.update(&pointers[0], k_character_count, 1.0f / 60.0f);
+
+		const uint32_t allocations = s_allocations;
+		const int64_t start = bx::getHPCounter();
+		for (uint32_t frame = 0; frame < k_frame_count; ++frame)
+		{
+			for (uint32_t ii = 0; ii < k_character_count; ++ii)
+			{
+				instances[ii].setParameter(move_x, sinf(frame * 0.05f + ii));
+			}
+			evaluator.update(&pointers[0], k_character_count, 1.0f / 60.0f);
+		}
+		const double ms = double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency()) / k_frame_count;
+		const uint32_t frame_allocations = s_allocations - allocations;
+
+		if (0 == workers)
+		{
+			single_ms = ms;
+		}
+		printf("%u workers: %.3f ms/frame, %.2fx, %u allocations\n", workers, ms, single_ms / ms, frame_allocations);
+
+		if (0 != frame_allocations)
+		{
+			result = 1;
+		}
+
+		evaluator.shutdown();
+		job_system.shutdown();
+	}
+
+	return result;
+}
@@ -0,0 +1,238 @@
+// Times pair generation of both broadphases against a 4-wide brute force
+// over the same boxes: the first updatePairs() of a fresh world, then
+// frames where a tenth of the boxes move and a few are destroyed and
+// created again. The pairs kept from updatePairs() are compared with the
+// brute force at the start and at the end. Also rebuilds a tree over
+// boxes spread out geometrically, which binned SAH splits a few boxes at
+// a time, and checks that its height stays within the traversal stack.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <bx/timer.h>
+
+#include "physics/broadphase.h"
+
+using namespace monster;
+
+typedef std::set<std::pair<uint32_t, uint32_t> > PairList;
+
+static const float k_extent = 100.0f;
+static const uint32_t k_frame_count = 100;
+static const uint32_t k_churn = 8;
+static const uint32_t k_skewed_count = 1800;
+
+struct World
+{
+	std::vector<Aabb> _boxes;
+	std::vector<uint32_t> _proxies;
+	std::vector<uint8_t> _is_static;
+	std::vector<uint8_t> _is_alive;
+};
+
+static double getMs(int64_t start)
+{
+	return double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency());
+}
+
+static void addPair(PairList& pairs, uint32_t a, uint32_t b)
+{
+	pairs.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+}
+
+// every overlapping pair of fat boxes but static ones, four boxes per test
+static void bruteForce(const Broadphase& broadphase, const World& world, PairList& pairs)
+{
+	std::vector<uint32_t> bodies;
+	std::vector<Aabb> fat;
+	for (uint32_t ii = 0; ii < world._boxes.size(); ++ii)
+	{
+		if (world._is_alive[ii])
+		{
+			bodies.push_back(ii);
+			fat.push_back(broadphase.getFatAabb(world._proxies[ii]));
+		}
+	}
+
+	const uint32_t count = (uint32_t)bodies.size();
+	std::vector<Aabb4> groups((count + 3) / 4);
+	for (uint32_t ii = 0; ii < count; ii += 4)
+	{
+		loadAabb4(groups[ii / 4], &fat[ii], std::min(4u, count - ii));
+	}
+
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		for (uint32_t group = (ii + 1) / 4; group * 4 < count; ++group)
+		{
+			const uint32_t mask = aabbOverlapTest4(fat[ii], groups[group]);
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				const uint32_t jj = group * 4 + lane;
+				if (0 != (mask >> lane & 1)
+					&& jj > ii
+					&& !(world._is_static[bodies[ii]] && world._is_static[bodies[jj]]))
+				{
+					addPair(pairs, bodies[ii], bodies[jj]);
+				}
+			}
+		}
+	}
+}
+
+static bool run(const char* name, Broadphase& broadphase, uint32_t count)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> position(0.0f, k_extent);
+	std::uniform_real_distribution<float> size(0.1f, 1.0f);
+	std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+
+	World world;
+	world._boxes.resize(count);
+	world._proxies.resize(count);
+	world._is_static.resize(count);
+	world._is_alive.assign(count, 1);
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			world._boxes[ii].m_min[axis] = position(rng);
+			world._boxes[ii].m_max[axis] = world._boxes[ii].m_min[axis] + size(rng);
+		}
+		world._is_static[ii] = 0 == (rng() & 1);
+	}
+
+	std::vector<ProxyPair> found;
+	int64_t start = bx::getHPCounter();
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		world._proxies[ii] = broadphase.createProxy(world._boxes[ii], ii, 0 != world._is_static[ii]);
+	}
+	broadphase.updatePairs(found);
+	const double first_ms = getMs(start);
+
+	PairList live;
+	for (const ProxyPair& pair : found)
+	{
+		addPair(live, pair._a, pair._b);
+	}
+
+	start = bx::getHPCounter();
+	PairList reference;
+	bruteForce(broadphase, world, reference);
+	const double brute_ms = getMs(start);
+	bool is_ok = reference == live;
+
+	std::vector<uint32_t> movers;
+	for (uint32_t ii = 0; ii < count && movers.size() < count / 10; ++ii)
+	{
+		if (!world._is_static[ii])
+		{
+			movers.push_back(ii);
+		}
+	}
+	std::vector<float> velocity(movers.size() * 3);
+	for (float& value : velocity)
+	{
+		value = step(rng);
+	}
+
+	double frame_ms = 0.0;
+	for (uint32_t frame = 0; frame < k_frame_count; ++frame)
+	{
+		found.clear();
+		start = bx::getHPCounter();
+		for (uint32_t ii = 0; ii < movers.size(); ++ii)
+		{
+			const uint32_t body = movers[ii];
+			if (!world._is_alive[body])
+			{
+				continue;
+			}
+
+			Aabb& box = world._boxes[body];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				box.m_min[axis] += velocity[ii * 3 + axis];
+				box.m_max[axis] += velocity[ii * 3 + axis];
+			}
+			broadphase.moveProxy(world._proxies[body], box, &velocity[ii * 3]);
+		}
+
+		for (uint32_t ii = 0; ii < k_churn; ++ii)
+		{
+			const uint32_t body = movers[rng() % movers.size()];
+			if (world._is_alive[body])
+			{
+				broadphase.destroyProxy(world._proxies[body]);
+			}
+			else
+			{
+				world._proxies[body] = broadphase.createProxy(world._boxes[body], body, false);
+			}
+			world._is_alive[body] ^= 1;
+		}
+		broadphase.updatePairs(found);
+		frame_ms += getMs(start);
+
+		// the caller's part: keep new pairs, drop the ones that separated
+		for (const ProxyPair& pair : found)
+		{
+			addPair(live, pair._a, pair._b);
+		}
+		for (PairList::iterator it = live.begin(); it != live.end();)
+		{
+			if (!world._is_alive[it->first]
+				|| !world._is_alive[it->second]
+				|| !broadphase.testOverlap(world._proxies[it->first], world._proxies[it->second]))
+			{
+				it = live.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	reference.clear();
+	bruteForce(broadphase, world, reference);
+	is_ok = is_ok && reference == live;
+
+	printf("%-12s %u boxes: first %.2f ms (brute force %.2f ms, %.1fx), %.3f ms per frame, %zu pairs %s\n",
+		name, count, first_ms, brute_ms, brute_ms / first_ms, frame_ms / k_frame_count, live.size(), is_ok ? "match" : "MISMATCH");
+	return is_ok;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t count = 1 < argc ? (uint32_t)atoi(argv[1]) : 20000;
+
+	bool is_ok = true;
+	{
+		DynamicTree tree;
+		is_ok &= run("tree", tree, count);
+	}
+	{
+		SweepAndPrune sap;
+		is_ok &= run("sap", sap, count);
+	}
+
+	// centers spread out geometrically: the binned SAH puts all but the
+	// outermost few boxes in the first bin on every level
+	DynamicTree tree;
+	for (uint32_t ii = 0; ii < k_skewed_count; ++ii)
+	{
+		const float x = powf(1.05f, (float)ii);
+		const Aabb box = { { x - 0.5f, -0.5f, -0.5f }, { x + 0.5f, 0.5f, 0.5f } };
+		tree.createProxy(box, ii, false);
+	}
+	tree.rebuild();
+	printf("skewed rebuild of %u boxes: height %u (stack %u)\n", k_skewed_count, tree.getHeight(), DynamicTree::k_stack_size);
+	is_ok &= tree.getHeight() < DynamicTree::k_stack_size;
+
+	return is_ok ? 0 : 1;
+}
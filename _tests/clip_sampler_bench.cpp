@@ -0,0 +1,131 @@
+// Compresses a synthetic walk cycle and measures how fast ClipSampler
+// decodes it, in joint samples per second on one core. Also checks that
+// isValidClip() turns away a clip whose key streams are cut short or
+// whose leading keys miss a track.
+
+#include <cmath>
+#include <cstdio>
+#include <bx/timer.h>
+
+#include "animation/clip_compressor.h"
+
+using namespace monster;
+
+static const uint32_t k_track_count = 64;
+static const uint32_t k_frame_count = 300;
+static const uint32_t k_instance_count = 256;
+static const uint32_t k_sample_frames = 600;
+
+static void makeAnimation(RawAnimation& raw)
+{
+	raw._frame_rate = 30.0f;
+	raw._frame_count = k_frame_count;
+	raw._track_count = k_track_count;
+	raw._frames.resize(k_frame_count * k_track_count);
+
+	for (uint32_t frame = 0; frame < k_frame_count; ++frame)
+	{
+		const float t = frame / raw._frame_rate;
+		for (uint32_t track = 0; track < k_track_count; ++track)
+		{
+			// every joint swings about its own axis; a few also drift and stretch
+			const float angle = 0.6f * sinf(t * 2.0f + track * 0.37f);
+			const float axis[3] = { sinf(track * 1.3f), cosf(track * 0.7f), 0.5f };
+			const float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+			JointTransform& joint = raw._frames[frame * k_track_count + track];
+			joint._translation[0] = 0 == track % 8 ? 0.2f * sinf(t) : 0.0f;
+			joint._translation[1] = 0.1f * track;
+			joint._translation[2] = 0.0f;
+			for (uint32_t ii = 0; ii < 3; ++ii)
+			{
+				joint._rotation[ii] = axis[ii] / length * sinf(angle * 0.5f);
+			}
+			joint._rotation[3] = cosf(angle * 0.5f);
+			joint._scale[0] = joint._scale[1] = joint._scale[2] = 0 == track % 16 ? 1.0f + 0.1f * sinf(t * 3.0f) : 1.0f;
+		}
+	}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	RawAnimation raw;
+	makeAnimation(raw);
+
+	std::vector<uint8_t> blob;
+	ClipCompressionStats stats;
+	if (!compressClip(raw, ClipCompressionSettings(), blob, &stats))
+	{
+		printf("compressClip failed\n");
+		return 1;
+	}
+
+	const AnimationClip* clip = (const AnimationClip*)getBlobRoot(&blob[0], blob.size(), getTypeInfo<AnimationClip>());
+	if (nullptr == clip
+		|| !isValidClip(*clip))
+	{
+		printf("compressed clip doesn't validate\n");
+		return 1;
+	}
+
+	printf("clip: %u tracks, %u frames, %u bytes raw, %u compressed (%.1f%%)\n",
+		k_track_count, k_frame_count, stats._raw_size, stats._compressed_size, 100.0f * stats._compressed_size / stats._raw_size);
+	printf("keys kept of %u: translation %u, rotation %u, scale %u\n",
+		stats._raw_keys, stats._kept_keys[k_stream_translation], stats._kept_keys[k_stream_rotation], stats._kept_keys[k_stream_scale]);
+
+	// a rotation stream one key short of key 1 of every track
+	AnimationClip truncated;
+	truncated._duration = clip->_duration;
+	truncated._frame_rate = clip->_frame_rate;
+	truncated._frame_count = clip->_frame_count;
+	truncated._track_count = clip->_track_count;
+	truncated._translation_ranges.set(clip->_translation_ranges.data(), clip->_translation_ranges.size());
+	truncated._scale_ranges.set(clip->_scale_ranges.data(), clip->_scale_ranges.size());
+	truncated._translations.set(clip->_translations.data(), clip->_translations.size());
+	truncated._rotations.set(clip->_rotations.data(), 2 * k_track_count - 1);
+	truncated._scales.set(clip->_scales.data(), clip->_scales.size());
+	if (isValidClip(truncated))
+	{
+		printf("truncated clip validated\n");
+		return 1;
+	}
+
+	// the right number of leading keys, but track 0 twice and track 1 not at all
+	std::vector<AnimationKey> repeated(clip->_rotations.data(), clip->_rotations.data() + clip->_rotations.size());
+	for (AnimationKey& key : repeated)
+	{
+		key._track = 1 == key._track ? 0 : key._track;
+	}
+	truncated._rotations.set(&repeated[0], (uint32_t)repeated.size());
+	if (isValidClip(truncated))
+	{
+		printf("clip with a track repeated validated\n");
+		return 1;
+	}
+
+	// instances start spread over the clip and play forward, wrapping around
+	static ClipSampler samplers[k_instance_count];
+	for (ClipSampler& sampler : samplers)
+	{
+		sampler.bind(clip);
+	}
+
+	AlignedVector<SoaTransform> pose((k_track_count + 3) / 4);
+	float checksum = 0.0f;
+	const int64_t start = bx::getHPCounter();
+	for (uint32_t frame = 0; frame < k_sample_frames; ++frame)
+	{
+		for (uint32_t ii = 0; ii < k_instance_count; ++ii)
+		{
+			const float time = fmodf((frame + ii * 7) / 60.0f, clip->_duration);
+			samplers[ii].sample(time, &pose[0]);
+			checksum += getLane(pose[ii % pose.size()]._qw, ii & 3);
+		}
+	}
+	const double seconds = double(bx::getHPCounter() - start) / double(bx::getHPFrequency());
+
+	const double samples = double(k_sample_frames) * k_instance_count;
+	printf("%u instances x %u frames: %.3f us per clip sample, %.1f M joint samples/s per core (checksum %.3f)\n",
+		k_instance_count, k_sample_frames, seconds * 1e6 / samples, samples * k_track_count / seconds * 1e-6, checksum);
+	return 0;
+}
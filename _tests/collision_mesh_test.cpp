@@ -0,0 +1,167 @@
+// Checks that isValidCollisionMesh() accepts a baked mesh and turns away
+// copies of it with a broken node link, a leaf past the last triangle, a
+// vertex index past the last vertex or a zero quantization step. Also
+// builds chains of nodes just within and just past the traversal stack
+// and queries the one that passes.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "physics/mesh_baker.h"
+
+using namespace monster;
+
+static const uint32_t k_grid = 64;
+static const uint32_t k_deepest = 63;
+
+struct BrokenMesh
+{
+	AlignedVector<uint8_t> _blob;
+	CollisionMesh* _mesh;
+
+	explicit BrokenMesh(const std::vector<uint8_t>& blob)
+		: _blob(blob.begin(), blob.end())
+		, _mesh((CollisionMesh*)getBlobRoot(&_blob[0], _blob.size(), getTypeInfo<CollisionMesh>()))
+	{
+	}
+};
+
+static uint32_t findNode(const CollisionMesh& mesh, bool is_leaf)
+{
+	for (uint32_t ii = 0; ii < mesh._nodes.size(); ++ii)
+	{
+		if (is_leaf == (0 != (mesh._nodes[ii]._data & CollisionMesh::k_leaf_flag)))
+		{
+			return ii;
+		}
+	}
+	return 0;
+}
+
+static void countTriangle(void* data, uint32_t /*triangle*/)
+{
+	++*(uint32_t*)data;
+}
+
+// inner nodes whose first child is a leaf and whose second is the next inner node
+static bool isValidChain(uint32_t depth, uint32_t& queried)
+{
+	std::vector<MeshNode> nodes;
+	for (uint32_t ii = 0; ii < depth; ++ii)
+	{
+		const MeshNode inner = { { 0, 0, 0 }, { 65535, 65535, 65535 }, (uint32_t)nodes.size() + 2 };
+		const MeshNode leaf = { { 0, 0, 0 }, { 65535, 65535, 65535 }, CollisionMesh::k_leaf_flag | 1u << CollisionMesh::k_count_shift };
+		nodes.push_back(inner);
+		nodes.push_back(leaf);
+	}
+	const MeshNode last = { { 0, 0, 0 }, { 65535, 65535, 65535 }, CollisionMesh::k_leaf_flag | 1u << CollisionMesh::k_count_shift };
+	nodes.push_back(last);
+
+	const MeshTriangle triangle = { { 0, 1, 2 } };
+	const MeshVertex vertices[3] = { { { 0.0f, 0.0f, 0.0f } }, { { 1.0f, 0.0f, 0.0f } }, { { 0.0f, 0.0f, 1.0f } } };
+
+	CollisionMesh mesh;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		mesh._min[axis] = 0.0f;
+		mesh._step[axis] = 1.0f / 65535.0f;
+	}
+	mesh._nodes.set(&nodes[0], (uint32_t)nodes.size());
+	mesh._triangles.set(&triangle, 1);
+	mesh._vertices.set(vertices, 3);
+
+	if (!isValidCollisionMesh(mesh))
+	{
+		return false;
+	}
+
+	const Aabb box = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	queried = 0;
+	queryMesh(mesh, box, countTriangle, &queried);
+	return true;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	// a bumpy square of k_grid by k_grid quads
+	RawMesh raw;
+	for (uint32_t z = 0; z <= k_grid; ++z)
+	{
+		for (uint32_t x = 0; x <= k_grid; ++x)
+		{
+			raw._positions.push_back((float)x);
+			raw._positions.push_back(0.3f * sinf(x * 0.4f) * cosf(z * 0.3f));
+			raw._positions.push_back((float)z);
+		}
+	}
+	for (uint32_t z = 0; z < k_grid; ++z)
+	{
+		for (uint32_t x = 0; x < k_grid; ++x)
+		{
+			const uint32_t corner = z * (k_grid + 1) + x;
+			const uint32_t quad[6] = { corner, corner + k_grid + 1, corner + 1, corner + 1, corner + k_grid + 1, corner + k_grid + 2 };
+			raw._indices.insert(raw._indices.end(), quad, quad + 6);
+		}
+	}
+
+	std::vector<uint8_t> blob;
+	MeshBakeStats stats;
+	if (!bakeCollisionMesh(raw, MeshBakeSettings(), blob, &stats))
+	{
+		printf("bakeCollisionMesh failed\n");
+		return 1;
+	}
+	printf("baked %u triangles, %u nodes, depth %u\n", stats._triangle_count, stats._node_count, stats._depth);
+
+	int result = 0;
+	{
+		BrokenMesh baked(blob);
+		const bool is_valid = nullptr != baked._mesh && isValidCollisionMesh(*baked._mesh);
+		printf("baked mesh: %s\n", is_valid ? "valid" : "INVALID");
+		result |= is_valid ? 0 : 1;
+	}
+
+	uint32_t rejected = 0;
+	uint32_t tried = 0;
+	{
+		BrokenMesh broken(blob);
+		MeshNode& node = broken._mesh->_nodes[findNode(*broken._mesh, false)];
+		node._data = 0;
+		rejected += isValidCollisionMesh(*broken._mesh) ? 0 : 1; ++tried;
+	}
+	{
+		BrokenMesh broken(blob);
+		MeshNode& node = broken._mesh->_nodes[findNode(*broken._mesh, false)];
+		node._data = broken._mesh->_nodes.size();
+		rejected += isValidCollisionMesh(*broken._mesh) ? 0 : 1; ++tried;
+	}
+	{
+		BrokenMesh broken(blob);
+		MeshNode& node = broken._mesh->_nodes[findNode(*broken._mesh, true)];
+		node._data = CollisionMesh::k_leaf_flag | 2u << CollisionMesh::k_count_shift | (broken._mesh->_triangles.size() - 1);
+		rejected += isValidCollisionMesh(*broken._mesh) ? 0 : 1; ++tried;
+	}
+	{
+		BrokenMesh broken(blob);
+		broken._mesh->_triangles[broken._mesh->_triangles.size() / 2]._vertex[1] = broken._mesh->_vertices.size();
+		rejected += isValidCollisionMesh(*broken._mesh) ? 0 : 1; ++tried;
+	}
+	{
+		BrokenMesh broken(blob);
+		broken._mesh->_step[1] = 0.0f;
+		rejected += isValidCollisionMesh(*broken._mesh) ? 0 : 1; ++tried;
+	}
+	printf("broken meshes rejected: %u/%u\n", rejected, tried);
+	result |= rejected == tried ? 0 : 1;
+
+	uint32_t queried = 0;
+	const bool is_deepest_valid = isValidChain(k_deepest, queried);
+	uint32_t too_deep_queried = 0;
+	const bool is_too_deep_valid = isValidChain(k_deepest + 1, too_deep_queried);
+	printf("chain of depth %u: %s, %u triangles queried; depth %u: %s\n",
+		k_deepest, is_deepest_valid ? "valid" : "INVALID", queried, k_deepest + 1, is_too_deep_valid ? "VALID" : "invalid");
+	result |= is_deepest_valid && k_deepest + 1 == queried && !is_too_deep_valid ? 0 : 1;
+
+	return result;
+}
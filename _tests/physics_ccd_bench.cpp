@@ -0,0 +1,100 @@
+// Fires 10k small balls at 100 to 300 m/s at a row of walls thinner than
+// the balls, once as ordinary bodies and once flagged _is_fast, and prints
+// ms per step, the part of it spent sweeping and how many balls got past
+// the first wall. None may get past it when flagged. Fast bodies are only
+// swept against static bodies, so the same walls made kinematic are let
+// through; that count is printed but not checked.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <bx/timer.h>
+
+#include "physics/physics_manager.h"
+
+using namespace monster;
+
+static const uint32_t k_wall_count = 5;
+static const float k_wall_spacing = 10.0f;
+static const uint32_t k_row = 100;
+static const uint32_t k_step_count = 60;
+
+struct Result
+{
+	double _step_ms;
+	double _continuous_ms;
+	uint32_t _tunneled;
+};
+
+static Result run(const CollisionShape& wall, const CollisionShape& ball, uint32_t count, bool is_fast, BodyType wall_type)
+{
+	PhysicsManager world;
+	world.initialize();
+	const float gravity[3] = { 0.0f, 0.0f, 0.0f };
+	world.setGravity(gravity);
+
+	for (uint32_t ii = 0; ii < k_wall_count; ++ii)
+	{
+		BodyDesc desc;
+		desc._shape = &wall;
+		desc._type = wall_type;
+		desc._position[0] = k_wall_spacing * (ii + 1);
+		world.createBody(desc);
+	}
+
+	std::vector<BodyHandle> balls(count);
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		BodyDesc desc;
+		desc._shape = &ball;
+		desc._is_fast = is_fast;
+		desc._position[1] = -45.0f + (ii % k_row) * 0.9f;
+		desc._position[2] = -45.0f + (ii / k_row % k_row) * 0.9f;
+		desc._linear_velocity[0] = 100.0f + (ii % 201);
+		desc._linear_velocity[1] = ((ii * 7) % 11 - 5.0f) * 0.3f;
+		balls[ii] = world.createBody(desc);
+	}
+
+	world.setProfiling(true);
+	Result result = {};
+	const int64_t start = bx::getHPCounter();
+	for (uint32_t step = 0; step < k_step_count; ++step)
+	{
+		world.step(1.0f / 60.0f);
+		PhysicsProfile profile;
+		world.getProfile(profile);
+		result._continuous_ms += profile._continuous;
+	}
+	result._step_ms = double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency()) / k_step_count;
+	result._continuous_ms /= k_step_count;
+
+	for (BodyHandle handle : balls)
+	{
+		float position[3];
+		world.getPosition(handle, position);
+		result._tunneled += position[0] > k_wall_spacing ? 1 : 0;
+	}
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t count = 1 < argc ? (uint32_t)atoi(argv[1]) : 10000;
+
+	// walls 5 cm thick, balls 10 cm across
+	CollisionShape wall;
+	const float half_extents[3] = { 0.025f, 50.0f, 50.0f };
+	wall.createBox(half_extents);
+	CollisionShape ball;
+	ball.createSphere(0.05f);
+
+	const Result plain = run(wall, ball, count, false, BodyType::Static);
+	const Result fast = run(wall, ball, count, true, BodyType::Static);
+	const Result moving = run(wall, ball, count, true, BodyType::Kinematic);
+
+	printf("%u balls, %u steps\n", count, k_step_count);
+	printf("ordinary:                %.3f ms per step, %u got through\n", plain._step_ms, plain._tunneled);
+	printf("fast:                    %.3f ms per step (%.3f sweeping), %u got through\n", fast._step_ms, fast._continuous_ms, fast._tunneled);
+	printf("fast, kinematic walls:   %.3f ms per step (%.3f sweeping), %u got through\n", moving._step_ms, moving._continuous_ms, moving._tunneled);
+	return 0 == fast._tunneled ? 0 : 1;
+}
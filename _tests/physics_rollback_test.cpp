@@ -0,0 +1,344 @@
+// Rolls a settling pile of bodies back 8 frames every 10 frames and
+// resimulates with the same inputs, which must give the same state hash
+// after every step, with and without workers and with both broadphases.
+// Snapshots that are cut short, carry a bad header or point an index out
+// of range must fail to load and leave the world as it was, also after
+// any single byte of a snapshot is flipped. Prints the time of a rollback
+// and 8 steps against the 16 ms frame budget.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <bx/timer.h>
+
+#include "core/job/job_system.h"
+#include "physics/physics_manager.h"
+
+using namespace monster;
+
+static const uint32_t k_frame_count = 300;
+static const uint32_t k_window = 8;
+static const uint32_t k_rollback_interval = 10;
+static const uint32_t k_flip_count = 2000;
+static const double k_budget_ms = 16.0;
+
+struct Shapes
+{
+	CollisionShape _ground;
+	CollisionShape _box;
+	CollisionShape _sphere;
+	CollisionShape _capsule;
+};
+
+struct Scene
+{
+	std::vector<BodyHandle> _bodies;
+	BodyHandle _spawned;
+};
+
+struct Snapshot
+{
+	std::vector<uint8_t> _state;
+	BodyHandle _spawned;
+};
+
+static double getMs(int64_t start)
+{
+	return double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency());
+}
+
+static void build(PhysicsManager& world, const Shapes& shapes, uint32_t count, Scene& scene)
+{
+	BodyDesc ground;
+	ground._shape = &shapes._ground;
+	ground._type = BodyType::Static;
+	ground._position[1] = -0.5f;
+	world.createBody(ground);
+
+	// a pile ten by ten wide, every other layer shifted
+	const CollisionShape* kinds[] = { &shapes._box, &shapes._sphere, &shapes._capsule };
+	scene._bodies.resize(count);
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		const uint32_t layer = ii / 100;
+		BodyDesc desc;
+		desc._shape = kinds[ii % 3];
+		desc._position[0] = (ii % 10) * 1.1f - 5.0f + (layer % 2) * 0.3f;
+		desc._position[1] = 1.0f + layer * 1.2f;
+		desc._position[2] = (ii / 10 % 10) * 1.1f - 5.0f;
+		scene._bodies[ii] = world.createBody(desc);
+	}
+
+	BodyDesc pusher;
+	pusher._shape = &shapes._box;
+	pusher._type = BodyType::Kinematic;
+	pusher._position[0] = -12.0f;
+	pusher._position[1] = 0.5f;
+	pusher._linear_velocity[0] = 2.0f;
+	world.createBody(pusher);
+
+	scene._spawned = k_invalid_body;
+}
+
+// the game's input for a frame, from the frame number alone
+static void applyInput(PhysicsManager& world, const Shapes& shapes, uint32_t frame, Scene& scene)
+{
+	if (0 == frame % 7)
+	{
+		const BodyHandle body = scene._bodies[frame * 37 % scene._bodies.size()];
+		const float impulse[3] = { (float)(frame % 5) - 2.0f, 3.0f, 0.5f };
+		float point[3];
+		world.getPosition(body, point);
+		world.applyImpulse(body, impulse, point);
+	}
+
+	if (25 == frame % 50)
+	{
+		BodyDesc desc;
+		desc._shape = &shapes._sphere;
+		desc._position[1] = 20.0f;
+		desc._linear_velocity[1] = -5.0f;
+		scene._spawned = world.createBody(desc);
+	}
+	else if (40 == frame % 50 && isValid(scene._spawned))
+	{
+		world.destroyBody(scene._spawned);
+		scene._spawned = k_invalid_body;
+	}
+}
+
+static void stepFrame(PhysicsManager& world, const Shapes& shapes, uint32_t frame, Scene& scene)
+{
+	applyInput(world, shapes, frame, scene);
+	world.step(1.0f / 60.0f);
+}
+
+// Returns the number of resimulated steps whose hash differs from the first run.
+static uint32_t run(const char* name, const Shapes& shapes, uint32_t count, JobSystem* job_system, BroadphaseType broadphase, uint64_t& final_hash)
+{
+	PhysicsManager world;
+	world.initialize(job_system);
+	world.setBroadphase(broadphase);
+	Scene scene;
+	build(world, shapes, count, scene);
+
+	std::vector<Snapshot> snapshots(k_window + 1);
+	std::vector<uint64_t> hashes(k_frame_count);
+	uint32_t mismatches = 0;
+	uint32_t rollback_count = 0;
+	double save_ms = 0.0;
+	double load_ms = 0.0;
+	double rollback_ms = 0.0;
+	double max_rollback_ms = 0.0;
+	for (uint32_t frame = 0; frame < k_frame_count; ++frame)
+	{
+		Snapshot& snapshot = snapshots[frame % snapshots.size()];
+		int64_t start = bx::getHPCounter();
+		world.saveState(snapshot._state);
+		save_ms += getMs(start);
+		snapshot._spawned = scene._spawned;
+
+		stepFrame(world, shapes, frame, scene);
+		hashes[frame] = world.computeStateHash();
+
+		if (k_window > frame || 0 != frame % k_rollback_interval)
+		{
+			continue;
+		}
+
+		// back to the start of the window and forward to this frame again
+		const uint32_t first = frame - k_window + 1;
+		const Snapshot& back = snapshots[first % snapshots.size()];
+		start = bx::getHPCounter();
+		if (!world.loadState(back._state.data(), back._state.size()))
+		{
+			printf("%s: snapshot of frame %u failed to load\n", name, first);
+			return 1;
+		}
+		load_ms += getMs(start);
+		scene._spawned = back._spawned;
+
+		for (uint32_t replay = first; replay <= frame; ++replay)
+		{
+			stepFrame(world, shapes, replay, scene);
+			mismatches += world.computeStateHash() == hashes[replay] ? 0 : 1;
+			if (replay < frame)
+			{
+				Snapshot& resaved = snapshots[(replay + 1) % snapshots.size()];
+				world.saveState(resaved._state);
+				resaved._spawned = scene._spawned;
+			}
+		}
+
+		const double ms = getMs(start);
+		rollback_ms += ms;
+		max_rollback_ms = std::max(max_rollback_ms, ms);
+		++rollback_count;
+	}
+
+	final_hash = hashes[k_frame_count - 1];
+	printf("%-22s %u bodies, snapshot %zu KB, save %.3f ms, load %.3f ms, rollback and %u steps %.2f ms (max %.2f, budget %.0f), %u rollbacks, %u mismatches\n",
+		name, world.getBodyCount(), snapshots[0]._state.size() / 1024, save_ms / k_frame_count, load_ms / rollback_count, k_window,
+		rollback_ms / rollback_count, max_rollback_ms, k_budget_ms, rollback_count, mismatches);
+	return mismatches;
+}
+
+// Offset of the first element of the array after the header and the
+// arrays before it, each a count and the elements.
+static size_t skipArray(size_t offset, size_t element_size, uint32_t count)
+{
+	return offset + sizeof(uint32_t) + element_size * count;
+}
+
+static bool isRejected(PhysicsManager& world, const std::vector<uint8_t>& state)
+{
+	const uint64_t hash = world.computeStateHash();
+	const uint32_t count = world.getBodyCount();
+	return !world.loadState(state.data(), state.size())
+		&& hash == world.computeStateHash()
+		&& count == world.getBodyCount();
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t count = 1 < argc ? (uint32_t)atoi(argv[1]) : 1000;
+
+	Shapes shapes;
+	const float ground[3] = { 50.0f, 0.5f, 50.0f };
+	shapes._ground.createBox(ground);
+	const float box[3] = { 0.5f, 0.5f, 0.5f };
+	shapes._box.createBox(box);
+	shapes._sphere.createSphere(0.5f);
+	shapes._capsule.createCapsule(0.3f, 0.5f);
+
+	int result = 0;
+	uint64_t hashes[4];
+	result |= 0 == run("tree", shapes, count, nullptr, BroadphaseType::DynamicTree, hashes[0]) ? 0 : 1;
+	result |= 0 == run("tree again", shapes, count, nullptr, BroadphaseType::DynamicTree, hashes[1]) ? 0 : 1;
+	result |= 0 == run("sweep and prune", shapes, count, nullptr, BroadphaseType::SweepAndPrune, hashes[2]) ? 0 : 1;
+	{
+		JobSystem job_system;
+		job_system.initialize(3);
+		result |= 0 == run("tree, 3 workers", shapes, count, &job_system, BroadphaseType::DynamicTree, hashes[3]) ? 0 : 1;
+		job_system.shutdown();
+	}
+
+	const bool is_repeatable = hashes[0] == hashes[1] && hashes[0] == hashes[3];
+	printf("same final hash across runs and with workers: %s\n", is_repeatable ? "yes" : "NO");
+	result |= is_repeatable ? 0 : 1;
+
+	// a snapshot loads into another manager and carries on the same
+	PhysicsManager world;
+	world.initialize();
+	Scene scene;
+	build(world, shapes, count, scene);
+	for (uint32_t frame = 0; frame < 60; ++frame)
+	{
+		stepFrame(world, shapes, frame, scene);
+	}
+
+	std::vector<uint8_t> state;
+	world.saveState(state);
+	{
+		PhysicsManager other;
+		other.initialize();
+		Scene other_scene = scene;
+		const bool is_loaded = other.loadState(state.data(), state.size());
+		for (uint32_t frame = 60; frame < 120; ++frame)
+		{
+			stepFrame(world, shapes, frame, scene);
+			stepFrame(other, shapes, frame, other_scene);
+		}
+		const bool is_same = is_loaded && world.computeStateHash() == other.computeStateHash();
+		printf("loaded into another manager: %s\n", is_same ? "same" : "DIFFERENT");
+		result |= is_same ? 0 : 1;
+	}
+
+	// broken snapshots, tried on a world that has moved on since
+	uint32_t saved_count = 0;
+	memcpy(&saved_count, &state[3 * sizeof(uint32_t)], sizeof(saved_count));
+
+	// magic, version and accumulator, then the per body arrays up to _proxy
+	size_t proxy_offset = 3 * sizeof(uint32_t);
+	const size_t sizes[] = { sizeof(Vec3), sizeof(Quat), sizeof(Vec3), sizeof(Vec3), sizeof(Vec3), sizeof(Vec3), sizeof(float),
+		sizeof(Mat3), sizeof(Mat3), sizeof(const CollisionShape*), sizeof(BodyType), sizeof(float), sizeof(float), sizeof(float),
+		sizeof(float), sizeof(float), sizeof(uint8_t), sizeof(uint8_t), sizeof(Aabb) };
+	for (size_t size : sizes)
+	{
+		proxy_offset = skipArray(proxy_offset, size, saved_count);
+	}
+	const size_t handle_offset = skipArray(proxy_offset, sizeof(uint32_t), saved_count);
+
+	uint32_t rejected = 0;
+	uint32_t tried = 0;
+	std::vector<uint8_t> broken(state.begin(), state.end() - 3);
+	rejected += isRejected(world, broken) ? 1 : 0; ++tried;
+
+	broken = state;
+	broken[0] ^= 1;
+	rejected += isRejected(world, broken) ? 1 : 0; ++tried;
+
+	const uint32_t out_of_range = 0x00ffffff;
+	broken = state;
+	memcpy(&broken[proxy_offset + sizeof(uint32_t) * 4], &out_of_range, sizeof(out_of_range));
+	rejected += isRejected(world, broken) ? 1 : 0; ++tried;
+
+	broken = state;
+	memcpy(&broken[handle_offset + sizeof(uint32_t) * 5], &out_of_range, sizeof(out_of_range));
+	rejected += isRejected(world, broken) ? 1 : 0; ++tried;
+
+	// the body count of the last per body array one short
+	broken = state;
+	const uint32_t short_count = saved_count - 1;
+	memcpy(&broken[handle_offset], &short_count, sizeof(short_count));
+	rejected += isRejected(world, broken) ? 1 : 0; ++tried;
+
+	printf("broken snapshots rejected with the world left alone: %u/%u\n", rejected, tried);
+	result |= rejected == tried ? 0 : 1;
+
+	// any one byte flipped either loads or leaves the world alone; most
+	// bytes are floats, which load fine
+	std::mt19937 rng(5);
+	uint32_t flip_rejected = 0;
+	uint32_t flip_failed = 0;
+	for (uint32_t ii = 0; ii < k_flip_count; ++ii)
+	{
+		broken = state;
+		broken[rng() % broken.size()] ^= (uint8_t)(1 + rng() % 255);
+		const uint64_t hash = world.computeStateHash();
+		if (world.loadState(broken.data(), broken.size()))
+		{
+			world.loadState(state.data(), state.size());
+		}
+		else
+		{
+			++flip_rejected;
+			flip_failed += hash == world.computeStateHash() ? 0 : 1;
+		}
+	}
+	printf("%u single byte flips: %u rejected, %u of them changed the world\n", k_flip_count, flip_rejected, flip_failed);
+	result |= 0 == flip_failed ? 0 : 1;
+
+	// a destroyed body's handle goes stale once its slot is reused, and
+	// destroying it again leaves the new body alone
+	{
+		BodyDesc desc;
+		desc._shape = &shapes._box;
+		desc._position[1] = 50.0f;
+		const BodyHandle destroyed = world.createBody(desc);
+		world.destroyBody(destroyed);
+		const BodyHandle reused = world.createBody(desc);
+		const uint32_t body_count = world.getBodyCount();
+		world.destroyBody(destroyed);
+		const bool is_stale = reused.idx == destroyed.idx
+			&& !world.isAlive(destroyed)
+			&& world.isAlive(reused)
+			&& body_count == world.getBodyCount();
+		printf("stale body handle after its slot is reused: %s\n", is_stale ? "ignored" : "ALIASED");
+		result |= is_stale ? 0 : 1;
+	}
+
+	return result;
+}
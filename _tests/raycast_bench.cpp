@@ -0,0 +1,265 @@
+// Scene query throughput of PhysicsManager::rayCast() over 20k static
+// boxes, spheres, capsules and hulls: the latency of one query at a time
+// and rays per second for a batch, for random rays and for coherent fans
+// like an agent looking around. The hits are checked against testing
+// every body, and the batch is timed again through a job system.
+// Speedups from the workers only show on a machine with the cores.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <bx/timer.h>
+
+#include "core/job/job_system.h"
+#include "physics/physics_manager.h"
+#include "physics/shape_cast.h"
+
+using namespace monster;
+
+static const uint32_t k_ray_count = 20000;
+static const uint32_t k_checked_count = 2000;
+static const uint32_t k_fan_size = 16;
+static const uint32_t k_repeat_count = 3;
+
+struct Shapes
+{
+	CollisionShape _ground;
+	CollisionShape _box;
+	CollisionShape _sphere;
+	CollisionShape _capsule;
+	CollisionShape _hull;
+};
+
+struct Body
+{
+	const CollisionShape* _shape;
+	Transform _transform;
+	BodyHandle _handle;
+};
+
+static double getSeconds(int64_t start)
+{
+	return double(bx::getHPCounter() - start) / double(bx::getHPFrequency());
+}
+
+static void createShapes(Shapes& shapes)
+{
+	const float ground[3] = { 100.0f, 0.5f, 100.0f };
+	shapes._ground.createBox(ground);
+	const float box[3] = { 0.5f, 0.5f, 0.5f };
+	shapes._box.createBox(box);
+	shapes._sphere.createSphere(0.5f);
+	shapes._capsule.createCapsule(0.3f, 0.5f);
+
+	float points[8 * 3];
+	for (uint32_t ii = 0; ii < 8; ++ii)
+	{
+		points[ii * 3 + 0] = 0 != (ii & 1) ? 1.0f : -0.2f;
+		points[ii * 3 + 1] = 0 != (ii & 2) ? 0.5f : -0.5f;
+		points[ii * 3 + 2] = 0 != (ii & 4) ? 0.3f : -0.6f;
+	}
+	shapes._hull.createConvex(points, 8);
+}
+
+static void createWorld(PhysicsManager& world, const Shapes& shapes, uint32_t count, std::vector<Body>& bodies)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> height(0.0f, 20.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	BodyDesc ground;
+	ground._shape = &shapes._ground;
+	ground._type = BodyType::Static;
+	ground._position[1] = -0.5f;
+
+	bodies.clear();
+	const Body ground_body = { &shapes._ground, Transform(), world.createBody(ground) };
+	bodies.push_back(ground_body);
+
+	const CollisionShape* kinds[] = { &shapes._box, &shapes._sphere, &shapes._capsule, &shapes._hull };
+	for (uint32_t ii = 0; ii < count; ++ii)
+	{
+		BodyDesc desc;
+		desc._shape = kinds[ii % 4];
+		desc._type = BodyType::Static;
+		desc._position[0] = spread(rng);
+		desc._position[1] = height(rng);
+		desc._position[2] = spread(rng);
+		const Quat rotation = normalize(Quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+		desc._rotation[0] = rotation.x;
+		desc._rotation[1] = rotation.y;
+		desc._rotation[2] = rotation.z;
+		desc._rotation[3] = rotation.w;
+		const Body body = { desc._shape, Transform(), world.createBody(desc) };
+		bodies.push_back(body);
+	}
+
+	// lets the tree rebuild once after the bulk load
+	world.step(1.0f / 60.0f);
+
+	for (Body& body : bodies)
+	{
+		float position[3];
+		float rotation[4];
+		world.getPosition(body._handle, position);
+		world.getRotation(body._handle, rotation);
+		body._transform = Transform(Vec3(position), Quat(rotation[0], rotation[1], rotation[2], rotation[3]));
+	}
+}
+
+static bool rayCastAll(const std::vector<Body>& bodies, const RayCastInput& ray, QueryHit& hit)
+{
+	const Vec3 direction = normalize(Vec3(ray._direction));
+	float closest = ray._max_distance;
+	hit._body = k_invalid_body;
+	for (const Body& body : bodies)
+	{
+		ShapeHit shape_hit;
+		if (rayCastShape(*body._shape, body._transform, Vec3(ray._origin), direction, closest, shape_hit))
+		{
+			closest = shape_hit._t;
+			hit._body = body._handle;
+			hit._distance = shape_hit._t;
+		}
+	}
+	return isValid(hit._body);
+}
+
+static void timeRays(const char* name, const PhysicsManager& world, const std::vector<RayCastInput>& rays, std::vector<QueryHit>& hits)
+{
+	double batch = 1e9;
+	double single = 1e9;
+	for (uint32_t repeat = 0; repeat < k_repeat_count; ++repeat)
+	{
+		int64_t start = bx::getHPCounter();
+		world.rayCast(&rays[0], k_ray_count, &hits[0]);
+		batch = std::min(batch, getSeconds(start));
+
+		start = bx::getHPCounter();
+		for (uint32_t ii = 0; ii < k_ray_count; ++ii)
+		{
+			world.rayCast(rays[ii], hits[ii]);
+		}
+		single = std::min(single, getSeconds(start));
+	}
+
+	uint32_t hit_count = 0;
+	for (const QueryHit& hit : hits)
+	{
+		hit_count += isValid(hit._body) ? 1 : 0;
+	}
+
+	printf("%-14s batched %.2f Mrays/s, one at a time %.2f Mrays/s (%.2f us per query), %u/%u hit\n",
+		name, k_ray_count / batch * 1e-6, k_ray_count / single * 1e-6, single / k_ray_count * 1e6, hit_count, k_ray_count);
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t body_count = 1 < argc ? (uint32_t)atoi(argv[1]) : 20000;
+
+	Shapes shapes;
+	createShapes(shapes);
+
+	PhysicsManager world;
+	world.initialize();
+	std::vector<Body> bodies;
+	createWorld(world, shapes, body_count, bodies);
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> height(0.0f, 20.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<RayCastInput> random_rays(k_ray_count);
+	for (RayCastInput& ray : random_rays)
+	{
+		ray._origin[0] = spread(rng);
+		ray._origin[1] = height(rng);
+		ray._origin[2] = spread(rng);
+		ray._direction[0] = unit(rng);
+		ray._direction[1] = unit(rng);
+		ray._direction[2] = unit(rng);
+		ray._max_distance = 50.0f;
+	}
+
+	std::vector<RayCastInput> fan_rays(k_ray_count);
+	for (uint32_t fan = 0; fan < k_ray_count / k_fan_size; ++fan)
+	{
+		const float origin[3] = { spread(rng), height(rng), spread(rng) };
+		const float yaw = unit(rng) * 3.14159f;
+		for (uint32_t ii = 0; ii < k_fan_size; ++ii)
+		{
+			RayCastInput& ray = fan_rays[fan * k_fan_size + ii];
+			const float angle = yaw + ((float)ii - 8.0f) * 0.02f;
+			memcpy(ray._origin, origin, sizeof(origin));
+			ray._direction[0] = cosf(angle);
+			ray._direction[1] = -0.05f * (float)(ii % 4);
+			ray._direction[2] = sinf(angle);
+			ray._max_distance = 50.0f;
+		}
+	}
+
+	int result = 0;
+	std::vector<QueryHit> hits(k_ray_count);
+
+	{
+		world.rayCast(&random_rays[0], k_checked_count, &hits[0]);
+		uint32_t mismatches = 0;
+		for (uint32_t ii = 0; ii < k_checked_count; ++ii)
+		{
+			QueryHit reference;
+			const bool is_hit = rayCastAll(bodies, random_rays[ii], reference);
+			if (is_hit != isValid(hits[ii]._body)
+				|| (is_hit && 1e-4f < fabsf(reference._distance - hits[ii]._distance)))
+			{
+				++mismatches;
+			}
+		}
+		printf("%u bodies; %u rays against every body: %u mismatches\n", (uint32_t)bodies.size(), k_checked_count, mismatches);
+		result |= 0 == mismatches ? 0 : 1;
+	}
+
+	timeRays("random rays", world, random_rays, hits);
+	timeRays("coherent fans", world, fan_rays, hits);
+
+	// the same batch split over workers finds the same hits
+	{
+		world.rayCast(&random_rays[0], k_ray_count, &hits[0]);
+
+		const uint32_t core_count = std::thread::hardware_concurrency();
+		JobSystem job_system;
+		job_system.initialize(core_count > 1 ? core_count - 1 : 3);
+
+		PhysicsManager parallel;
+		parallel.initialize(&job_system);
+		std::vector<Body> parallel_bodies;
+		createWorld(parallel, shapes, body_count, parallel_bodies);
+
+		std::vector<QueryHit> parallel_hits(k_ray_count);
+		double batch = 1e9;
+		for (uint32_t repeat = 0; repeat < k_repeat_count; ++repeat)
+		{
+			const int64_t start = bx::getHPCounter();
+			parallel.rayCast(&random_rays[0], k_ray_count, &parallel_hits[0]);
+			batch = std::min(batch, getSeconds(start));
+		}
+
+		uint32_t same = 0;
+		for (uint32_t ii = 0; ii < k_ray_count; ++ii)
+		{
+			same += hits[ii]._body.idx == parallel_hits[ii]._body.idx ? 1 : 0;
+		}
+		printf("%u cores, %u workers: random rays batched %.2f Mrays/s, %u/%u same hits\n",
+			core_count, job_system.getWorkerCount(), k_ray_count / batch * 1e-6, same, k_ray_count);
+		result |= k_ray_count == same ? 0 : 1;
+
+		job_system.shutdown();
+	}
+
+	return result;
+}
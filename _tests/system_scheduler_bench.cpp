@@ -0,0 +1,362 @@
+// Runs 10 systems with mixed component access over 100k entities through
+// SystemScheduler with a growing number of job workers and prints ms per
+// frame and the speedup over the calling thread alone. Conflicting systems
+// keep their registration order, so every worker count must end on the
+// same checksum as the single threaded run. Speedups only mean something
+// when the machine has the cores; the core count is printed first.
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <bx/timer.h>
+
+#include "core/job/job_system.h"
+#include "entity/system_scheduler.h"
+
+using namespace monster;
+
+static const uint32_t k_entity_count = 100000;
+static const uint32_t k_frame_count = 60;
+static const float k_dt = 1.0f / 60.0f;
+
+struct Position { float _value[3]; };
+struct Velocity { float _value[3]; };
+struct Acceleration { float _value[3]; };
+struct Rotation { float _value[4]; };
+struct AngularVelocity { float _value[3]; };
+struct Bounds { float _min[3]; float _max[3]; };
+struct Heading { float _yaw; };
+struct Lifetime { float _age; };
+struct Health { float _value; };
+struct Damage { float _per_second; };
+struct Tint { float _rgba[4]; };
+
+// reads Acceleration, writes Velocity
+class AccelerateSystem : public System
+{
+public:
+	AccelerateSystem() { reads<Acceleration>(); writes<Velocity>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		const Acceleration* acceleration = chunk.get<Acceleration>();
+		Velocity* velocity = chunk.get<Velocity>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				velocity[ii]._value[axis] += acceleration[ii]._value[axis] * dt;
+			}
+		}
+	}
+};
+
+// writes Velocity
+class DragSystem : public System
+{
+public:
+	DragSystem() { writes<Velocity>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		Velocity* velocity = chunk.get<Velocity>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			float* v = velocity[ii]._value;
+			const float speed = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+			const float scale = 1.0f / (1.0f + 0.05f * speed * dt);
+			v[0] *= scale;
+			v[1] *= scale;
+			v[2] *= scale;
+		}
+	}
+};
+
+// reads Velocity, writes Position
+class MoveSystem : public System
+{
+public:
+	MoveSystem() { reads<Velocity>(); writes<Position>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		const Velocity* velocity = chunk.get<Velocity>();
+		Position* position = chunk.get<Position>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				position[ii]._value[axis] += velocity[ii]._value[axis] * dt;
+			}
+		}
+	}
+};
+
+// reads AngularVelocity, writes Rotation
+class SpinSystem : public System
+{
+public:
+	SpinSystem() { reads<AngularVelocity>(); writes<Rotation>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		const AngularVelocity* angular = chunk.get<AngularVelocity>();
+		Rotation* rotation = chunk.get<Rotation>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			const float* w = angular[ii]._value;
+			float* q = rotation[ii]._value;
+			const float h = 0.5f * dt;
+			const float x = q[0] + h * (w[0] * q[3] + w[1] * q[2] - w[2] * q[1]);
+			const float y = q[1] + h * (w[1] * q[3] + w[2] * q[0] - w[0] * q[2]);
+			const float z = q[2] + h * (w[2] * q[3] + w[0] * q[1] - w[1] * q[0]);
+			const float s = q[3] - h * (w[0] * q[0] + w[1] * q[1] + w[2] * q[2]);
+			const float inv_length = 1.0f / sqrtf(x * x + y * y + z * z + s * s);
+			q[0] = x * inv_length;
+			q[1] = y * inv_length;
+			q[2] = z * inv_length;
+			q[3] = s * inv_length;
+		}
+	}
+};
+
+// reads Position and Rotation, writes Bounds
+class BoundsSystem : public System
+{
+public:
+	BoundsSystem() { reads<Position>(); reads<Rotation>(); writes<Bounds>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float /*dt*/) override
+	{
+		const Position* position = chunk.get<Position>();
+		const Rotation* rotation = chunk.get<Rotation>();
+		Bounds* bounds = chunk.get<Bounds>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			// a unit box turned by the rotation, its extent along each axis
+			const float* q = rotation[ii]._value;
+			const float extent[3] =
+			{
+				fabsf(1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2])) + fabsf(2.0f * (q[0] * q[1] - q[2] * q[3])) + fabsf(2.0f * (q[0] * q[2] + q[1] * q[3])),
+				fabsf(2.0f * (q[0] * q[1] + q[2] * q[3])) + fabsf(1.0f - 2.0f * (q[0] * q[0] + q[2] * q[2])) + fabsf(2.0f * (q[1] * q[2] - q[0] * q[3])),
+				fabsf(2.0f * (q[0] * q[2] - q[1] * q[3])) + fabsf(2.0f * (q[1] * q[2] + q[0] * q[3])) + fabsf(1.0f - 2.0f * (q[0] * q[0] + q[1] * q[1])),
+			};
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				bounds[ii]._min[axis] = position[ii]._value[axis] - 0.5f * extent[axis];
+				bounds[ii]._max[axis] = position[ii]._value[axis] + 0.5f * extent[axis];
+			}
+		}
+	}
+};
+
+// reads Velocity, writes Heading
+class HeadingSystem : public System
+{
+public:
+	HeadingSystem() { reads<Velocity>(); writes<Heading>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float /*dt*/) override
+	{
+		const Velocity* velocity = chunk.get<Velocity>();
+		Heading* heading = chunk.get<Heading>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			heading[ii]._yaw = atan2f(velocity[ii]._value[0], velocity[ii]._value[2]);
+		}
+	}
+};
+
+// reads Damage, writes Health
+class DamageSystem : public System
+{
+public:
+	DamageSystem() { reads<Damage>(); writes<Health>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		const Damage* damage = chunk.get<Damage>();
+		Health* health = chunk.get<Health>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			health[ii]._value -= damage[ii]._per_second * dt;
+		}
+	}
+};
+
+// writes Lifetime
+class AgeSystem : public System
+{
+public:
+	AgeSystem() { writes<Lifetime>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		Lifetime* lifetime = chunk.get<Lifetime>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			lifetime[ii]._age += dt;
+		}
+	}
+};
+
+// reads Lifetime and Health, writes Tint
+class FadeSystem : public System
+{
+public:
+	FadeSystem() { reads<Lifetime>(); reads<Health>(); writes<Tint>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float /*dt*/) override
+	{
+		const Lifetime* lifetime = chunk.get<Lifetime>();
+		const Health* health = chunk.get<Health>();
+		Tint* tint = chunk.get<Tint>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			const float life = health[ii]._value / 100.0f;
+			tint[ii]._rgba[0] = 1.0f - life;
+			tint[ii]._rgba[1] = life;
+			tint[ii]._rgba[2] = 0.5f + 0.5f * sinf(lifetime[ii]._age);
+			tint[ii]._rgba[3] = expf(-0.1f * lifetime[ii]._age);
+		}
+	}
+};
+
+// reads Lifetime, writes Health
+class RegenSystem : public System
+{
+public:
+	RegenSystem() { reads<Lifetime>(); writes<Health>(); buildQuery(); }
+
+	virtual void updateChunk(const ChunkView& chunk, float dt) override
+	{
+		const Lifetime* lifetime = chunk.get<Lifetime>();
+		Health* health = chunk.get<Health>();
+		for (uint32_t ii = 0; ii < chunk._count; ++ii)
+		{
+			const float regen = 2.0f * dt / (1.0f + lifetime[ii]._age);
+			health[ii]._value = fminf(100.0f, health[ii]._value + regen);
+		}
+	}
+};
+
+// every entity moves, spins and ages; every other one also takes damage
+static void build(EntityManager& manager)
+{
+	for (uint32_t ii = 0; ii < k_entity_count; ++ii)
+	{
+		const Entity entity = manager.create();
+		const float f = (float)ii;
+		const Position position = { { fmodf(f, 100.0f), 0.0f, f / 100.0f } };
+		const Velocity velocity = { { sinf(f), 0.0f, cosf(f) } };
+		const Acceleration acceleration = { { 0.0f, -9.81f, 0.1f * sinf(f * 0.3f) } };
+		const Rotation rotation = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		const AngularVelocity angular = { { 0.1f * sinf(f * 0.7f), 1.0f, 0.0f } };
+		const Lifetime lifetime = { fmodf(f, 10.0f) };
+		manager.addComponent(entity, position);
+		manager.addComponent(entity, velocity);
+		manager.addComponent(entity, acceleration);
+		manager.addComponent(entity, rotation);
+		manager.addComponent(entity, angular);
+		manager.addComponent(entity, Bounds());
+		manager.addComponent(entity, Heading());
+		manager.addComponent(entity, lifetime);
+		manager.addComponent(entity, Tint());
+		if (0 == ii % 2)
+		{
+			const Health health = { 100.0f };
+			const Damage damage = { 1.0f + fmodf(f, 5.0f) };
+			manager.addComponent(entity, health);
+			manager.addComponent(entity, damage);
+		}
+	}
+}
+
+static double computeChecksum(const EntityManager& manager)
+{
+	double checksum = 0.0;
+	manager.forEach<Bounds, Heading>([&checksum](Entity, const Bounds& bounds, const Heading& heading)
+	{
+		checksum += bounds._min[0] + bounds._max[1] + bounds._min[2] + heading._yaw;
+	});
+	manager.forEach<Tint, Health>([&checksum](Entity, const Tint& tint, const Health& health)
+	{
+		checksum += tint._rgba[0] + tint._rgba[2] + tint._rgba[3] + health._value;
+	});
+	return checksum;
+}
+
+// queries cache the archetypes of the manager they ran on, so each run gets its own
+struct Systems
+{
+	AccelerateSystem _accelerate;
+	DragSystem _drag;
+	MoveSystem _move;
+	SpinSystem _spin;
+	BoundsSystem _bounds;
+	HeadingSystem _heading;
+	DamageSystem _damage;
+	AgeSystem _age;
+	FadeSystem _fade;
+	RegenSystem _regen;
+
+	static const uint32_t k_count = 10;
+
+	void addTo(SystemScheduler& scheduler)
+	{
+		System* systems[k_count] = { &_accelerate, &_drag, &_move, &_spin, &_bounds, &_heading, &_damage, &_age, &_fade, &_regen };
+		for (System* system : systems)
+		{
+			scheduler.addSystem(system);
+		}
+	}
+};
+
+int main(int /*argc*/, char** /*argv*/)
+{
+	const uint32_t core_count = std::thread::hardware_concurrency();
+	printf("%u cores; %u entities, %u systems, %u frames\n", core_count, k_entity_count, Systems::k_count, k_frame_count);
+
+	// 0 workers runs the jobs on the calling thread
+	const uint32_t max_workers = core_count > 4 ? core_count - 1 : 3;
+	double single_ms = 0.0;
+	double single_checksum = 0.0;
+	int result = 0;
+	for (uint32_t workers = 0; workers <= max_workers; ++workers)
+	{
+		JobSystem job_system;
+		if (0 < workers)
+		{
+			job_system.initialize(workers);
+		}
+
+		EntityManager manager;
+		build(manager);
+
+		Systems systems;
+		SystemScheduler scheduler(&job_system);
+		systems.addTo(scheduler);
+
+		const int64_t start = bx::getHPCounter();
+		for (uint32_t frame = 0; frame < k_frame_count; ++frame)
+		{
+			scheduler.update(manager, k_dt);
+		}
+		const double ms = double(bx::getHPCounter() - start) * 1e3 / double(bx::getHPFrequency()) / k_frame_count;
+		const double checksum = computeChecksum(manager);
+
+		if (0 == workers)
+		{
+			single_ms = ms;
+			single_checksum = checksum;
+		}
+
+		const bool is_same = checksum == single_checksum;
+		printf("%u workers: %.3f ms/frame, %.2fx, checksum %s\n", workers, ms, single_ms / ms, is_same ? "same" : "DIFFERENT");
+		result |= is_same ? 0 : 1;
+
+		job_system.shutdown();
+	}
+
+	return result;
+}